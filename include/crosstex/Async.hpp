@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <memory>
+
+#include "Surface.hpp"
+
+
+namespace Tex
+{
+//-------------------------------------------------------------------------------------
+// Job system integration
+//
+// The Async variants of EncodeSurface and DecodeSurface cut the surface into
+// tasks of a few blocks or block rows and hand them to a submitter of the
+// caller's job system instead of the internal thread pool, then return without
+// waiting. Every task checks for cancellation before its batch of blocks. The
+// handle reports progress and cancels; the completion callback runs once, on the
+// thread that finishes the last task. Source and destination buffers must stay
+// valid until then.
+//-------------------------------------------------------------------------------------
+
+// Schedules task(i) for every i in [0, count), on any threads and in any order. It
+// may run the tasks inline or return before they start.
+typedef std::function<void(size_t count, std::function<void(size_t index)> task)> BC_TASK_SUBMITTER;
+
+enum BC_ASYNC_STATUS
+{
+    BC_ASYNC_RUNNING = 0,
+    BC_ASYNC_DONE,          // Every block was processed
+    BC_ASYNC_CANCELLED,     // Cancel stopped the work early, the output is incomplete
+};
+
+// Receives BC_ASYNC_DONE or BC_ASYNC_CANCELLED when the last task finishes
+typedef std::function<void(BC_ASYNC_STATUS status)> BC_ASYNC_CALLBACK;
+
+class AsyncHandle
+{
+public:
+    // Not attached to any work, reports BC_ASYNC_DONE
+    AsyncHandle();
+
+    // BC_ASYNC_RUNNING until the completion callback has returned
+    BC_ASYNC_STATUS GetStatus() const;
+
+    // Fraction of the work processed so far, from 0 to 1
+    float GetProgress() const;
+
+    // Asks the remaining tasks to return without processing their blocks. Tasks
+    // already running finish their batch. Returns immediately.
+    void Cancel();
+
+    // Blocks until the completion callback has returned. Only call it from a
+    // thread the tasks do not depend on.
+    BC_ASYNC_STATUS Wait() const;
+
+private:
+    friend class AsyncJob;
+    struct State;
+    std::shared_ptr<State> m_pState;
+};
+
+//-------------------------------------------------------------------------------------
+// Functions
+//
+// Same results as the synchronous versions. Without a submitter the tasks run
+// inline before the call returns.
+//-------------------------------------------------------------------------------------
+
+AsyncHandle EncodeSurfaceAsync(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete = nullptr);
+
+AsyncHandle EncodeSurfaceAsync(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete = nullptr);
+
+AsyncHandle EncodeSurfaceAsync(BC_FORMAT format, const uint16_t *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete = nullptr);
+
+AsyncHandle DecodeSurfaceAsync(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    HDRColorA *pDst, size_t dstRowPitch, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete = nullptr);
+
+AsyncHandle DecodeSurfaceAsync(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    uint16_t *pDst, size_t dstRowPitch, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete = nullptr);
+
+AsyncHandle DecodeSurfaceAsync(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    LDRColorA *pDst, size_t dstRowPitch, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete = nullptr);
+
+}; // namespace
@@ -23,6 +23,17 @@ enum BC_FLAGS
     BC_FLAGS_UNIFORM            = 0x40000,  // By default, uses perceptual weighting for BC1-3; this flag makes it a uniform weighting
     BC_FLAGS_USE_3SUBSETS       = 0x80000,  // By default, BC7 skips mode 0 & 2; this flag adds those modes back
     BC_FLAGS_FORCE_BC7_MODE6    = 0x100000, // BC7 should only use mode 6; skip other modes
+
+    // BC7 search effort, one of the values below. Scales the partition shapes refined,
+    // the endpoint perturbation radius and the number of endpoint optimization passes.
+    // Normal is the default and matches DirectXTex. BC6H only honors the fast level.
+    BC_FLAGS_EFFORT_NORMAL      = 0x0,
+    BC_FLAGS_EFFORT_FAST        = 0x200000, // Scores the shapes closest to a pixel clustering, refines the best with a narrow radius
+    BC_FLAGS_EFFORT_SLOW        = 0x400000, // Refines twice the shapes with a second endpoint pass
+    BC_FLAGS_EFFORT_EXHAUSTIVE  = 0x600000, // Refines every shape, wider perturbation, up to four endpoint passes
+    BC_FLAGS_EFFORT_MASK        = 0x600000,
+
+    BC_FLAGS_NO_BLOCK_CACHE     = 0x800000, // EncodeSurface encodes every block, even repeats of a block already compressed
 };
 
 //-------------------------------------------------------------------------------------
@@ -31,6 +42,7 @@ enum BC_FLAGS
 
 typedef void (*BC_DECODE)(HDRColorA *pColor, const uint8_t *pBC);
 typedef void (*BC_ENCODE)(uint8_t *pDXT, const HDRColorA *pColor, uint32_t flags);
+typedef void (*BC_ENCODE_LDR)(uint8_t *pDXT, const LDRColorA *pColor, uint32_t flags);
 
 void DecodeBC1(HDRColorA *pColor, const uint8_t *pBC);
 void DecodeBC2(HDRColorA *pColor, const uint8_t *pBC);
@@ -59,4 +71,81 @@ void EncodeBC6HU(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags);
 void EncodeBC6HS(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags);
 void EncodeBC7(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags);
 
+// RGBA8 input. A block of 16 LDRColorA has the same layout as 64 bytes of RGBA8
+// texels, so byte buffers can be passed with a reinterpret_cast. The result is
+// identical to encoding LDRColorA::ToHDRColorA() of every texel.
+void EncodeBC1(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags);
+void EncodeBC1(uint8_t *pBC, const LDRColorA *pColor, float threshold, uint32_t flags);
+void EncodeBC2(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags);
+void EncodeBC3(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags);
+void EncodeBC7(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags);
+
+// RGBA16F input/output, 4 half floats per texel. Alpha is ignored when encoding
+// and set to 1.0 when decoding.
+void DecodeBC6HU(uint16_t *pColor, const uint8_t *pBC);
+void DecodeBC6HS(uint16_t *pColor, const uint8_t *pBC);
+void EncodeBC6HU(uint8_t *pBC, const uint16_t *pColor, uint32_t flags);
+void EncodeBC6HS(uint8_t *pBC, const uint16_t *pColor, uint32_t flags);
+
+// Warm started BC6H/BC7 encoding, for blocks whose texels changed a little since
+// they were last encoded. pSeedBC is that earlier block in the same format and may
+// be pBC itself. Its mode, partition shape and endpoints are refined first. The
+// mode search is skipped when the result is close enough: for BC6H when the error
+// left is small next to the spread of the texels, for BC7 when refitting gains
+// little over the seed and a mode 6 fit does no better. A BC7 block never ends up
+// decoding worse than its seed.
+void EncodeBC6HUSeeded(uint8_t *pBC, const HDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags);
+void EncodeBC6HSSeeded(uint8_t *pBC, const HDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags);
+void EncodeBC6HUSeeded(uint8_t *pBC, const uint16_t *pColor, const uint8_t *pSeedBC, uint32_t flags);
+void EncodeBC6HSSeeded(uint8_t *pBC, const uint16_t *pColor, const uint8_t *pSeedBC, uint32_t flags);
+void EncodeBC7Seeded(uint8_t *pBC, const HDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags);
+void EncodeBC7Seeded(uint8_t *pBC, const LDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags);
+
+// BC6H row decoding into RGBA16F or RGBA32F texels, same layout as DecodeBC1Row
+// with rowPitch in bytes. Alpha is 1.0, every texel equals the single block result.
+void DecodeBC6HURow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC6HSRow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC6HURow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC6HSRow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+// RGBA8 output for BC1-3, each texel equal to the float decoder's result converted
+// with uint8_t(x * 255.0f + 0.5f). The row forms decode nBlocks consecutive blocks
+// lying side by side: block i fills texels 4 * i to 4 * i + 3 of the 4 rows starting
+// at pDst, rowPitch bytes apart.
+void DecodeBC1(LDRColorA *pColor, const uint8_t *pBC);
+void DecodeBC2(LDRColorA *pColor, const uint8_t *pBC);
+void DecodeBC3(LDRColorA *pColor, const uint8_t *pBC);
+void DecodeBC1Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC2Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC3Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+// RGBA8 output for BC7, the texels the float decoder converts to float. The row
+// form has the layout of DecodeBC1Row.
+void DecodeBC7(LDRColorA *pColor, const uint8_t *pBC);
+void DecodeBC7Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+// Row decoding of BC4/BC5 into single channel R or interleaved RG texels, same
+// layout as DecodeBC1Row. Float output equals DecodeBC4U and friends, integer
+// output is that value rounded to UNORM/SNORM of the destination type.
+void DecodeBC4URow(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC4URow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC4URow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC4SRow(int8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC4SRow(int16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC4SRow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC5URow(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC5URow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC5URow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC5SRow(int8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC5SRow(int16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC5SRow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+// Batched BC4/BC5 encoding of nBlocks consecutive blocks from planar input. Each
+// plane holds 16 texels per block in row order, block after block; BC5 takes its
+// red and green planes separately. Results match the single block encoders.
+void EncodeBC4UBatch(uint8_t *pBC, const float *pRed, size_t nBlocks, uint32_t flags);
+void EncodeBC4SBatch(uint8_t *pBC, const float *pRed, size_t nBlocks, uint32_t flags);
+void EncodeBC5UBatch(uint8_t *pBC, const float *pRed, const float *pGreen, size_t nBlocks, uint32_t flags);
+void EncodeBC5SBatch(uint8_t *pBC, const float *pRed, const float *pGreen, size_t nBlocks, uint32_t flags);
+
 }; // namespace
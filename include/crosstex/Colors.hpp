@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include <cassert>
 #include <algorithm>
 
@@ -14,6 +15,7 @@ const uint16_t F16E_MASK = 0x7c00;   // f16 exponent mask
 const uint16_t F16M_MASK = 0x03FF;   // f16 mantissa mask
 const uint16_t F16EM_MASK = 0x7fff;   // f16 exp & mantissa mask
 const uint16_t F16MAX = 0x7bff;   // MAXFLT bit pattern for XMHALF
+const uint16_t F16ONE = 0x3c00;   // 1.0 as a half float
 
 const uint32_t F32E_MASK = 0x7f800000;
 
@@ -414,6 +416,7 @@ public:
     INTColor() = default;
     INTColor(int r_, int g_, int b_) : r(r_), g(g_), b(b_) {}
     INTColor(const INTColor& c) : r(c.r), g(c.g), b(c.b) {}
+    INTColor& operator=(const INTColor& c) = default;
 
     INTColor operator+(const INTColor& c) const
     {
@@ -577,8 +580,8 @@ public:
         HDRColorA c_hdr;
 
         c_hdr.r = INT2Float(r, bSigned);
-        c_hdr.g = INT2Float(r, bSigned);
-        c_hdr.b = INT2Float(r, bSigned);
+        c_hdr.g = INT2Float(g, bSigned);
+        c_hdr.b = INT2Float(b, bSigned);
         c_hdr.a = 1.0f;
         return c_hdr;
     }
@@ -594,6 +597,25 @@ public:
         return c_int;
     }
 
+    // pHalf points to the r, g and b half floats of one texel
+    static INTColor FromHalf(const uint16_t* pHalf, bool bSigned)
+    {
+        INTColor c_int;
+
+        c_int.r = HalfToINT(pHalf[0], bSigned);
+        c_int.g = HalfToINT(pHalf[1], bSigned);
+        c_int.b = HalfToINT(pHalf[2], bSigned);
+
+        return c_int;
+    }
+
+    void ToHalf(uint16_t* pHalf, bool bSigned) const
+    {
+        pHalf[0] = INT2Half(r, bSigned);
+        pHalf[1] = INT2Half(g, bSigned);
+        pHalf[2] = INT2Half(b, bSigned);
+    }
+
     void SignExtend(const LDRColorA& prec)
     {
         r = SIGN_EXTEND(r, prec.r);
@@ -603,11 +625,19 @@ public:
 
     static int FloatToINT(float f, bool bSigned)
     {
-        uint32_t f32 = *reinterpret_cast<uint32_t*>(&f);
-        uint16_t f16 = (f32 >> 16) & F16S_MASK;
-        f16 |= (((f32 & F32E_MASK) - 0x38000000) >> 13) & F16E_MASK;
-        f16 |= (f32 >> 13) & F16M_MASK;
+        return HalfToINT(FloatToHalf(f), bSigned);
+    }
+
+    static float INT2Float(int input, bool bSigned)
+    {
+        return HalfToFloat(INT2Half(input, bSigned));
+    }
 
+    // Maps a half float bit pattern to the integer domain used by BC6H: the
+    // magnitude bits, negated for negative values in signed mode. Values that
+    // can't be represented are clamped.
+    static int HalfToINT(uint16_t f16, bool bSigned)
+    {
         int out;
         if (bSigned)
         {
@@ -624,6 +654,8 @@ public:
         {
             if (f16 & F16S_MASK) {
                 out = 0;
+            } else if (f16 > F16MAX) {
+                out = F16MAX;
             } else {
                 out = f16;
             }
@@ -631,7 +663,7 @@ public:
         return out;
     }
 
-    static float INT2Float(int input, bool bSigned)
+    static uint16_t INT2Half(int input, bool bSigned)
     {
         uint16_t out;
         if (bSigned)
@@ -649,11 +681,75 @@ public:
             assert(input >= 0 && input <= F16MAX);
             out = (uint16_t)input;
         }
+        return out;
+    }
+
+    static float HalfToFloat(uint16_t f16)
+    {
+        uint32_t uMantissa = f16 & F16M_MASK;
+        uint32_t uExponent = (f16 & F16E_MASK) >> 10;
+        uint32_t f32 = uint32_t(f16 & F16S_MASK) << 16;
+
+        if (uExponent == 0x1f)
+        {
+            // Infinity or NaN
+            f32 |= F32E_MASK | (uMantissa << 13);
+        }
+        else if (uExponent != 0)
+        {
+            f32 |= ((uExponent + 112) << 23) | (uMantissa << 13);
+        }
+        else if (uMantissa != 0)
+        {
+            // Denormal, renormalize it for the float
+            uExponent = 113;
+            while (!(uMantissa & 0x400))
+            {
+                uMantissa <<= 1;
+                --uExponent;
+            }
+            f32 |= (uExponent << 23) | ((uMantissa & F16M_MASK) << 13);
+        }
+
+        float f;
+        memcpy(&f, &f32, sizeof(f));
+        return f;
+    }
 
-        uint32_t f32 = (out & F16S_MASK) << 16;
-        f32 |= ((out & F16E_MASK) + 0x1C000) << 13;
-        f32 |= (out & F16M_MASK) << 13;
-        return *reinterpret_cast<float*>(&f32);
+    // Round to nearest even, overflow goes to infinity
+    static uint16_t FloatToHalf(float f)
+    {
+        uint32_t f32;
+        memcpy(&f32, &f, sizeof(f32));
+        uint32_t uSign = (f32 >> 16) & F16S_MASK;
+        f32 &= 0x7fffffff;
+
+        uint32_t uResult;
+        if (f32 >= 0x47800000)
+        {
+            // Too large for a half, keep NaNs as NaNs
+            uResult = F16E_MASK | ((f32 > F32E_MASK) ? (0x200 | ((f32 >> 13) & F16M_MASK)) : 0);
+        }
+        else if (f32 <= 0x33000000)
+        {
+            uResult = 0;
+        }
+        else if (f32 < 0x38800000)
+        {
+            // Too small for a normalized half, produce a denormal
+            uint32_t uShift = 125 - (f32 >> 23);
+            f32 = 0x800000 | (f32 & 0x7fffff);
+            uResult = f32 >> (uShift + 1);
+            uint32_t uSticky = (f32 & ((1u << uShift) - 1)) != 0;
+            uResult += (uResult | uSticky) & ((f32 >> uShift) & 1);
+        }
+        else
+        {
+            // Rebias the exponent
+            f32 += 0xC8000000;
+            uResult = ((f32 + 0x0fff + ((f32 >> 13) & 1)) >> 13) & F16EM_MASK;
+        }
+        return uint16_t(uResult | uSign);
     }
 };
 
@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+#include "Surface.hpp"
+
+
+namespace Tex
+{
+class MappedFile;
+
+//-------------------------------------------------------------------------------------
+// Functions
+//
+// Surfaces follow the header item by item, each item holding its mip chain from
+// the top level down. Every surface is tightly packed exactly as EncodeSurface
+// writes and DecodeSurface reads them.
+//-------------------------------------------------------------------------------------
+
+// Header size in bytes, 148 when the DX10 extension is needed and 128 otherwise.
+// BC6H, BC7, sRGB formats and texture arrays need the extension.
+size_t GetDDSHeaderSize(const TextureDesc& desc);
+
+// Size of the whole file in bytes, 0 when desc is not a valid layout
+size_t ComputeDDSSize(const TextureDesc& desc);
+
+// Offset of one surface from the start of the file
+size_t GetDDSSurfaceOffset(const TextureDesc& desc, size_t item, size_t level);
+
+// Writes the GetDDSHeaderSize(desc) header bytes to pDst, returns their number
+// or 0 when desc is not a valid layout
+size_t WriteDDSHeader(uint8_t *pDst, const TextureDesc& desc);
+
+// Parses the header of a size byte DDS file. Fails for anything but block
+// compressed 2D textures and files too short for all their surfaces. A missing
+// mip count is read as a single level.
+bool ReadDDSHeader(const uint8_t *pSrc, size_t size, TextureDesc& desc, size_t *pHeaderSize = nullptr);
+
+//-------------------------------------------------------------------------------------
+// Memory mapped DDS files
+//
+// The reader maps the file and hands out pointers to the surfaces in place, so
+// DecodeSurface reads the blocks straight from the page cache. The writer sizes
+// the file up front and hands out pointers into the writable mapping for
+// EncodeSurface to fill. Neither copies surfaces or issues write calls.
+//-------------------------------------------------------------------------------------
+
+class DDSReader
+{
+public:
+    DDSReader();
+    ~DDSReader();
+
+    DDSReader(const DDSReader&) = delete;
+    DDSReader& operator=(const DDSReader&) = delete;
+
+    // Maps the file at path and parses its header
+    bool Open(const char *path);
+    void Close();
+
+    const TextureDesc& GetDesc() const { return m_desc; }
+
+    // Compressed blocks of one surface, valid until Close
+    const uint8_t *GetSurface(size_t item, size_t level) const;
+
+private:
+    std::unique_ptr<MappedFile> m_pFile;
+    TextureDesc m_desc;
+};
+
+class DDSWriter
+{
+public:
+    DDSWriter();
+    ~DDSWriter();
+
+    DDSWriter(const DDSWriter&) = delete;
+    DDSWriter& operator=(const DDSWriter&) = delete;
+
+    // Creates the file at path with its header and room for every surface
+    bool Create(const char *path, const TextureDesc& desc);
+
+    // Unmaps and closes the file, false if it could not be written back
+    bool Close();
+
+    // The desc passed to Create, with mipLevels = 0 resolved to the full chain
+    const TextureDesc& GetDesc() const { return m_desc; }
+
+    // Destination of one surface for EncodeSurface, valid until Close
+    uint8_t *GetSurface(size_t item, size_t level);
+
+private:
+    std::unique_ptr<MappedFile> m_pFile;
+    TextureDesc m_desc;
+};
+
+}; // namespace
@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Surface.hpp"
+
+
+namespace Tex
+{
+class MappedFile;
+
+//-------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------
+
+enum KTX2_SUPERCOMPRESSION
+{
+    KTX2_SUPERCOMPRESSION_NONE = 0,
+    KTX2_SUPERCOMPRESSION_ZLIB = 3,     // Needs a build with zlib, see IsKTX2SupercompressionSupported
+};
+
+//-------------------------------------------------------------------------------------
+// KTX2 files
+//
+// Files hold a level index, a data format descriptor and the mip levels from the
+// smallest to the largest. Each level stores its surfaces item by item, the
+// items of a cube map array being the faces of every cube in turn. Surfaces are
+// tightly packed exactly as EncodeSurface writes and DecodeSurface reads them.
+//
+// Supercompressed files compress every level on its own, the levels are
+// compressed and expanded in parallel on the shared thread pool.
+//-------------------------------------------------------------------------------------
+
+// Whether this build can write and read files with the given scheme
+bool IsKTX2SupercompressionSupported(KTX2_SUPERCOMPRESSION scheme);
+
+// Memory maps uncompressed files and hands out surface pointers in place,
+// supercompressed files are expanded into memory when they are opened
+class KTX2Reader
+{
+public:
+    KTX2Reader();
+    ~KTX2Reader();
+
+    KTX2Reader(const KTX2Reader&) = delete;
+    KTX2Reader& operator=(const KTX2Reader&) = delete;
+
+    // Fails for anything but block compressed 2D textures, unsupported
+    // supercompression schemes and damaged files
+    bool Open(const char *path, size_t threadCount = 0);
+    void Close();
+
+    const TextureDesc& GetDesc() const { return m_desc; }
+    KTX2_SUPERCOMPRESSION GetSupercompression() const { return m_scheme; }
+
+    // Compressed blocks of one surface, valid until Close
+    const uint8_t *GetSurface(size_t item, size_t level) const;
+
+private:
+    std::unique_ptr<MappedFile> m_pFile;
+    std::vector<uint8_t> m_aExpanded;
+    std::vector<size_t> m_aLevelOffsets;
+    const uint8_t *m_pLevels;
+    TextureDesc m_desc;
+    KTX2_SUPERCOMPRESSION m_scheme;
+};
+
+// Without supercompression the file is created at its final size and mapped, so
+// EncodeSurface writes straight into it. Otherwise the surfaces are gathered in
+// memory and Close compresses the levels and writes the file.
+class KTX2Writer
+{
+public:
+    KTX2Writer();
+    ~KTX2Writer();
+
+    KTX2Writer(const KTX2Writer&) = delete;
+    KTX2Writer& operator=(const KTX2Writer&) = delete;
+
+    // compressionLevel is passed on to the supercompressor, -1 picks its default
+    bool Create(const char *path, const TextureDesc& desc,
+        KTX2_SUPERCOMPRESSION scheme = KTX2_SUPERCOMPRESSION_NONE, int compressionLevel = -1);
+
+    // Supercompresses the levels on up to threadCount threads and finishes the
+    // file, false if it could not be written. A partly written file is removed.
+    bool Close(size_t threadCount = 0);
+
+    // The desc passed to Create, with mipLevels = 0 resolved to the full chain
+    const TextureDesc& GetDesc() const { return m_desc; }
+
+    // Destination of one surface for EncodeSurface, valid until Close
+    uint8_t *GetSurface(size_t item, size_t level);
+
+private:
+    std::unique_ptr<MappedFile> m_pFile;
+    std::vector<uint8_t> m_aLevels;
+    std::vector<size_t> m_aLevelOffsets;
+    uint8_t *m_pLevels;
+    std::string m_path;
+    TextureDesc m_desc;
+    KTX2_SUPERCOMPRESSION m_scheme;
+    int m_compressionLevel;
+};
+
+}; // namespace
@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Surface.hpp"
+
+
+namespace Tex
+{
+//-------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------
+
+enum MIP_FILTER
+{
+    MIP_FILTER_BOX = 0,     // Average of the texels under each output texel
+    MIP_FILTER_KAISER,      // Kaiser windowed sinc, 6 output texels wide, 12 taps at 2:1, sharper than box
+    MIP_FILTER_LANCZOS,     // Lanczos 3, sharpest, can ring at hard edges
+};
+
+enum MIP_FLAGS
+{
+    MIP_FLAGS_NONE  = 0x0,
+    MIP_FLAGS_SRGB  = 0x1,  // RGB is sRGB encoded, levels are filtered in linear light and encoded back
+    MIP_FLAGS_WRAP  = 0x2,  // Filters wrap around the edges instead of clamping, for tiling textures
+};
+
+//-------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------
+
+// Generates the mip chain of an image and compresses every level into
+// apDst[level], tightly packed like EncodeSurface writes them. mipLevels = 0
+// generates the full chain down to 1x1. Level 0 is compressed from pSrc as is.
+//
+// The work is one pass per level on the shared pool: each block row of level N
+// is compressed and filtered into the rows of level N + 1 it covers while its
+// texels are in cache, so the encode of level N overlaps with filtering level
+// N + 1 and only two levels are held in memory as floats. Alpha is filtered as
+// is, without weighting the colors.
+void EncodeMipChain(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t mipLevels, uint8_t *const apDst[], MIP_FILTER filter,
+    uint32_t mipFlags, uint32_t flags, size_t threadCount = 0);
+
+// RGBA8 source. The generated levels are rounded to 8 bits before compression,
+// the way a separately downsampled RGBA8 chain would be.
+void EncodeMipChain(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t mipLevels, uint8_t *const apDst[], MIP_FILTER filter,
+    uint32_t mipFlags, uint32_t flags, size_t threadCount = 0);
+
+}; // namespace
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <memory>
+
+#include "Surface.hpp"
+
+
+namespace Tex
+{
+//-------------------------------------------------------------------------------------
+// Streaming band encoder
+//
+// Compresses an image that arrives a few scanlines at a time. Every completed
+// band of 4 rows is handed to an encoder thread, which compresses its blocks in
+// parallel on the shared pool and passes them on to the sink in band order, while
+// the caller keeps adding rows. At most maxBands bands are held at once, so
+// memory grows with the width of the image only; AddRows waits while all of them
+// are still queued for encoding.
+//-------------------------------------------------------------------------------------
+
+// Receives the compressed blocks of one band, bands arrive in order on the
+// encoder thread. size is the width in blocks times the block size.
+typedef std::function<void(size_t band, const uint8_t *pBlocks, size_t size)> BC_BAND_SINK;
+
+// Color is HDRColorA or LDRColorA, the texel type of the rows passed in
+template <typename Color>
+class StreamEncoder
+{
+public:
+    StreamEncoder(BC_FORMAT format, size_t width, uint32_t flags, const BC_BAND_SINK& sink,
+        size_t threadCount = 0, size_t maxBands = 4);
+
+    // Finishes the image if Finish was not called
+    ~StreamEncoder();
+
+    StreamEncoder(const StreamEncoder&) = delete;
+    StreamEncoder& operator=(const StreamEncoder&) = delete;
+
+    // Appends rows of width texels, rowPitch bytes apart
+    void AddRows(const Color *pSrc, size_t rows, size_t rowPitch);
+
+    // Encodes the last band, padding it like EncodeSurface pads the bottom
+    // edge, and returns once the sink has received every band
+    void Finish();
+
+private:
+    struct State;
+    std::unique_ptr<State> m_pState;
+};
+
+typedef StreamEncoder<HDRColorA> StreamEncoderHDR;
+typedef StreamEncoder<LDRColorA> StreamEncoderLDR;
+
+}; // namespace
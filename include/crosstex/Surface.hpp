@@ -0,0 +1,144 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BC.hpp"
+
+
+namespace Tex
+{
+//-------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------
+
+enum BC_FORMAT
+{
+    BC_FORMAT_UNKNOWN = 0,
+    BC_FORMAT_BC1,
+    BC_FORMAT_BC2,
+    BC_FORMAT_BC3,
+    BC_FORMAT_BC4U,
+    BC_FORMAT_BC4S,
+    BC_FORMAT_BC5U,
+    BC_FORMAT_BC5S,
+    BC_FORMAT_BC6HU,
+    BC_FORMAT_BC6HS,
+    BC_FORMAT_BC7,
+};
+
+// Layout of a block compressed 2D texture in a container file
+struct TextureDesc
+{
+    BC_FORMAT format;
+    size_t width;
+    size_t height;
+    size_t mipLevels;       // Levels per array item, 0 stands for the full chain down to 1x1
+    size_t arraySize;       // Array items, a cube map counts one item per face
+    bool cubeMap;           // Items are cube faces, 6 per cube in +X -X +Y -Y +Z -Z order
+    bool srgb;              // Stored with an sRGB format, BC1-3 and BC7 only
+};
+
+// Rectangle of texels, used to mark the parts of an image that changed
+struct SurfaceRect
+{
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+};
+
+// Filled in by EncodeSurface when requested
+struct SurfaceStats
+{
+    size_t blocks;          // Blocks in the surface
+    size_t cachedBlocks;    // Blocks copied from an identical block encoded earlier
+};
+
+//-------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------
+
+// Size of one compressed 4x4 block in bytes, 0 for unknown formats
+size_t GetBlockSize(BC_FORMAT format);
+
+// Size of a tightly packed compressed surface in bytes
+size_t ComputeSurfaceSize(BC_FORMAT format, size_t width, size_t height);
+
+// Number of levels of a full mip chain down to 1x1, each level halving the size
+// of the previous one rounded down
+size_t ComputeMipLevels(size_t width, size_t height);
+
+// Compresses a whole image. Blocks are written row by row without padding between
+// block rows. Partial blocks at the right and bottom edges are padded by
+// replicating the last column/row. rowPitch is the distance between source rows
+// in bytes. threadCount = 0 uses one thread per hardware thread.
+// Blocks whose texels repeat an earlier block are copied from its compressed
+// result unless BC_FLAGS_NO_BLOCK_CACHE is set; the output is the same either way.
+void EncodeSurface(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, size_t threadCount = 0,
+    SurfaceStats *pStats = nullptr);
+
+// RGBA8 source. BC1-3 and BC7 consume the texels directly, the other formats
+// widen each block to HDRColorA first.
+void EncodeSurface(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, size_t threadCount = 0,
+    SurfaceStats *pStats = nullptr);
+
+// RGBA16F source, 4 half floats per texel. BC6H consumes the halves directly,
+// the other formats widen each block to HDRColorA first.
+void EncodeSurface(BC_FORMAT format, const uint16_t *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, size_t threadCount = 0,
+    SurfaceStats *pStats = nullptr);
+
+// Re-encodes the blocks of a compressed surface that any of the dirty rectangles
+// touch and leaves the others as they are, for images edited in place. pBlocks
+// holds what EncodeSurface wrote for the image before the edit. BC6H and BC7
+// blocks are encoded with the seeded encoders, starting from their previous
+// contents, so blocks that barely changed skip the mode search; the other formats
+// encode the blocks afresh. Rectangles may overlap and reach past the image.
+void UpdateSurface(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, uint32_t flags,
+    size_t threadCount = 0);
+
+// RGBA8 source
+void UpdateSurface(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, uint32_t flags,
+    size_t threadCount = 0);
+
+// RGBA16F source, 4 half floats per texel
+void UpdateSurface(BC_FORMAT format, const uint16_t *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, uint32_t flags,
+    size_t threadCount = 0);
+
+// Rewrites BC1, BC3 or BC7 blocks produced by EncodeSurface from the same source
+// so that they repeat endpoint and index bytes of recently emitted blocks, which
+// makes the surface compress better with an LZ coder such as zlib or zstd at some
+// loss of quality. Each block is replaced by the candidate with the lowest squared
+// error plus lambda times its estimated size in bits, taken over copies of and
+// mixes with the 64 blocks before it. lambda = 0 leaves the blocks as they are,
+// values of about 1 to 10 trade a fraction of a dB for noticeably smaller files.
+// Other formats are left unchanged. The result does not depend on threadCount.
+void OptimizeSurfaceRDO(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, float lambda, size_t threadCount = 0);
+
+// RGBA8 source
+void OptimizeSurfaceRDO(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, float lambda, size_t threadCount = 0);
+
+// Expands a tightly packed compressed surface into a pitched image. Texels of edge
+// blocks that fall outside width x height are dropped. dstRowPitch is the distance
+// between destination rows in bytes. BC6H decodes whole block rows in place.
+void DecodeSurface(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    HDRColorA *pDst, size_t dstRowPitch, size_t threadCount = 0);
+
+// RGBA16F destination, 4 half floats per texel. BC6H decodes whole block rows in
+// place, the other formats narrow HDRColorA blocks.
+void DecodeSurface(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    uint16_t *pDst, size_t dstRowPitch, size_t threadCount = 0);
+
+// RGBA8 destination. BC1-3 and BC7 decode whole block rows in place with the
+// integer decoders, the other formats are clamped to [0, 1] and rounded.
+void DecodeSurface(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    LDRColorA *pDst, size_t dstRowPitch, size_t threadCount = 0);
+
+}; // namespace
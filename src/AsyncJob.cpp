@@ -0,0 +1,136 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "AsyncJob.hpp"
+
+
+namespace Tex {
+
+struct AsyncHandle::State
+{
+    size_t uTotal;
+    std::atomic<size_t> uProcessed;
+    std::atomic<size_t> uTasksLeft;
+    std::atomic<bool> bCancel;
+    std::atomic<bool> bSkipped;
+    BC_ASYNC_CALLBACK onComplete;
+
+    std::mutex mutex;
+    std::condition_variable doneCV;
+    BC_ASYNC_STATUS status;
+
+    void Finish();
+};
+
+void AsyncHandle::State::Finish()
+{
+    const BC_ASYNC_STATUS final = bSkipped.load() ? BC_ASYNC_CANCELLED : BC_ASYNC_DONE;
+    if (onComplete)
+        onComplete(final);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        status = final;
+    }
+    doneCV.notify_all();
+}
+
+AsyncHandle::AsyncHandle()
+{
+}
+
+BC_ASYNC_STATUS AsyncHandle::GetStatus() const
+{
+    if (!m_pState)
+        return BC_ASYNC_DONE;
+
+    std::lock_guard<std::mutex> lock(m_pState->mutex);
+    return m_pState->status;
+}
+
+float AsyncHandle::GetProgress() const
+{
+    if (!m_pState || m_pState->uTotal == 0)
+        return 1.0f;
+    return float(m_pState->uProcessed.load(std::memory_order_relaxed)) / float(m_pState->uTotal);
+}
+
+void AsyncHandle::Cancel()
+{
+    if (m_pState)
+        m_pState->bCancel.store(true, std::memory_order_relaxed);
+}
+
+BC_ASYNC_STATUS AsyncHandle::Wait() const
+{
+    if (!m_pState)
+        return BC_ASYNC_DONE;
+
+    std::unique_lock<std::mutex> lock(m_pState->mutex);
+    m_pState->doneCV.wait(lock, [this]() { return m_pState->status != BC_ASYNC_RUNNING; });
+    return m_pState->status;
+}
+
+AsyncHandle AsyncJob::Start(size_t count, size_t grain, const ThreadPool::RangeFunc& func,
+    const BC_TASK_SUBMITTER& submitter, const BC_ASYNC_CALLBACK& onComplete)
+{
+    assert(grain > 0);
+    const size_t nTasks = (count + grain - 1) / grain;
+
+    AsyncHandle handle;
+    handle.m_pState = std::make_shared<AsyncHandle::State>();
+    AsyncHandle::State& s = *handle.m_pState;
+    s.uTotal = count;
+    s.uProcessed = 0;
+    s.uTasksLeft = nTasks;
+    s.bCancel = false;
+    s.bSkipped = false;
+    s.onComplete = onComplete;
+    s.status = BC_ASYNC_RUNNING;
+
+    if (nTasks == 0)
+    {
+        s.Finish();
+        return handle;
+    }
+
+    std::shared_ptr<AsyncHandle::State> pState = handle.m_pState;
+    std::function<void(size_t)> task = [pState, func, count, grain](size_t uTask)
+    {
+        assert(uTask * grain < count);
+        if (pState->bCancel.load(std::memory_order_relaxed))
+        {
+            pState->bSkipped.store(true, std::memory_order_relaxed);
+        }
+        else
+        {
+            const size_t uBegin = uTask * grain;
+            const size_t uEnd = std::min(count, uBegin + grain);
+            func(uBegin, uEnd);
+            pState->uProcessed.fetch_add(uEnd - uBegin, std::memory_order_relaxed);
+        }
+
+        // The last task sees the writes of all the others
+        if (pState->uTasksLeft.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            pState->Finish();
+    };
+
+    if (submitter)
+    {
+        submitter(nTasks, task);
+    }
+    else
+    {
+        for (size_t i = 0; i < nTasks; ++i)
+            task(i);
+    }
+
+    return handle;
+}
+
+} // namespace
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Async.hpp"
+#include "ThreadPool.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Tasks for a job system
+//
+// Runs the same range functions the ParallelFor paths use, one grain per task,
+// through a BC_TASK_SUBMITTER. The state the tasks share lives with the handle,
+// the last task to finish reports completion.
+//-------------------------------------------------------------------------------------
+
+class AsyncJob
+{
+public:
+    // Submits ceil(count / grain) tasks running func over consecutive grains of
+    // [0, count). A job with no items completes before returning.
+    static AsyncHandle Start(size_t count, size_t grain, const ThreadPool::RangeFunc& func,
+        const BC_TASK_SUBMITTER& submitter, const BC_ASYNC_CALLBACK& onComplete);
+};
+
+} // namespace
@@ -15,12 +15,17 @@ void DecodeBC1(HDRColorA *pColor, const uint8_t *pBC)
     DecodeBC1(pColor, pBC1, true);
 }
 
-void EncodeBC1(uint8_t *pBC, const HDRColorA *pColor, float threshold, uint32_t flags)
+void DecodeBC1(LDRColorA *pColor, const uint8_t *pBC)
 {
-    assert(pBC && pColor);
+    DecodeBC1Row(reinterpret_cast<uint8_t *>(pColor), 4 * sizeof(LDRColorA), pBC, 1);
+}
 
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+namespace {
 
+// Copies the block, diffusing the alpha quantization error over the neighbours
+// when alpha dithering is enabled
+void DitherAlpha(HDRColorA *Color, const HDRColorA *pColor, uint32_t flags)
+{
     if (flags & BC_FLAGS_DITHER_A)
     {
         float fError[NUM_PIXELS_PER_BLOCK];
@@ -67,6 +72,16 @@ void EncodeBC1(uint8_t *pBC, const HDRColorA *pColor, float threshold, uint32_t
             Color[i] = pColor[i];
         }
     }
+}
+
+}
+
+void EncodeBC1(uint8_t *pBC, const HDRColorA *pColor, float threshold, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    DitherAlpha(Color, pColor, flags);
 
     auto pBC1 = reinterpret_cast<Block_BC1 *>(pBC);
     EncodeBC1(pBC1, Color, true, threshold, flags);
@@ -77,4 +92,81 @@ void EncodeBC1(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
     EncodeBC1(pBC, pColor, 0.5f, flags);
 }
 
+void EncodeBC1(uint8_t *pBC, const LDRColorA *pColor, float threshold, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        Color[i] = pColor[i].ToHDRColorA();
+    }
+
+    // The error only ever travels forward, so dithering in place is safe
+    if (flags & BC_FLAGS_DITHER_A)
+        DitherAlpha(Color, Color, flags);
+
+    auto pBC1 = reinterpret_cast<Block_BC1 *>(pBC);
+    EncodeBC1(pBC1, Color, true, threshold, flags, pColor);
+}
+
+void EncodeBC1(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags)
+{
+    EncodeBC1(pBC, pColor, 0.5f, flags);
+}
+
+void EncodeBC1Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    HDRColorA Color[BC1_MAX_BATCH][NUM_PIXELS_PER_BLOCK];
+    Block_BC1 *ppBC1[BC1_MAX_BATCH];
+    const HDRColorA *ppColor[BC1_MAX_BATCH];
+
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
+        for (size_t j = 0; j < nGroup; ++j)
+        {
+            DitherAlpha(Color[j], pColor + (i + j) * NUM_PIXELS_PER_BLOCK, flags);
+            ppBC1[j] = reinterpret_cast<Block_BC1 *>(pBC) + i + j;
+            ppColor[j] = Color[j];
+        }
+
+        EncodeBC1Batch(ppBC1, ppColor, nullptr, nGroup, true, 0.5f, flags);
+    }
+}
+
+void EncodeBC1Blocks(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    HDRColorA Color[BC1_MAX_BATCH][NUM_PIXELS_PER_BLOCK];
+    Block_BC1 *ppBC1[BC1_MAX_BATCH];
+    const HDRColorA *ppColor[BC1_MAX_BATCH];
+    const LDRColorA *ppLDR[BC1_MAX_BATCH];
+
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
+        for (size_t j = 0; j < nGroup; ++j)
+        {
+            const LDRColorA *pBlock = pColor + (i + j) * NUM_PIXELS_PER_BLOCK;
+            for (size_t k = 0; k < NUM_PIXELS_PER_BLOCK; ++k)
+            {
+                Color[j][k] = pBlock[k].ToHDRColorA();
+            }
+
+            if (flags & BC_FLAGS_DITHER_A)
+                DitherAlpha(Color[j], Color[j], flags);
+
+            ppBC1[j] = reinterpret_cast<Block_BC1 *>(pBC) + i + j;
+            ppColor[j] = Color[j];
+            ppLDR[j] = pBlock;
+        }
+
+        EncodeBC1Batch(ppBC1, ppColor, ppLDR, nGroup, true, 0.5f, flags);
+    }
+}
+
 }
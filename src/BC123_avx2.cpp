@@ -0,0 +1,83 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <float.h>
+#include <immintrin.h>
+
+#include "BC123_simd.hpp"
+#include "DecodeBC123Lanes.hpp"
+#include "OptimizeRGBLanes.hpp"
+#include "VecAVX2.hpp"
+
+
+namespace Tex {
+
+void OptimizeRGBBatchAVX2(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags)
+{
+    for (size_t i = 0; i < nBlocks; i += VecAVX2::WIDTH)
+    {
+        const size_t n = (nBlocks - i < VecAVX2::WIDTH) ? nBlocks - i : VecAVX2::WIDTH;
+        OptimizeRGBLanes<VecAVX2>(pX + i, pY + i, ppPoints + i, pSteps + i, n, flags);
+    }
+}
+
+
+namespace {
+
+// Two blocks per register, one per 128-bit lane; 4 blocks per iteration give
+// every destination row 64 contiguous bytes
+inline __m256i ExpandRowPair(const DecodeBlock& b0, const DecodeBlock& b1, bool bAlpha, size_t y)
+{
+    const __m256i palette = _mm256_set_m128i(b1.palette, b0.palette);
+    const __m256i shuffle = _mm256_set_m128i(LoadRowShuffle(b1.bitmap, y), LoadRowShuffle(b0.bitmap, y));
+    __m256i row = _mm256_shuffle_epi8(palette, shuffle);
+    if (bAlpha)
+    {
+        const __m256i alpha = _mm256_set_m128i(b1.alpha, b0.alpha);
+        row = _mm256_or_si256(row, _mm256_shuffle_epi8(alpha, _mm256_broadcastsi128_si256(LoadRowAlphaShuffle(y))));
+    }
+    return row;
+}
+
+template <size_t BLOCK_SIZE, bool bAlpha, DecodeBlock (*pfnLoad)(const uint8_t *)>
+void DecodeRow(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    size_t i = 0;
+    for (; i + 4 <= nBlocks; i += 4, pBC += 4 * BLOCK_SIZE, pDst += 64)
+    {
+        const DecodeBlock aBlocks[4] = { pfnLoad(pBC), pfnLoad(pBC + BLOCK_SIZE),
+            pfnLoad(pBC + 2 * BLOCK_SIZE), pfnLoad(pBC + 3 * BLOCK_SIZE) };
+        for (size_t y = 0; y < 4; ++y)
+        {
+            auto pRow = reinterpret_cast<__m256i *>(pDst + y * rowPitch);
+            _mm256_storeu_si256(pRow, ExpandRowPair(aBlocks[0], aBlocks[1], bAlpha, y));
+            _mm256_storeu_si256(pRow + 1, ExpandRowPair(aBlocks[2], aBlocks[3], bAlpha, y));
+        }
+    }
+
+    for (; i < nBlocks; ++i, pBC += BLOCK_SIZE, pDst += 16)
+    {
+        const DecodeBlock block = pfnLoad(pBC);
+        for (size_t y = 0; y < 4; ++y)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + y * rowPitch), ExpandRow<bAlpha>(block, y));
+    }
+}
+
+}
+
+void DecodeBC1RowAVX2(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    DecodeRow<8, false, LoadBlockBC1>(pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC2RowAVX2(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    DecodeRow<16, true, LoadBlockBC2>(pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC3RowAVX2(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    DecodeRow<16, true, LoadBlockBC3>(pDst, rowPitch, pBC, nBlocks);
+}
+
+} // namespace
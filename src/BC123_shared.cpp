@@ -2,10 +2,14 @@
 #include <stddef.h>
 #include <string.h>
 #include <float.h>
+#include <math.h>
 
 #include "BC.hpp"
 #include "BC123_shared.hpp"
+#include "BC123_simd.hpp"
 #include "Colors.hpp"
+#include "CPUFeatures.hpp"
+#include "DecodeBC123.hpp"
 
 
 namespace Tex {
@@ -18,10 +22,72 @@ namespace Tex {
 const HDRColorA g_Luminance(0.2125f / 0.7154f, 1.0f, 0.0721f / 0.7154f, 1.0f);
 const HDRColorA g_LuminanceInv(0.7154f / 0.2125f, 1.0f, 0.7154f / 0.0721f, 1.0f);
 
+// 565 quantization of every 8-bit value, computed with the same expression as the
+// float path so RGBA8 input produces identical blocks
+struct Quantize565Table
+{
+    float r5[256];
+    float g6[256];
+
+    Quantize565Table()
+    {
+        for (size_t i = 0; i < 256; ++i)
+        {
+            float f = LDRColorA((uint8_t)i, 0, 0, 0).ToHDRColorA().r;
+            r5[i] = (float) static_cast<int32_t>(f * 31.0f + 0.5f) * (1.0f / 31.0f);
+            g6[i] = (float) static_cast<int32_t>(f * 63.0f + 0.5f) * (1.0f / 63.0f);
+        }
+    }
+};
+
+const Quantize565Table g_Quantize565;
+
+// Endpoint pairs whose 1/3 interpolant decodes closest to each 8-bit value, for the
+// 5 and 6 bit channels of a 565 color. Solid blocks are encoded straight from these.
+struct SolidBC1Table
+{
+    uint8_t aEndPts5[256][2];
+    uint8_t aEndPts6[256][2];
+
+    SolidBC1Table()
+    {
+        Build(aEndPts5, 31);
+        Build(aEndPts6, 63);
+    }
+
+    static void Build(uint8_t aEndPts[256][2], int iMax)
+    {
+        const float fScale = 1.0f / float(iMax);
+        for (size_t t = 0; t < 256; ++t)
+        {
+            const float fTarget = float(t) * (1.0f / 255.0f);
+            float fBestErr = FLT_MAX;
+            for (int e0 = 0; e0 <= iMax; ++e0)
+            {
+                for (int e1 = 0; e1 <= iMax; ++e1)
+                {
+                    // Same expression as HDRColorA::Lerp in DecodeBC1
+                    const float c0 = (float)e0 * fScale;
+                    const float c1 = (float)e1 * fScale;
+                    const float fErr = fabsf(c0 + (float)((1.f / 3.f) * (c1 - c0)) - fTarget);
+                    if (fErr < fBestErr)
+                    {
+                        fBestErr = fErr;
+                        aEndPts[t][0] = uint8_t(e0);
+                        aEndPts[t][1] = uint8_t(e1);
+                    }
+                }
+            }
+        }
+    }
+};
+
+const SolidBC1Table g_SolidBC1;
+
 
 
 //-------------------------------------------------------------------------------------
-void OptimizeRGB(
+void OptimizeRGBScalar(
     HDRColorA *pX,
     HDRColorA *pY,
     const HDRColorA *pPoints,
@@ -276,6 +342,54 @@ void OptimizeRGB(
     pY->r = Y.r; pY->g = Y.g; pY->b = Y.b;
 }
 
+void OptimizeRGBBatchScalar(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags)
+{
+    for (size_t i = 0; i < nBlocks; ++i)
+        OptimizeRGBScalar(&pX[i], &pY[i], ppPoints[i], pSteps[i], flags);
+}
+
+namespace {
+
+// Optimizer kernels picked once for the running CPU, all of them give identical results.
+// The vector kernels do not implement the COLOR_WEIGHTS variant.
+struct OptimizeKernels
+{
+    BC1_OPTIMIZE_RGB pfnOptimizeRGB;
+    BC1_OPTIMIZE_RGB_BATCH pfnOptimizeRGBBatch;
+};
+
+OptimizeKernels SelectOptimizeKernels()
+{
+#if defined(CROSSTEX_X86_SIMD) && !defined(COLOR_WEIGHTS)
+    const CPUFeatures& features = GetCPUFeatures();
+    if (features.bAVX2)
+        return { OptimizeRGBSSE41, OptimizeRGBBatchAVX2 };
+    if (features.bSSE41)
+        return { OptimizeRGBSSE41, OptimizeRGBBatchSSE41 };
+#endif
+    return { OptimizeRGBScalar, OptimizeRGBBatchScalar };
+}
+
+const OptimizeKernels& GetOptimizeKernels()
+{
+    static const OptimizeKernels kernels = SelectOptimizeKernels();
+    return kernels;
+}
+
+}
+
+void OptimizeRGB(HDRColorA *pX, HDRColorA *pY, const HDRColorA *pPoints, size_t cSteps, uint32_t flags)
+{
+    GetOptimizeKernels().pfnOptimizeRGB(pX, pY, pPoints, cSteps, flags);
+}
+
+void OptimizeRGBBatch(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags)
+{
+    GetOptimizeKernels().pfnOptimizeRGBBatch(pX, pY, ppPoints, pSteps, nBlocks, flags);
+}
+
 
 //-------------------------------------------------------------------------------------
 void DecodeBC1(HDRColorA *pColor, const Block_BC1 *pBC, bool isbc1)
@@ -316,11 +430,241 @@ void DecodeBC1(HDRColorA *pColor, const Block_BC1 *pBC, bool isbc1)
 
 
 //-------------------------------------------------------------------------------------
-void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float threshold, uint32_t flags)
+// RGBA8 decoding
+//-------------------------------------------------------------------------------------
+DecodeBC123Tables::DecodeBC123Tables()
 {
-    assert(pBC && pColor);
-    static_assert(sizeof(Block_BC1) == 8, "Block_BC1 should be 8 bytes");
+    static const float aRatios[3] = { 1.f / 3.f, 2.f / 3.f, 0.5f };
+
+    // Same expressions as Decode565 and HDRColorA::Lerp in DecodeBC1, rounded the
+    // way RGBA8 output is
+    for (int e0 = 0; e0 < 64; ++e0)
+    {
+        const float f5 = (float)e0 * (1.0f / 31.0f);
+        const float f6 = (float)e0 * (1.0f / 63.0f);
+        if (e0 < 32)
+            aExpand5[e0] = static_cast<uint8_t>(f5 * 255.0f + 0.5f);
+        aExpand6[e0] = static_cast<uint8_t>(f6 * 255.0f + 0.5f);
+
+        for (int e1 = 0; e1 < 64; ++e1)
+        {
+            const float g5 = (float)e1 * (1.0f / 31.0f);
+            const float g6 = (float)e1 * (1.0f / 63.0f);
+            for (size_t k = 0; k < 3; ++k)
+            {
+                if (e0 < 32 && e1 < 32)
+                    aLerp5[k][e0][e1] = static_cast<uint8_t>((f5 + (float)(aRatios[k] * (g5 - f5))) * 255.0f + 0.5f);
+                aLerp6[k][e0][e1] = static_cast<uint8_t>((f6 + (float)(aRatios[k] * (g6 - f6))) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    for (size_t v = 0; v < 256; ++v)
+    {
+        for (size_t p = 0; p < 4; ++p)
+        {
+            const uint8_t index = uint8_t((v >> (2 * p)) & 3);
+            for (size_t k = 0; k < 4; ++k)
+                aShuffle[v][4 * p + k] = uint8_t(index * 4 + k);
+        }
+    }
+}
+
+const DecodeBC123Tables g_DecodeBC123;
+
+namespace {
+
+inline uint32_t LoadBitmap(const uint8_t *pBC)
+{
+    return uint32_t(pBC[0]) | (uint32_t(pBC[1]) << 8) | (uint32_t(pBC[2]) << 16) | (uint32_t(pBC[3]) << 24);
+}
+
+// Writes one block from its palette, the 2-bit indices and 16 alphas. Alphas
+// replace the palette alpha unless pAlpha is null.
+inline void StoreBlock(uint8_t *pDst, size_t rowPitch, const uint32_t aPalette[4], uint32_t dw,
+    const uint8_t *pAlpha)
+{
+    for (size_t y = 0; y < 4; ++y, pDst += rowPitch)
+    {
+        uint32_t aRow[4];
+        for (size_t x = 0; x < 4; ++x, dw >>= 2)
+        {
+            aRow[x] = aPalette[dw & 3];
+            if (pAlpha)
+                aRow[x] = (aRow[x] & 0x00ffffff) | (uint32_t(pAlpha[y * 4 + x]) << 24);
+        }
+        memcpy(pDst, aRow, sizeof(aRow));
+    }
+}
+
+}
+
+void DecodeBC1RowScalar(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    for (size_t i = 0; i < nBlocks; ++i, pBC += 8, pDst += 16)
+    {
+        uint32_t aPalette[4];
+        BuildPaletteBC1(aPalette, pBC, true);
+        StoreBlock(pDst, rowPitch, aPalette, LoadBitmap(pBC + 4), nullptr);
+    }
+}
+
+void DecodeBC2RowScalar(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    for (size_t i = 0; i < nBlocks; ++i, pBC += 16, pDst += 16)
+    {
+        uint8_t aAlpha[NUM_PIXELS_PER_BLOCK];
+        for (size_t j = 0; j < 8; ++j)
+        {
+            aAlpha[2 * j] = uint8_t((pBC[j] & 0xf) * 17);
+            aAlpha[2 * j + 1] = uint8_t((pBC[j] >> 4) * 17);
+        }
+
+        uint32_t aPalette[4];
+        BuildPaletteBC1(aPalette, pBC + 8, false);
+        StoreBlock(pDst, rowPitch, aPalette, LoadBitmap(pBC + 12), aAlpha);
+    }
+}
+
+void DecodeBC3RowScalar(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    for (size_t i = 0; i < nBlocks; ++i, pBC += 16, pDst += 16)
+    {
+        uint8_t aAlphaPalette[8];
+        BuildAlphaPaletteBC3(aAlphaPalette, pBC);
+
+        uint8_t aAlpha[NUM_PIXELS_PER_BLOCK];
+        uint64_t dw = LoadAlphaIndicesBC3(pBC);
+        for (size_t j = 0; j < NUM_PIXELS_PER_BLOCK; ++j, dw >>= 3)
+            aAlpha[j] = aAlphaPalette[dw & 7];
+
+        uint32_t aPalette[4];
+        BuildPaletteBC1(aPalette, pBC + 8, false);
+        StoreBlock(pDst, rowPitch, aPalette, LoadBitmap(pBC + 12), aAlpha);
+    }
+}
+
+namespace {
+
+struct DecodeKernels
+{
+    BC123_DECODE_ROW pfnDecodeBC1Row;
+    BC123_DECODE_ROW pfnDecodeBC2Row;
+    BC123_DECODE_ROW pfnDecodeBC3Row;
+};
+
+DecodeKernels SelectDecodeKernels()
+{
+#if defined(CROSSTEX_X86_SIMD)
+    const CPUFeatures& features = GetCPUFeatures();
+    if (features.bAVX2)
+        return { DecodeBC1RowAVX2, DecodeBC2RowAVX2, DecodeBC3RowAVX2 };
+    if (features.bSSE41)
+        return { DecodeBC1RowSSE41, DecodeBC2RowSSE41, DecodeBC3RowSSE41 };
+#endif
+    return { DecodeBC1RowScalar, DecodeBC2RowScalar, DecodeBC3RowScalar };
+}
+
+const DecodeKernels& GetDecodeKernels()
+{
+    static const DecodeKernels kernels = SelectDecodeKernels();
+    return kernels;
+}
+
+}
+
+void DecodeBC1Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    GetDecodeKernels().pfnDecodeBC1Row(pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC2Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    GetDecodeKernels().pfnDecodeBC2Row(pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC3Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    GetDecodeKernels().pfnDecodeBC3Row(pDst, rowPitch, pBC, nBlocks);
+}
+
+
+//-------------------------------------------------------------------------------------
+namespace {
+
+// Single color blocks skip the endpoint search: each channel takes the table pair whose
+// 1/3 interpolant is closest, which is optimal for any channel weighting. Returns false
+// when the block has more than one color, needs color keying or is dithered.
+bool EncodeSolidBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float threshold, uint32_t flags,
+    const LDRColorA *pLDR)
+{
+    if (flags & BC_FLAGS_DITHER_RGB)
+        return false;
+
+    for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        if (pColor[i].r != pColor[0].r || pColor[i].g != pColor[0].g || pColor[i].b != pColor[0].b)
+            return false;
+    }
+
+    if (bColorKey)
+    {
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            if (pColor[i].a < threshold)
+                return false;
+        }
+    }
+
+    size_t r, g, b;
+    if (pLDR)
+    {
+        r = pLDR[0].r;
+        g = pLDR[0].g;
+        b = pLDR[0].b;
+    }
+    else
+    {
+        r = static_cast<size_t>(std::max(0.0f, std::min(1.0f, pColor[0].r)) * 255.0f + 0.5f);
+        g = static_cast<size_t>(std::max(0.0f, std::min(1.0f, pColor[0].g)) * 255.0f + 0.5f);
+        b = static_cast<size_t>(std::max(0.0f, std::min(1.0f, pColor[0].b)) * 255.0f + 0.5f);
+    }
+
+    const uint16_t w0 = uint16_t((g_SolidBC1.aEndPts5[r][0] << 11) | (g_SolidBC1.aEndPts6[g][0] << 5) | g_SolidBC1.aEndPts5[b][0]);
+    const uint16_t w1 = uint16_t((g_SolidBC1.aEndPts5[r][1] << 11) | (g_SolidBC1.aEndPts6[g][1] << 5) | g_SolidBC1.aEndPts5[b][1]);
+
+    // Index 2 interpolates 1/3 of the way to rgb[1]; four color mode needs rgb[0] > rgb[1],
+    // so the endpoints swap and index 3 takes over when they are in the wrong order
+    if (w0 > w1)
+    {
+        pBC->rgb[0] = w0;
+        pBC->rgb[1] = w1;
+        pBC->bitmap = 0xaaaaaaaa;
+    }
+    else if (w0 < w1)
+    {
+        pBC->rgb[0] = w1;
+        pBC->rgb[1] = w0;
+        pBC->bitmap = 0xffffffff;
+    }
+    else
+    {
+        pBC->rgb[0] = w0;
+        pBC->rgb[1] = w1;
+        pBC->bitmap = 0x00000000;
+    }
+
+    return true;
+}
 
+// First half of EncodeBC1: picks the step count and quantizes the block into Color.
+// Returns false when the block is fully transparent and already written.
+bool PrepareBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float threshold, uint32_t flags,
+    const LDRColorA *pLDR, HDRColorA *Color, size_t *puSteps)
+{
     // Determine if we need to colorkey this block
     size_t uSteps;
 
@@ -339,7 +683,7 @@ void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float th
             pBC->rgb[0] = 0x0000;
             pBC->rgb[1] = 0xffff;
             pBC->bitmap = 0xffffffff;
-            return;
+            return false;
         }
 
         uSteps = (uColorKey > 0) ? 3 : 4;
@@ -349,10 +693,11 @@ void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float th
         uSteps = 4;
     }
 
+    *puSteps = uSteps;
+
     // Quantize block to R56B5, using Floyd Stienberg error diffusion.  This
     // increases the chance that colors will map directly to the quantized
     // axis endpoints.
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
     HDRColorA Error[NUM_PIXELS_PER_BLOCK];
 
     if (flags & BC_FLAGS_DITHER_RGB)
@@ -373,9 +718,18 @@ void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float th
             Clr.b += Error[i].b;
         }
 
-        Color[i].r = (float) static_cast<int32_t>(Clr.r * 31.0f + 0.5f) * (1.0f / 31.0f);
-        Color[i].g = (float) static_cast<int32_t>(Clr.g * 63.0f + 0.5f) * (1.0f / 63.0f);
-        Color[i].b = (float) static_cast<int32_t>(Clr.b * 31.0f + 0.5f) * (1.0f / 31.0f);
+        if (pLDR && !(flags & BC_FLAGS_DITHER_RGB))
+        {
+            Color[i].r = g_Quantize565.r5[pLDR[i].r];
+            Color[i].g = g_Quantize565.g6[pLDR[i].g];
+            Color[i].b = g_Quantize565.r5[pLDR[i].b];
+        }
+        else
+        {
+            Color[i].r = (float) static_cast<int32_t>(Clr.r * 31.0f + 0.5f) * (1.0f / 31.0f);
+            Color[i].g = (float) static_cast<int32_t>(Clr.g * 63.0f + 0.5f) * (1.0f / 63.0f);
+            Color[i].b = (float) static_cast<int32_t>(Clr.b * 31.0f + 0.5f) * (1.0f / 31.0f);
+        }
 
 #ifdef COLOR_WEIGHTS
         Color[i].a = pColor[i].a;
@@ -429,11 +783,14 @@ void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float th
         }
     }
 
-    // Perform 6D root finding function to find two endpoints of color axis.
-    // Then quantize and sort the endpoints depending on mode.
-    HDRColorA ColorA, ColorB, ColorC, ColorD;
+    return true;
+}
 
-    OptimizeRGB(&ColorA, &ColorB, Color, uSteps, flags);
+// Second half of EncodeBC1: quantizes the optimized endpoints and writes the indices
+void FinishBC1(Block_BC1 *pBC, const HDRColorA *pColor, const HDRColorA *Color, size_t uSteps,
+    HDRColorA ColorA, HDRColorA ColorB, float threshold, uint32_t flags)
+{
+    HDRColorA ColorC, ColorD;
 
     if (flags & BC_FLAGS_UNIFORM)
     {
@@ -535,10 +892,11 @@ void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float th
 
     // Encode colors
     uint32_t dw = 0;
+    HDRColorA Error[NUM_PIXELS_PER_BLOCK];
     if (flags & BC_FLAGS_DITHER_RGB)
         memset(Error, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(HDRColorA));
 
-    for (i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
         if ((3 == uSteps) && (pColor[i].a < threshold))
         {
@@ -620,37 +978,72 @@ void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float th
     pBC->bitmap = dw;
 }
 
-//-------------------------------------------------------------------------------------
-#ifdef COLOR_WEIGHTS
-void EncodeSolidBC1(Block_BC1 *pBC, const HDRColorA *pColor)
+}
+
+void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float threshold, uint32_t flags,
+    const LDRColorA *pLDR)
 {
-#ifdef COLOR_AVG_0WEIGHTS
-    // Compute avg color
-    HDRColorA Color;
-    Color.r = pColor[0].r;
-    Color.g = pColor[0].g;
-    Color.b = pColor[0].b;
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC1) == 8, "Block_BC1 should be 8 bytes");
 
-    for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+    if (EncodeSolidBC1(pBC, pColor, bColorKey, threshold, flags, pLDR))
+        return;
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    size_t uSteps;
+    if (!PrepareBC1(pBC, pColor, bColorKey, threshold, flags, pLDR, Color, &uSteps))
+        return;
+
+    // Perform 6D root finding function to find two endpoints of color axis.
+    // Then quantize and sort the endpoints depending on mode.
+    HDRColorA ColorA, ColorB;
+    OptimizeRGB(&ColorA, &ColorB, Color, uSteps, flags);
+
+    FinishBC1(pBC, pColor, Color, uSteps, ColorA, ColorB, threshold, flags);
+}
+
+void EncodeBC1Batch(Block_BC1 *const *ppBC, const HDRColorA *const *ppColor, const LDRColorA *const *ppLDR,
+    size_t nBlocks, bool bColorKey, float threshold, uint32_t flags)
+{
+    assert(ppBC && ppColor);
+
+    HDRColorA Color[BC1_MAX_BATCH][NUM_PIXELS_PER_BLOCK];
+    HDRColorA ColorA[BC1_MAX_BATCH], ColorB[BC1_MAX_BATCH];
+    const HDRColorA *pPoints[BC1_MAX_BATCH];
+    size_t uSteps[BC1_MAX_BATCH];
+    size_t uBlock[BC1_MAX_BATCH];
+
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
     {
-        Color.r += pColor[i].r;
-        Color.g += pColor[i].g;
-        Color.b += pColor[i].b;
-    }
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
 
-    Color.r *= 1.0f / 16.0f;
-    Color.g *= 1.0f / 16.0f;
-    Color.b *= 1.0f / 16.0f;
+        // Solid and fully transparent blocks drop out here
+        size_t nPending = 0;
+        for (size_t j = i; j < i + nGroup; ++j)
+        {
+            const LDRColorA *pLDR = ppLDR ? ppLDR[j] : nullptr;
+            if (EncodeSolidBC1(ppBC[j], ppColor[j], bColorKey, threshold, flags, pLDR))
+                continue;
 
-    uint16_t wColor = Color.Encode565();
-#else
-    uint16_t wColor = 0x0000;
-#endif // COLOR_AVG_0WEIGHTS
+            if (PrepareBC1(ppBC[j], ppColor[j], bColorKey, threshold, flags, pLDR, Color[nPending], &uSteps[nPending]))
+            {
+                pPoints[nPending] = Color[nPending];
+                uBlock[nPending] = j;
+                nPending++;
+            }
+        }
+
+        if (!nPending)
+            continue;
 
-    // Encode solid block
-    pBC->rgb[0] = wColor;
-    pBC->rgb[1] = wColor;
-    pBC->bitmap = 0x00000000;
+        OptimizeRGBBatch(ColorA, ColorB, pPoints, uSteps, nPending, flags);
+
+        for (size_t k = 0; k < nPending; ++k)
+        {
+            const size_t j = uBlock[k];
+            FinishBC1(ppBC[j], ppColor[j], Color[k], uSteps[k], ColorA[k], ColorB[k], threshold, flags);
+        }
+    }
 }
-#endif // COLOR_WEIGHTS
+
 }
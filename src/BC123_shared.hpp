@@ -1,7 +1,9 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 #include "BC.hpp"
+#include "BC123_simd.hpp"
 #include "Colors.hpp"
 
 
@@ -31,10 +33,32 @@ struct Block_BC3
 };
 #pragma pack(pop)
 
+// Perceptual weightings for the importance of each channel.
+extern const HDRColorA g_Luminance;
+
+// Finds the two endpoints of the color axis for cSteps (3 or 4) interpolation steps
+void OptimizeRGB(HDRColorA *pX, HDRColorA *pY, const HDRColorA *pPoints, size_t cSteps, uint32_t flags);
+
+// OptimizeRGB for nBlocks blocks, several blocks are processed at once where the CPU allows
+void OptimizeRGBBatch(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags);
+
 void DecodeBC1(HDRColorA *pColor, const Block_BC1 *pBC, bool isbc1);
-void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float threshold, uint32_t flags);
-#ifdef COLOR_WEIGHTS
-void EncodeSolidBC1(Block_BC1 *pBC, const HDRColorA *pColor);
-#endif
+// pLDR optionally holds the same texels as RGBA8, which allows table driven 565 quantization
+void EncodeBC1(Block_BC1 *pBC, const HDRColorA *pColor, bool bColorKey, float threshold, uint32_t flags,
+    const LDRColorA *pLDR = nullptr);
+
+// EncodeBC1 for nBlocks blocks sharing the settings, with the endpoint search batched;
+// the results match encoding the blocks one at a time. ppLDR may be null.
+void EncodeBC1Batch(Block_BC1 *const *ppBC, const HDRColorA *const *ppColor, const LDRColorA *const *ppLDR,
+    size_t nBlocks, bool bColorKey, float threshold, uint32_t flags);
+// Batched forms of the EncodeBC1/2/3 entry points for nBlocks consecutive blocks,
+// pColor holds the texels block after block
+void EncodeBC1Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC1Blocks(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC2Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC2Blocks(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC3Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC3Blocks(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags);
 
 }
@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Colors.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// BC1 endpoint optimizer kernels
+//
+// Every variant performs the same float operations in the same order as the
+// scalar OptimizeRGB in BC123_shared.cpp, so all of them produce bit-identical
+// endpoints. The batched variants run one block per vector lane.
+//-------------------------------------------------------------------------------------
+
+// Widest batch handled by a single kernel call
+const size_t BC1_MAX_BATCH = 8;
+
+typedef void (*BC1_OPTIMIZE_RGB)(HDRColorA *pX, HDRColorA *pY, const HDRColorA *pPoints,
+    size_t cSteps, uint32_t flags);
+
+// Optimizes nBlocks <= BC1_MAX_BATCH blocks, block i uses ppPoints[i] and pSteps[i]
+typedef void (*BC1_OPTIMIZE_RGB_BATCH)(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags);
+
+#if defined(CROSSTEX_X86_SIMD)
+void OptimizeRGBSSE41(HDRColorA *pX, HDRColorA *pY, const HDRColorA *pPoints,
+    size_t cSteps, uint32_t flags);
+void OptimizeRGBBatchSSE41(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags);
+
+void OptimizeRGBBatchAVX2(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags);
+#endif
+
+
+//-------------------------------------------------------------------------------------
+// BC1/BC2/BC3 RGBA8 decoder kernels
+//
+// Color palettes come from tables built with the float decoder's expressions, so
+// every variant writes exactly the rounded float result.
+//-------------------------------------------------------------------------------------
+
+struct DecodeBC123Tables
+{
+    uint8_t aExpand5[32];               // 5-bit channel to 8 bits
+    uint8_t aExpand6[64];               // 6-bit channel to 8 bits
+    uint8_t aLerp5[3][32][32];          // [1/3, 2/3, 1/2][e0][e1] for 5-bit channels
+    uint8_t aLerp6[3][64][64];          // Same for the 6-bit green channel
+    alignas(16) uint8_t aShuffle[256][16];  // Byte shuffle picking 4 palette words by one row of 2-bit indices
+
+    DecodeBC123Tables();
+};
+
+extern const DecodeBC123Tables g_DecodeBC123;
+
+// Decodes nBlocks blocks lying side by side into 4 RGBA8 rows rowPitch bytes apart
+typedef void (*BC123_DECODE_ROW)(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+void DecodeBC1RowScalar(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC2RowScalar(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC3RowScalar(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+#if defined(CROSSTEX_X86_SIMD)
+void DecodeBC1RowSSE41(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC2RowSSE41(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC3RowSSE41(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+void DecodeBC1RowAVX2(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC2RowAVX2(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+void DecodeBC3RowAVX2(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+#endif
+
+} // namespace
@@ -0,0 +1,235 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <float.h>
+#include <smmintrin.h>
+
+#include "BC123_simd.hpp"
+#include "DecodeBC123Lanes.hpp"
+#include "OptimizeRGBLanes.hpp"
+#include "VecSSE41.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+// ((a.r * b.r + a.g * b.g) + a.b * b.b) in the low lane, the scalar summation order
+inline __m128 Dot3(__m128 a, __m128 b)
+{
+    __m128 m = _mm_mul_ps(a, b);
+    __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_add_ss(s, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2)));
+}
+
+inline __m128 LoadColor(const HDRColorA& c)
+{
+    return _mm_loadu_ps(&c.r);
+}
+
+inline void StoreRGB(HDRColorA *pColor, __m128 v)
+{
+    alignas(16) float f[4];
+    _mm_store_ps(f, v);
+    pColor->r = f[0];
+    pColor->g = f[1];
+    pColor->b = f[2];
+}
+
+}
+
+// OptimizeRGB with one color per register, see the scalar version for the comments
+void OptimizeRGBSSE41(HDRColorA *pX, HDRColorA *pY, const HDRColorA *pPoints,
+    size_t cSteps, uint32_t flags)
+{
+    static const float fEpsilon = (0.25f / 64.0f) * (0.25f / 64.0f);
+    static const float pC3[] = { 2.0f / 2.0f, 1.0f / 2.0f, 0.0f / 2.0f };
+    static const float pD3[] = { 0.0f / 2.0f, 1.0f / 2.0f, 2.0f / 2.0f };
+    static const float pC4[] = { 3.0f / 3.0f, 2.0f / 3.0f, 1.0f / 3.0f, 0.0f / 3.0f };
+    static const float pD4[] = { 0.0f / 3.0f, 1.0f / 3.0f, 2.0f / 3.0f, 3.0f / 3.0f };
+
+    const float *pC = (3 == cSteps) ? pC3 : pC4;
+    const float *pD = (3 == cSteps) ? pD3 : pD4;
+
+    __m128 X = (flags & BC_FLAGS_UNIFORM) ? _mm_set1_ps(1.f) : LoadColor(g_Luminance);
+    __m128 Y = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+    for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+    {
+        const __m128 P = LoadColor(pPoints[iPoint]);
+        X = _mm_min_ps(P, X);
+        Y = _mm_max_ps(P, Y);
+    }
+
+    __m128 AB = _mm_sub_ps(Y, X);
+    const float fAB = _mm_cvtss_f32(Dot3(AB, AB));
+
+    if (fAB < FLT_MIN)
+    {
+        StoreRGB(pX, X);
+        StoreRGB(pY, Y);
+        return;
+    }
+
+    const float fABInv = 1.0f / fAB;
+    const __m128 Dir = _mm_mul_ps(AB, _mm_set1_ps(fABInv));
+    const __m128 Mid = _mm_mul_ps(_mm_add_ps(X, Y), _mm_set1_ps(0.5f));
+
+    // Lane d holds direction d: r + (+-g) + (+-b)
+    const __m128 signG = _mm_castsi128_ps(_mm_setr_epi32(0, 0, INT32_MIN, INT32_MIN));
+    const __m128 signB = _mm_castsi128_ps(_mm_setr_epi32(0, INT32_MIN, 0, INT32_MIN));
+    __m128 fDir = _mm_setzero_ps();
+
+    for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+    {
+        const __m128 Pt = _mm_mul_ps(_mm_sub_ps(LoadColor(pPoints[iPoint]), Mid), Dir);
+        const __m128 R = _mm_shuffle_ps(Pt, Pt, _MM_SHUFFLE(0, 0, 0, 0));
+        const __m128 G = _mm_xor_ps(_mm_shuffle_ps(Pt, Pt, _MM_SHUFFLE(1, 1, 1, 1)), signG);
+        const __m128 B = _mm_xor_ps(_mm_shuffle_ps(Pt, Pt, _MM_SHUFFLE(2, 2, 2, 2)), signB);
+        const __m128 f = _mm_add_ps(_mm_add_ps(R, G), B);
+        fDir = _mm_add_ps(fDir, _mm_mul_ps(f, f));
+    }
+
+    alignas(16) float afDir[4];
+    _mm_store_ps(afDir, fDir);
+
+    float fDirMax = afDir[0];
+    size_t  iDirMax = 0;
+
+    for (size_t iDir = 1; iDir < 4; iDir++)
+    {
+        if (afDir[iDir] > fDirMax)
+        {
+            fDirMax = afDir[iDir];
+            iDirMax = iDir;
+        }
+    }
+
+    const __m128 swap = _mm_castsi128_ps(_mm_setr_epi32(0, (iDirMax & 2) ? -1 : 0, (iDirMax & 1) ? -1 : 0, 0));
+    const __m128 T = X;
+    X = _mm_blendv_ps(X, Y, swap);
+    Y = _mm_blendv_ps(Y, T, swap);
+
+    if (fAB < 1.0f / 4096.0f)
+    {
+        StoreRGB(pX, X);
+        StoreRGB(pY, Y);
+        return;
+    }
+
+    const float fSteps = (float)(cSteps - 1);
+    const __m128 eps = _mm_set1_ps(fEpsilon);
+
+    for (size_t iIteration = 0; iIteration < 8; iIteration++)
+    {
+        __m128 Steps[4];
+        for (size_t iStep = 0; iStep < cSteps; iStep++)
+            Steps[iStep] = _mm_add_ps(_mm_mul_ps(X, _mm_set1_ps(pC[iStep])), _mm_mul_ps(Y, _mm_set1_ps(pD[iStep])));
+
+        __m128 V = _mm_sub_ps(Y, X);
+        const float fLen = _mm_cvtss_f32(Dot3(V, V));
+
+        if (fLen < (1.0f / 4096.0f))
+            break;
+
+        const float fScale = fSteps / fLen;
+        V = _mm_mul_ps(V, _mm_set1_ps(fScale));
+
+        float d2X = 0.0f, d2Y = 0.0f;
+        __m128 dX = _mm_setzero_ps(), dY = _mm_setzero_ps();
+
+        for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+        {
+            const __m128 P = LoadColor(pPoints[iPoint]);
+            const float fDot = _mm_cvtss_f32(Dot3(_mm_sub_ps(P, X), V));
+
+            size_t iStep;
+            if (fDot <= 0.0f)
+                iStep = 0;
+            else if (fDot >= fSteps)
+                iStep = cSteps - 1;
+            else
+                iStep = static_cast<size_t>(fDot + 0.5f);
+
+            const __m128 Diff = _mm_sub_ps(Steps[iStep], P);
+            const float fC = pC[iStep] * (1.0f / 8.0f);
+            const float fD = pD[iStep] * (1.0f / 8.0f);
+
+            d2X += fC * pC[iStep];
+            dX = _mm_add_ps(dX, _mm_mul_ps(_mm_set1_ps(fC), Diff));
+
+            d2Y += fD * pD[iStep];
+            dY = _mm_add_ps(dY, _mm_mul_ps(_mm_set1_ps(fD), Diff));
+        }
+
+        if (d2X > 0.0f)
+            X = _mm_add_ps(X, _mm_mul_ps(dX, _mm_set1_ps(-1.0f / d2X)));
+
+        if (d2Y > 0.0f)
+            Y = _mm_add_ps(Y, _mm_mul_ps(dY, _mm_set1_ps(-1.0f / d2Y)));
+
+        const int converged = _mm_movemask_ps(_mm_cmplt_ps(_mm_mul_ps(dX, dX), eps))
+            & _mm_movemask_ps(_mm_cmplt_ps(_mm_mul_ps(dY, dY), eps));
+        if ((converged & 0x7) == 0x7)
+            break;
+    }
+
+    StoreRGB(pX, X);
+    StoreRGB(pY, Y);
+}
+
+void OptimizeRGBBatchSSE41(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags)
+{
+    for (size_t i = 0; i < nBlocks; i += VecSSE41::WIDTH)
+    {
+        const size_t n = (nBlocks - i < VecSSE41::WIDTH) ? nBlocks - i : VecSSE41::WIDTH;
+        OptimizeRGBLanes<VecSSE41>(pX + i, pY + i, ppPoints + i, pSteps + i, n, flags);
+    }
+}
+
+
+namespace {
+
+// Decodes 4 blocks per iteration so every destination row gets 64 contiguous bytes
+template <size_t BLOCK_SIZE, bool bAlpha, DecodeBlock (*pfnLoad)(const uint8_t *)>
+void DecodeRow(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    size_t i = 0;
+    for (; i + 4 <= nBlocks; i += 4, pBC += 4 * BLOCK_SIZE, pDst += 64)
+    {
+        const DecodeBlock aBlocks[4] = { pfnLoad(pBC), pfnLoad(pBC + BLOCK_SIZE),
+            pfnLoad(pBC + 2 * BLOCK_SIZE), pfnLoad(pBC + 3 * BLOCK_SIZE) };
+        for (size_t y = 0; y < 4; ++y)
+        {
+            auto pRow = reinterpret_cast<__m128i *>(pDst + y * rowPitch);
+            for (size_t j = 0; j < 4; ++j)
+                _mm_storeu_si128(pRow + j, ExpandRow<bAlpha>(aBlocks[j], y));
+        }
+    }
+
+    for (; i < nBlocks; ++i, pBC += BLOCK_SIZE, pDst += 16)
+    {
+        const DecodeBlock block = pfnLoad(pBC);
+        for (size_t y = 0; y < 4; ++y)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + y * rowPitch), ExpandRow<bAlpha>(block, y));
+    }
+}
+
+}
+
+void DecodeBC1RowSSE41(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    DecodeRow<8, false, LoadBlockBC1>(pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC2RowSSE41(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    DecodeRow<16, true, LoadBlockBC2>(pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC3RowSSE41(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    DecodeRow<16, true, LoadBlockBC3>(pDst, rowPitch, pBC, nBlocks);
+}
+
+} // namespace
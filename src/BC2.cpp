@@ -35,19 +35,15 @@ void DecodeBC2(HDRColorA *pColor, const uint8_t *pBC)
     }
 }
 
-void EncodeBC2(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
+void DecodeBC2(LDRColorA *pColor, const uint8_t *pBC)
 {
-    assert(pBC && pColor);
-    static_assert(sizeof(Block_BC2) == 16, "Block_BC2 should be 16 bytes");
-
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
-    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-    {
-        Color[i] = pColor[i];
-    }
+    DecodeBC2Row(reinterpret_cast<uint8_t *>(pColor), 4 * sizeof(LDRColorA), pBC, 1);
+}
 
-    auto pBC2 = reinterpret_cast<Block_BC2 *>(pBC);
+namespace {
 
+void EncodeBC2Alpha(Block_BC2 *pBC2, const HDRColorA *pColor, uint32_t flags)
+{
     // 4-bit alpha part.  Dithered using Floyd Stienberg error diffusion.
     pBC2->bitmap[0] = 0;
     pBC2->bitmap[1] = 0;
@@ -58,7 +54,7 @@ void EncodeBC2(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
 
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        float fAlph = Color[i].a;
+        float fAlph = pColor[i].a;
         if (flags & BC_FLAGS_DITHER_A)
             fAlph += fError[i];
 
@@ -92,17 +88,87 @@ void EncodeBC2(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
             }
         }
     }
+}
+
+void EncodeBC2(Block_BC2 *pBC2, const HDRColorA *pColor, uint32_t flags, const LDRColorA *pLDR)
+{
+    EncodeBC2Alpha(pBC2, pColor, flags);
 
     // RGB part
-#ifdef COLOR_WEIGHTS
-    if (!pBC2->bitmap[0] && !pBC2->bitmap[1])
+    EncodeBC1(&pBC2->bc1, pColor, false, 0.f, flags, pLDR);
+}
+
+// Alpha per block, the color parts of up to BC1_MAX_BATCH blocks in one batch
+void EncodeBC2Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags,
+    const LDRColorA *pLDR)
+{
+    Block_BC1 *ppBC1[BC1_MAX_BATCH];
+    const HDRColorA *ppColor[BC1_MAX_BATCH];
+    const LDRColorA *ppLDR[BC1_MAX_BATCH];
+
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
+        for (size_t j = 0; j < nGroup; ++j)
+        {
+            auto pBC2 = reinterpret_cast<Block_BC2 *>(pBC) + i + j;
+            ppColor[j] = pColor + (i + j) * NUM_PIXELS_PER_BLOCK;
+            ppLDR[j] = pLDR ? pLDR + (i + j) * NUM_PIXELS_PER_BLOCK : nullptr;
+            ppBC1[j] = &pBC2->bc1;
+            EncodeBC2Alpha(pBC2, ppColor[j], flags);
+        }
+
+        EncodeBC1Batch(ppBC1, ppColor, ppLDR, nGroup, false, 0.f, flags);
+    }
+}
+
+}
+
+void EncodeBC2(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC2) == 16, "Block_BC2 should be 16 bytes");
+
+    EncodeBC2(reinterpret_cast<Block_BC2 *>(pBC), pColor, flags, nullptr);
+}
+
+void EncodeBC2(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC2) == 16, "Block_BC2 should be 16 bytes");
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        EncodeSolidBC1(pBC2->dxt1, Color);
-        return;
+        Color[i] = pColor[i].ToHDRColorA();
     }
-#endif // COLOR_WEIGHTS
 
-    EncodeBC1(&pBC2->bc1, Color, false, 0.f, flags);
+    EncodeBC2(reinterpret_cast<Block_BC2 *>(pBC), Color, flags, pColor);
+}
+
+void EncodeBC2Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    EncodeBC2Blocks(pBC, pColor, nBlocks, flags, nullptr);
+}
+
+void EncodeBC2Blocks(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    HDRColorA Color[BC1_MAX_BATCH * NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
+        const LDRColorA *pGroup = pColor + i * NUM_PIXELS_PER_BLOCK;
+        for (size_t j = 0; j < nGroup * NUM_PIXELS_PER_BLOCK; ++j)
+        {
+            Color[j] = pGroup[j].ToHDRColorA();
+        }
+
+        EncodeBC2Blocks(pBC + i * sizeof(Block_BC2), Color, nGroup, flags, pGroup);
+    }
 }
 
 }
@@ -51,19 +51,21 @@ void DecodeBC3(HDRColorA *pColor, const uint8_t *pBC)
         pColor[i].a = fAlpha[dw & 0x7];
 }
 
-void EncodeBC3(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
+void DecodeBC3(LDRColorA *pColor, const uint8_t *pBC)
 {
-    assert(pBC && pColor);
-    static_assert(sizeof(Block_BC3) == 16, "Block_BC3 should be 16 bytes");
+    DecodeBC3Row(reinterpret_cast<uint8_t *>(pColor), 4 * sizeof(LDRColorA), pBC, 1);
+}
+
+namespace {
 
+void EncodeBC3Alpha(Block_BC3 *pBC3, const HDRColorA *pColor, uint32_t flags)
+{
     HDRColorA Color[NUM_PIXELS_PER_BLOCK];
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
         Color[i] = pColor[i];
     }
 
-    auto pBC3 = reinterpret_cast<Block_BC3 *>(pBC);
-
     // Quantize block to A8, using Floyd Stienberg error diffusion.  This
     // increases the chance that colors will map directly to the quantized
     // axis endpoints.
@@ -115,24 +117,23 @@ void EncodeBC3(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
         }
     }
 
-#ifdef COLOR_WEIGHTS
-    if (0.0f == fMaxAlpha)
+    // Alpha part
+    if (1.0f == fMinAlpha)
     {
-        EncodeSolidBC1(&pBC3->dxt1, Color);
-        pBC3->alpha[0] = 0x00;
-        pBC3->alpha[1] = 0x00;
+        pBC3->alpha[0] = 0xff;
+        pBC3->alpha[1] = 0xff;
         memset(pBC3->bitmap, 0x00, 6);
+        return;
     }
-#endif
 
-    // RGB part
-    EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
+    // A single quantized alpha is stored exactly as both endpoints
+    bool bSolid = true;
+    for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK && bSolid; ++i)
+        bSolid = (fAlpha[i] == fAlpha[0]);
 
-    // Alpha part
-    if (1.0f == fMinAlpha)
+    if (bSolid)
     {
-        pBC3->alpha[0] = 0xff;
-        pBC3->alpha[1] = 0xff;
+        pBC3->alpha[0] = pBC3->alpha[1] = (uint8_t) static_cast<int32_t>(fAlpha[0] * 255.0f + 0.5f);
         memset(pBC3->bitmap, 0x00, 6);
         return;
     }
@@ -251,4 +252,85 @@ void EncodeBC3(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
     }
 }
 
+void EncodeBC3(Block_BC3 *pBC3, const HDRColorA *pColor, uint32_t flags, const LDRColorA *pLDR)
+{
+    EncodeBC3Alpha(pBC3, pColor, flags);
+
+    // RGB part
+    EncodeBC1(&pBC3->bc1, pColor, false, 0.f, flags, pLDR);
+}
+
+// Alpha per block, the color parts of up to BC1_MAX_BATCH blocks in one batch
+void EncodeBC3Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags,
+    const LDRColorA *pLDR)
+{
+    Block_BC1 *ppBC1[BC1_MAX_BATCH];
+    const HDRColorA *ppColor[BC1_MAX_BATCH];
+    const LDRColorA *ppLDR[BC1_MAX_BATCH];
+
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
+        for (size_t j = 0; j < nGroup; ++j)
+        {
+            auto pBC3 = reinterpret_cast<Block_BC3 *>(pBC) + i + j;
+            ppColor[j] = pColor + (i + j) * NUM_PIXELS_PER_BLOCK;
+            ppLDR[j] = pLDR ? pLDR + (i + j) * NUM_PIXELS_PER_BLOCK : nullptr;
+            ppBC1[j] = &pBC3->bc1;
+            EncodeBC3Alpha(pBC3, ppColor[j], flags);
+        }
+
+        EncodeBC1Batch(ppBC1, ppColor, ppLDR, nGroup, false, 0.f, flags);
+    }
+}
+
+}
+
+void EncodeBC3(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC3) == 16, "Block_BC3 should be 16 bytes");
+
+    EncodeBC3(reinterpret_cast<Block_BC3 *>(pBC), pColor, flags, nullptr);
+}
+
+void EncodeBC3(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC3) == 16, "Block_BC3 should be 16 bytes");
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        Color[i] = pColor[i].ToHDRColorA();
+    }
+
+    EncodeBC3(reinterpret_cast<Block_BC3 *>(pBC), Color, flags, pColor);
+}
+
+void EncodeBC3Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    EncodeBC3Blocks(pBC, pColor, nBlocks, flags, nullptr);
+}
+
+void EncodeBC3Blocks(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    assert(pBC && pColor);
+
+    HDRColorA Color[BC1_MAX_BATCH * NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < nBlocks; i += BC1_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC1_MAX_BATCH) ? nBlocks - i : BC1_MAX_BATCH;
+        const LDRColorA *pGroup = pColor + i * NUM_PIXELS_PER_BLOCK;
+        for (size_t j = 0; j < nGroup * NUM_PIXELS_PER_BLOCK; ++j)
+        {
+            Color[j] = pGroup[j].ToHDRColorA();
+        }
+
+        EncodeBC3Blocks(pBC + i * sizeof(Block_BC3), Color, nGroup, flags, pGroup);
+    }
+}
+
 }
@@ -4,6 +4,7 @@
 
 #include "BC.hpp"
 #include "BC45_shared.hpp"
+#include "BC45_simd.hpp"
 #include "Colors.hpp"
 
 
@@ -16,9 +17,13 @@ void DecodeBC4U(HDRColorA *pColor, const uint8_t *pBC)
 
     auto pBC4 = reinterpret_cast<const BC4_UNORM*>(pBC);
 
+    // Palette once per block instead of a division per texel
+    float fPalette[8];
+    BuildPaletteBC4(fPalette, pBC, false);
+
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        pColor[i] = HDRColorA(pBC4->R(i), 0.0f, 0.0f, 1.0f);
+        pColor[i] = HDRColorA(fPalette[pBC4->GetIndex(i)], 0.0f, 0.0f, 1.0f);
     }
 }
 
@@ -29,9 +34,13 @@ void DecodeBC4S(HDRColorA *pColor, const uint8_t *pBC)
 
     auto pBC4 = reinterpret_cast<const BC4_SNORM*>(pBC);
 
+    // Palette once per block instead of a division per texel
+    float fPalette[8];
+    BuildPaletteBC4(fPalette, pBC, true);
+
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        pColor[i] = HDRColorA(pBC4->R(i), 0.0f, 0.0f, 1.0f);
+        pColor[i] = HDRColorA(fPalette[pBC4->GetIndex(i)], 0.0f, 0.0f, 1.0f);
     }
 }
 
@@ -51,6 +60,9 @@ void EncodeBC4U(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
         theTexelsU[i] = pColor[i].r;
     }
 
+    if (EncodeSolidBC4U(pBC4, theTexelsU))
+        return;
+
     FindEndPointsBC4U(theTexelsU, pBC4->red_0, pBC4->red_1);
     FindClosestUNORM(pBC4, theTexelsU);
 }
@@ -71,8 +83,64 @@ void EncodeBC4S(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
         theTexelsU[i] = pColor[i].r;
     }
 
+    if (EncodeSolidBC4S(pBC4, theTexelsU))
+        return;
+
     FindEndPointsBC4S(theTexelsU, pBC4->red_0, pBC4->red_1);
     FindClosestSNORM(pBC4, theTexelsU);
 }
 
+void EncodeBC4UBatch(uint8_t *pBC, const float *pRed, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    assert(pBC && pRed);
+    EncodeBC4UChannel(pBC, sizeof(BC4_UNORM), pRed, nBlocks);
+}
+
+void EncodeBC4SBatch(uint8_t *pBC, const float *pRed, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    assert(pBC && pRed);
+    EncodeBC4SChannel(pBC, sizeof(BC4_SNORM), pRed, nBlocks);
+}
+
+namespace {
+
+template <void (*pfnEncode)(uint8_t *, size_t, const float *, size_t)>
+void EncodeBC4Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks)
+{
+    assert(pBC && pColor);
+
+    float theTexelsU[BC4_MAX_BATCH * NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < nBlocks; i += BC4_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC4_MAX_BATCH) ? nBlocks - i : BC4_MAX_BATCH;
+        const HDRColorA *pGroup = pColor + i * NUM_PIXELS_PER_BLOCK;
+        for (size_t j = 0; j < nGroup * NUM_PIXELS_PER_BLOCK; ++j)
+        {
+            theTexelsU[j] = pGroup[j].r;
+        }
+
+        pfnEncode(pBC + i * 8, 8, theTexelsU, nGroup);
+    }
+}
+
+}
+
+void EncodeBC4UBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    EncodeBC4Blocks<EncodeBC4UChannel>(pBC, pColor, nBlocks);
+}
+
+void EncodeBC4SBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    EncodeBC4Blocks<EncodeBC4SChannel>(pBC, pColor, nBlocks);
+}
+
 }
@@ -0,0 +1,37 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <immintrin.h>
+
+#include "BC45_simd.hpp"
+#include "BC4Lanes.hpp"
+#include "VecAVX2.hpp"
+
+
+namespace Tex {
+
+void OptimizeBC4BatchAVX2(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels,
+    size_t nBlocks, bool bRange)
+{
+    for (size_t i = 0; i < nBlocks; i += VecAVX2::WIDTH)
+    {
+        const size_t n = (nBlocks - i < VecAVX2::WIDTH) ? nBlocks - i : VecAVX2::WIDTH;
+        const float *pBlocks = pTexels + i * NUM_PIXELS_PER_BLOCK;
+        if (bRange)
+            OptimizeBC4Lanes<VecAVX2, true>(pStart + i, pEnd + i, pSteps + i, pBlocks, n);
+        else
+            OptimizeBC4Lanes<VecAVX2, false>(pStart + i, pEnd + i, pSteps + i, pBlocks, n);
+    }
+}
+
+void FindClosestBC4BatchAVX2(uint8_t *pIndices, const float *pGradients, const float *pTexels,
+    size_t nBlocks)
+{
+    for (size_t i = 0; i < nBlocks; i += VecAVX2::WIDTH)
+    {
+        const size_t n = (nBlocks - i < VecAVX2::WIDTH) ? nBlocks - i : VecAVX2::WIDTH;
+        FindClosestBC4Lanes<VecAVX2>(pIndices + i * NUM_PIXELS_PER_BLOCK, pGradients + i * 8,
+            pTexels + i * NUM_PIXELS_PER_BLOCK, n);
+    }
+}
+
+} // namespace
@@ -1,10 +1,15 @@
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
+#include <float.h>
 #include <cmath>
+#include <algorithm>
 
 #include "BC.hpp"
 #include "BC45_shared.hpp"
+#include "BC45_simd.hpp"
 #include "Colors.hpp"
+#include "CPUFeatures.hpp"
 #include "OptimizeAlpha.hpp"
 
 
@@ -44,10 +49,12 @@ void inline FloatToSNorm(float fVal, int8_t *piSNorm)
 
 
 //------------------------------------------------------------------------------
-void FindEndPointsBC4U(const float* theTexelsU, uint8_t &endpointU_0, uint8_t &endpointU_1)
+// Picks the 6 or 8 step codec and optimizes the (unquantized) endpoints
+template <bool bRange>
+void OptimizeBC4(const float* theTexelsU, float *pStart, float *pEnd, size_t *pSteps)
 {
     // The boundary of codec for signed/unsigned format
-    const float MIN_NORM = 0.f;
+    const float MIN_NORM = (bRange) ? -1.f : 0.f;
     const float MAX_NORM = 1.f;
 
     // Find max/min of input texels
@@ -70,95 +77,69 @@ void FindEndPointsBC4U(const float* theTexelsU, uint8_t &endpointU_0, uint8_t &e
     bool bUsing4BlockCodec = (MIN_NORM == fBlockMin || MAX_NORM == fBlockMax);
 
     // Using Optimize
-    float fStart, fEnd;
+    *pSteps = (!bUsing4BlockCodec) ? 8 : 6;
+    OptimizeAlpha<bRange>(pStart, pEnd, theTexelsU, *pSteps);
+}
+
+void SetEndPointsBC4U(float fStart, float fEnd, size_t uSteps, uint8_t &endpointU_0, uint8_t &endpointU_1)
+{
+    uint8_t iStart = static_cast<uint8_t>(fStart * 255.0f);
+    uint8_t iEnd = static_cast<uint8_t>(fEnd * 255.0f);
 
-    if (!bUsing4BlockCodec)
+    if (8 == uSteps)
     {
         // 6 interpolated color values
-        OptimizeAlpha<false>(&fStart, &fEnd, theTexelsU, 8);
-
-        uint8_t iStart = static_cast<uint8_t>(fStart * 255.0f);
-        uint8_t iEnd = static_cast<uint8_t>(fEnd * 255.0f);
-
         endpointU_0 = iEnd;
         endpointU_1 = iStart;
     }
     else
     {
         // 4 interpolated color values
-        OptimizeAlpha<false>(&fStart, &fEnd, theTexelsU, 6);
-
-        uint8_t iStart = static_cast<uint8_t>(fStart * 255.0f);
-        uint8_t iEnd = static_cast<uint8_t>(fEnd * 255.0f);
-
         endpointU_1 = iEnd;
         endpointU_0 = iStart;
     }
 }
 
-void FindEndPointsBC4S(const float* theTexelsU, int8_t &endpointU_0, int8_t &endpointU_1)
+void SetEndPointsBC4S(float fStart, float fEnd, size_t uSteps, int8_t &endpointU_0, int8_t &endpointU_1)
 {
-    // The boundary of codec for signed/unsigned format
-    const float MIN_NORM = -1.f;
-    const float MAX_NORM = 1.f;
-
-    // Find max/min of input texels
-    float fBlockMax = theTexelsU[0];
-    float fBlockMin = theTexelsU[0];
-    for (size_t i = 0; i < BLOCK_SIZE; ++i)
-    {
-        if (theTexelsU[i] < fBlockMin)
-        {
-            fBlockMin = theTexelsU[i];
-        }
-        else if (theTexelsU[i] > fBlockMax)
-        {
-            fBlockMax = theTexelsU[i];
-        }
-    }
-
-    //  If there are boundary values in input texels, should use 4 interpolated color values to guarantee
-    //  the exact code of the boundary values.
-    bool bUsing4BlockCodec = (MIN_NORM == fBlockMin || MAX_NORM == fBlockMax);
+    int8_t iStart, iEnd;
+    FloatToSNorm(fStart, &iStart);
+    FloatToSNorm(fEnd, &iEnd);
 
-    // Using Optimize
-    float fStart, fEnd;
-
-    if (!bUsing4BlockCodec)
+    if (8 == uSteps)
     {
         // 6 interpolated color values
-        OptimizeAlpha<true>(&fStart, &fEnd, theTexelsU, 8);
-
-        int8_t iStart, iEnd;
-        FloatToSNorm(fStart, &iStart);
-        FloatToSNorm(fEnd, &iEnd);
-
         endpointU_0 = iEnd;
         endpointU_1 = iStart;
     }
     else
     {
         // 4 interpolated color values
-        OptimizeAlpha<true>(&fStart, &fEnd, theTexelsU, 6);
-
-        int8_t iStart, iEnd;
-        FloatToSNorm(fStart, &iStart);
-        FloatToSNorm(fEnd, &iEnd);
-
         endpointU_1 = iEnd;
         endpointU_0 = iStart;
     }
 }
 
-//------------------------------------------------------------------------------
-void FindClosestUNORM(BC4_UNORM* pBC, const float* theTexelsU)
+void FindEndPointsBC4U(const float* theTexelsU, uint8_t &endpointU_0, uint8_t &endpointU_1)
 {
-    float rGradient[8];
-    for (size_t i = 0; i < 8; ++i)
-    {
-        rGradient[i] = pBC->DecodeFromIndex(i);
-    }
+    float fStart, fEnd;
+    size_t uSteps;
+    OptimizeBC4<false>(theTexelsU, &fStart, &fEnd, &uSteps);
+    SetEndPointsBC4U(fStart, fEnd, uSteps, endpointU_0, endpointU_1);
+}
+
+void FindEndPointsBC4S(const float* theTexelsU, int8_t &endpointU_0, int8_t &endpointU_1)
+{
+    float fStart, fEnd;
+    size_t uSteps;
+    OptimizeBC4<true>(theTexelsU, &fStart, &fEnd, &uSteps);
+    SetEndPointsBC4S(fStart, fEnd, uSteps, endpointU_0, endpointU_1);
+}
 
+//------------------------------------------------------------------------------
+// Index of the first gradient value closest to each texel
+void FindClosestIndices(uint8_t *pIndices, const float *rGradient, const float* theTexelsU)
+{
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
         size_t uBestIndex = 0;
@@ -172,11 +153,12 @@ void FindClosestUNORM(BC4_UNORM* pBC, const float* theTexelsU)
                 fBestDelta = fCurrentDelta;
             }
         }
-        pBC->SetIndex(i, uBestIndex);
+        pIndices[i] = (uint8_t)uBestIndex;
     }
 }
 
-void FindClosestSNORM(BC4_SNORM* pBC, const float* theTexelsU)
+template <class Block>
+void FindClosest(Block* pBC, const float* theTexelsU)
 {
     float rGradient[8];
     for (size_t i = 0; i < 8; ++i)
@@ -184,21 +166,410 @@ void FindClosestSNORM(BC4_SNORM* pBC, const float* theTexelsU)
         rGradient[i] = pBC->DecodeFromIndex(i);
     }
 
+    uint8_t uIndices[NUM_PIXELS_PER_BLOCK];
+    FindClosestIndices(uIndices, rGradient, theTexelsU);
+
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        size_t uBestIndex = 0;
-        float fBestDelta = 100000;
-        for (size_t uIndex = 0; uIndex < 8; uIndex++)
+        pBC->SetIndex(i, uIndices[i]);
+    }
+}
+
+void FindClosestUNORM(BC4_UNORM* pBC, const float* theTexelsU)
+{
+    FindClosest(pBC, theTexelsU);
+}
+
+void FindClosestSNORM(BC4_SNORM* pBC, const float* theTexelsU)
+{
+    FindClosest(pBC, theTexelsU);
+}
+
+//------------------------------------------------------------------------------
+// Solid blocks
+//------------------------------------------------------------------------------
+namespace {
+
+// A constant channel lies between two adjacent endpoint values. Interpolants of
+// any endpoint pair sit on multiples of 1/7 (8 step codec) or 1/5 (6 step codec)
+// of one unit, so the closest of the two adjacent pairs in both orders is optimal.
+template <class Block, class Endpoint>
+bool EncodeSolid(Block* pBC, const float* theTexelsU, float fMin, float fScale)
+{
+    const float fValue = theTexelsU[0];
+    for (size_t i = 1; i < BLOCK_SIZE; ++i)
+    {
+        if (theTexelsU[i] != fValue)
+            return false;
+    }
+
+    // NaN fails the comparisons above unless every texel is NaN
+    if (std::isnan(fValue))
+        return false;
+
+    const float fScaled = std::max(fMin, std::min(1.0f, fValue)) * fScale;
+    const Endpoint lo = static_cast<Endpoint>(floorf(fScaled));
+    const Endpoint hi = static_cast<Endpoint>(ceilf(fScaled));
+
+    Block candidate = {};
+    float fBestDelta = FLT_MAX;
+    for (size_t uOrder = 0; uOrder < 2; ++uOrder)
+    {
+        candidate.red_0 = uOrder ? lo : hi;
+        candidate.red_1 = uOrder ? hi : lo;
+        for (size_t uIndex = 0; uIndex < 8; ++uIndex)
         {
-            float fCurrentDelta = fabsf(rGradient[uIndex] - theTexelsU[i]);
-            if (fCurrentDelta < fBestDelta)
+            const float fDelta = fabsf(candidate.DecodeFromIndex(uIndex) - fValue);
+            if (fDelta < fBestDelta)
             {
-                uBestIndex = uIndex;
-                fBestDelta = fCurrentDelta;
+                fBestDelta = fDelta;
+                pBC->red_0 = candidate.red_0;
+                pBC->red_1 = candidate.red_1;
+                for (size_t k = 0; k < BLOCK_SIZE; ++k)
+                    pBC->SetIndex(k, uIndex);
+            }
+        }
+    }
+
+    return true;
+}
+
+}
+
+bool EncodeSolidBC4U(BC4_UNORM* pBC, const float* theTexelsU)
+{
+    return EncodeSolid<BC4_UNORM, uint8_t>(pBC, theTexelsU, 0.0f, 255.0f);
+}
+
+bool EncodeSolidBC4S(BC4_SNORM* pBC, const float* theTexelsU)
+{
+    return EncodeSolid<BC4_SNORM, int8_t>(pBC, theTexelsU, -1.0f, 127.0f);
+}
+
+//------------------------------------------------------------------------------
+// Batch encoding
+//------------------------------------------------------------------------------
+void OptimizeBC4BatchScalar(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels,
+    size_t nBlocks, bool bRange)
+{
+    for (size_t i = 0; i < nBlocks; ++i)
+    {
+        if (bRange)
+            OptimizeBC4<true>(pTexels + i * BLOCK_SIZE, &pStart[i], &pEnd[i], &pSteps[i]);
+        else
+            OptimizeBC4<false>(pTexels + i * BLOCK_SIZE, &pStart[i], &pEnd[i], &pSteps[i]);
+    }
+}
+
+void FindClosestBC4BatchScalar(uint8_t *pIndices, const float *pGradients, const float *pTexels,
+    size_t nBlocks)
+{
+    for (size_t i = 0; i < nBlocks; ++i)
+        FindClosestIndices(pIndices + i * BLOCK_SIZE, pGradients + i * 8, pTexels + i * BLOCK_SIZE);
+}
+
+namespace {
+
+// Kernels picked once for the running CPU, all of them give identical results
+struct BC4Kernels
+{
+    BC4_OPTIMIZE_BATCH pfnOptimize;
+    BC4_FIND_CLOSEST_BATCH pfnFindClosest;
+};
+
+BC4Kernels SelectBC4Kernels()
+{
+#if defined(CROSSTEX_X86_SIMD)
+    const CPUFeatures& features = GetCPUFeatures();
+    if (features.bAVX2)
+        return { OptimizeBC4BatchAVX2, FindClosestBC4BatchAVX2 };
+    if (features.bSSE41)
+        return { OptimizeBC4BatchSSE41, FindClosestBC4BatchSSE41 };
+#endif
+    return { OptimizeBC4BatchScalar, FindClosestBC4BatchScalar };
+}
+
+const BC4Kernels& GetBC4Kernels()
+{
+    static const BC4Kernels kernels = SelectBC4Kernels();
+    return kernels;
+}
+
+void SetEndPoints(BC4_UNORM* pBC, float fStart, float fEnd, size_t uSteps)
+{
+    SetEndPointsBC4U(fStart, fEnd, uSteps, pBC->red_0, pBC->red_1);
+}
+
+void SetEndPoints(BC4_SNORM* pBC, float fStart, float fEnd, size_t uSteps)
+{
+    SetEndPointsBC4S(fStart, fEnd, uSteps, pBC->red_0, pBC->red_1);
+}
+
+bool EncodeSolid(BC4_UNORM* pBC, const float* theTexelsU)
+{
+    return EncodeSolidBC4U(pBC, theTexelsU);
+}
+
+bool EncodeSolid(BC4_SNORM* pBC, const float* theTexelsU)
+{
+    return EncodeSolidBC4S(pBC, theTexelsU);
+}
+
+// Encodes nBlocks <= BC4_MAX_BATCH blocks, block j goes to pBC + puBlock[j] * stride
+template <class Block>
+void EncodeBC4Group(uint8_t *pBC, size_t stride, const size_t *puBlock, const float *pTexels,
+    size_t nBlocks, bool bRange)
+{
+    const BC4Kernels& kernels = GetBC4Kernels();
+
+    float fStart[BC4_MAX_BATCH], fEnd[BC4_MAX_BATCH];
+    size_t uSteps[BC4_MAX_BATCH];
+    float rGradients[BC4_MAX_BATCH * 8];
+    uint8_t uIndices[BC4_MAX_BATCH * BLOCK_SIZE];
+
+    kernels.pfnOptimize(fStart, fEnd, uSteps, pTexels, nBlocks, bRange);
+
+    for (size_t j = 0; j < nBlocks; ++j)
+    {
+        auto pBlock = reinterpret_cast<Block*>(pBC + puBlock[j] * stride);
+        SetEndPoints(pBlock, fStart[j], fEnd[j], uSteps[j]);
+        for (size_t k = 0; k < 8; ++k)
+            rGradients[j * 8 + k] = pBlock->DecodeFromIndex(k);
+    }
+
+    kernels.pfnFindClosest(uIndices, rGradients, pTexels, nBlocks);
+
+    for (size_t j = 0; j < nBlocks; ++j)
+    {
+        auto pBlock = reinterpret_cast<Block*>(pBC + puBlock[j] * stride);
+        for (size_t k = 0; k < BLOCK_SIZE; ++k)
+            pBlock->SetIndex(k, uIndices[j * BLOCK_SIZE + k]);
+    }
+}
+
+// Solid blocks are written directly, the others are gathered into groups for the kernels
+template <class Block>
+void EncodeBC4Batch(uint8_t *pBC, size_t stride, const float *pTexels, size_t nBlocks, bool bRange)
+{
+    float fTexels[BC4_MAX_BATCH * BLOCK_SIZE];
+    size_t uBlock[BC4_MAX_BATCH];
+    size_t nPending = 0;
+
+    for (size_t i = 0; i < nBlocks; ++i)
+    {
+        auto pBlock = reinterpret_cast<Block*>(pBC + i * stride);
+        const float *pBlockTexels = pTexels + i * BLOCK_SIZE;
+        memset(pBlock, 0, sizeof(Block));
+        if (EncodeSolid(pBlock, pBlockTexels))
+            continue;
+
+        memcpy(fTexels + nPending * BLOCK_SIZE, pBlockTexels, BLOCK_SIZE * sizeof(float));
+        uBlock[nPending++] = i;
+        if (nPending == BC4_MAX_BATCH)
+        {
+            EncodeBC4Group<Block>(pBC, stride, uBlock, fTexels, nPending, bRange);
+            nPending = 0;
+        }
+    }
+
+    if (nPending)
+        EncodeBC4Group<Block>(pBC, stride, uBlock, fTexels, nPending, bRange);
+}
+
+}
+
+void EncodeBC4UChannel(uint8_t *pBC, size_t stride, const float *pTexels, size_t nBlocks)
+{
+    EncodeBC4Batch<BC4_UNORM>(pBC, stride, pTexels, nBlocks, false);
+}
+
+void EncodeBC4SChannel(uint8_t *pBC, size_t stride, const float *pTexels, size_t nBlocks)
+{
+    EncodeBC4Batch<BC4_SNORM>(pBC, stride, pTexels, nBlocks, true);
+}
+
+
+//------------------------------------------------------------------------------
+// Row decoding
+//------------------------------------------------------------------------------
+namespace {
+
+void ConvertNorm(float fVal, float *pVal)
+{
+    *pVal = fVal;
+}
+
+void ConvertNorm(float fVal, uint8_t *pVal)
+{
+    *pVal = static_cast<uint8_t>(fVal * 255.0f + 0.5f);
+}
+
+void ConvertNorm(float fVal, uint16_t *pVal)
+{
+    *pVal = static_cast<uint16_t>(fVal * 65535.0f + 0.5f);
+}
+
+void ConvertNorm(float fVal, int8_t *pVal)
+{
+    FloatToSNorm(fVal, pVal);
+}
+
+void ConvertNorm(float fVal, int16_t *pVal)
+{
+    fVal *= 32767.0f;
+    *pVal = static_cast<int16_t>((fVal >= 0) ? fVal + 0.5f : fVal - 0.5f);
+}
+
+template <typename Block, typename T>
+void BuildPalette(T aPalette[8], const uint8_t *pBC)
+{
+    auto pBC4 = reinterpret_cast<const Block *>(pBC);
+    for (size_t i = 0; i < 8; ++i)
+        ConvertNorm(pBC4->DecodeFromIndex(i), &aPalette[i]);
+}
+
+}
+
+template <typename T>
+void BuildPaletteBC4(T aPalette[8], const uint8_t *pBC, bool bSigned)
+{
+    if (bSigned)
+        BuildPalette<BC4_SNORM>(aPalette, pBC);
+    else
+        BuildPalette<BC4_UNORM>(aPalette, pBC);
+}
+
+template void BuildPaletteBC4<float>(float aPalette[8], const uint8_t *pBC, bool bSigned);
+template void BuildPaletteBC4<uint8_t>(uint8_t aPalette[8], const uint8_t *pBC, bool bSigned);
+template void BuildPaletteBC4<uint16_t>(uint16_t aPalette[8], const uint8_t *pBC, bool bSigned);
+template void BuildPaletteBC4<int8_t>(int8_t aPalette[8], const uint8_t *pBC, bool bSigned);
+template void BuildPaletteBC4<int16_t>(int16_t aPalette[8], const uint8_t *pBC, bool bSigned);
+
+namespace {
+
+template <bool bBC5, bool bSigned, typename T>
+void DecodeRowScalar(void *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    const size_t nChannels = bBC5 ? 2 : 1;
+    for (size_t i = 0; i < nBlocks; ++i)
+    {
+        for (size_t c = 0; c < nChannels; ++c, pBC += sizeof(BC4_UNORM))
+        {
+            T aPalette[8];
+            BuildPaletteBC4(aPalette, pBC, bSigned);
+
+            uint64_t dw = 0;
+            memcpy(&dw, pBC, sizeof(dw));
+            dw >>= 16;
+            for (size_t j = 0; j < BLOCK_SIZE; ++j, dw >>= 3)
+            {
+                auto pRow = reinterpret_cast<T *>(static_cast<uint8_t *>(pDst) + (j / BLOCK_LEN) * rowPitch);
+                pRow[(i * BLOCK_LEN + j % BLOCK_LEN) * nChannels + c] = aPalette[dw & 7];
             }
         }
-        pBC->SetIndex(i, uBestIndex);
     }
 }
 
 }
+
+void GetDecodeKernelsScalar(BC45DecodeKernels& kernels)
+{
+    kernels.pfnDecodeRow[0][0][BC45_DECODE_8] = DecodeRowScalar<false, false, uint8_t>;
+    kernels.pfnDecodeRow[0][0][BC45_DECODE_16] = DecodeRowScalar<false, false, uint16_t>;
+    kernels.pfnDecodeRow[0][0][BC45_DECODE_FLOAT] = DecodeRowScalar<false, false, float>;
+    kernels.pfnDecodeRow[0][1][BC45_DECODE_8] = DecodeRowScalar<false, true, int8_t>;
+    kernels.pfnDecodeRow[0][1][BC45_DECODE_16] = DecodeRowScalar<false, true, int16_t>;
+    kernels.pfnDecodeRow[0][1][BC45_DECODE_FLOAT] = DecodeRowScalar<false, true, float>;
+    kernels.pfnDecodeRow[1][0][BC45_DECODE_8] = DecodeRowScalar<true, false, uint8_t>;
+    kernels.pfnDecodeRow[1][0][BC45_DECODE_16] = DecodeRowScalar<true, false, uint16_t>;
+    kernels.pfnDecodeRow[1][0][BC45_DECODE_FLOAT] = DecodeRowScalar<true, false, float>;
+    kernels.pfnDecodeRow[1][1][BC45_DECODE_8] = DecodeRowScalar<true, true, int8_t>;
+    kernels.pfnDecodeRow[1][1][BC45_DECODE_16] = DecodeRowScalar<true, true, int16_t>;
+    kernels.pfnDecodeRow[1][1][BC45_DECODE_FLOAT] = DecodeRowScalar<true, true, float>;
+}
+
+namespace {
+
+BC45DecodeKernels SelectDecodeKernels()
+{
+    BC45DecodeKernels kernels;
+#if defined(CROSSTEX_X86_SIMD)
+    if (GetCPUFeatures().bSSE41)
+    {
+        GetDecodeKernelsSSE41(kernels);
+        return kernels;
+    }
+#endif
+    GetDecodeKernelsScalar(kernels);
+    return kernels;
+}
+
+const BC45DecodeKernels& GetDecodeKernels()
+{
+    static const BC45DecodeKernels kernels = SelectDecodeKernels();
+    return kernels;
+}
+
+}
+
+void DecodeBC4URow(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[0][0][BC45_DECODE_8](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC4URow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[0][0][BC45_DECODE_16](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC4URow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[0][0][BC45_DECODE_FLOAT](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC4SRow(int8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[0][1][BC45_DECODE_8](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC4SRow(int16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[0][1][BC45_DECODE_16](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC4SRow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[0][1][BC45_DECODE_FLOAT](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC5URow(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[1][0][BC45_DECODE_8](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC5URow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[1][0][BC45_DECODE_16](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC5URow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[1][0][BC45_DECODE_FLOAT](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC5SRow(int8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[1][1][BC45_DECODE_8](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC5SRow(int16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[1][1][BC45_DECODE_16](pDst, rowPitch, pBC, nBlocks);
+}
+
+void DecodeBC5SRow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    GetDecodeKernels().pfnDecodeRow[1][1][BC45_DECODE_FLOAT](pDst, rowPitch, pBC, nBlocks);
+}
+
+}
@@ -126,4 +126,27 @@ void FindEndPointsBC4S(const float* theTexelsU, int8_t &endpointU_0, int8_t &end
 void FindClosestUNORM(BC4_UNORM* pBC, const float* theTexelsU);
 void FindClosestSNORM(BC4_SNORM* pBC, const float* theTexelsU);
 
+// The 8 decoded values of the BC4U or BC4S block at pBC as float, uint8_t/uint16_t
+// for BC4U or int8_t/int16_t for BC4S. Integer entries are the float values
+// rounded to UNORM/SNORM.
+template <typename T>
+void BuildPaletteBC4(T aPalette[8], const uint8_t *pBC, bool bSigned);
+
+// Writes the optimal block for a channel with a single value, returns false and
+// leaves the block untouched when the texels differ
+bool EncodeSolidBC4U(BC4_UNORM* pBC, const float* theTexelsU);
+bool EncodeSolidBC4S(BC4_SNORM* pBC, const float* theTexelsU);
+
+// Encodes nBlocks single channel blocks of 16 texels each, block i is written to
+// pBC + i * stride
+void EncodeBC4UChannel(uint8_t *pBC, size_t stride, const float *pTexels, size_t nBlocks);
+void EncodeBC4SChannel(uint8_t *pBC, size_t stride, const float *pTexels, size_t nBlocks);
+
+// Batched forms of the EncodeBC4/5 entry points for nBlocks consecutive blocks,
+// pColor holds the texels block after block
+void EncodeBC4UBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC4SBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC5UBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+void EncodeBC5SBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+
 }
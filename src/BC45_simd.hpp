@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// BC4/BC5 batch kernels
+//
+// Texels are block-major, 16 floats per block. Every variant performs the
+// operations of the scalar BC4 code in the same order, so all of them produce
+// bit-identical blocks.
+//-------------------------------------------------------------------------------------
+
+// Blocks handled per kernel call by the batch encoders
+const size_t BC4_MAX_BATCH = 16;
+
+// Endpoint search: unclamped start/end values and the step count (6 or 8) per block
+typedef void (*BC4_OPTIMIZE_BATCH)(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels,
+    size_t nBlocks, bool bRange);
+
+// Index search against 8 gradient values per block, 16 indices per block
+typedef void (*BC4_FIND_CLOSEST_BATCH)(uint8_t *pIndices, const float *pGradients, const float *pTexels,
+    size_t nBlocks);
+
+#if defined(CROSSTEX_X86_SIMD)
+void OptimizeBC4BatchSSE41(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels,
+    size_t nBlocks, bool bRange);
+void FindClosestBC4BatchSSE41(uint8_t *pIndices, const float *pGradients, const float *pTexels,
+    size_t nBlocks);
+
+void OptimizeBC4BatchAVX2(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels,
+    size_t nBlocks, bool bRange);
+void FindClosestBC4BatchAVX2(uint8_t *pIndices, const float *pGradients, const float *pTexels,
+    size_t nBlocks);
+#endif
+
+
+//-------------------------------------------------------------------------------------
+// BC4/BC5 row decoder kernels
+//
+// A kernel decodes nBlocks blocks lying side by side into 4 rows rowPitch bytes
+// apart, BC5 interleaving red and green. The 8 palette entries of a block are
+// computed once with the operations of BC4_UNORM::DecodeFromIndex and converted
+// to the output type, so every variant writes the same values.
+//-------------------------------------------------------------------------------------
+
+enum BC45_DECODE_TYPE
+{
+    BC45_DECODE_8,          // uint8_t, int8_t for the signed formats
+    BC45_DECODE_16,         // uint16_t, int16_t for the signed formats
+    BC45_DECODE_FLOAT,
+    BC45_DECODE_TYPES
+};
+
+typedef void (*BC45_DECODE_ROW)(void *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+// Kernels indexed by [BC5][signed][BC45_DECODE_TYPE]
+struct BC45DecodeKernels
+{
+    BC45_DECODE_ROW pfnDecodeRow[2][2][BC45_DECODE_TYPES];
+};
+
+void GetDecodeKernelsScalar(BC45DecodeKernels& kernels);
+#if defined(CROSSTEX_X86_SIMD)
+void GetDecodeKernelsSSE41(BC45DecodeKernels& kernels);
+#endif
+
+} // namespace
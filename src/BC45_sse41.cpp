@@ -0,0 +1,247 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <smmintrin.h>
+
+#include "BC45_simd.hpp"
+#include "BC4Lanes.hpp"
+#include "DecodeLanes.hpp"
+#include "VecSSE41.hpp"
+
+
+namespace Tex {
+
+void OptimizeBC4BatchSSE41(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels,
+    size_t nBlocks, bool bRange)
+{
+    for (size_t i = 0; i < nBlocks; i += VecSSE41::WIDTH)
+    {
+        const size_t n = (nBlocks - i < VecSSE41::WIDTH) ? nBlocks - i : VecSSE41::WIDTH;
+        const float *pBlocks = pTexels + i * NUM_PIXELS_PER_BLOCK;
+        if (bRange)
+            OptimizeBC4Lanes<VecSSE41, true>(pStart + i, pEnd + i, pSteps + i, pBlocks, n);
+        else
+            OptimizeBC4Lanes<VecSSE41, false>(pStart + i, pEnd + i, pSteps + i, pBlocks, n);
+    }
+}
+
+void FindClosestBC4BatchSSE41(uint8_t *pIndices, const float *pGradients, const float *pTexels,
+    size_t nBlocks)
+{
+    for (size_t i = 0; i < nBlocks; i += VecSSE41::WIDTH)
+    {
+        const size_t n = (nBlocks - i < VecSSE41::WIDTH) ? nBlocks - i : VecSSE41::WIDTH;
+        FindClosestBC4Lanes<VecSSE41>(pIndices + i * NUM_PIXELS_PER_BLOCK, pGradients + i * 8,
+            pTexels + i * NUM_PIXELS_PER_BLOCK, n);
+    }
+}
+
+namespace {
+
+// The 8 palette entries of a BC4 block in two registers, computed with the
+// operations of BC4_UNORM/BC4_SNORM::DecodeFromIndex in the same order
+inline void BuildPaletteLanes(__m128 *pLo, __m128 *pHi, const uint8_t *pBC, bool bSigned)
+{
+    int e0, e1;
+    bool b8Steps;
+    float fScale, fMin;
+    if (bSigned)
+    {
+        const int8_t red_0 = int8_t(pBC[0]);
+        const int8_t red_1 = int8_t(pBC[1]);
+        e0 = (red_0 == -128) ? -127 : red_0;
+        e1 = (red_1 == -128) ? -127 : red_1;
+        b8Steps = red_0 > red_1;
+        fScale = 127.0f;
+        fMin = -1.0f;
+    }
+    else
+    {
+        e0 = pBC[0];
+        e1 = pBC[1];
+        b8Steps = e0 > e1;
+        fScale = 255.0f;
+        fMin = 0.0f;
+    }
+
+    const __m128 f0 = _mm_div_ps(_mm_set1_ps(float(e0)), _mm_set1_ps(fScale));
+    const __m128 f1 = _mm_div_ps(_mm_set1_ps(float(e1)), _mm_set1_ps(fScale));
+    __m128 lo, hi;
+    if (b8Steps)
+    {
+        const __m128 d = _mm_set1_ps(7.0f);
+        lo = _mm_div_ps(_mm_add_ps(_mm_mul_ps(f0, _mm_setr_ps(0, 0, 6, 5)), _mm_mul_ps(f1, _mm_setr_ps(0, 0, 1, 2))), d);
+        hi = _mm_div_ps(_mm_add_ps(_mm_mul_ps(f0, _mm_setr_ps(4, 3, 2, 1)), _mm_mul_ps(f1, _mm_setr_ps(3, 4, 5, 6))), d);
+    }
+    else
+    {
+        const __m128 d = _mm_set1_ps(5.0f);
+        lo = _mm_div_ps(_mm_add_ps(_mm_mul_ps(f0, _mm_setr_ps(0, 0, 4, 3)), _mm_mul_ps(f1, _mm_setr_ps(0, 0, 1, 2))), d);
+        hi = _mm_div_ps(_mm_add_ps(_mm_mul_ps(f0, _mm_setr_ps(2, 1, 0, 0)), _mm_mul_ps(f1, _mm_setr_ps(3, 4, 0, 0))), d);
+        hi = _mm_blend_ps(hi, _mm_setr_ps(0, 0, fMin, 1.0f), 0xc);
+    }
+    *pLo = _mm_blend_ps(lo, _mm_unpacklo_ps(f0, f1), 0x3);
+    *pHi = hi;
+}
+
+// Float to UNORM/SNORM as in ConvertNorm, two registers of 4 values to 8 values of T
+inline __m128i ConvertNormLanes(__m128 lo, __m128 hi, bool bSigned, float fScale)
+{
+    lo = _mm_mul_ps(lo, _mm_set1_ps(fScale));
+    hi = _mm_mul_ps(hi, _mm_set1_ps(fScale));
+    if (bSigned)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        lo = _mm_add_ps(lo, _mm_blendv_ps(_mm_set1_ps(0.5f), _mm_set1_ps(-0.5f), _mm_cmplt_ps(lo, zero)));
+        hi = _mm_add_ps(hi, _mm_blendv_ps(_mm_set1_ps(0.5f), _mm_set1_ps(-0.5f), _mm_cmplt_ps(hi, zero)));
+        return _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+    }
+
+    lo = _mm_add_ps(lo, _mm_set1_ps(0.5f));
+    hi = _mm_add_ps(hi, _mm_set1_ps(0.5f));
+    return _mm_packus_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+}
+
+// The 16 texels of a BC4 block looked up in its palette, in texel order over
+// sizeof(T) registers
+template <typename T>
+inline void LookupBlock(__m128i *pTexels, const uint8_t *pBC, bool bSigned)
+{
+    __m128 paletteLoF, paletteHiF;
+    BuildPaletteLanes(&paletteLoF, &paletteHiF, pBC, bSigned);
+    const __m128i indices = ExpandIndices3(pBC);
+
+    if (sizeof(T) == 1)
+    {
+        const __m128i palette16 = ConvertNormLanes(paletteLoF, paletteHiF, bSigned, bSigned ? 127.0f : 255.0f);
+        const __m128i palette = bSigned ? _mm_packs_epi16(palette16, palette16) : _mm_packus_epi16(palette16, palette16);
+        pTexels[0] = _mm_shuffle_epi8(palette, indices);
+    }
+    else if (sizeof(T) == 2)
+    {
+        const __m128i palette = ConvertNormLanes(paletteLoF, paletteHiF, bSigned, bSigned ? 32767.0f : 65535.0f);
+        const __m128i lo = _mm_add_epi8(indices, indices);
+        const __m128i hi = _mm_add_epi8(lo, _mm_set1_epi8(1));
+        pTexels[0] = _mm_shuffle_epi8(palette, _mm_unpacklo_epi8(lo, hi));
+        pTexels[1] = _mm_shuffle_epi8(palette, _mm_unpackhi_epi8(lo, hi));
+    }
+    else
+    {
+        // Entries 0-3 and 4-7 live in separate registers, bit 2 of the index picks one
+        const __m128i paletteLo = _mm_castps_si128(paletteLoF);
+        const __m128i paletteHi = _mm_castps_si128(paletteHiF);
+        const __m128i bytes = _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+        for (size_t y = 0; y < 4; ++y)
+        {
+            const char b = char(4 * y);
+            const __m128i spread = _mm_shuffle_epi8(indices, _mm_setr_epi8(b, b, b, b,
+                char(b + 1), char(b + 1), char(b + 1), char(b + 1), char(b + 2), char(b + 2), char(b + 2), char(b + 2),
+                char(b + 3), char(b + 3), char(b + 3), char(b + 3)));
+            const __m128i shuffle = _mm_add_epi8(_mm_slli_epi16(_mm_and_si128(spread, _mm_set1_epi8(3)), 2), bytes);
+            pTexels[y] = _mm_blendv_epi8(_mm_shuffle_epi8(paletteLo, shuffle), _mm_shuffle_epi8(paletteHi, shuffle),
+                _mm_cmpgt_epi8(spread, _mm_set1_epi8(3)));
+        }
+    }
+}
+
+// Interleaves the red and green texels of a BC5 block, doubling the registers
+template <typename T>
+inline void InterleaveBlock(__m128i *pTexels, const __m128i *pRed, const __m128i *pGreen)
+{
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        if (sizeof(T) == 1)
+        {
+            pTexels[2 * i] = _mm_unpacklo_epi8(pRed[i], pGreen[i]);
+            pTexels[2 * i + 1] = _mm_unpackhi_epi8(pRed[i], pGreen[i]);
+        }
+        else if (sizeof(T) == 2)
+        {
+            pTexels[2 * i] = _mm_unpacklo_epi16(pRed[i], pGreen[i]);
+            pTexels[2 * i + 1] = _mm_unpackhi_epi16(pRed[i], pGreen[i]);
+        }
+        else
+        {
+            pTexels[2 * i] = _mm_unpacklo_epi32(pRed[i], pGreen[i]);
+            pTexels[2 * i + 1] = _mm_unpackhi_epi32(pRed[i], pGreen[i]);
+        }
+    }
+}
+
+// Writes the 4 rows of rowBytes bytes held by rowBytes / 4 registers
+inline void StoreBlock(uint8_t *pDst, size_t rowPitch, const __m128i *pTexels, size_t rowBytes)
+{
+    switch (rowBytes)
+    {
+    case 4:
+    {
+        alignas(16) uint8_t aTexels[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(aTexels), pTexels[0]);
+        for (size_t y = 0; y < 4; ++y)
+            memcpy(pDst + y * rowPitch, aTexels + 4 * y, 4);
+        break;
+    }
+
+    case 8:
+        for (size_t y = 0; y < 4; y += 2)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(pDst + y * rowPitch), pTexels[y / 2]);
+            _mm_storeh_pi(reinterpret_cast<__m64 *>(pDst + (y + 1) * rowPitch), _mm_castsi128_ps(pTexels[y / 2]));
+        }
+        break;
+
+    default:
+        for (size_t y = 0; y < 4; ++y)
+        {
+            for (size_t i = 0; i < rowBytes / 16; ++i)
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + y * rowPitch) + i, pTexels[y * (rowBytes / 16) + i]);
+        }
+        break;
+    }
+}
+
+template <bool bBC5, bool bSigned, typename T>
+void DecodeRow(void *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    const size_t rowBytes = 4 * sizeof(T) * (bBC5 ? 2 : 1);
+    auto pOut = static_cast<uint8_t *>(pDst);
+    for (size_t i = 0; i < nBlocks; ++i, pOut += rowBytes)
+    {
+        __m128i aRed[sizeof(T)];
+        LookupBlock<T>(aRed, pBC, bSigned);
+        pBC += 8;
+
+        if (bBC5)
+        {
+            __m128i aGreen[sizeof(T)], aTexels[2 * sizeof(T)];
+            LookupBlock<T>(aGreen, pBC, bSigned);
+            pBC += 8;
+            InterleaveBlock<T>(aTexels, aRed, aGreen);
+            StoreBlock(pOut, rowPitch, aTexels, rowBytes);
+        }
+        else
+        {
+            StoreBlock(pOut, rowPitch, aRed, rowBytes);
+        }
+    }
+}
+
+}
+
+void GetDecodeKernelsSSE41(BC45DecodeKernels& kernels)
+{
+    kernels.pfnDecodeRow[0][0][BC45_DECODE_8] = DecodeRow<false, false, uint8_t>;
+    kernels.pfnDecodeRow[0][0][BC45_DECODE_16] = DecodeRow<false, false, uint16_t>;
+    kernels.pfnDecodeRow[0][0][BC45_DECODE_FLOAT] = DecodeRow<false, false, float>;
+    kernels.pfnDecodeRow[0][1][BC45_DECODE_8] = DecodeRow<false, true, int8_t>;
+    kernels.pfnDecodeRow[0][1][BC45_DECODE_16] = DecodeRow<false, true, int16_t>;
+    kernels.pfnDecodeRow[0][1][BC45_DECODE_FLOAT] = DecodeRow<false, true, float>;
+    kernels.pfnDecodeRow[1][0][BC45_DECODE_8] = DecodeRow<true, false, uint8_t>;
+    kernels.pfnDecodeRow[1][0][BC45_DECODE_16] = DecodeRow<true, false, uint16_t>;
+    kernels.pfnDecodeRow[1][0][BC45_DECODE_FLOAT] = DecodeRow<true, false, float>;
+    kernels.pfnDecodeRow[1][1][BC45_DECODE_8] = DecodeRow<true, true, int8_t>;
+    kernels.pfnDecodeRow[1][1][BC45_DECODE_16] = DecodeRow<true, true, int16_t>;
+    kernels.pfnDecodeRow[1][1][BC45_DECODE_FLOAT] = DecodeRow<true, true, float>;
+}
+
+} // namespace
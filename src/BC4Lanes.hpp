@@ -0,0 +1,202 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BC.hpp"
+
+
+namespace Tex {
+
+// Transposes nBlocks blocks of N floats each into lane order, unused lanes
+// repeat the first block
+template <class V, size_t N>
+void TransposeLanes(float (*aOut)[V::WIDTH], const float *pIn, size_t nBlocks)
+{
+    for (size_t l = 0; l < V::WIDTH; ++l)
+    {
+        const float *pBlock = pIn + ((l < nBlocks) ? l : 0) * N;
+        for (size_t i = 0; i < N; ++i)
+            aOut[i][l] = pBlock[i];
+    }
+}
+
+// The endpoint search of FindEndPointsBC4U/S (the 6/8 step choice and
+// OptimizeAlpha) for V::WIDTH blocks, one block per lane. Each lane runs the
+// operations of the scalar version in the same order.
+template <class V, bool bRange>
+void OptimizeBC4Lanes(float *pStart, float *pEnd, size_t *pSteps, const float *pTexels, size_t nBlocks)
+{
+    typedef typename V::F F;
+    const size_t W = V::WIDTH;
+    assert(nBlocks > 0 && nBlocks <= W);
+
+    static const float pC6[] = { 5.0f / 5.0f, 4.0f / 5.0f, 3.0f / 5.0f, 2.0f / 5.0f, 1.0f / 5.0f, 0.0f / 5.0f, 0.0f, 0.0f };
+    static const float pD6[] = { 0.0f / 5.0f, 1.0f / 5.0f, 2.0f / 5.0f, 3.0f / 5.0f, 4.0f / 5.0f, 5.0f / 5.0f, 0.0f, 0.0f };
+    static const float pC8[] = { 7.0f / 7.0f, 6.0f / 7.0f, 5.0f / 7.0f, 4.0f / 7.0f, 3.0f / 7.0f, 2.0f / 7.0f, 1.0f / 7.0f, 0.0f / 7.0f };
+    static const float pD8[] = { 0.0f / 7.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f, 7.0f / 7.0f };
+
+    alignas(32) float aT[NUM_PIXELS_PER_BLOCK][W];
+    TransposeLanes<V, NUM_PIXELS_PER_BLOCK>(aT, pTexels, nBlocks);
+
+    const F zero = V::Zero();
+    const F all = V::CmpEQ(zero, zero);
+    const F half = V::Set1(0.5f);
+    const F vMin = V::Set1((bRange) ? -1.0f : 0.0f);
+    const F vMax = V::Set1(1.0f);
+
+    // Boundary values in the block need the 6 step codec for exact codes
+    F fBlockMin = V::Load(aT[0]);
+    F fBlockMax = fBlockMin;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        const F t = V::Load(aT[i]);
+        fBlockMin = V::Min(t, fBlockMin);
+        fBlockMax = V::Max(t, fBlockMax);
+    }
+
+    const F b6 = V::Or(V::CmpEQ(fBlockMin, vMin), V::CmpEQ(fBlockMax, vMax));
+    const F b8 = V::AndNot(b6, all);
+    const F fSteps = V::Select(V::Set1(7.0f), V::Set1(5.0f), b6);
+    const F fNumSteps = V::Add(fSteps, V::Set1(1.0f));
+
+    F C[8], D[8];
+    for (size_t k = 0; k < 8; ++k)
+    {
+        C[k] = V::Select(V::Set1(pC8[k]), V::Set1(pC6[k]), b6);
+        D[k] = V::Select(V::Set1(pD8[k]), V::Set1(pD6[k]), b6);
+    }
+
+    // Find Min and Max points, as starting point. The 6 step codec skips the
+    // values it can represent exactly.
+    F fX = vMax;
+    F fY = vMin;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        const F t = V::Load(aT[i]);
+        fX = V::Select(fX, t, V::And(V::CmpLT(t, fX), V::Or(b8, V::CmpGT(t, vMin))));
+        fY = V::Select(fY, t, V::And(V::CmpGT(t, fY), V::Or(b8, V::CmpLT(t, vMax))));
+    }
+    fY = V::Select(fY, vMax, V::And(b6, V::CmpEQ(fX, fY)));
+
+    // Use Newton's Method to find local minima of sum-of-squares error.
+    F active = all;
+    for (size_t iIteration = 0; iIteration < 8; iIteration++)
+    {
+        active = V::AndNot(V::CmpLT(V::Sub(fY, fX), V::Set1(1.0f / 256.0f)), active);
+        if (!V::MoveMask(active))
+            break;
+
+        const F fScale = V::Div(fSteps, V::Sub(fY, fX));
+
+        // Calculate new steps
+        F S[8];
+        for (size_t k = 0; k < 8; ++k)
+            S[k] = V::Add(V::Mul(C[k], fX), V::Mul(D[k], fY));
+        S[6] = V::Select(S[6], vMin, b6);
+        S[7] = V::Select(S[7], vMax, b6);
+
+        // Evaluate function, and derivatives
+        F dX = zero, dY = zero, d2X = zero, d2Y = zero;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const F t = V::Load(aT[i]);
+            const F fDot = V::Mul(V::Sub(t, fX), fScale);
+
+            const F fLow = V::And(V::And(b6, V::CmpLE(t, V::Mul(fX, half))), V::Set1(6.0f));
+            const F fHigh = V::Select(fSteps, V::Set1(7.0f), V::And(b6, V::CmpGE(t, V::Mul(V::Add(fY, vMax), half))));
+
+            F fStep = V::Trunc(V::Add(fDot, half));
+            fStep = V::Select(fStep, fHigh, V::CmpGE(fDot, fSteps));
+            fStep = V::Select(fStep, fLow, V::CmpLE(fDot, zero));
+
+            F Cs = C[0], Ds = D[0], Ss = S[0];
+            for (size_t k = 1; k < 8; ++k)
+            {
+                const F m = V::CmpEQ(fStep, V::Set1((float)k));
+                Cs = V::Select(Cs, C[k], m);
+                Ds = V::Select(Ds, D[k], m);
+                Ss = V::Select(Ss, S[k], m);
+            }
+
+            // Steps 6 and 7 of the 6 step codec are fixed
+            const F bUsed = V::CmpLT(fStep, fNumSteps);
+            const F fDiff = V::Sub(Ss, t);
+
+            dX = V::Select(dX, V::Add(dX, V::Mul(Cs, fDiff)), bUsed);
+            d2X = V::Select(d2X, V::Add(d2X, V::Mul(Cs, Cs)), bUsed);
+            dY = V::Select(dY, V::Add(dY, V::Mul(Ds, fDiff)), bUsed);
+            d2Y = V::Select(d2Y, V::Add(d2Y, V::Mul(Ds, Ds)), bUsed);
+        }
+
+        // Move endpoints
+        fX = V::Select(fX, V::Sub(fX, V::Div(dX, d2X)), V::And(active, V::CmpGT(d2X, zero)));
+        fY = V::Select(fY, V::Sub(fY, V::Div(dY, d2Y)), V::And(active, V::CmpGT(d2Y, zero)));
+
+        const F bSwap = V::And(active, V::CmpGT(fX, fY));
+        const F f = fX;
+        fX = V::Select(fX, fY, bSwap);
+        fY = V::Select(fY, f, bSwap);
+
+        const F fLimit = V::Set1(1.0f / 64.0f);
+        active = V::AndNot(V::And(V::CmpLT(V::Mul(dX, dX), fLimit), V::CmpLT(V::Mul(dY, dY), fLimit)), active);
+    }
+
+    fX = V::Select(V::Select(fX, vMax, V::CmpGT(fX, vMax)), vMin, V::CmpLT(fX, vMin));
+    fY = V::Select(V::Select(fY, vMax, V::CmpGT(fY, vMax)), vMin, V::CmpLT(fY, vMin));
+
+    alignas(32) float aX[W], aY[W];
+    alignas(32) float a6[W];
+    V::Store(aX, fX);
+    V::Store(aY, fY);
+    V::Store(a6, V::And(b6, vMax));
+    for (size_t l = 0; l < nBlocks; ++l)
+    {
+        pStart[l] = aX[l];
+        pEnd[l] = aY[l];
+        pSteps[l] = (a6[l] != 0.0f) ? 6 : 8;
+    }
+}
+
+// The index search of FindClosestUNORM/SNORM for V::WIDTH blocks, one block per
+// lane: the first of the 8 gradient values closest to each texel
+template <class V>
+void FindClosestBC4Lanes(uint8_t *pIndices, const float *pGradients, const float *pTexels, size_t nBlocks)
+{
+    typedef typename V::F F;
+    const size_t W = V::WIDTH;
+    assert(nBlocks > 0 && nBlocks <= W);
+
+    alignas(32) float aT[NUM_PIXELS_PER_BLOCK][W];
+    alignas(32) float aG[8][W];
+    TransposeLanes<V, NUM_PIXELS_PER_BLOCK>(aT, pTexels, nBlocks);
+    TransposeLanes<V, 8>(aG, pGradients, nBlocks);
+
+    F G[8];
+    for (size_t k = 0; k < 8; ++k)
+        G[k] = V::Load(aG[k]);
+
+    alignas(32) float aIndex[NUM_PIXELS_PER_BLOCK][W];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        const F t = V::Load(aT[i]);
+        F fBestDelta = V::Set1(100000.0f);
+        F fBestIndex = V::Zero();
+        for (size_t k = 0; k < 8; ++k)
+        {
+            const F fDelta = V::Abs(V::Sub(G[k], t));
+            const F bBetter = V::CmpLT(fDelta, fBestDelta);
+            fBestIndex = V::Select(fBestIndex, V::Set1((float)k), bBetter);
+            fBestDelta = V::Select(fBestDelta, fDelta, bBetter);
+        }
+        V::Store(aIndex[i], fBestIndex);
+    }
+
+    for (size_t l = 0; l < nBlocks; ++l)
+    {
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            pIndices[l * NUM_PIXELS_PER_BLOCK + i] = (uint8_t)aIndex[i][l];
+    }
+}
+
+} // namespace
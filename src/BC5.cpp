@@ -4,37 +4,12 @@
 
 #include "BC.hpp"
 #include "BC45_shared.hpp"
+#include "BC45_simd.hpp"
 #include "Colors.hpp"
 
 
 namespace Tex {
 
-inline void FindEndPointsBC5U(
-    const float theTexelsU[],
-    const float theTexelsV[],
-    uint8_t &endpointU_0,
-    uint8_t &endpointU_1,
-    uint8_t &endpointV_0,
-    uint8_t &endpointV_1)
-{
-    //Encoding the U and V channel by BC4 codec separately.
-    FindEndPointsBC4U(theTexelsU, endpointU_0, endpointU_1);
-    FindEndPointsBC4U(theTexelsV, endpointV_0, endpointV_1);
-}
-
-inline void FindEndPointsBC5S(
-    const float theTexelsU[],
-    const float theTexelsV[],
-    int8_t &endpointU_0,
-    int8_t &endpointU_1,
-    int8_t &endpointV_0,
-    int8_t &endpointV_1)
-{
-    //Encoding the U and V channel by BC4 codec separately.
-    FindEndPointsBC4S(theTexelsU, endpointU_0, endpointU_1);
-    FindEndPointsBC4S(theTexelsV, endpointV_0, endpointV_1);
-}
-
 void DecodeBC5U(HDRColorA *pColor, const uint8_t *pBC)
 {
     assert(pColor && pBC);
@@ -43,9 +18,14 @@ void DecodeBC5U(HDRColorA *pColor, const uint8_t *pBC)
     auto pBCR = reinterpret_cast<const BC4_UNORM*>(pBC);
     auto pBCG = reinterpret_cast<const BC4_UNORM*>(pBC + sizeof(BC4_UNORM));
 
+    // Palettes once per block instead of a division per texel
+    float fPaletteR[8], fPaletteG[8];
+    BuildPaletteBC4(fPaletteR, pBC, false);
+    BuildPaletteBC4(fPaletteG, pBC + sizeof(BC4_UNORM), false);
+
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        pColor[i] = HDRColorA(pBCR->R(i), pBCG->R(i), 0, 1.0f);
+        pColor[i] = HDRColorA(fPaletteR[pBCR->GetIndex(i)], fPaletteG[pBCG->GetIndex(i)], 0, 1.0f);
     }
 }
 
@@ -57,9 +37,14 @@ void DecodeBC5S(HDRColorA *pColor, const uint8_t *pBC)
     auto pBCR = reinterpret_cast<const BC4_SNORM*>(pBC);
     auto pBCG = reinterpret_cast<const BC4_SNORM*>(pBC + sizeof(BC4_SNORM));
 
+    // Palettes once per block instead of a division per texel
+    float fPaletteR[8], fPaletteG[8];
+    BuildPaletteBC4(fPaletteR, pBC, true);
+    BuildPaletteBC4(fPaletteG, pBC + sizeof(BC4_SNORM), true);
+
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        pColor[i] = HDRColorA(pBCR->R(i), pBCG->R(i), 0, 1.0f);
+        pColor[i] = HDRColorA(fPaletteR[pBCR->GetIndex(i)], fPaletteG[pBCG->GetIndex(i)], 0, 1.0f);
     }
 }
 
@@ -82,16 +67,18 @@ void EncodeBC5U(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
         theTexelsV[i] = pColor[i].g;
     }
 
-    FindEndPointsBC5U(
-        theTexelsU,
-        theTexelsV,
-        pBCR->red_0,
-        pBCR->red_1,
-        pBCG->red_0,
-        pBCG->red_1);
+    // Constant channels are written directly, the rest go through the endpoint search
+    if (!EncodeSolidBC4U(pBCR, theTexelsU))
+    {
+        FindEndPointsBC4U(theTexelsU, pBCR->red_0, pBCR->red_1);
+        FindClosestUNORM(pBCR, theTexelsU);
+    }
 
-    FindClosestUNORM(pBCR, theTexelsU);
-    FindClosestUNORM(pBCG, theTexelsV);
+    if (!EncodeSolidBC4U(pBCG, theTexelsV))
+    {
+        FindEndPointsBC4U(theTexelsV, pBCG->red_0, pBCG->red_1);
+        FindClosestUNORM(pBCG, theTexelsV);
+    }
 }
 
 void EncodeBC5S(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
@@ -113,16 +100,76 @@ void EncodeBC5S(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
         theTexelsV[i] = pColor[i].g;
     }
 
-    FindEndPointsBC5S(
-        theTexelsU,
-        theTexelsV,
-        pBCR->red_0,
-        pBCR->red_1,
-        pBCG->red_0,
-        pBCG->red_1);
+    // Constant channels are written directly, the rest go through the endpoint search
+    if (!EncodeSolidBC4S(pBCR, theTexelsU))
+    {
+        FindEndPointsBC4S(theTexelsU, pBCR->red_0, pBCR->red_1);
+        FindClosestSNORM(pBCR, theTexelsU);
+    }
+
+    if (!EncodeSolidBC4S(pBCG, theTexelsV))
+    {
+        FindEndPointsBC4S(theTexelsV, pBCG->red_0, pBCG->red_1);
+        FindClosestSNORM(pBCG, theTexelsV);
+    }
+}
+
+void EncodeBC5UBatch(uint8_t *pBC, const float *pRed, const float *pGreen, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    assert(pBC && pRed && pGreen);
+    EncodeBC4UChannel(pBC, sizeof(BC4_UNORM) * 2, pRed, nBlocks);
+    EncodeBC4UChannel(pBC + sizeof(BC4_UNORM), sizeof(BC4_UNORM) * 2, pGreen, nBlocks);
+}
+
+void EncodeBC5SBatch(uint8_t *pBC, const float *pRed, const float *pGreen, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    assert(pBC && pRed && pGreen);
+    EncodeBC4SChannel(pBC, sizeof(BC4_SNORM) * 2, pRed, nBlocks);
+    EncodeBC4SChannel(pBC + sizeof(BC4_SNORM), sizeof(BC4_SNORM) * 2, pGreen, nBlocks);
+}
+
+namespace {
+
+template <void (*pfnEncode)(uint8_t *, size_t, const float *, size_t)>
+void EncodeBC5Blocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks)
+{
+    assert(pBC && pColor);
+
+    float theTexelsU[BC4_MAX_BATCH * NUM_PIXELS_PER_BLOCK];
+    float theTexelsV[BC4_MAX_BATCH * NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < nBlocks; i += BC4_MAX_BATCH)
+    {
+        const size_t nGroup = (nBlocks - i < BC4_MAX_BATCH) ? nBlocks - i : BC4_MAX_BATCH;
+        const HDRColorA *pGroup = pColor + i * NUM_PIXELS_PER_BLOCK;
+        for (size_t j = 0; j < nGroup * NUM_PIXELS_PER_BLOCK; ++j)
+        {
+            theTexelsU[j] = pGroup[j].r;
+            theTexelsV[j] = pGroup[j].g;
+        }
+
+        pfnEncode(pBC + i * 16, 16, theTexelsU, nGroup);
+        pfnEncode(pBC + i * 16 + 8, 16, theTexelsV, nGroup);
+    }
+}
+
+}
+
+void EncodeBC5UBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
+
+    EncodeBC5Blocks<EncodeBC4UChannel>(pBC, pColor, nBlocks);
+}
+
+void EncodeBC5SBlocks(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(flags);
 
-    FindClosestSNORM(pBCR, theTexelsU);
-    FindClosestSNORM(pBCG, theTexelsV);
+    EncodeBC5Blocks<EncodeBC4SChannel>(pBC, pColor, nBlocks);
 }
 
 }
@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <float.h>
+#include <string.h>
+#include <algorithm>
 
 #include "BC.hpp"
 #include "BC67_shared.hpp"
@@ -237,6 +239,188 @@ float OptimizeRGB(
     return fError;
 }
 
+//-------------------------------------------------------------------------------------
+// Partition shape estimation
+//-------------------------------------------------------------------------------------
+namespace {
+
+inline size_t PopCount16(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x5555);
+    v = (v & 0x3333) + ((v >> 2) & 0x3333);
+    v = (v + (v >> 4)) & 0x0F0F;
+    return (v + (v >> 8)) & 0x1F;
+}
+
+inline float ClusterDistance(const HDRColorA& a, const HDRColorA& b, bool bAlpha)
+{
+    float fDist = (a.r - b.r) * (a.r - b.r) + (a.g - b.g) * (a.g - b.g) + (a.b - b.b) * (a.b - b.b);
+    if (bAlpha)
+        fDist += (a.a - b.a) * (a.a - b.a);
+    return fDist;
+}
+
+// k-means over the 16 pixels of a block, returns one bit mask of member pixels per cluster
+void ClusterPixels(const HDRColorA* const pPoints, bool bAlpha, size_t nClusters, uint32_t auMasks[])
+{
+    assert(nClusters >= 2 && nClusters <= 3);
+
+    HDRColorA aCenters[3];
+    HDRColorA mean(0.0f, 0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        mean += pPoints[i];
+    mean *= 1.0f / NUM_PIXELS_PER_BLOCK;
+
+    // Seed with the pixel farthest from the mean, then repeatedly with the pixel
+    // farthest from all centers picked so far
+    for (size_t c = 0; c < nClusters; ++c)
+    {
+        size_t uBest = 0;
+        float fBestDist = -1.0f;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            float fDist = (c == 0) ? ClusterDistance(pPoints[i], mean, bAlpha) : FLT_MAX;
+            for (size_t j = 0; j < c; ++j)
+                fDist = std::min(fDist, ClusterDistance(pPoints[i], aCenters[j], bAlpha));
+            if (fDist > fBestDist)
+            {
+                fBestDist = fDist;
+                uBest = i;
+            }
+        }
+        aCenters[c] = pPoints[uBest];
+    }
+
+    uint8_t auLabel[NUM_PIXELS_PER_BLOCK] = {};
+    for (size_t iter = 0; iter < 8; ++iter)
+    {
+        bool bChanged = false;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            uint8_t uLabel = 0;
+            float fBestDist = ClusterDistance(pPoints[i], aCenters[0], bAlpha);
+            for (size_t c = 1; c < nClusters; ++c)
+            {
+                const float fDist = ClusterDistance(pPoints[i], aCenters[c], bAlpha);
+                if (fDist < fBestDist)
+                {
+                    fBestDist = fDist;
+                    uLabel = uint8_t(c);
+                }
+            }
+            bChanged |= (auLabel[i] != uLabel) || iter == 0;
+            auLabel[i] = uLabel;
+        }
+
+        if (!bChanged)
+            break;
+
+        for (size_t c = 0; c < nClusters; ++c)
+        {
+            HDRColorA sum(0.0f, 0.0f, 0.0f, 0.0f);
+            size_t np = 0;
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                if (auLabel[i] == c)
+                {
+                    sum += pPoints[i];
+                    ++np;
+                }
+            }
+            if (np)
+                aCenters[c] = sum * (1.0f / float(np));
+        }
+    }
+
+    for (size_t c = 0; c < nClusters; ++c)
+    {
+        auMasks[c] = 0;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            if (auLabel[i] == c)
+                auMasks[c] |= 1u << i;
+    }
+}
+
+}
+
+// Orders the first uShapes shapes of a uPartitions subset mode by the Hamming distance
+// between their subsets and a clustering of the pixels, under the best matching of
+// subsets to clusters. The nCandidates closest shapes are written to auShapes, best
+// first, ties keep the table order. Returns the number of shapes written.
+size_t RankPartitionShapes(
+    const HDRColorA* const pPoints, bool bAlpha, size_t uPartitions,
+    size_t uShapes, size_t nCandidates, size_t auShapes[])
+{
+    assert(pPoints && auShapes);
+    assert(uPartitions >= 1 && uPartitions <= 2 && uShapes <= 64);
+
+    uint32_t auClusters[3];
+    ClusterPixels(pPoints, bAlpha, uPartitions + 1, auClusters);
+
+    static const uint8_t s_aPerm[6][3] =
+    {
+        {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0},
+    };
+    const size_t nPerms = (uPartitions == 1) ? 2 : 6;
+
+    size_t auDist[64];
+    for (size_t s = 0; s < uShapes; ++s)
+    {
+        uint32_t auSubsets[3] = {};
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            auSubsets[g_aPartitionTable[uPartitions][s][i]] |= 1u << i;
+
+        size_t uMatched = 0;
+        for (size_t p = 0; p < nPerms; ++p)
+        {
+            // The 2 subset case uses the permutations that keep cluster 2 in place
+            const uint8_t* pPerm = s_aPerm[(uPartitions == 1) ? p * 2 : p];
+            size_t uSum = 0;
+            for (size_t j = 0; j <= uPartitions; ++j)
+                uSum += PopCount16(auSubsets[j] & auClusters[pPerm[j]]);
+            uMatched = std::max(uMatched, uSum);
+        }
+        auDist[s] = NUM_PIXELS_PER_BLOCK - uMatched;
+    }
+
+    // Partial selection sort, stable so equal distances keep the table order
+    size_t auOrder[64];
+    for (size_t s = 0; s < uShapes; ++s)
+        auOrder[s] = s;
+
+    const size_t nCount = std::min(nCandidates, uShapes);
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        size_t uMin = i;
+        for (size_t j = i + 1; j < uShapes; ++j)
+            if (auDist[auOrder[j]] < auDist[auOrder[uMin]])
+                uMin = j;
+
+        const size_t uShape = auOrder[uMin];
+        memmove(&auOrder[i + 1], &auOrder[i], (uMin - i) * sizeof(size_t));
+        auOrder[i] = uShape;
+        auShapes[i] = uShape;
+    }
+
+    return nCount;
+}
+
+AnchorTable::AnchorTable()
+{
+    for (size_t p = 0; p < 3; ++p)
+    {
+        for (size_t uShape = 0; uShape < 64; ++uShape)
+        {
+            uint8_t *pAnchors = aAnchors[p][uShape];
+            for (size_t i = 0; i <= p; ++i)
+                pAnchors[i] = g_aFixUp[p][uShape][i];
+            std::sort(pAnchors, pAnchors + p + 1);
+        }
+    }
+}
+
+const AnchorTable g_Anchors;
+
 void FillWithErrorColors(HDRColorA* pOut)
 {
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "BC.hpp"
 #include "Colors.hpp"
 
 
@@ -10,6 +11,16 @@ const int32_t BC67_WEIGHT_MAX = 64;
 const uint32_t BC67_WEIGHT_SHIFT = 6;
 const int32_t BC67_WEIGHT_ROUND = 32;
 
+// A BC6H block encoded from a seed skips the mode search when the error left is
+// below this fraction of the spread of its texels around their mean, or below a
+// floor of BC6H_SEED_MIN_ERROR per channel
+const float BC6H_SEED_VARIANCE_FRACTION = 1.0f / 16.0f;
+const float BC6H_SEED_MIN_ERROR = 16.0f;
+
+// A BC7 block encoded from a seed skips the mode search when refitting the seed
+// lowers its error by less than this fraction, and a mode 6 fit beats it by less
+const float BC7_SEED_MARGIN = 1.0f / 4.0f;
+
 const float fEpsilon = (0.25f / 64.0f) * (0.25f / 64.0f);
 const float pC3[] = { 2.0f / 2.0f, 1.0f / 2.0f, 0.0f / 2.0f };
 const float pD3[] = { 0.0f / 2.0f, 1.0f / 2.0f, 2.0f / 2.0f };
@@ -358,76 +369,161 @@ inline int NBits(int n, bool bIsSigned)
 }
 
 
-template<size_t SizeInBytes>
-class CBits
+//------------------------------------------------------------------------------
+// 128-bit block bit stream
+//
+// Bit i of a block is bit i % 64 of word i / 64, the words are stored little
+// endian. Fields of up to 64 bits are read and written with a few shifts, a
+// field may straddle the two words.
+//------------------------------------------------------------------------------
+
+// Anchor texels of every partition shape in increasing order, their indices are
+// stored with one bit less
+struct AnchorTable
 {
-public:
-    uint8_t GetBit(size_t& uStartBit) const
+    uint8_t aAnchors[3][64][3];
+
+    AnchorTable();
+};
+
+extern const AnchorTable g_Anchors;
+
+// Inserts a zero top bit into every anchor index so index i sits at bit i * uPrec
+inline uint64_t ExpandAnchors(uint64_t v, const uint8_t *pAnchors, size_t nAnchors, size_t uPrec)
+{
+    for (size_t i = 0; i < nAnchors; ++i)
     {
-        assert(uStartBit < 128);
-        size_t uIndex = uStartBit >> 3;
-        uint8_t ret = (m_uBits[uIndex] >> (uStartBit - (uIndex << 3))) & 0x01;
-        uStartBit++;
-        return ret;
+        const size_t uPos = pAnchors[i] * uPrec + uPrec - 1;
+        const uint64_t low = v & ((uint64_t(1) << uPos) - 1);
+        v = (uPos + 1 < 64) ? low | ((v >> uPos) << (uPos + 1)) : low;
     }
+    return v;
+}
 
-    uint8_t GetBits(size_t& uStartBit, size_t uNumBits) const
+// Inverse of ExpandAnchors, drops the zero top bit of every anchor index
+inline uint64_t CompactAnchors(uint64_t v, const uint8_t *pAnchors, size_t nAnchors, size_t uPrec)
+{
+    for (size_t i = nAnchors; i-- > 0;)
     {
-        if (uNumBits == 0) return 0;
-        assert(uStartBit + uNumBits <= 128 && uNumBits <= 8);
-        uint8_t ret;
-        size_t uIndex = uStartBit >> 3;
-        size_t uBase = uStartBit - (uIndex << 3);
-        if (uBase + uNumBits > 8)
+        const size_t uPos = pAnchors[i] * uPrec + uPrec - 1;
+        assert(!((v >> uPos) & 1));
+        const uint64_t low = v & ((uint64_t(1) << uPos) - 1);
+        v = (uPos + 1 < 64) ? low | ((v >> (uPos + 1)) << uPos) : low;
+    }
+    return v;
+}
+
+class BlockBits
+{
+public:
+    BlockBits() : m_uLo(0), m_uHi(0) {}
+
+    explicit BlockBits(const uint8_t* pBC) : m_uLo(0), m_uHi(0)
+    {
+        for (size_t i = 0; i < 8; ++i)
         {
-            size_t uFirstIndexBits = 8 - uBase;
-            size_t uNextIndexBits = uNumBits - uFirstIndexBits;
-            ret = (m_uBits[uIndex] >> uBase) | ((m_uBits[uIndex + 1] & ((1 << uNextIndexBits) - 1)) << uFirstIndexBits);
+            m_uLo |= uint64_t(pBC[i]) << (8 * i);
+            m_uHi |= uint64_t(pBC[i + 8]) << (8 * i);
         }
-        else
+    }
+
+    void Store(uint8_t* pBC) const
+    {
+        for (size_t i = 0; i < 8; ++i)
         {
-            ret = (m_uBits[uIndex] >> uBase) & ((1 << uNumBits) - 1);
+            pBC[i] = uint8_t(m_uLo >> (8 * i));
+            pBC[i + 8] = uint8_t(m_uHi >> (8 * i));
         }
-        assert(ret < (1 << uNumBits));
-        uStartBit += uNumBits;
-        return ret;
     }
 
-    void SetBit(size_t& uStartBit, uint8_t uValue)
+    // Bits 0-63 or 64-127
+    uint64_t GetWord(size_t uIndex) const
     {
-        assert(uStartBit < 128 && uValue < 2);
-        size_t uIndex = uStartBit >> 3;
-        size_t uBase = uStartBit - (uIndex << 3);
-        m_uBits[uIndex] &= ~(1 << uBase);
-        m_uBits[uIndex] |= uValue << uBase;
-        uStartBit++;
+        assert(uIndex < 2);
+        return uIndex ? m_uHi : m_uLo;
     }
 
-    void SetBits(size_t& uStartBit, size_t uNumBits, uint8_t uValue)
+    // uNumBits bits starting at bit uOffset
+    uint64_t Get(size_t uOffset, size_t uNumBits) const
     {
+        assert(uOffset + uNumBits <= 128 && uNumBits <= 64);
+        const uint64_t v = (uOffset < 64) ? (m_uLo >> uOffset) | ((m_uHi << 1) << (63 - uOffset)) : m_uHi >> (uOffset - 64);
+        return (uNumBits < 64) ? v & ((uint64_t(1) << uNumBits) - 1) : v;
+    }
+
+    // Ors uValue into the uNumBits bits starting at bit uOffset, which are
+    // expected to be clear
+    void Set(size_t uOffset, size_t uNumBits, uint64_t uValue)
+    {
+        assert(uOffset + uNumBits <= 128 && uNumBits <= 64);
+        assert(uNumBits == 64 || uValue < (uint64_t(1) << uNumBits));
         if (uNumBits == 0)
             return;
-        assert(uStartBit + uNumBits <= 128 && uNumBits <= 8);
-        assert(uValue < (1 << uNumBits));
-        size_t uIndex = uStartBit >> 3;
-        size_t uBase = uStartBit - (uIndex << 3);
-        if (uBase + uNumBits > 8)
+
+        if (uOffset < 64)
         {
-            size_t uFirstIndexBits = 8 - uBase;
-            size_t uNextIndexBits = uNumBits - uFirstIndexBits;
-            m_uBits[uIndex] &= ~(((1 << uFirstIndexBits) - 1) << uBase);
-            m_uBits[uIndex] |= uValue << uBase;
-            m_uBits[uIndex + 1] &= ~((1 << uNextIndexBits) - 1);
-            m_uBits[uIndex + 1] |= uValue >> uFirstIndexBits;
+            m_uLo |= uValue << uOffset;
+            if (uOffset + uNumBits > 64)
+                m_uHi |= uValue >> (64 - uOffset);
         }
         else
         {
-            m_uBits[uIndex] &= ~(((1 << uNumBits) - 1) << uBase);
-            m_uBits[uIndex] |= uValue << uBase;
+            m_uHi |= uValue << (uOffset - 64);
         }
+    }
+
+    // Sequential forms, uStartBit is advanced past the field
+    uint64_t Read(size_t& uStartBit, size_t uNumBits) const
+    {
+        const uint64_t v = Get(uStartBit, uNumBits);
+        uStartBit += uNumBits;
+        return v;
+    }
+
+    void Write(size_t& uStartBit, size_t uNumBits, uint64_t uValue)
+    {
+        Set(uStartBit, uNumBits, uValue);
         uStartBit += uNumBits;
     }
 
+    // Appends the 16 indices of uPrec bits of a block as one field, leaving out
+    // the top bit of the nAnchors anchor indices in pAnchors
+    void WriteIndices(size_t& uStartBit, const size_t aIndices[], size_t uPrec,
+        const uint8_t* pAnchors, size_t nAnchors)
+    {
+        assert(uPrec * NUM_PIXELS_PER_BLOCK <= 64);
+        uint64_t v = 0;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            assert(aIndices[i] < (size_t(1) << uPrec));
+            v |= uint64_t(aIndices[i]) << (i * uPrec);
+        }
+        Write(uStartBit, NUM_PIXELS_PER_BLOCK * uPrec - nAnchors, CompactAnchors(v, pAnchors, nAnchors, uPrec));
+    }
+
+private:
+    uint64_t m_uLo;
+    uint64_t m_uHi;
+};
+
+// Byte storage of a block, so blocks can overlay buffers of any alignment. The
+// contents are parsed and emitted as a whole through BlockBits.
+template<size_t SizeInBytes>
+class CBits
+{
+    static_assert(SizeInBytes == 16, "BlockBits covers 128-bit blocks");
+
+public:
+    BlockBits LoadBits() const
+    {
+        return BlockBits(m_uBits);
+    }
+
+    void StoreBits(const BlockBits& bits)
+    {
+        bits.Store(m_uBits);
+    }
+
 private:
     uint8_t m_uBits[SizeInBytes];
 };
@@ -440,6 +536,9 @@ void InterpolateLDR(
 float OptimizeRGB(
     const HDRColorA* const pPoints, HDRColorA* pX, HDRColorA* pY,
     size_t cSteps, size_t cPixels, const size_t* pIndex);
+size_t RankPartitionShapes(
+    const HDRColorA* const pPoints, bool bAlpha, size_t uPartitions,
+    size_t uShapes, size_t nCandidates, size_t auShapes[]);
 void FillWithErrorColors(HDRColorA* pOut);
 
 }
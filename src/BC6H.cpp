@@ -3,10 +3,13 @@
 #include <string.h>
 #include <float.h>
 #include <stdio.h>
+#include <algorithm>
 
 #include "BC.hpp"
 #include "BC67_shared.hpp"
+#include "BC6H_simd.hpp"
 #include "Colors.hpp"
+#include "CPUFeatures.hpp"
 
 #define ARRAYSIZE(array) (sizeof(array) / sizeof(array[0]))
 
@@ -24,7 +27,13 @@ class Block_BC6H : private CBits<16>
 {
 public:
     void Decode(bool bSigned, HDRColorA* pOut) const;
-    void Encode(bool bSigned, const HDRColorA* const pIn);
+    void Decode(bool bSigned, uint16_t* pOut) const;
+    // RGBA16F or RGBA32F texels written as 4 rows rowPitch bytes apart
+    void DecodeRows(bool bSigned, uint16_t* pDst, size_t rowPitch) const;
+    void DecodeRows(bool bSigned, float* pDst, size_t rowPitch) const;
+    // pSeedBC optionally holds an earlier encoding of similar texels to start from
+    void Encode(uint32_t flags, bool bSigned, const HDRColorA* const pIn, const uint8_t* pSeedBC = nullptr);
+    void Encode(uint32_t flags, bool bSigned, const uint16_t* const pIn, const uint8_t* pSeedBC = nullptr);
 
 private:
     enum EField : uint8_t
@@ -76,12 +85,59 @@ private:
         {
             for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
             {
-                aIPixels[i].FromHDRColorA(aOriginal[i], bSigned);
+                aIPixels[i] = INTColor::FromHDRColorA(aOriginal[i], bSigned);
             }
         }
+
+        EncodeParams(const HDRColorA* const aOriginal, const INTColor* const aInt, bool bSignedFormat) :
+            fBestErr(FLT_MAX), bSigned(bSignedFormat), aHDRPixels(aOriginal)
+        {
+            std::copy(aInt, aInt + NUM_PIXELS_PER_BLOCK, aIPixels);
+        }
+    };
+
+    // The header of one mode as runs of block bits that map to consecutive bits
+    // of the same field, so parsing and emitting take a shift and a mask per run
+    // instead of a ms_aDesc lookup per bit
+    struct HeaderRun
+    {
+        uint8_t uSrc;       // First block bit
+        uint8_t uCount;
+        uint8_t uField;     // EField
+        uint8_t uDst;       // First field bit
+    };
+
+    struct HeaderProgram
+    {
+        HeaderRun aRuns[82];
+        size_t nRuns;
+        uint64_t aInvalid[2];   // Header bits without a field, set ones are an error
+    };
+
+    struct HeaderPrograms
+    {
+        HeaderProgram aPrograms[14];
+
+        HeaderPrograms();
+    };
+
+    enum HeaderStatus
+    {
+        HEADER_OK,
+        HEADER_RESERVED_MODE,
+        HEADER_INVALID_BITS,
     };
 
+    // Reads the mode bits, the shape and the quantized endpoints, sign extended
+    // and inverse transformed
+    HeaderStatus ReadHeader(bool bSigned, uint8_t& uMode, size_t& uShape, INTEndPntPair aEndPts[]) const;
+    // Fills the 16 RGBA16F palette entries and the entry of every texel
+    void DecodePalette(bool bSigned, uint64_t aPalette[], uint8_t aTexels[]) const;
+    void Encode(uint32_t flags, EncodeParams& EP, const uint8_t* pSeedBC);
+    bool EncodeFromSeed(EncodeParams& EP, const uint8_t* pSeedBC);
+
     static int Quantize(int iValue, int prec, bool bSigned);
+    static int QuantizeInverse(int comp, int prec, bool bSigned);
     static int Unquantize(int comp, uint8_t uBitsPerComp, bool bSigned);
     static int FinishUnquantize(int comp, bool bSigned);
 
@@ -115,6 +171,7 @@ private:
     const static ModeDescriptor ms_aDesc[][82];
     const static ModeInfo ms_aInfo[];
     const static int ms_aModeToInfo[];
+    const static HeaderPrograms ms_headerPrograms;
 };
 
 // BC6H Compression
@@ -344,137 +401,253 @@ const int Block_BC6H::ms_aModeToInfo[] =
     -1, // Resreved - 0x1f
 };
 
+Block_BC6H::HeaderPrograms::HeaderPrograms()
+{
+    for (size_t uInfo = 0; uInfo < ARRAYSIZE(ms_aInfo); ++uInfo)
+    {
+        const ModeDescriptor* desc = ms_aDesc[uInfo];
+        HeaderProgram& program = aPrograms[uInfo];
+        program.nRuns = 0;
+        program.aInvalid[0] = 0;
+        program.aInvalid[1] = 0;
+
+        const size_t uHeaderBits = ms_aInfo[uInfo].uPartitions > 0 ? 82 : 65;
+        for (size_t uBit = 0; uBit < uHeaderBits; ++uBit)
+        {
+            const EField eField = desc[uBit].m_eField;
+            if (eField == NA)
+            {
+                program.aInvalid[uBit >> 6] |= uint64_t(1) << (uBit & 63);
+                continue;
+            }
+
+            if (program.nRuns > 0)
+            {
+                HeaderRun& run = program.aRuns[program.nRuns - 1];
+                if (run.uField == eField && run.uSrc + run.uCount == uBit && run.uDst + run.uCount == desc[uBit].m_uBit)
+                {
+                    ++run.uCount;
+                    continue;
+                }
+            }
+
+            HeaderRun& run = program.aRuns[program.nRuns++];
+            run.uSrc = uint8_t(uBit);
+            run.uCount = 1;
+            run.uField = uint8_t(eField);
+            run.uDst = desc[uBit].m_uBit;
+        }
+    }
+}
+
+const Block_BC6H::HeaderPrograms Block_BC6H::ms_headerPrograms;
+
 //-------------------------------------------------------------------------------------
-// BC6H Compression
+// BC6H Decompression
 //-------------------------------------------------------------------------------------
+namespace {
+
+void BuildHalfPaletteScalar(uint64_t *pPalette, const int aEndPtA[3], const int aEndPtB[3],
+    const int *pWeights, size_t nEntries, bool bSigned)
+{
+    for (size_t i = 0; i < nEntries; ++i)
+    {
+        const int w = pWeights[i];
+        uint64_t uEntry = uint64_t(F16ONE) << 48;
+        for (size_t ch = 0; ch < BC6H_NUM_CHANNELS; ++ch)
+        {
+            int comp = (aEndPtA[ch] * (BC67_WEIGHT_MAX - w) + aEndPtB[ch] * w + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT;
+
+            // Block_BC6H::FinishUnquantize
+            if (bSigned)
+                comp = (comp < 0) ? -(((-comp) * 31) >> 5) : (comp * 31) >> 5;
+            else
+                comp = (comp * 31) >> 6;
+
+            uEntry |= uint64_t(INTColor::INT2Half(comp, bSigned)) << (16 * ch);
+        }
+        pPalette[i] = uEntry;
+    }
+}
+
+void HalfPaletteToFloatScalar(float *pDst, const uint64_t *pPalette, size_t nEntries)
+{
+    for (size_t i = 0; i < nEntries; ++i)
+    {
+        for (size_t ch = 0; ch < 4; ++ch)
+            pDst[4 * i + ch] = INTColor::HalfToFloat(uint16_t(pPalette[i] >> (16 * ch)));
+    }
+}
+
+// Kernels picked once for the running CPU, all of them give identical results
+struct DecodeKernels
+{
+    BC6H_BUILD_PALETTE pfnBuildPalette;
+    BC6H_PALETTE_TO_FLOAT pfnPaletteToFloat;
+};
+
+DecodeKernels SelectDecodeKernels()
+{
+#if defined(CROSSTEX_X86_SIMD)
+    if (GetCPUFeatures().bSSE41)
+        return { BuildHalfPaletteSSE41, HalfPaletteToFloatSSE41 };
+#endif
+    return { BuildHalfPaletteScalar, HalfPaletteToFloatScalar };
+}
+
+const DecodeKernels& GetDecodeKernels()
+{
+    static const DecodeKernels kernels = SelectDecodeKernels();
+    return kernels;
+}
+
+// Every palette entry set to one RGB half float color
+void FillPalette(uint64_t aPalette[], uint8_t aTexels[], uint16_t r, uint16_t g, uint16_t b)
+{
+    const uint64_t uEntry = uint64_t(r) | (uint64_t(g) << 16) | (uint64_t(b) << 32) | (uint64_t(F16ONE) << 48);
+    for (size_t i = 0; i < BC6H_MAX_INDICES; ++i)
+        aPalette[i] = uEntry;
+    memset(aTexels, 0, NUM_PIXELS_PER_BLOCK);
+}
+
+void FillWithErrorColors(uint64_t aPalette[], uint8_t aTexels[])
+{
+#ifndef NDEBUG
+    // Use Magenta in debug as a highly-visible error color
+    FillPalette(aPalette, aTexels, F16ONE, 0, F16ONE);
+#else
+    // In production use, default to black
+    FillPalette(aPalette, aTexels, 0, 0, 0);
+#endif
+}
+
+}
+
 void Block_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
 {
     assert(pOut);
+    DecodeRows(bSigned, reinterpret_cast<float*>(pOut), 4 * sizeof(HDRColorA));
+}
 
-    size_t uStartBit = 0;
-    uint8_t uMode = GetBits(uStartBit, 2);
-    if (uMode != 0x00 && uMode != 0x01)
+
+void Block_BC6H::Decode(bool bSigned, uint16_t* pOut) const
+{
+    assert(pOut);
+    DecodeRows(bSigned, pOut, 4 * 4 * sizeof(uint16_t));
+}
+
+
+void Block_BC6H::DecodeRows(bool bSigned, uint16_t* pDst, size_t rowPitch) const
+{
+    assert(pDst);
+
+    uint64_t aPalette[BC6H_MAX_INDICES];
+    uint8_t aTexels[NUM_PIXELS_PER_BLOCK];
+    DecodePalette(bSigned, aPalette, aTexels);
+
+    for (size_t y = 0; y < 4; ++y)
     {
-        uMode = (GetBits(uStartBit, 3) << 2) | uMode;
+        uint8_t* pRow = reinterpret_cast<uint8_t*>(pDst) + y * rowPitch;
+        for (size_t x = 0; x < 4; ++x)
+            memcpy(pRow + x * sizeof(uint64_t), &aPalette[aTexels[y * 4 + x]], sizeof(uint64_t));
     }
+}
+
+
+void Block_BC6H::DecodeRows(bool bSigned, float* pDst, size_t rowPitch) const
+{
+    assert(pDst);
+
+    uint64_t aPalette[BC6H_MAX_INDICES];
+    uint8_t aTexels[NUM_PIXELS_PER_BLOCK];
+    DecodePalette(bSigned, aPalette, aTexels);
 
-    assert(uMode < 32);
+    float aPaletteF[BC6H_MAX_INDICES][4];
+    GetDecodeKernels().pfnPaletteToFloat(aPaletteF[0], aPalette, BC6H_MAX_INDICES);
 
-    if (ms_aModeToInfo[uMode] >= 0)
+    for (size_t y = 0; y < 4; ++y)
     {
-        assert(ms_aModeToInfo[uMode] < (int)ARRAYSIZE(ms_aInfo));
-                const ModeDescriptor* desc = ms_aDesc[ms_aModeToInfo[uMode]];
+        uint8_t* pRow = reinterpret_cast<uint8_t*>(pDst) + y * rowPitch;
+        for (size_t x = 0; x < 4; ++x)
+            memcpy(pRow + x * sizeof(aPaletteF[0]), aPaletteF[aTexels[y * 4 + x]], sizeof(aPaletteF[0]));
+    }
+}
 
-        assert(ms_aModeToInfo[uMode] < (int)ARRAYSIZE(ms_aDesc));
-                const ModeInfo& info = ms_aInfo[ms_aModeToInfo[uMode]];
 
-        INTEndPntPair aEndPts[BC6H_MAX_REGIONS];
-        memset(aEndPts, 0, BC6H_MAX_REGIONS * 2 * sizeof(INTColor));
-        uint32_t uShape = 0;
+Block_BC6H::HeaderStatus Block_BC6H::ReadHeader(bool bSigned, uint8_t& uMode, size_t& uShape,
+    INTEndPntPair aEndPts[]) const
+{
+    const BlockBits bits = LoadBits();
 
-        // Read header
-        const size_t uHeaderBits = info.uPartitions > 0 ? 82 : 65;
-        while (uStartBit < uHeaderBits)
-        {
-            size_t uCurBit = uStartBit;
-            if (GetBit(uStartBit))
-            {
-                switch (desc[uCurBit].m_eField)
-                {
-                case D:  uShape |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case RW: aEndPts[0].A.r |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case RX: aEndPts[0].B.r |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case RY: aEndPts[1].A.r |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case RZ: aEndPts[1].B.r |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case GW: aEndPts[0].A.g |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case GX: aEndPts[0].B.g |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case GY: aEndPts[1].A.g |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case GZ: aEndPts[1].B.g |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case BW: aEndPts[0].A.b |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case BX: aEndPts[0].B.b |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case BY: aEndPts[1].A.b |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                case BZ: aEndPts[1].B.b |= 1 << uint32_t(desc[uCurBit].m_uBit); break;
-                default:
-                {
-#ifndef NDEBUG
-                    fprintf(stderr, "BC6H: Invalid header bits encountered during decoding\n");
-#endif
-                    FillWithErrorColors(pOut);
-                    return;
-                }
-                }
-            }
-        }
+    uMode = uint8_t(bits.Get(0, 2));
+    if (uMode != 0x00 && uMode != 0x01)
+    {
+        uMode = uint8_t(bits.Get(0, 5));
+    }
 
-        assert(uShape < 64);
+    if (ms_aModeToInfo[uMode] < 0)
+        return HEADER_RESERVED_MODE;
 
-        // Sign extend necessary end points
-        if (bSigned)
-        {
-            aEndPts[0].A.SignExtend(info.RGBAPrec[0][0]);
-        }
-        if (bSigned || info.bTransformed)
+    assert(ms_aModeToInfo[uMode] < (int)ARRAYSIZE(ms_aInfo));
+    const ModeInfo& info = ms_aInfo[ms_aModeToInfo[uMode]];
+    const HeaderProgram& program = ms_headerPrograms.aPrograms[ms_aModeToInfo[uMode]];
+
+    if ((bits.GetWord(0) & program.aInvalid[0]) | (bits.GetWord(1) & program.aInvalid[1]))
+        return HEADER_INVALID_BITS;
+
+    // Read header
+    int aFields[BZ + 1] = {};
+    for (size_t i = 0; i < program.nRuns; ++i)
+    {
+        const HeaderRun& run = program.aRuns[i];
+        aFields[run.uField] |= int(bits.Get(run.uSrc, run.uCount) << run.uDst);
+    }
+
+    aEndPts[0].A = INTColor(aFields[RW], aFields[GW], aFields[BW]);
+    aEndPts[0].B = INTColor(aFields[RX], aFields[GX], aFields[BX]);
+    aEndPts[1].A = INTColor(aFields[RY], aFields[GY], aFields[BY]);
+    aEndPts[1].B = INTColor(aFields[RZ], aFields[GZ], aFields[BZ]);
+    uShape = size_t(aFields[D]);
+    assert(uShape < BC6H_MAX_SHAPES);
+
+    // Sign extend necessary end points
+    if (bSigned)
+    {
+        aEndPts[0].A.SignExtend(info.RGBAPrec[0][0]);
+    }
+    if (bSigned || info.bTransformed)
+    {
+        assert(info.uPartitions < BC6H_MAX_REGIONS);
+        for (size_t p = 0; p <= info.uPartitions; ++p)
         {
-            assert(info.uPartitions < BC6H_MAX_REGIONS);
-                        for (size_t p = 0; p <= info.uPartitions; ++p)
+            if (p != 0)
             {
-                if (p != 0)
-                {
-                    aEndPts[p].A.SignExtend(info.RGBAPrec[p][0]);
-                }
-                aEndPts[p].B.SignExtend(info.RGBAPrec[p][1]);
+                aEndPts[p].A.SignExtend(info.RGBAPrec[p][0]);
             }
+            aEndPts[p].B.SignExtend(info.RGBAPrec[p][1]);
         }
+    }
 
-        // Inverse transform the end points
-        if (info.bTransformed)
-        {
-            TransformInverse(aEndPts, info.RGBAPrec[0][0], bSigned);
-        }
+    // Inverse transform the end points
+    if (info.bTransformed)
+    {
+        TransformInverse(aEndPts, info.RGBAPrec[0][0], bSigned);
+    }
 
-        // Read indices
-        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-        {
-            size_t uNumBits = IsFixUpOffset(info.uPartitions, uShape, i) ? info.uIndexPrec - 1 : info.uIndexPrec;
-            if (uStartBit + uNumBits > 128)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC6H: Invalid block encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
-            uint8_t uIndex = GetBits(uStartBit, uNumBits);
+    return HEADER_OK;
+}
 
-            if (uIndex >= ((info.uPartitions > 0) ? 8 : 16))
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC6H: Invalid index encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
 
-            size_t uRegion = g_aPartitionTable[info.uPartitions][uShape][i];
-            assert(uRegion < BC6H_MAX_REGIONS);
-
-            // Unquantize endpoints and interpolate
-            int r1 = Unquantize(aEndPts[uRegion].A.r, info.RGBAPrec[0][0].r, bSigned);
-            int g1 = Unquantize(aEndPts[uRegion].A.g, info.RGBAPrec[0][0].g, bSigned);
-            int b1 = Unquantize(aEndPts[uRegion].A.b, info.RGBAPrec[0][0].b, bSigned);
-            int r2 = Unquantize(aEndPts[uRegion].B.r, info.RGBAPrec[0][0].r, bSigned);
-            int g2 = Unquantize(aEndPts[uRegion].B.g, info.RGBAPrec[0][0].g, bSigned);
-            int b2 = Unquantize(aEndPts[uRegion].B.b, info.RGBAPrec[0][0].b, bSigned);
-            const int* aWeights = info.uPartitions > 0 ? g_aWeights3 : g_aWeights4;
-            INTColor fc;
-            fc.r = FinishUnquantize((r1 * (BC67_WEIGHT_MAX - aWeights[uIndex]) + r2 * aWeights[uIndex] + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT, bSigned);
-            fc.g = FinishUnquantize((g1 * (BC67_WEIGHT_MAX - aWeights[uIndex]) + g2 * aWeights[uIndex] + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT, bSigned);
-            fc.b = FinishUnquantize((b1 * (BC67_WEIGHT_MAX - aWeights[uIndex]) + b2 * aWeights[uIndex] + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT, bSigned);
-
-            pOut[i] = fc.ToHDRColorA(bSigned);
-        }
-    }
-    else
+// Palette entries are indexed by region * 2^uIndexPrec + index; the endpoints
+// are unquantized once per region instead of once per texel
+void Block_BC6H::DecodePalette(bool bSigned, uint64_t aPalette[], uint8_t aTexels[]) const
+{
+    uint8_t uMode;
+    size_t uShape;
+    INTEndPntPair aEndPts[BC6H_MAX_REGIONS];
+    const HeaderStatus status = ReadHeader(bSigned, uMode, uShape, aEndPts);
+
+    if (status == HEADER_RESERVED_MODE)
     {
 #ifndef NDEBUG
         const char* warnstr = "BC6H: Invalid mode encountered during decoding\n";
@@ -488,41 +661,128 @@ void Block_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
         fprintf(stderr, warnstr);
 #endif
         // Per the BC6H format spec, we must return opaque black
-        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-        {
-            pOut[i] = HDRColorA(0.0f, 0.0f, 0.0f, 1.0f);
-        }
+        FillPalette(aPalette, aTexels, 0, 0, 0);
+        return;
+    }
+
+    if (status == HEADER_INVALID_BITS)
+    {
+#ifndef NDEBUG
+        fprintf(stderr, "BC6H: Invalid header bits encountered during decoding\n");
+#endif
+        FillWithErrorColors(aPalette, aTexels);
+        return;
+    }
+
+    const ModeInfo& info = ms_aInfo[ms_aModeToInfo[uMode]];
+
+    // Unquantize endpoints and interpolate
+    const LDRColorA& prec = info.RGBAPrec[0][0];
+    const int* aWeights = info.uPartitions > 0 ? g_aWeights3 : g_aWeights4;
+    const size_t nEntries = size_t(1) << info.uIndexPrec;
+    for (size_t p = 0; p <= info.uPartitions; ++p)
+    {
+        const int aEndPtA[BC6H_NUM_CHANNELS] = {
+            Unquantize(aEndPts[p].A.r, prec.r, bSigned),
+            Unquantize(aEndPts[p].A.g, prec.g, bSigned),
+            Unquantize(aEndPts[p].A.b, prec.b, bSigned) };
+        const int aEndPtB[BC6H_NUM_CHANNELS] = {
+            Unquantize(aEndPts[p].B.r, prec.r, bSigned),
+            Unquantize(aEndPts[p].B.g, prec.g, bSigned),
+            Unquantize(aEndPts[p].B.b, prec.b, bSigned) };
+        GetDecodeKernels().pfnBuildPalette(aPalette + p * nEntries, aEndPtA, aEndPtB, aWeights, nEntries, bSigned);
+    }
+
+    // Read indices, the indices fill the block after the header
+    const size_t uHeaderBits = info.uPartitions > 0 ? 82 : 65;
+    uint64_t uIndices = LoadBits().Get(uHeaderBits, 128 - uHeaderBits);
+    uIndices = ExpandAnchors(uIndices, g_Anchors.aAnchors[info.uPartitions][uShape], info.uPartitions + 1, info.uIndexPrec);
+
+    const uint8_t* pRegions = g_aPartitionTable[info.uPartitions][uShape];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, uIndices >>= info.uIndexPrec)
+    {
+        aTexels[i] = uint8_t((pRegions[i] << info.uIndexPrec) | (uIndices & (nEntries - 1)));
     }
 }
 
 
-void Block_BC6H::Encode(bool bSigned, const HDRColorA* const pIn)
+void Block_BC6H::Encode(uint32_t flags, bool bSigned, const HDRColorA* const pIn, const uint8_t* pSeedBC)
 {
     assert(pIn);
 
     EncodeParams EP(pIn, bSigned);
+    Encode(flags, EP, pSeedBC);
+}
+
+
+void Block_BC6H::Encode(uint32_t flags, bool bSigned, const uint16_t* const pIn, const uint8_t* pSeedBC)
+{
+    assert(pIn);
+
+    // The integer pixels come straight from the half bits; the float copy only
+    // feeds the rough endpoint fit in RoughMSE
+    INTColor aIPixels[NUM_PIXELS_PER_BLOCK];
+    HDRColorA aHDRPixels[NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        aIPixels[i] = INTColor::FromHalf(pIn + i * 4, bSigned);
+        aHDRPixels[i] = aIPixels[i].ToHDRColorA(bSigned);
+    }
+
+    EncodeParams EP(aHDRPixels, aIPixels, bSigned);
+    Encode(flags, EP, pSeedBC);
+}
+
+
+void Block_BC6H::Encode(uint32_t flags, EncodeParams& EP, const uint8_t* pSeedBC)
+{
+    if (pSeedBC && EncodeFromSeed(EP, pSeedBC))
+        return;
+
+    // The fast effort level only scores the shapes closest to a clustering of the
+    // pixels and refines the best two of them
+    const bool bFast = (flags & BC_FLAGS_EFFORT_MASK) == BC_FLAGS_EFFORT_FAST;
+    const size_t uRoughShapes = bFast ? 8 : BC6H_MAX_SHAPES;
+
+    // Cluster in the integer space the refinement measures its error in
+    HDRColorA aClusterPixels[NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK && bFast; ++i)
+        aClusterPixels[i] = HDRColorA(float(EP.aIPixels[i].r), float(EP.aIPixels[i].g), float(EP.aIPixels[i].b), 0.0f);
 
     for (EP.uMode = 0; EP.uMode < ARRAYSIZE(ms_aInfo) && EP.fBestErr > 0; ++EP.uMode)
     {
         const uint8_t uShapes = ms_aInfo[EP.uMode].uPartitions ? 32 : 1;
         // Number of rough cases to look at. reasonable values of this are 1, uShapes/4, and uShapes
         // uShapes/4 gets nearly all the cases; you can increase that a bit (say by 3 or 4) if you really want to squeeze the last bit out
-        const size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        const size_t uItems = bFast ? 2 : std::max<size_t>(1, uShapes >> 2);
         float afRoughMSE[BC6H_MAX_SHAPES];
         uint8_t auShape[BC6H_MAX_SHAPES];
 
+        size_t auCandidate[BC6H_MAX_SHAPES];
+        size_t uCandidates = uShapes;
+        if (uShapes > uRoughShapes)
+        {
+            uCandidates = RankPartitionShapes(aClusterPixels, false, ms_aInfo[EP.uMode].uPartitions,
+                uShapes, uRoughShapes, auCandidate);
+        }
+        else
+        {
+            for (size_t s = 0; s < uShapes; ++s)
+                auCandidate[s] = s;
+        }
+
         // pick the best uItems shapes and refine these.
-        for (EP.uShape = 0; EP.uShape < uShapes; ++EP.uShape)
+        for (size_t s = 0; s < uCandidates; ++s)
         {
-            size_t uShape = EP.uShape;
-            afRoughMSE[uShape] = RoughMSE(&EP);
-            auShape[uShape] = static_cast<uint8_t>(uShape);
+            EP.uShape = static_cast<uint8_t>(auCandidate[s]);
+            afRoughMSE[s] = RoughMSE(&EP);
+            auShape[s] = EP.uShape;
         }
 
         // Bubble up the first uItems items
-        for (size_t i = 0; i < uItems; i++)
+        for (size_t i = 0; i < uItems && i < uCandidates; i++)
         {
-            for (size_t j = i + 1; j < uShapes; j++)
+            for (size_t j = i + 1; j < uCandidates; j++)
             {
                 if (afRoughMSE[i] > afRoughMSE[j])
                 {
@@ -532,7 +792,7 @@ void Block_BC6H::Encode(bool bSigned, const HDRColorA* const pIn)
             }
         }
 
-        for (size_t i = 0; i < uItems && EP.fBestErr > 0; i++)
+        for (size_t i = 0; i < uItems && i < uCandidates && EP.fBestErr > 0; i++)
         {
             EP.uShape = auShape[i];
             Refine(&EP);
@@ -541,6 +801,47 @@ void Block_BC6H::Encode(bool bSigned, const HDRColorA* const pIn)
 }
 
 
+// Refines the mode, shape and endpoints of an earlier encoding of the block, then
+// a fresh endpoint fit for the same mode and shape. Returns whether the result
+// is close enough to skip the search, which otherwise has to beat it.
+bool Block_BC6H::EncodeFromSeed(EncodeParams& EP, const uint8_t* pSeedBC)
+{
+    uint8_t uMode;
+    size_t uShape;
+    INTEndPntPair aEndPts[BC6H_MAX_REGIONS];
+    if (reinterpret_cast<const Block_BC6H*>(pSeedBC)->ReadHeader(EP.bSigned, uMode, uShape, aEndPts) != HEADER_OK)
+        return false;
+
+    EP.uMode = uint8_t(ms_aModeToInfo[uMode]);
+    EP.uShape = uint8_t(uShape);
+    const LDRColorA& Prec = ms_aInfo[EP.uMode].RGBAPrec[0][0];
+    for (size_t p = 0; p <= ms_aInfo[EP.uMode].uPartitions; ++p)
+    {
+        INTEndPntPair& unq = EP.aUnqEndPts[uShape][p];
+        unq.A = INTColor(QuantizeInverse(aEndPts[p].A.r, Prec.r, EP.bSigned),
+            QuantizeInverse(aEndPts[p].A.g, Prec.g, EP.bSigned), QuantizeInverse(aEndPts[p].A.b, Prec.b, EP.bSigned));
+        unq.B = INTColor(QuantizeInverse(aEndPts[p].B.r, Prec.r, EP.bSigned),
+            QuantizeInverse(aEndPts[p].B.g, Prec.g, EP.bSigned), QuantizeInverse(aEndPts[p].B.b, Prec.b, EP.bSigned));
+    }
+    Refine(&EP);
+
+    RoughMSE(&EP);
+    Refine(&EP);
+
+    // Kept when the error left is small next to the spread of the texels
+    INTColor mean(0, 0, 0);
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        mean += EP.aIPixels[i];
+    mean = INTColor(mean.r / int(NUM_PIXELS_PER_BLOCK), mean.g / int(NUM_PIXELS_PER_BLOCK), mean.b / int(NUM_PIXELS_PER_BLOCK));
+
+    float fVariance = 0.0f;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        fVariance += Norm(EP.aIPixels[i], mean);
+
+    return EP.fBestErr <= std::max(BC6H_SEED_MIN_ERROR * BC6H_NUM_CHANNELS, fVariance * BC6H_SEED_VARIANCE_FRACTION);
+}
+
+
 //-------------------------------------------------------------------------------------
 int Block_BC6H::Quantize(int iValue, int prec, bool bSigned)
 {
@@ -570,6 +871,23 @@ int Block_BC6H::Quantize(int iValue, int prec, bool bSigned)
 }
 
 
+// Smallest magnitude Quantize maps to comp
+int Block_BC6H::QuantizeInverse(int comp, int prec, bool bSigned)
+{
+    if (bSigned)
+    {
+        if (prec >= 16)
+            return comp;
+        const int m = std::min<int>(F16MAX, ((comp < 0 ? -comp : comp) * (F16MAX + 1) + (1 << (prec - 1)) - 1) >> (prec - 1));
+        return comp < 0 ? -m : m;
+    }
+
+    if (prec >= 15)
+        return comp;
+    return std::min<int>(F16MAX, (comp * (F16MAX + 1) + (1 << prec) - 1) >> prec);
+}
+
+
 int Block_BC6H::Unquantize(int comp, uint8_t uBitsPerComp, bool bSigned)
 {
     int unq = 0, s = 0;
@@ -682,7 +1000,9 @@ void Block_BC6H::GeneratePaletteQuantized(const EncodeParams* pEP, const INTEndP
     const int* aWeights = nullptr;
     switch (uIndexPrec)
     {
-    case 3: aWeights = g_aWeights3; assert(uNumIndices <= 8);     case 4: aWeights = g_aWeights4; assert(uNumIndices <= 16);     default:
+    case 3: aWeights = g_aWeights3; assert(uNumIndices <= 8); break;
+    case 4: aWeights = g_aWeights4; assert(uNumIndices <= 16); break;
+    default:
         assert(false);
         for (size_t i = 0; i < uNumIndices; ++i)
         {
@@ -866,7 +1186,7 @@ void Block_BC6H::OptimizeEndPoints(const EncodeParams* pEP, const float aOrgErr[
         size_t np = 0;
         for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
         {
-            if (g_aPartitionTable[p][pEP->uShape][i] == p)
+            if (g_aPartitionTable[uPartitions][pEP->uShape][i] == p)
             {
                 aPixels[np++] = pEP->aIPixels[i];
             }
@@ -967,43 +1287,32 @@ void Block_BC6H::QuantizeEndPts(const EncodeParams* pEP, INTEndPntPair* aQntEndP
 void Block_BC6H::EmitBlock(const EncodeParams* pEP, const INTEndPntPair aEndPts[], const size_t aIndices[])
 {
     assert(pEP);
-    const uint8_t uRealMode = ms_aInfo[pEP->uMode].uMode;
     const uint8_t uPartitions = ms_aInfo[pEP->uMode].uPartitions;
     const uint8_t uIndexPrec = ms_aInfo[pEP->uMode].uIndexPrec;
     const size_t uHeaderBits = uPartitions > 0 ? 82 : 65;
-    const ModeDescriptor* desc = ms_aDesc[pEP->uMode];
-    size_t uStartBit = 0;
-
-    while (uStartBit < uHeaderBits)
+    const HeaderProgram& program = ms_headerPrograms.aPrograms[pEP->uMode];
+
+    // Negative endpoints are stored as two's complement
+    int aFields[BZ + 1] = {};
+    aFields[M] = ms_aInfo[pEP->uMode].uMode;
+    aFields[D] = pEP->uShape;
+    aFields[RW] = aEndPts[0].A.r; aFields[GW] = aEndPts[0].A.g; aFields[BW] = aEndPts[0].A.b;
+    aFields[RX] = aEndPts[0].B.r; aFields[GX] = aEndPts[0].B.g; aFields[BX] = aEndPts[0].B.b;
+    aFields[RY] = aEndPts[1].A.r; aFields[GY] = aEndPts[1].A.g; aFields[BY] = aEndPts[1].A.b;
+    aFields[RZ] = aEndPts[1].B.r; aFields[GZ] = aEndPts[1].B.g; aFields[BZ] = aEndPts[1].B.b;
+
+    BlockBits bits;
+    for (size_t i = 0; i < program.nRuns; ++i)
     {
-        switch (desc[uStartBit].m_eField)
-        {
-        case M:  SetBit(uStartBit, uint8_t(uRealMode >> desc[uStartBit].m_uBit) & 0x01); break;
-        case D:  SetBit(uStartBit, uint8_t(pEP->uShape >> desc[uStartBit].m_uBit) & 0x01); break;
-        case RW: SetBit(uStartBit, uint8_t(aEndPts[0].A.r >> desc[uStartBit].m_uBit) & 0x01); break;
-        case RX: SetBit(uStartBit, uint8_t(aEndPts[0].B.r >> desc[uStartBit].m_uBit) & 0x01); break;
-        case RY: SetBit(uStartBit, uint8_t(aEndPts[1].A.r >> desc[uStartBit].m_uBit) & 0x01); break;
-        case RZ: SetBit(uStartBit, uint8_t(aEndPts[1].B.r >> desc[uStartBit].m_uBit) & 0x01); break;
-        case GW: SetBit(uStartBit, uint8_t(aEndPts[0].A.g >> desc[uStartBit].m_uBit) & 0x01); break;
-        case GX: SetBit(uStartBit, uint8_t(aEndPts[0].B.g >> desc[uStartBit].m_uBit) & 0x01); break;
-        case GY: SetBit(uStartBit, uint8_t(aEndPts[1].A.g >> desc[uStartBit].m_uBit) & 0x01); break;
-        case GZ: SetBit(uStartBit, uint8_t(aEndPts[1].B.g >> desc[uStartBit].m_uBit) & 0x01); break;
-        case BW: SetBit(uStartBit, uint8_t(aEndPts[0].A.b >> desc[uStartBit].m_uBit) & 0x01); break;
-        case BX: SetBit(uStartBit, uint8_t(aEndPts[0].B.b >> desc[uStartBit].m_uBit) & 0x01); break;
-        case BY: SetBit(uStartBit, uint8_t(aEndPts[1].A.b >> desc[uStartBit].m_uBit) & 0x01); break;
-        case BZ: SetBit(uStartBit, uint8_t(aEndPts[1].B.b >> desc[uStartBit].m_uBit) & 0x01); break;
-        default: assert(false);
-        }
+        const HeaderRun& run = program.aRuns[i];
+        const uint64_t uField = uint32_t(aFields[run.uField]);
+        bits.Set(run.uSrc, run.uCount, (uField >> run.uDst) & ((uint64_t(1) << run.uCount) - 1));
     }
 
-    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-    {
-        if (IsFixUpOffset(ms_aInfo[pEP->uMode].uPartitions, pEP->uShape, i))
-            SetBits(uStartBit, uIndexPrec - 1, static_cast<uint8_t>(aIndices[i]));
-        else
-            SetBits(uStartBit, uIndexPrec, static_cast<uint8_t>(aIndices[i]));
-    }
+    size_t uStartBit = uHeaderBits;
+    bits.WriteIndices(uStartBit, aIndices, uIndexPrec, g_Anchors.aAnchors[uPartitions][pEP->uShape], uPartitions + 1);
     assert(uStartBit == 128);
+    StoreBits(bits);
 }
 
 
@@ -1152,8 +1461,8 @@ float Block_BC6H::RoughMSE(EncodeParams* pEP) const
 
         HDRColorA epA, epB;
         OptimizeRGB(pEP->aHDRPixels, &epA, &epB, 4, np, auPixIdx);
-        aEndPts[p].A.FromHDRColorA(epA, pEP->bSigned);
-        aEndPts[p].B.FromHDRColorA(epB, pEP->bSigned);
+        aEndPts[p].A = INTColor::FromHDRColorA(epA, pEP->bSigned);
+        aEndPts[p].B = INTColor::FromHDRColorA(epB, pEP->bSigned);
         if (pEP->bSigned)
         {
             aEndPts[p].A.Clamp(-F16MAX, F16MAX);
@@ -1190,18 +1499,96 @@ void DecodeBC6HS(HDRColorA *pColor, const uint8_t *pBC)
 
 void EncodeBC6HU(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
 {
-    UNREFERENCED_PARAMETER(flags);
     assert(pBC && pColor);
     static_assert(sizeof(Block_BC6H) == 16, "Block_BC6H should be 16 bytes");
-    reinterpret_cast<Block_BC6H*>(pBC)->Encode(false, pColor);
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, false, pColor);
 }
 
 void EncodeBC6HS(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
 {
-    UNREFERENCED_PARAMETER(flags);
     assert(pBC && pColor);
     static_assert(sizeof(Block_BC6H) == 16, "Block_BC6H should be 16 bytes");
-    reinterpret_cast<Block_BC6H*>(pBC)->Encode(true, pColor);
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, true, pColor);
+}
+
+void DecodeBC6HU(uint16_t *pColor, const uint8_t *pBC)
+{
+    assert(pColor && pBC);
+    static_assert(sizeof(Block_BC6H) == 16, "Block_BC6H should be 16 bytes");
+    reinterpret_cast<const Block_BC6H*>(pBC)->Decode(false, pColor);
+}
+
+void DecodeBC6HS(uint16_t *pColor, const uint8_t *pBC)
+{
+    assert(pColor && pBC);
+    static_assert(sizeof(Block_BC6H) == 16, "Block_BC6H should be 16 bytes");
+    reinterpret_cast<const Block_BC6H*>(pBC)->Decode(true, pColor);
+}
+
+void DecodeBC6HURow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    for (size_t i = 0; i < nBlocks; ++i)
+        reinterpret_cast<const Block_BC6H*>(pBC + i * 16)->DecodeRows(false, pDst + i * 16, rowPitch);
+}
+
+void DecodeBC6HSRow(uint16_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    for (size_t i = 0; i < nBlocks; ++i)
+        reinterpret_cast<const Block_BC6H*>(pBC + i * 16)->DecodeRows(true, pDst + i * 16, rowPitch);
+}
+
+void DecodeBC6HURow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    for (size_t i = 0; i < nBlocks; ++i)
+        reinterpret_cast<const Block_BC6H*>(pBC + i * 16)->DecodeRows(false, pDst + i * 16, rowPitch);
+}
+
+void DecodeBC6HSRow(float *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    for (size_t i = 0; i < nBlocks; ++i)
+        reinterpret_cast<const Block_BC6H*>(pBC + i * 16)->DecodeRows(true, pDst + i * 16, rowPitch);
+}
+
+void EncodeBC6HU(uint8_t *pBC, const uint16_t *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC6H) == 16, "Block_BC6H should be 16 bytes");
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, false, pColor);
+}
+
+void EncodeBC6HS(uint8_t *pBC, const uint16_t *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC6H) == 16, "Block_BC6H should be 16 bytes");
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, true, pColor);
+}
+
+void EncodeBC6HUSeeded(uint8_t *pBC, const HDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags)
+{
+    assert(pBC && pColor && pSeedBC);
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, false, pColor, pSeedBC);
+}
+
+void EncodeBC6HSSeeded(uint8_t *pBC, const HDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags)
+{
+    assert(pBC && pColor && pSeedBC);
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, true, pColor, pSeedBC);
+}
+
+void EncodeBC6HUSeeded(uint8_t *pBC, const uint16_t *pColor, const uint8_t *pSeedBC, uint32_t flags)
+{
+    assert(pBC && pColor && pSeedBC);
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, false, pColor, pSeedBC);
+}
+
+void EncodeBC6HSSeeded(uint8_t *pBC, const uint16_t *pColor, const uint8_t *pSeedBC, uint32_t flags)
+{
+    assert(pBC && pColor && pSeedBC);
+    reinterpret_cast<Block_BC6H*>(pBC)->Encode(flags, true, pColor, pSeedBC);
 }
 
 }
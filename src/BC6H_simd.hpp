@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// BC6H decoder kernels
+//
+// A palette entry is one RGBA16F texel packed into a 64-bit word, red in the low
+// 16 bits and alpha 1.0. All variants give the same bits as the scalar kernels in
+// BC6H.cpp.
+//-------------------------------------------------------------------------------------
+
+// Interpolates nEntries (8 or 16) entries between the unquantized r, g, b endpoints
+// aEndPtA and aEndPtB with the matching weights, scales them to half floats like
+// Block_BC6H::FinishUnquantize and packs them
+typedef void (*BC6H_BUILD_PALETTE)(uint64_t *pPalette, const int aEndPtA[3], const int aEndPtB[3],
+    const int *pWeights, size_t nEntries, bool bSigned);
+
+// Widens nEntries palette entries to RGBA32F, 4 floats per entry
+typedef void (*BC6H_PALETTE_TO_FLOAT)(float *pDst, const uint64_t *pPalette, size_t nEntries);
+
+#if defined(CROSSTEX_X86_SIMD)
+void BuildHalfPaletteSSE41(uint64_t *pPalette, const int aEndPtA[3], const int aEndPtB[3],
+    const int *pWeights, size_t nEntries, bool bSigned);
+void HalfPaletteToFloatSSE41(float *pDst, const uint64_t *pPalette, size_t nEntries);
+#endif
+
+} // namespace
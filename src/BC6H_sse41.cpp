@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <smmintrin.h>
+
+#include "BC6H_simd.hpp"
+
+
+namespace Tex {
+
+// Four entries per iteration, one 32-bit lane per entry and channel
+void BuildHalfPaletteSSE41(uint64_t *pPalette, const int aEndPtA[3], const int aEndPtB[3],
+    const int *pWeights, size_t nEntries, bool bSigned)
+{
+    const __m128i wMax = _mm_set1_epi32(64);
+    const __m128i round = _mm_set1_epi32(32);
+    const __m128i scale = _mm_set1_epi32(31);
+    const __m128i signBit = _mm_set1_epi32(0x8000);
+    const __m128i one = _mm_set1_epi32(0x3c00);
+
+    for (size_t i = 0; i < nEntries; i += 4)
+    {
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pWeights + i));
+        const __m128i wInv = _mm_sub_epi32(wMax, w);
+
+        __m128i aChannels[3];
+        for (size_t ch = 0; ch < 3; ++ch)
+        {
+            __m128i v = _mm_add_epi32(_mm_mullo_epi32(_mm_set1_epi32(aEndPtA[ch]), wInv),
+                _mm_mullo_epi32(_mm_set1_epi32(aEndPtB[ch]), w));
+            v = _mm_srai_epi32(_mm_add_epi32(v, round), 6);
+
+            if (bSigned)
+            {
+                // Scale the magnitude by 31/32, the sign bit only survives a
+                // nonzero result
+                const __m128i mag = _mm_srli_epi32(_mm_mullo_epi32(_mm_abs_epi32(v), scale), 5);
+                const __m128i neg = _mm_cmpgt_epi32(mag, _mm_setzero_si128());
+                aChannels[ch] = _mm_or_si128(mag, _mm_and_si128(_mm_and_si128(neg, _mm_srai_epi32(v, 31)), signBit));
+            }
+            else
+            {
+                aChannels[ch] = _mm_srli_epi32(_mm_mullo_epi32(v, scale), 6);
+            }
+        }
+
+        // r0-3 g0-3 and b0-3 a0-3 to RGBA per entry
+        const __m128i rg = _mm_packus_epi32(aChannels[0], aChannels[1]);
+        const __m128i ba = _mm_packus_epi32(aChannels[2], one);
+        const __m128i rgPairs = _mm_unpacklo_epi16(rg, _mm_srli_si128(rg, 8));
+        const __m128i baPairs = _mm_unpacklo_epi16(ba, _mm_srli_si128(ba, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pPalette + i), _mm_unpacklo_epi32(rgPairs, baPairs));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pPalette + i + 2), _mm_unpackhi_epi32(rgPairs, baPairs));
+    }
+}
+
+// Exact conversion: normals rebias the exponent, denormals go through an integer
+// to float conversion so flush-to-zero modes don't matter
+void HalfPaletteToFloatSSE41(float *pDst, const uint64_t *pPalette, size_t nEntries)
+{
+    const __m128i expMask = _mm_set1_epi32(0x7c00);
+    const __m128i magMask = _mm_set1_epi32(0x7fff);
+    const __m128i signMask = _mm_set1_epi32(0x8000);
+    const __m128i rebias = _mm_set1_epi32(112 << 23);
+    const __m128i infExp = _mm_set1_epi32(0x7f800000);
+    const __m128 denormScale = _mm_set1_ps(1.0f / 16777216.0f);
+
+    for (size_t i = 0; i < nEntries; ++i)
+    {
+        const __m128i h = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pPalette + i)));
+        const __m128i mag = _mm_and_si128(h, magMask);
+        const __m128i exp = _mm_and_si128(h, expMask);
+
+        const __m128i normal = _mm_add_epi32(_mm_slli_epi32(mag, 13), rebias);
+        const __m128i denormal = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(mag), denormScale));
+        const __m128i special = _mm_or_si128(_mm_slli_epi32(mag, 13), infExp);
+
+        __m128i f = _mm_blendv_epi8(normal, denormal, _mm_cmpeq_epi32(exp, _mm_setzero_si128()));
+        f = _mm_blendv_epi8(f, special, _mm_cmpeq_epi32(exp, expMask));
+        f = _mm_or_si128(f, _mm_slli_epi32(_mm_and_si128(h, signMask), 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + 4 * i), f);
+    }
+}
+
+} // namespace
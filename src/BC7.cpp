@@ -2,11 +2,15 @@
 #include <stddef.h>
 #include <string.h>
 #include <float.h>
+#include <limits.h>
 #include <stdio.h>
+#include <algorithm>
 
 #include "BC.hpp"
 #include "BC67_shared.hpp"
+#include "BC7_simd.hpp"
 #include "Colors.hpp"
+#include "CPUFeatures.hpp"
 
 
 namespace Tex {
@@ -22,7 +26,9 @@ class Block_BC7 : private CBits<16>
 {
 public:
     void Decode(HDRColorA* pOut) const;
-    void Encode(uint32_t flags, const HDRColorA* const pIn);
+    // pSeedBC optionally holds an earlier encoding of similar texels to start from
+    void Encode(uint32_t flags, const HDRColorA* const pIn, const uint8_t* pSeedBC = nullptr);
+    void Encode(uint32_t flags, const LDRColorA* const pIn, const uint8_t* pSeedBC = nullptr);
 
 private:
     struct ModeInfo
@@ -38,14 +44,24 @@ private:
         LDRColorA RGBAPrecWithP;
     };
 
+    // Search budget of one effort level
+    struct EffortInfo
+    {
+        uint8_t uRoughShapes;   // shapes scored with RoughMSE after ranking them by pixel clusters, 0 scores all
+        uint8_t uShapeShift;    // refine max(1, uShapes >> uShapeShift) of the best rough shapes
+        int iDelta;             // radius of the final exhaustive endpoint search, 0 skips it
+        uint8_t uRefinePasses;  // maximum endpoint optimization passes per shape
+    };
+
     struct EncodeParams
     {
         uint8_t uMode;
+        const EffortInfo* pEffort;
         LDREndPntPair aEndPts[BC7_MAX_SHAPES][BC7_MAX_REGIONS];
         LDRColorA aLDRPixels[NUM_PIXELS_PER_BLOCK];
         const HDRColorA* const aHDRPixels;
 
-        EncodeParams(const HDRColorA* const aOriginal) : aHDRPixels(aOriginal) {}
+        EncodeParams(const HDRColorA* const aOriginal) : pEffort(nullptr), aHDRPixels(aOriginal) {}
     };
 
     static uint8_t Quantize(uint8_t comp, uint8_t uPrec)
@@ -107,13 +123,20 @@ private:
         const size_t aIndex[],
         const size_t aIndex2[]);
     float Refine(const EncodeParams* pEP, size_t uShape, size_t uRotation, size_t uIndexMode);
+    bool EncodeSolid(uint32_t flags, EncodeParams& EP);
+    bool EncodeFromSeed(uint32_t flags, EncodeParams& EP, const uint8_t* pSeedBC, float& fErr);
+
+    void Encode(uint32_t flags, EncodeParams& EP, const uint8_t* pSeedBC);
 
     float MapColors(const EncodeParams* pEP, const LDRColorA aColors[], size_t np, size_t uIndexMode,
         const LDREndPntPair& endPts, float fMinErr) const;
     static float RoughMSE(EncodeParams* pEP, size_t uShape, size_t uIndexMode);
+    static bool IsModeAllowed(uint32_t flags, size_t uMode);
+    static void RotatePixels(LDRColorA aPixels[], size_t uRotation);
 
 private:
     const static ModeInfo ms_aInfo[];
+    const static EffortInfo ms_aEffort[];
 };
 
 // BC7 compression: uPartitions, uPartitionBits, uPBits, uRotationBits, uIndexModeBits, uIndexPrec, uIndexPrec2, RGBAPrec, RGBAPrecWithP
@@ -137,6 +160,100 @@ const Block_BC7::ModeInfo Block_BC7::ms_aInfo[] =
         // Mode 7: Color+Alpha, 2 Subsets, RGBAP 55551 (unique P-bit), 2-bit indices, 64 partitions
 };
 
+// BC7 effort levels, indexed by the BC_FLAGS_EFFORT bits: uRoughShapes, uShapeShift, iDelta, uRefinePasses
+const Block_BC7::EffortInfo Block_BC7::ms_aEffort[] =
+{
+    {0, 2, 5, 1},     // Normal
+    {8, 6, 2, 1},     // Fast
+    {0, 1, 5, 2},     // Slow
+    {0, 0, 6, 4},     // Exhaustive
+};
+
+// Endpoints whose interpolant at one fixed index is closest to each 8-bit value, for
+// the 7-bit color endpoints of mode 5 and the 7-bit + P-bit endpoints of mode 6.
+// Mode 5 reaches every value exactly; mode 6 misses a few by one for some P-bits.
+struct SolidBC7Entry
+{
+    uint8_t uA;     // endpoint A as stored in LDREndPntPair for the mode
+    uint8_t uB;
+    uint8_t uErr;   // absolute error of the interpolant
+};
+
+const size_t BC7_SOLID_INDEX5 = 1;
+const size_t BC7_SOLID_INDEX6 = 1;
+
+struct SolidBC7Table
+{
+    SolidBC7Entry aMode5[256];
+    SolidBC7Entry aMode6[4][256];   // [P-bit of A * 2 + P-bit of B][value]
+
+    SolidBC7Table()
+    {
+        SolidBC7Entry aReach[256];
+
+        // Mode 5 stores 7-bit endpoints and expands them by bit replication
+        Clear(aReach);
+        for (int a = 0; a < 128; ++a)
+            for (int b = 0; b < 128; ++b)
+                Reach(aReach, (a << 1) | (a >> 6), (b << 1) | (b >> 6), g_aWeights2[BC7_SOLID_INDEX5], a, b);
+        Fill(aMode5, aReach);
+
+        // Mode 6 stores the full 8-bit endpoint, the P-bit being its low bit
+        for (int p = 0; p < 4; ++p)
+        {
+            Clear(aReach);
+            for (int a = 0; a < 128; ++a)
+            {
+                for (int b = 0; b < 128; ++b)
+                {
+                    const int ea = (a << 1) | (p >> 1);
+                    const int eb = (b << 1) | (p & 1);
+                    Reach(aReach, ea, eb, g_aWeights4[BC7_SOLID_INDEX6], ea, eb);
+                }
+            }
+            Fill(aMode6[p], aReach);
+        }
+    }
+
+    static void Clear(SolidBC7Entry aReach[256])
+    {
+        for (size_t t = 0; t < 256; ++t)
+            aReach[t].uErr = 0xff;
+    }
+
+    // Records the first stored pair whose interpolant hits each value, same rounding as InterpolateLDR
+    static void Reach(SolidBC7Entry aReach[256], int ea, int eb, int w, int uStoredA, int uStoredB)
+    {
+        const int v = (ea * (BC67_WEIGHT_MAX - w) + eb * w + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT;
+        if (aReach[v].uErr)
+        {
+            aReach[v].uA = uint8_t(uStoredA);
+            aReach[v].uB = uint8_t(uStoredB);
+            aReach[v].uErr = 0;
+        }
+    }
+
+    // Each value takes the nearest reachable one
+    static void Fill(SolidBC7Entry aTable[256], const SolidBC7Entry aReach[256])
+    {
+        for (int t = 0; t < 256; ++t)
+        {
+            for (int d = 0; d < 256; ++d)
+            {
+                const int v = (t - d >= 0 && !aReach[t - d].uErr) ? t - d : (t + d < 256 && !aReach[t + d].uErr) ? t + d : -1;
+                if (v >= 0)
+                {
+                    aTable[t] = aReach[v];
+                    aTable[t].uErr = uint8_t(d);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+const SolidBC7Table g_SolidBC7;
+
 float OptimizeRGBA(
     const HDRColorA* const pPoints, HDRColorA* pX, HDRColorA* pY,
     size_t cSteps, size_t cPixels, const size_t* pIndex)
@@ -295,9 +412,9 @@ float OptimizeRGBA(
     return fError;
 }
 
-float ComputeError(const LDRColorA& pixel, const LDRColorA aPalette[],
-    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex = nullptr,
-    size_t* pBestIndex2 = nullptr)
+float ComputeErrorScalar(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex,
+    size_t* pBestIndex2)
 {
     const size_t uNumIndices = size_t(1) << uIndexPrec;
     const size_t uNumIndices2 = size_t(1) << uIndexPrec2;
@@ -367,221 +484,357 @@ float ComputeError(const LDRColorA& pixel, const LDRColorA aPalette[],
     return fTotalErr;
 }
 
-//-------------------------------------------------------------------------------------
-// BC7 Compression
-//-------------------------------------------------------------------------------------
-void Block_BC7::Decode(HDRColorA* pOut) const
+float MapColorsScalar(const LDRColorA aColors[], size_t np, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, float fMinErr)
 {
-    assert(pOut);
+    float fTotalErr = 0;
+    for (size_t i = 0; i < np; ++i)
+    {
+        fTotalErr += ComputeErrorScalar(aColors[i], aPalette, uIndexPrec, uIndexPrec2, nullptr, nullptr);
+        if (fTotalErr > fMinErr)   // check for early exit
+        {
+            fTotalErr = FLT_MAX;
+            break;
+        }
+    }
 
-    size_t uFirst = 0;
-    while (uFirst < 128 && !GetBit(uFirst)) {}
-    uint8_t uMode = uint8_t(uFirst - 1);
+    return fTotalErr;
+}
 
-    if (uMode < 8)
-    {
-        const uint8_t uPartitions = ms_aInfo[uMode].uPartitions;
-        assert(uPartitions < BC7_MAX_REGIONS);
+// Error kernels picked once for the running CPU, all of them give identical results
+struct ErrorKernels
+{
+    BC7_COMPUTE_ERROR pfnComputeError;
+    BC7_MAP_COLORS pfnMapColors;
+};
 
-        const uint8_t uNumEndPts = (uPartitions + 1) << 1;
-        const uint8_t uIndexPrec = ms_aInfo[uMode].uIndexPrec;
-        const uint8_t uIndexPrec2 = ms_aInfo[uMode].uIndexPrec2;
-        size_t i;
-        size_t uStartBit = uMode + 1;
-        uint8_t P[6];
-        uint8_t uShape = GetBits(uStartBit, ms_aInfo[uMode].uPartitionBits);
-        assert(uShape < BC7_MAX_SHAPES);
+ErrorKernels SelectErrorKernels()
+{
+#if defined(CROSSTEX_X86_SIMD)
+    const CPUFeatures& features = GetCPUFeatures();
+    if (features.bAVX2)
+        return { ComputeErrorAVX2, MapColorsAVX2 };
+    if (features.bSSE41)
+        return { ComputeErrorSSE41, MapColorsSSE41 };
+#endif
+    return { ComputeErrorScalar, MapColorsScalar };
+}
 
-        uint8_t uRotation = GetBits(uStartBit, ms_aInfo[uMode].uRotationBits);
-        assert(uRotation < 4);
+const ErrorKernels& GetErrorKernels()
+{
+    static const ErrorKernels kernels = SelectErrorKernels();
+    return kernels;
+}
 
-        uint8_t uIndexMode = GetBits(uStartBit, ms_aInfo[uMode].uIndexModeBits);
-        assert(uIndexMode < 2);
+inline float ComputeError(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex = nullptr,
+    size_t* pBestIndex2 = nullptr)
+{
+    return GetErrorKernels().pfnComputeError(pixel, aPalette, uIndexPrec, uIndexPrec2, pBestIndex, pBestIndex2);
+}
 
-        LDRColorA c[BC7_MAX_REGIONS << 1];
-        const LDRColorA RGBAPrec = ms_aInfo[uMode].RGBAPrec;
-        const LDRColorA RGBAPrecWithP = ms_aInfo[uMode].RGBAPrecWithP;
+//-------------------------------------------------------------------------------------
+// BC7 Decompression
+//-------------------------------------------------------------------------------------
+namespace {
 
-        assert(uNumEndPts <= (BC7_MAX_REGIONS << 1));
+// ms_aInfo with the precisions split by field, as compile time constants so every
+// mode is decoded with fixed field offsets
+struct ModeLayout
+{
+    size_t uPartitions;
+    size_t uPartitionBits;
+    size_t uRotationBits;
+    size_t uIndexModeBits;
+    size_t uColorBits;      // Per red, green and blue endpoint component
+    size_t uAlphaBits;      // Per alpha endpoint component, 0 for opaque modes
+    size_t uPBits;
+    size_t uIndexPrec;
+    size_t uIndexPrec2;
+};
 
-        // Red channel
-        for (i = 0; i < uNumEndPts; i++)
-        {
-            if (uStartBit + RGBAPrec.r > 128)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
+constexpr ModeLayout g_aModeLayouts[8] =
+{
+    { 2, 4, 0, 0, 4, 0, 6, 3, 0 },
+    { 1, 6, 0, 0, 6, 0, 2, 3, 0 },
+    { 2, 6, 0, 0, 5, 0, 0, 2, 0 },
+    { 1, 6, 0, 0, 7, 0, 4, 2, 0 },
+    { 0, 0, 2, 1, 5, 6, 0, 2, 3 },
+    { 0, 0, 2, 0, 7, 8, 0, 2, 2 },
+    { 0, 0, 0, 0, 7, 7, 2, 4, 0 },
+    { 1, 6, 0, 0, 5, 5, 4, 2, 0 },
+};
 
-            c[i].r = GetBits(uStartBit, RGBAPrec.r);
-        }
+// Block_BC7::Unquantize for one component
+inline uint8_t Unquantize(uint32_t comp, size_t uPrec)
+{
+    comp = (comp << (8 - uPrec)) & 0xff;
+    return uint8_t(comp | (comp >> uPrec));
+}
 
-        // Green channel
-        for (i = 0; i < uNumEndPts; i++)
+void BuildPaletteScalar(uint32_t *pPalette, const LDRColorA& c0, const LDRColorA& c1,
+    const int *pWeights, size_t nEntries)
+{
+    for (size_t i = 0; i < nEntries; ++i)
+    {
+        const uint32_t w = uint32_t(pWeights[i]);
+        uint32_t uColor = 0;
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
         {
-            if (uStartBit + RGBAPrec.g > 128)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
-
-            c[i].g = GetBits(uStartBit, RGBAPrec.g);
+            const uint32_t v = (uint32_t(c0[ch]) * (BC67_WEIGHT_MAX - w) + uint32_t(c1[ch]) * w + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT;
+            uColor |= v << (8 * ch);
         }
+        pPalette[i] = uColor;
+    }
+}
 
-        // Blue channel
-        for (i = 0; i < uNumEndPts; i++)
-        {
-            if (uStartBit + RGBAPrec.b > 128)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
+// Palette kernel picked once for the running CPU, all of them give identical results
+BC7_BUILD_PALETTE SelectPaletteKernel()
+{
+#if defined(CROSSTEX_X86_SIMD)
+    if (GetCPUFeatures().bSSE41)
+        return BuildPaletteSSE41;
 #endif
-                FillWithErrorColors(pOut);
-                return;
-            }
+    return BuildPaletteScalar;
+}
 
-            c[i].b = GetBits(uStartBit, RGBAPrec.b);
-        }
+BC7_BUILD_PALETTE GetPaletteKernel()
+{
+    static const BC7_BUILD_PALETTE pfnBuildPalette = SelectPaletteKernel();
+    return pfnBuildPalette;
+}
 
-        // Alpha channel
-        for (i = 0; i < uNumEndPts; i++)
-        {
-            if (uStartBit + RGBAPrec.a > 128)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
+void BuildPalette(uint32_t *pPalette, const LDRColorA& c0, const LDRColorA& c1, size_t uPrec)
+{
+    const int* pWeights = (uPrec == 2) ? g_aWeights2 : (uPrec == 3) ? g_aWeights3 : g_aWeights4;
+    GetPaletteKernel()(pPalette, c0, c1, pWeights, size_t(1) << uPrec);
+}
 
-            c[i].a = RGBAPrec.a ? GetBits(uStartBit, RGBAPrec.a) : 255;
-        }
+}
 
-        // P-bits
-        assert(ms_aInfo[uMode].uPBits <= 6);
-                for (i = 0; i < ms_aInfo[uMode].uPBits; i++)
-        {
-            if (uStartBit > 127)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
+namespace {
 
-            P[i] = GetBit(uStartBit);
-        }
+template <size_t uMode>
+void DecodeMode(uint32_t aTexels[], const BlockBits& bits)
+{
+    constexpr ModeLayout layout = g_aModeLayouts[uMode];
+    const size_t uNumEndPts = (layout.uPartitions + 1) << 1;
+
+    size_t uOffset = uMode + 1;
+    const size_t uShape = size_t(bits.Get(uOffset, layout.uPartitionBits));
+    uOffset += layout.uPartitionBits;
+    const size_t uRotation = size_t(bits.Get(uOffset, layout.uRotationBits));
+    uOffset += layout.uRotationBits;
+    const size_t uIndexMode = size_t(bits.Get(uOffset, layout.uIndexModeBits));
+    uOffset += layout.uIndexModeBits;
+
+    // Endpoints are stored channel by channel, the P-bits follow
+    uint32_t aEndPts[BC7_MAX_REGIONS << 1][BC7_NUM_CHANNELS];
+    for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+    {
+        const size_t uBits = (ch < 3) ? layout.uColorBits : layout.uAlphaBits;
+        for (size_t i = 0; i < uNumEndPts; ++i, uOffset += uBits)
+            aEndPts[i][ch] = uint32_t(bits.Get(uOffset, uBits));
+    }
 
-        if (ms_aInfo[uMode].uPBits)
+    const size_t uPBit = layout.uPBits ? 1 : 0;
+    if (layout.uPBits)
+    {
+        for (size_t i = 0; i < uNumEndPts; ++i)
         {
-            for (i = 0; i < uNumEndPts; i++)
-            {
-                size_t pi = i * ms_aInfo[uMode].uPBits / uNumEndPts;
-                for (uint8_t ch = 0; ch < BC7_NUM_CHANNELS; ch++)
-                {
-                    if (RGBAPrec[ch] != RGBAPrecWithP[ch])
-                    {
-                        c[i][ch] = (c[i][ch] << 1) | P[pi];
-                    }
-                }
-            }
+            const uint32_t p = uint32_t(bits.Get(uOffset + i * layout.uPBits / uNumEndPts, 1));
+            for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+                aEndPts[i][ch] = (aEndPts[i][ch] << 1) | p;
         }
+        uOffset += layout.uPBits;
+    }
 
-        for (i = 0; i < uNumEndPts; i++)
-        {
-            c[i] = Unquantize(c[i], RGBAPrecWithP);
-        }
+    LDRColorA c[BC7_MAX_REGIONS << 1];
+    for (size_t i = 0; i < uNumEndPts; ++i)
+    {
+        c[i].r = Unquantize(aEndPts[i][0], layout.uColorBits + uPBit);
+        c[i].g = Unquantize(aEndPts[i][1], layout.uColorBits + uPBit);
+        c[i].b = Unquantize(aEndPts[i][2], layout.uColorBits + uPBit);
+        c[i].a = layout.uAlphaBits ? Unquantize(aEndPts[i][3], layout.uAlphaBits + uPBit) : 255;
+    }
 
-        uint8_t w1[NUM_PIXELS_PER_BLOCK], w2[NUM_PIXELS_PER_BLOCK];
+    const size_t uIndexBits = NUM_PIXELS_PER_BLOCK * layout.uIndexPrec - layout.uPartitions - 1;
+    uint64_t w1 = bits.Get(uOffset, uIndexBits);
+    w1 = ExpandAnchors(w1, g_Anchors.aAnchors[layout.uPartitions][uShape], layout.uPartitions + 1, layout.uIndexPrec);
+    uOffset += uIndexBits;
 
-        // read color indices
-        for (i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
-        {
-            size_t uNumBits = IsFixUpOffset(ms_aInfo[uMode].uPartitions, uShape, i) ? uIndexPrec - 1 : uIndexPrec;
-            if (uStartBit + uNumBits > 128)
-            {
-#ifndef NDEBUG
-                fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
-#endif
-                FillWithErrorColors(pOut);
-                return;
-            }
-            w1[i] = GetBits(uStartBit, uNumBits);
-        }
+    if (!layout.uIndexPrec2)
+    {
+        alignas(16) uint32_t aPalette[BC7_MAX_REGIONS][16];
+        for (size_t p = 0; p <= layout.uPartitions; ++p)
+            BuildPalette(aPalette[p], c[p << 1], c[(p << 1) + 1], layout.uIndexPrec);
+
+        const uint8_t* pRegions = g_aPartitionTable[layout.uPartitions][uShape];
+        const uint64_t uMask = (uint64_t(1) << layout.uIndexPrec) - 1;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, w1 >>= layout.uIndexPrec)
+            aTexels[i] = aPalette[pRegions[i]][w1 & uMask];
+    }
+    else
+    {
+        // Separate color and alpha indices, the index mode bit swaps their roles
+        uint64_t w2 = bits.Get(uOffset, NUM_PIXELS_PER_BLOCK * layout.uIndexPrec2 - 1);
+        w2 = ExpandAnchors(w2, g_Anchors.aAnchors[0][0], 1, layout.uIndexPrec2);
+
+        uint64_t wc = uIndexMode ? w2 : w1;
+        uint64_t wa = uIndexMode ? w1 : w2;
+        const size_t uColorPrec = uIndexMode ? layout.uIndexPrec2 : layout.uIndexPrec;
+        const size_t uAlphaPrec = uIndexMode ? layout.uIndexPrec : layout.uIndexPrec2;
+
+        alignas(16) uint32_t aPalette[16];
+        alignas(16) uint32_t aPaletteA[16];
+        BuildPalette(aPalette, c[0], c[1], uColorPrec);
+        BuildPalette(aPaletteA, c[0], c[1], uAlphaPrec);
+
+        const uint64_t uColorMask = (uint64_t(1) << uColorPrec) - 1;
+        const uint64_t uAlphaMask = (uint64_t(1) << uAlphaPrec) - 1;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, wc >>= uColorPrec, wa >>= uAlphaPrec)
+            aTexels[i] = (aPalette[wc & uColorMask] & 0x00ffffff) | (aPaletteA[wa & uAlphaMask] & 0xff000000);
+    }
 
-        // read alpha indices
-        if (uIndexPrec2)
+    if (uRotation)
+    {
+        // Swaps alpha with red, green or blue
+        const size_t uShift = 8 * (uRotation - 1);
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
         {
-            for (i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
-            {
-                size_t uNumBits = i ? uIndexPrec2 : uIndexPrec2 - 1;
-                if (uStartBit + uNumBits > 128)
-                {
-#ifndef NDEBUG
-                    fprintf(stderr, "BC7: Invalid block encountered during decoding\n");
-#endif
-                    FillWithErrorColors(pOut);
-                    return;
-                }
-                w2[i] = GetBits(uStartBit, uNumBits);
-            }
+            const uint32_t a = aTexels[i] >> 24;
+            const uint32_t x = (aTexels[i] >> uShift) & 0xff;
+            aTexels[i] = (aTexels[i] & ~((0xffu << uShift) | 0xff000000u)) | (a << uShift) | (x << 24);
         }
+    }
+}
 
-        for (i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-        {
-            uint8_t uRegion = g_aPartitionTable[uPartitions][uShape][i];
-            LDRColorA outPixel;
-            if (uIndexPrec2 == 0)
-            {
-                InterpolateLDR(c[uRegion << 1], c[(uRegion << 1) + 1], w1[i], w1[i], uIndexPrec, uIndexPrec, outPixel);
-            }
-            else
-            {
-                if (uIndexMode == 0)
-                {
-                    InterpolateLDR(c[uRegion << 1], c[(uRegion << 1) + 1], w1[i], w2[i], uIndexPrec, uIndexPrec2, outPixel);
-                }
-                else
-                {
-                    InterpolateLDR(c[uRegion << 1], c[(uRegion << 1) + 1], w2[i], w1[i], uIndexPrec2, uIndexPrec, outPixel);
-                }
-            }
+// RGBA8 texels of the block at pBC, written as 4 rows rowPitch bytes apart
+void DecodeRows(uint8_t* pDst, size_t rowPitch, const uint8_t* pBC)
+{
+    assert(pDst && pBC);
 
-            switch (uRotation)
-            {
-            case 1: std::swap(outPixel.r, outPixel.a); break;
-            case 2: std::swap(outPixel.g, outPixel.a); break;
-            case 3: std::swap(outPixel.b, outPixel.a); break;
-            }
+    const BlockBits bits(pBC);
+    const uint64_t uModeBits = bits.GetWord(0);
 
-            pOut[i] = outPixel.ToHDRColorA();
-        }
-    }
-    else
+    size_t uMode = 0;
+    while (uMode < 8 && !(uModeBits & (uint64_t(1) << uMode)))
+        ++uMode;
+
+    uint32_t aTexels[NUM_PIXELS_PER_BLOCK];
+    switch (uMode)
     {
+    case 0: DecodeMode<0>(aTexels, bits); break;
+    case 1: DecodeMode<1>(aTexels, bits); break;
+    case 2: DecodeMode<2>(aTexels, bits); break;
+    case 3: DecodeMode<3>(aTexels, bits); break;
+    case 4: DecodeMode<4>(aTexels, bits); break;
+    case 5: DecodeMode<5>(aTexels, bits); break;
+    case 6: DecodeMode<6>(aTexels, bits); break;
+    case 7: DecodeMode<7>(aTexels, bits); break;
+    default:
 #ifndef NDEBUG
         fprintf(stderr, "BC7: Reserved mode 8 encountered during decoding\n");
 #endif
         // Per the BC7 format spec, we must return transparent black
-        memset(pOut, 0, sizeof(HDRColorA) * NUM_PIXELS_PER_BLOCK);
+        memset(aTexels, 0, sizeof(aTexels));
+        break;
+    }
+
+    for (size_t y = 0; y < 4; ++y)
+        memcpy(pDst + y * rowPitch, aTexels + y * 4, 4 * sizeof(uint32_t));
+}
+
+// The choices of an encoded block an encoder can start from. Endpoints are
+// ordered A, B per region and include the P-bit as their low bit.
+struct SeedBC7
+{
+    size_t uMode;
+    size_t uShape;
+    size_t uRotation;
+    size_t uIndexMode;
+    uint32_t aEndPts[BC7_MAX_REGIONS << 1][BC7_NUM_CHANNELS];
+};
+
+bool ReadSeed(const uint8_t* pBC, SeedBC7& seed)
+{
+    const BlockBits bits(pBC);
+    const uint64_t uModeBits = bits.GetWord(0);
+
+    seed.uMode = 0;
+    while (seed.uMode < 8 && !(uModeBits & (uint64_t(1) << seed.uMode)))
+        ++seed.uMode;
+    if (seed.uMode == 8)
+        return false;
+
+    const ModeLayout& layout = g_aModeLayouts[seed.uMode];
+    const size_t uNumEndPts = (layout.uPartitions + 1) << 1;
+
+    size_t uOffset = seed.uMode + 1;
+    seed.uShape = size_t(bits.Get(uOffset, layout.uPartitionBits));
+    uOffset += layout.uPartitionBits;
+    seed.uRotation = size_t(bits.Get(uOffset, layout.uRotationBits));
+    uOffset += layout.uRotationBits;
+    seed.uIndexMode = size_t(bits.Get(uOffset, layout.uIndexModeBits));
+    uOffset += layout.uIndexModeBits;
+
+    for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+    {
+        const size_t uBits = (ch < 3) ? layout.uColorBits : layout.uAlphaBits;
+        for (size_t i = 0; i < uNumEndPts; ++i, uOffset += uBits)
+            seed.aEndPts[i][ch] = uint32_t(bits.Get(uOffset, uBits));
+    }
+
+    if (layout.uPBits)
+    {
+        for (size_t i = 0; i < uNumEndPts; ++i)
+        {
+            const uint32_t p = uint32_t(bits.Get(uOffset + i * layout.uPBits / uNumEndPts, 1));
+            for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+                seed.aEndPts[i][ch] = (seed.aEndPts[i][ch] << 1) | p;
+        }
+    }
+
+    return true;
+}
+
+// Squared error of an encoded block as decoded. The errors the encoder works with
+// depend on the order of the endpoints, which EmitBlock may swap, so blocks from
+// different sources are compared on this one.
+float DecodedError(const void* pBC, const LDRColorA aPixels[])
+{
+    LDRColorA aTexels[NUM_PIXELS_PER_BLOCK];
+    DecodeRows(reinterpret_cast<uint8_t*>(aTexels), 4 * sizeof(LDRColorA), static_cast<const uint8_t*>(pBC));
+
+    float fErr = 0.0f;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+        {
+            const float f = float(aTexels[i][ch]) - float(aPixels[i][ch]);
+            fErr += f * f;
+        }
     }
+    return fErr;
+}
+
+}
+
+void Block_BC7::Decode(HDRColorA* pOut) const
+{
+    assert(pOut);
+
+    LDRColorA aTexels[NUM_PIXELS_PER_BLOCK];
+    DecodeRows(reinterpret_cast<uint8_t*>(aTexels), 4 * sizeof(LDRColorA), reinterpret_cast<const uint8_t*>(this));
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        pOut[i] = aTexels[i].ToHDRColorA();
 }
 
-void Block_BC7::Encode(uint32_t flags, const HDRColorA* const pIn)
+void Block_BC7::Encode(uint32_t flags, const HDRColorA* const pIn, const uint8_t* pSeedBC)
 {
     assert(pIn);
 
-    Block_BC7 final = *this;
     EncodeParams EP(pIn);
-    float fMSEBest = FLT_MAX;
 
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
@@ -591,19 +844,50 @@ void Block_BC7::Encode(uint32_t flags, const HDRColorA* const pIn)
         EP.aLDRPixels[i].a = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].a * 255.0f + 0.01f)));
     }
 
-    for (EP.uMode = 0; EP.uMode < 8 && fMSEBest > 0; ++EP.uMode)
+    Encode(flags, EP, pSeedBC);
+}
+
+void Block_BC7::Encode(uint32_t flags, const LDRColorA* const pIn, const uint8_t* pSeedBC)
+{
+    assert(pIn);
+
+    // The float copy only feeds the rough endpoint fit in RoughMSE
+    HDRColorA aHDRPixels[NUM_PIXELS_PER_BLOCK];
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        if (!(flags & BC_FLAGS_USE_3SUBSETS) && (EP.uMode == 0 || EP.uMode == 2))
-        {
-            // 3 subset modes tend to be used rarely and add significant compression time
-            continue;
-        }
+        aHDRPixels[i] = pIn[i].ToHDRColorA();
+    }
 
-        if ((flags & BC_FLAGS_FORCE_BC7_MODE6) && (EP.uMode != 6))
-        {
-            // Use only mode 6
+    EncodeParams EP(aHDRPixels);
+    memcpy(EP.aLDRPixels, pIn, sizeof(EP.aLDRPixels));
+
+    Encode(flags, EP, pSeedBC);
+}
+
+void Block_BC7::Encode(uint32_t flags, EncodeParams& EP, const uint8_t* pSeedBC)
+{
+    if (EncodeSolid(flags, EP))
+        return;
+
+    Block_BC7 final = *this;
+    float fMSEBest = FLT_MAX;
+
+    static_assert(BC_FLAGS_EFFORT_MASK >> 21 == 3, "effort table expects a 2 bit field at bit 21");
+    EP.pEffort = &ms_aEffort[(flags & BC_FLAGS_EFFORT_MASK) >> 21];
+
+    Block_BC7 seeded;
+    float fSeedErr = FLT_MAX;
+    if (pSeedBC)
+    {
+        if (EncodeFromSeed(flags, EP, pSeedBC, fSeedErr))
+            return;
+        seeded = *this;
+    }
+
+    for (EP.uMode = 0; EP.uMode < 8 && fMSEBest > 0; ++EP.uMode)
+    {
+        if (!IsModeAllowed(flags, EP.uMode))
             continue;
-        }
 
         const size_t uShapes = size_t(1) << ms_aInfo[EP.uMode].uPartitionBits;
         assert(uShapes <= BC7_MAX_SHAPES);
@@ -612,32 +896,41 @@ void Block_BC7::Encode(uint32_t flags, const HDRColorA* const pIn)
         const size_t uNumIdxMode = size_t(1) << ms_aInfo[EP.uMode].uIndexModeBits;
         // Number of rough cases to look at. reasonable values of this are 1, uShapes/4, and uShapes
         // uShapes/4 gets nearly all the cases; you can increase that a bit (say by 3 or 4) if you really want to squeeze the last bit out
-        const size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        const size_t uItems = std::max<size_t>(1, uShapes >> EP.pEffort->uShapeShift);
         float afRoughMSE[BC7_MAX_SHAPES];
         size_t auShape[BC7_MAX_SHAPES];
 
+        // Lower effort levels only score the shapes closest to a clustering of the pixels
+        size_t auCandidate[BC7_MAX_SHAPES];
+        size_t uCandidates = uShapes;
+        if (EP.pEffort->uRoughShapes && uShapes > EP.pEffort->uRoughShapes)
+        {
+            uCandidates = RankPartitionShapes(EP.aHDRPixels, ms_aInfo[EP.uMode].RGBAPrec.a != 0,
+                ms_aInfo[EP.uMode].uPartitions, uShapes, EP.pEffort->uRoughShapes, auCandidate);
+        }
+        else
+        {
+            for (size_t s = 0; s < uShapes; s++)
+                auCandidate[s] = s;
+        }
+
         for (size_t r = 0; r < uNumRots && fMSEBest > 0; ++r)
         {
-            switch (r)
-            {
-            case 1: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].r, EP.aLDRPixels[i].a); break;
-            case 2: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].g, EP.aLDRPixels[i].a); break;
-            case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].b, EP.aLDRPixels[i].a); break;
-            }
+            RotatePixels(EP.aLDRPixels, r);
 
             for (size_t im = 0; im < uNumIdxMode && fMSEBest > 0; ++im)
             {
                 // pick the best uItems shapes and refine these.
-                for (size_t s = 0; s < uShapes; s++)
+                for (size_t s = 0; s < uCandidates; s++)
                 {
-                    afRoughMSE[s] = RoughMSE(&EP, s, im);
-                    auShape[s] = s;
+                    afRoughMSE[s] = RoughMSE(&EP, auCandidate[s], im);
+                    auShape[s] = auCandidate[s];
                 }
 
                 // Bubble up the first uItems items
-                for (size_t i = 0; i < uItems; i++)
+                for (size_t i = 0; i < uItems && i < uCandidates; i++)
                 {
-                    for (size_t j = i + 1; j < uShapes; j++)
+                    for (size_t j = i + 1; j < uCandidates; j++)
                     {
                         if (afRoughMSE[i] > afRoughMSE[j])
                         {
@@ -647,7 +940,7 @@ void Block_BC7::Encode(uint32_t flags, const HDRColorA* const pIn)
                     }
                 }
 
-                for (size_t i = 0; i < uItems && fMSEBest > 0; i++)
+                for (size_t i = 0; i < uItems && i < uCandidates && fMSEBest > 0; i++)
                 {
                     float fMSE = Refine(&EP, auShape[i], r, im);
                     if (fMSE < fMSEBest)
@@ -658,19 +951,191 @@ void Block_BC7::Encode(uint32_t flags, const HDRColorA* const pIn)
                 }
             }
 
-            switch (r)
-            {
-            case 1: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].r, EP.aLDRPixels[i].a); break;
-            case 2: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].g, EP.aLDRPixels[i].a); break;
-            case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].b, EP.aLDRPixels[i].a); break;
-            }
+            RotatePixels(EP.aLDRPixels, r);
         }
     }
 
     *this = final;
+
+    // The search can miss a result as good as the seeded one
+    if (fSeedErr < FLT_MAX && fSeedErr <= DecodedError(this, EP.aLDRPixels))
+        *this = seeded;
+}
+
+
+// Starts from an earlier encoding of the block: refines its endpoints for the new
+// texels, then fits fresh endpoints for its mode, shape, rotation and index mode.
+// The seed as it stands or the fit that decodes closest is left in the block, with
+// its error in fErr; FLT_MAX when the seed cannot be used. Returns whether it is
+// good enough to skip the search: when neither fit beats the seed by more than
+// BC7_SEED_MARGIN of its error, the texels changed too little for another mode or
+// shape to pay off.
+bool Block_BC7::EncodeFromSeed(uint32_t flags, EncodeParams& EP, const uint8_t* pSeedBC, float& fErr)
+{
+    fErr = FLT_MAX;
+
+    SeedBC7 seed;
+    if (!ReadSeed(pSeedBC, seed) || !IsModeAllowed(flags, seed.uMode))
+        return false;
+
+    // The seed may be this block, which Refine overwrites
+    const Block_BC7 seedBlock = *reinterpret_cast<const Block_BC7*>(pSeedBC);
+    const float fSeedErr = DecodedError(&seedBlock, EP.aLDRPixels);
+    *this = seedBlock;
+    fErr = fSeedErr;
+    if (fSeedErr == 0.0f)
+        return true;
+
+    // Endpoints are passed at 8 bits with the stored bits on top, Refine
+    // quantizes them back to the stored values
+    EP.uMode = uint8_t(seed.uMode);
+    const LDRColorA& prec = ms_aInfo[EP.uMode].RGBAPrecWithP;
+    LDREndPntPair* aEndPts = EP.aEndPts[seed.uShape];
+    for (size_t p = 0; p <= ms_aInfo[EP.uMode].uPartitions; ++p)
+    {
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+        {
+            aEndPts[p].A[ch] = prec[ch] ? uint8_t(seed.aEndPts[p << 1][ch] << (8 - prec[ch])) : 255;
+            aEndPts[p].B[ch] = prec[ch] ? uint8_t(seed.aEndPts[(p << 1) + 1][ch] << (8 - prec[ch])) : 255;
+        }
+    }
+
+    LDRColorA aPixels[NUM_PIXELS_PER_BLOCK];
+    memcpy(aPixels, EP.aLDRPixels, sizeof(aPixels));
+
+    RotatePixels(EP.aLDRPixels, seed.uRotation);
+    Block_BC7 best = seedBlock;
+    for (size_t uFit = 0; uFit < 2; ++uFit)
+    {
+        // A fresh fit escapes endpoints that no longer suit the texels at all
+        if (uFit)
+            RoughMSE(&EP, seed.uShape, seed.uIndexMode);
+        Refine(&EP, seed.uShape, seed.uRotation, seed.uIndexMode);
+
+        const float fFitErr = DecodedError(this, aPixels);
+        if (fFitErr < fErr)
+        {
+            best = *this;
+            fErr = fFitErr;
+        }
+    }
+    RotatePixels(EP.aLDRPixels, seed.uRotation);
+
+    const float fSeededErr = fErr;
+
+    // Neither fit moving far from the seed can also mean its mode or shape is
+    // wrong for all of them. A fit of mode 6, which suits most blocks, tells
+    // the two apart.
+    float fAnchorErr = fErr;
+    if (seed.uMode != 6)
+    {
+        EP.uMode = 6;
+        RoughMSE(&EP, 0, 0);
+        Refine(&EP, 0, 0, 0);
+        fAnchorErr = DecodedError(this, aPixels);
+        if (fAnchorErr < fErr)
+        {
+            best = *this;
+            fErr = fAnchorErr;
+        }
+    }
+
+    *this = best;
+    return fSeededErr * (1.0f + BC7_SEED_MARGIN) >= fSeedErr
+        && fSeededErr <= fAnchorErr * (1.0f + BC7_SEED_MARGIN);
 }
 
 
+bool Block_BC7::IsModeAllowed(uint32_t flags, size_t uMode)
+{
+    if (!(flags & BC_FLAGS_USE_3SUBSETS) && (uMode == 0 || uMode == 2))
+    {
+        // 3 subset modes tend to be used rarely and add significant compression time
+        return false;
+    }
+
+    if ((flags & BC_FLAGS_FORCE_BC7_MODE6) && (uMode != 6))
+    {
+        // Use only mode 6
+        return false;
+    }
+
+    return true;
+}
+
+
+// Swaps alpha with red, green or blue; applying it twice undoes it
+void Block_BC7::RotatePixels(LDRColorA aPixels[], size_t uRotation)
+{
+    switch (uRotation)
+    {
+    case 1: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aPixels[i].r, aPixels[i].a); break;
+    case 2: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aPixels[i].g, aPixels[i].a); break;
+    case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aPixels[i].b, aPixels[i].a); break;
+    }
+}
+
+
+// Single color blocks are written straight from the solid tables. Mode 5 keeps alpha
+// exact and reaches every color, so it is optimal unless only mode 6 is allowed.
+bool Block_BC7::EncodeSolid(uint32_t flags, EncodeParams& EP)
+{
+    for (size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        if (memcmp(&EP.aLDRPixels[i], &EP.aLDRPixels[0], sizeof(LDRColorA)) != 0)
+            return false;
+    }
+
+    const LDRColorA& color = EP.aLDRPixels[0];
+    LDREndPntPair aEndPts[1];
+    size_t aIndex[NUM_PIXELS_PER_BLOCK];
+    size_t aIndex2[NUM_PIXELS_PER_BLOCK] = {};
+
+    if (!(flags & BC_FLAGS_FORCE_BC7_MODE6))
+    {
+        EP.uMode = 5;
+        for (size_t ch = 0; ch < 3; ++ch)
+        {
+            aEndPts[0].A[ch] = g_SolidBC7.aMode5[color[ch]].uA;
+            aEndPts[0].B[ch] = g_SolidBC7.aMode5[color[ch]].uB;
+        }
+        aEndPts[0].A.a = aEndPts[0].B.a = color.a;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            aIndex[i] = BC7_SOLID_INDEX5;
+    }
+    else
+    {
+        // Every channel shares the two P-bits, pick the pair with the least error
+        size_t uBestP = 0;
+        int iBestErr = INT_MAX;
+        for (size_t p = 0; p < 4; ++p)
+        {
+            int iErr = 0;
+            for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+                iErr += g_SolidBC7.aMode6[p][color[ch]].uErr * g_SolidBC7.aMode6[p][color[ch]].uErr;
+            if (iErr < iBestErr)
+            {
+                iBestErr = iErr;
+                uBestP = p;
+            }
+        }
+
+        EP.uMode = 6;
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+        {
+            aEndPts[0].A[ch] = g_SolidBC7.aMode6[uBestP][color[ch]].uA;
+            aEndPts[0].B[ch] = g_SolidBC7.aMode6[uBestP][color[ch]].uB;
+        }
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            aIndex[i] = BC7_SOLID_INDEX6;
+    }
+
+    EmitBlock(&EP, 0, 0, 0, aEndPts, aIndex, aIndex2);
+    return true;
+}
+
 //-------------------------------------------------------------------------------------
 void Block_BC7::GeneratePaletteQuantized(const EncodeParams* pEP, size_t uIndexMode, const LDREndPntPair& endPts, LDRColorA aPalette[]) const
 {
@@ -745,11 +1210,10 @@ void Block_BC7::Exhaustive(const EncodeParams* pEP, const LDRColorA aColors[], s
     assert(pEP);
     const uint8_t uPrec = ms_aInfo[pEP->uMode].RGBAPrecWithP[ch];
     LDREndPntPair tmpEndPt;
-    if (fOrgErr == 0)
+    const int delta = pEP->pEffort->iDelta;
+    if (fOrgErr == 0 || delta == 0)
         return;
 
-    int delta = 5;
-
     // ok figure out the range of A and B
     tmpEndPt = optEndPt;
     int alow = std::max<int>(0, int(optEndPt.A[ch]) - delta);
@@ -981,76 +1445,63 @@ void Block_BC7::EmitBlock(const EncodeParams* pEP, size_t uShape, size_t uRotati
     const size_t uIndexPrec2 = ms_aInfo[pEP->uMode].uIndexPrec2;
     const LDRColorA RGBAPrec = ms_aInfo[pEP->uMode].RGBAPrec;
     const LDRColorA RGBAPrecWithP = ms_aInfo[pEP->uMode].RGBAPrecWithP;
+    const size_t uNumEP = size_t(1 + uPartitions) << 1;
     size_t i;
+
+    BlockBits bits;
     size_t uStartBit = 0;
-    SetBits(uStartBit, pEP->uMode, 0);
-    SetBits(uStartBit, 1, 1);
-    SetBits(uStartBit, ms_aInfo[pEP->uMode].uRotationBits, static_cast<uint8_t>(uRotation));
-    SetBits(uStartBit, ms_aInfo[pEP->uMode].uIndexModeBits, static_cast<uint8_t>(uIndexMode));
-    SetBits(uStartBit, ms_aInfo[pEP->uMode].uPartitionBits, static_cast<uint8_t>(uShape));
-
-    if (uPBits)
-    {
-        const size_t uNumEP = size_t(1 + uPartitions) << 1;
-        uint8_t aPVote[BC7_MAX_REGIONS << 1] = { 0,0,0,0,0,0 };
-        uint8_t aCount[BC7_MAX_REGIONS << 1] = { 0,0,0,0,0,0 };
-        for (uint8_t ch = 0; ch < BC7_NUM_CHANNELS; ch++)
+    bits.Write(uStartBit, pEP->uMode + 1, uint64_t(1) << pEP->uMode);
+    bits.Write(uStartBit, ms_aInfo[pEP->uMode].uRotationBits, uRotation);
+    bits.Write(uStartBit, ms_aInfo[pEP->uMode].uIndexModeBits, uIndexMode);
+    bits.Write(uStartBit, ms_aInfo[pEP->uMode].uPartitionBits, uShape);
+
+    // The endpoints of a channel go out as one field, the P-bits follow as the
+    // majority vote of the endpoint low bits they replace
+    uint8_t aPVote[BC7_MAX_REGIONS << 1] = { 0,0,0,0,0,0 };
+    uint8_t aCount[BC7_MAX_REGIONS << 1] = { 0,0,0,0,0,0 };
+    for (uint8_t ch = 0; ch < BC7_NUM_CHANNELS; ch++)
+    {
+        const size_t uPrec = RGBAPrec[ch];
+        if (!uPrec)
+            continue;
+
+        const bool bPBit = uPBits && RGBAPrec[ch] != RGBAPrecWithP[ch];
+        uint64_t uChannel = 0;
+        uint8_t ep = 0;
+        for (i = 0; i <= uPartitions; i++)
         {
-            uint8_t ep = 0;
-            for (i = 0; i <= uPartitions; i++)
+            uChannel |= uint64_t(aEndPts[i].A[ch] >> (bPBit ? 1 : 0)) << (2 * i * uPrec);
+            uChannel |= uint64_t(aEndPts[i].B[ch] >> (bPBit ? 1 : 0)) << ((2 * i + 1) * uPrec);
+            if (bPBit)
             {
-                if (RGBAPrec[ch] == RGBAPrecWithP[ch])
-                {
-                    SetBits(uStartBit, RGBAPrec[ch], aEndPts[i].A[ch]);
-                    SetBits(uStartBit, RGBAPrec[ch], aEndPts[i].B[ch]);
-                }
-                else
-                {
-                    SetBits(uStartBit, RGBAPrec[ch], aEndPts[i].A[ch] >> 1);
-                    SetBits(uStartBit, RGBAPrec[ch], aEndPts[i].B[ch] >> 1);
-                    size_t idx = ep++ * uPBits / uNumEP;
-                    assert(idx < (BC7_MAX_REGIONS << 1));
-                                        aPVote[idx] += aEndPts[i].A[ch] & 0x01;
-                    aCount[idx]++;
-                    idx = ep++ * uPBits / uNumEP;
-                    assert(idx < (BC7_MAX_REGIONS << 1));
-                                        aPVote[idx] += aEndPts[i].B[ch] & 0x01;
-                    aCount[idx]++;
-                }
+                size_t idx = ep++ * uPBits / uNumEP;
+                assert(idx < (BC7_MAX_REGIONS << 1));
+                aPVote[idx] += aEndPts[i].A[ch] & 0x01;
+                aCount[idx]++;
+                idx = ep++ * uPBits / uNumEP;
+                assert(idx < (BC7_MAX_REGIONS << 1));
+                aPVote[idx] += aEndPts[i].B[ch] & 0x01;
+                aCount[idx]++;
             }
         }
-
-        for (i = 0; i < uPBits; i++)
-        {
-            SetBits(uStartBit, 1, aPVote[i] > (aCount[i] >> 1) ? 1 : 0);
-        }
+        bits.Write(uStartBit, uNumEP * uPrec, uChannel);
     }
-    else
+
+    uint64_t uPBitField = 0;
+    for (i = 0; i < uPBits; i++)
     {
-        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ch++)
-        {
-            for (i = 0; i <= uPartitions; i++)
-            {
-                SetBits(uStartBit, RGBAPrec[ch], aEndPts[i].A[ch]);
-                SetBits(uStartBit, RGBAPrec[ch], aEndPts[i].B[ch]);
-            }
-        }
+        uPBitField |= uint64_t(aPVote[i] > (aCount[i] >> 1) ? 1 : 0) << i;
     }
+    bits.Write(uStartBit, uPBits, uPBitField);
 
     const size_t* aI1 = uIndexMode ? aIndex2 : aIndex;
     const size_t* aI2 = uIndexMode ? aIndex : aIndex2;
-    for (i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
-    {
-        if (IsFixUpOffset(ms_aInfo[pEP->uMode].uPartitions, uShape, i))
-            SetBits(uStartBit, uIndexPrec - 1, static_cast<uint8_t>(aI1[i]));
-        else
-            SetBits(uStartBit, uIndexPrec, static_cast<uint8_t>(aI1[i]));
-    }
+    bits.WriteIndices(uStartBit, aI1, uIndexPrec, g_Anchors.aAnchors[uPartitions][uShape], uPartitions + 1);
     if (uIndexPrec2)
-        for (i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
-            SetBits(uStartBit, i ? uIndexPrec2 : uIndexPrec2 - 1, static_cast<uint8_t>(aI2[i]));
+        bits.WriteIndices(uStartBit, aI2, uIndexPrec2, g_Anchors.aAnchors[0][0], 1);
 
     assert(uStartBit == 128);
+    StoreBits(bits);
 }
 
 float Block_BC7::Refine(const EncodeParams* pEP, size_t uShape, size_t uRotation, size_t uIndexMode)
@@ -1087,6 +1538,30 @@ float Block_BC7::Refine(const EncodeParams* pEP, size_t uShape, size_t uRotation
         fOrgTotErr += aOrgErr[p];
         fOptTotErr += aOptErr[p];
     }
+
+    // Higher effort levels restart the optimization from the new indices while it keeps improving
+    for(size_t uPass = 1; uPass < pEP->pEffort->uRefinePasses && fOptTotErr < fOrgTotErr && fOptTotErr > 0; uPass++)
+    {
+        LDREndPntPair aNewEndPts[BC7_MAX_REGIONS];
+        size_t aNewIdx[NUM_PIXELS_PER_BLOCK];
+        size_t aNewIdx2[NUM_PIXELS_PER_BLOCK];
+        float aNewErr[BC7_MAX_REGIONS];
+
+        OptimizeEndPoints(pEP, uShape, uIndexMode, aOptErr, aOptEndPts, aNewEndPts);
+        AssignIndices(pEP, uShape, uIndexMode, aNewEndPts, aNewIdx, aNewIdx2, aNewErr);
+
+        float fNewTotErr = 0;
+        for(size_t p = 0; p <= uPartitions; p++)
+            fNewTotErr += aNewErr[p];
+        if(fNewTotErr >= fOptTotErr)
+            break;
+
+        memcpy(aOptEndPts, aNewEndPts, sizeof(aOptEndPts));
+        memcpy(aOptIdx, aNewIdx, sizeof(aOptIdx));
+        memcpy(aOptIdx2, aNewIdx2, sizeof(aOptIdx2));
+        memcpy(aOptErr, aNewErr, sizeof(aOptErr));
+        fOptTotErr = fNewTotErr;
+    }
     if(fOptTotErr < fOrgTotErr)
     {
         EmitBlock(pEP, uShape, uRotation, uIndexMode, aOptEndPts, aOptIdx, aOptIdx2);
@@ -1105,20 +1580,9 @@ float Block_BC7::MapColors(const EncodeParams* pEP, const LDRColorA aColors[], s
     const uint8_t uIndexPrec = uIndexMode ? ms_aInfo[pEP->uMode].uIndexPrec2 : ms_aInfo[pEP->uMode].uIndexPrec;
     const uint8_t uIndexPrec2 = uIndexMode ? ms_aInfo[pEP->uMode].uIndexPrec : ms_aInfo[pEP->uMode].uIndexPrec2;
     LDRColorA aPalette[BC7_MAX_INDICES];
-    float fTotalErr = 0;
 
     GeneratePaletteQuantized(pEP, uIndexMode, endPts, aPalette);
-    for (size_t i = 0; i < np; ++i)
-    {
-        fTotalErr += ComputeError(aColors[i], aPalette, uIndexPrec, uIndexPrec2);
-        if (fTotalErr > fMinErr)   // check for early exit
-        {
-            fTotalErr = FLT_MAX;
-            break;
-        }
-    }
-
-    return fTotalErr;
+    return GetErrorKernels().pfnMapColors(aColors, np, aPalette, uIndexPrec, uIndexPrec2, fMinErr);
 }
 
 float Block_BC7::RoughMSE(EncodeParams* pEP, size_t uShape, size_t uIndexMode)
@@ -1228,6 +1692,19 @@ void DecodeBC7(HDRColorA *pColor, const uint8_t *pBC)
     reinterpret_cast<const Block_BC7*>(pBC)->Decode(pColor);
 }
 
+void DecodeBC7(LDRColorA *pColor, const uint8_t *pBC)
+{
+    assert(pColor && pBC);
+    DecodeRows(reinterpret_cast<uint8_t*>(pColor), 4 * sizeof(LDRColorA), pBC);
+}
+
+void DecodeBC7Row(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDst && pBC);
+    for (size_t i = 0; i < nBlocks; ++i)
+        DecodeRows(pDst + i * 4 * sizeof(LDRColorA), rowPitch, pBC + i * sizeof(Block_BC7));
+}
+
 void EncodeBC7(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
 {
     assert(pBC && pColor);
@@ -1235,4 +1712,23 @@ void EncodeBC7(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags)
     reinterpret_cast<Block_BC7*>(pBC)->Encode(flags, pColor);
 }
 
+void EncodeBC7(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags)
+{
+    assert(pBC && pColor);
+    static_assert(sizeof(Block_BC7) == 16, "Block_BC7 should be 16 bytes");
+    reinterpret_cast<Block_BC7*>(pBC)->Encode(flags, pColor);
+}
+
+void EncodeBC7Seeded(uint8_t *pBC, const HDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags)
+{
+    assert(pBC && pColor && pSeedBC);
+    reinterpret_cast<Block_BC7*>(pBC)->Encode(flags, pColor, pSeedBC);
+}
+
+void EncodeBC7Seeded(uint8_t *pBC, const LDRColorA *pColor, const uint8_t *pSeedBC, uint32_t flags)
+{
+    assert(pBC && pColor && pSeedBC);
+    reinterpret_cast<Block_BC7*>(pBC)->Encode(flags, pColor, pSeedBC);
+}
+
 }
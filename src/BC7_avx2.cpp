@@ -0,0 +1,212 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <float.h>
+#include <limits.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "BC7_simd.hpp"
+#include "Colors.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+inline uint32_t CountTrailingZeros(uint32_t v)
+{
+    assert(v != 0);
+#if defined(_MSC_VER)
+    unsigned long uIndex;
+    _BitScanForward(&uIndex, v);
+    return uIndex;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+// Squared errors against 8 palette entries, see BC7_sse41.cpp
+inline __m256i ErrorRGBA(__m256i pixel, __m256i palette)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i d = _mm256_sub_epi8(pixel, palette);
+    __m256i lo = _mm256_unpacklo_epi8(d, zero);
+    __m256i hi = _mm256_unpackhi_epi8(d, zero);
+    lo = _mm256_madd_epi16(lo, lo);
+    hi = _mm256_madd_epi16(hi, hi);
+    return _mm256_hadd_epi32(lo, hi);
+}
+
+inline __m256i ErrorAlpha(__m256i pixelA, __m256i palette)
+{
+    __m256i d = _mm256_sub_epi32(pixelA, _mm256_srli_epi32(palette, 24));
+    return _mm256_mullo_epi32(d, d);
+}
+
+inline __m128i ErrorRGBA(__m128i pixel, __m128i palette)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i d = _mm_sub_epi8(pixel, palette);
+    __m128i lo = _mm_unpacklo_epi8(d, zero);
+    __m128i hi = _mm_unpackhi_epi8(d, zero);
+    lo = _mm_madd_epi16(lo, lo);
+    hi = _mm_madd_epi16(hi, hi);
+    return _mm_hadd_epi32(lo, hi);
+}
+
+inline __m128i ErrorAlpha(__m128i pixelA, __m128i palette)
+{
+    __m128i d = _mm_sub_epi32(pixelA, _mm_srli_epi32(palette, 24));
+    return _mm_mullo_epi32(d, d);
+}
+
+// Early out search rule over a 4 entry palette
+inline int SelectBest4(__m128i err, size_t* pBestIndex)
+{
+    __m128i shifted = _mm_alignr_epi8(err, _mm_set1_epi32(INT_MAX), 12);
+    uint32_t uIncrease = uint32_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(err, shifted)))) | 0x10;
+
+    alignas(16) int aErrors[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(aErrors), err);
+    const int best = aErrors[CountTrailingZeros(uIncrease) - 1];
+
+    if (pBestIndex)
+    {
+        __m128i eq = _mm_cmpeq_epi32(err, _mm_set1_epi32(best));
+        *pBestIndex = CountTrailingZeros(uint32_t(_mm_movemask_ps(_mm_castsi128_ps(eq))));
+    }
+
+    return best;
+}
+
+// Early out search rule over nRegs * 8 palette entries
+inline int SelectBest(const __m256i aErr[], size_t nRegs, size_t* pBestIndex)
+{
+    const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+    __m256i prevLast = _mm256_set1_epi32(INT_MAX);
+    uint32_t uIncrease = 1u << (nRegs * 8);
+    for (size_t r = 0; r < nRegs; ++r)
+    {
+        // Entry i - 1 in lane i, lane 0 takes the last entry of the previous register
+        __m256i shifted = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(aErr[r], rotate), prevLast, 0x01);
+        __m256i inc = _mm256_cmpgt_epi32(aErr[r], shifted);
+        uIncrease |= uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(inc))) << (r * 8);
+        prevLast = _mm256_permutevar8x32_epi32(aErr[r], _mm256_set1_epi32(7));
+    }
+
+    alignas(32) int aErrors[16];
+    for (size_t r = 0; r < nRegs; ++r)
+        _mm256_store_si256(reinterpret_cast<__m256i*>(aErrors) + r, aErr[r]);
+
+    const int best = aErrors[CountTrailingZeros(uIncrease) - 1];
+
+    if (pBestIndex)
+    {
+        const __m256i vBest = _mm256_set1_epi32(best);
+        uint32_t uEqual = 0;
+        for (size_t r = 0; r < nRegs; ++r)
+        {
+            __m256i eq = _mm256_cmpeq_epi32(aErr[r], vBest);
+            uEqual |= uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq))) << (r * 8);
+        }
+        *pBestIndex = CountTrailingZeros(uEqual);
+    }
+
+    return best;
+}
+
+// Palette held in registers; 4 entry palettes only use the low half of aPal[0]
+struct Palette
+{
+    __m256i aPal[2];
+    size_t uNumIndices;
+    size_t uNumIndices2;
+
+    Palette(const LDRColorA aPalette[], uint8_t uIndexPrec, uint8_t uIndexPrec2)
+    {
+        assert(uIndexPrec >= 2 && uIndexPrec <= 4);
+        uNumIndices = size_t(1) << uIndexPrec;
+        uNumIndices2 = uIndexPrec2 ? size_t(1) << uIndexPrec2 : 0;
+        const size_t uLoad = (uNumIndices > uNumIndices2) ? uNumIndices : uNumIndices2;
+
+        if (uLoad <= 4)
+        {
+            aPal[0] = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aPalette)));
+        }
+        else
+        {
+            for (size_t r = 0; r < uLoad / 8; ++r)
+                aPal[r] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aPalette) + r);
+        }
+    }
+};
+
+inline int SearchRGBA(__m256i vPixel, const Palette& pal, size_t uNumIndices, size_t* pBestIndex)
+{
+    if (uNumIndices == 4)
+        return SelectBest4(ErrorRGBA(_mm256_castsi256_si128(vPixel), _mm256_castsi256_si128(pal.aPal[0])), pBestIndex);
+
+    __m256i aErr[2];
+    const size_t nRegs = uNumIndices / 8;
+    for (size_t r = 0; r < nRegs; ++r)
+        aErr[r] = ErrorRGBA(vPixel, pal.aPal[r]);
+    return SelectBest(aErr, nRegs, pBestIndex);
+}
+
+inline int SearchAlpha(__m256i vAlpha, const Palette& pal, size_t uNumIndices, size_t* pBestIndex)
+{
+    if (uNumIndices == 4)
+        return SelectBest4(ErrorAlpha(_mm256_castsi256_si128(vAlpha), _mm256_castsi256_si128(pal.aPal[0])), pBestIndex);
+
+    __m256i aErr[2];
+    const size_t nRegs = uNumIndices / 8;
+    for (size_t r = 0; r < nRegs; ++r)
+        aErr[r] = ErrorAlpha(vAlpha, pal.aPal[r]);
+    return SelectBest(aErr, nRegs, pBestIndex);
+}
+
+inline int PixelError(const LDRColorA& pixel, const Palette& pal, size_t* pBestIndex, size_t* pBestIndex2)
+{
+    int32_t iPixel;
+    memcpy(&iPixel, &pixel, sizeof(iPixel));
+
+    int err = SearchRGBA(_mm256_set1_epi32(iPixel), pal, pal.uNumIndices, pBestIndex);
+    if (pal.uNumIndices2)
+        err += SearchAlpha(_mm256_set1_epi32(pixel.a), pal, pal.uNumIndices2, pBestIndex2);
+    return err;
+}
+
+}
+
+float ComputeErrorAVX2(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex, size_t* pBestIndex2)
+{
+    Palette pal(aPalette, uIndexPrec, uIndexPrec2);
+
+    if (pBestIndex2)
+        *pBestIndex2 = 0;
+
+    return float(PixelError(pixel, pal, pBestIndex, pBestIndex2));
+}
+
+float MapColorsAVX2(const LDRColorA aColors[], size_t np, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, float fMinErr)
+{
+    Palette pal(aPalette, uIndexPrec, uIndexPrec2);
+
+    // The sum only grows, so testing every few pixels exits at the same result
+    int iTotalErr = 0;
+    for (size_t i = 0; i < np; ++i)
+    {
+        iTotalErr += PixelError(aColors[i], pal, nullptr, nullptr);
+        if ((i & 3) == 3 && float(iTotalErr) > fMinErr)
+            return FLT_MAX;
+    }
+
+    return (float(iTotalErr) > fMinErr) ? FLT_MAX : float(iTotalErr);
+}
+
+} // namespace
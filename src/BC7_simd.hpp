@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Colors.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// BC7 error kernels
+//
+// All variants return exactly what the scalar reference in BC7.cpp returns. The
+// palette search stops at the first entry whose error is larger than the one
+// before it, so the best entry is the last one of the leading non-increasing run
+// and the reported index is the first entry with that error. Errors are small
+// integers, which keeps the float sums exact in every implementation.
+//-------------------------------------------------------------------------------------
+
+// Error of one pixel against the best palette entry, optionally reporting the
+// color and alpha indices
+typedef float (*BC7_COMPUTE_ERROR)(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex, size_t* pBestIndex2);
+
+// Sum of BC7_COMPUTE_ERROR over np pixels sharing one palette, FLT_MAX as soon as
+// the sum exceeds fMinErr
+typedef float (*BC7_MAP_COLORS)(const LDRColorA aColors[], size_t np, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, float fMinErr);
+
+// Interpolates nEntries (4, 8 or 16) palette colors between c0 and c1 with the
+// matching BC7 weights, as RGBA8 words with red in the low byte
+typedef void (*BC7_BUILD_PALETTE)(uint32_t *pPalette, const LDRColorA& c0, const LDRColorA& c1,
+    const int *pWeights, size_t nEntries);
+
+#if defined(CROSSTEX_X86_SIMD)
+float ComputeErrorSSE41(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex, size_t* pBestIndex2);
+float MapColorsSSE41(const LDRColorA aColors[], size_t np, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, float fMinErr);
+void BuildPaletteSSE41(uint32_t *pPalette, const LDRColorA& c0, const LDRColorA& c1,
+    const int *pWeights, size_t nEntries);
+
+float ComputeErrorAVX2(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex, size_t* pBestIndex2);
+float MapColorsAVX2(const LDRColorA aColors[], size_t np, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, float fMinErr);
+#endif
+
+} // namespace
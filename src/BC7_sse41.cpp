@@ -0,0 +1,178 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <float.h>
+#include <limits.h>
+#include <smmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "BC7_simd.hpp"
+#include "Colors.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+inline uint32_t CountTrailingZeros(uint32_t v)
+{
+    assert(v != 0);
+#if defined(_MSC_VER)
+    unsigned long uIndex;
+    _BitScanForward(&uIndex, v);
+    return uIndex;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+// Squared errors against 4 palette entries. The color difference wraps per byte
+// like LDRColorA::operator-, alpha uses the true difference.
+inline __m128i ErrorRGBA(__m128i pixel, __m128i palette)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i d = _mm_sub_epi8(pixel, palette);
+    __m128i lo = _mm_unpacklo_epi8(d, zero);
+    __m128i hi = _mm_unpackhi_epi8(d, zero);
+    lo = _mm_madd_epi16(lo, lo);
+    hi = _mm_madd_epi16(hi, hi);
+    return _mm_hadd_epi32(lo, hi);
+}
+
+inline __m128i ErrorAlpha(__m128i pixelA, __m128i palette)
+{
+    __m128i d = _mm_sub_epi32(pixelA, _mm_srli_epi32(palette, 24));
+    return _mm_mullo_epi32(d, d);
+}
+
+// Applies the early out search rule to the errors of nRegs * 4 palette entries
+inline int SelectBest(const __m128i aErr[], size_t nRegs, size_t* pBestIndex)
+{
+    // Bit i is set when entry i is worse than entry i - 1
+    __m128i prev = _mm_set1_epi32(INT_MAX);
+    uint32_t uIncrease = 1u << (nRegs * 4);
+    for (size_t r = 0; r < nRegs; ++r)
+    {
+        __m128i shifted = _mm_alignr_epi8(aErr[r], prev, 12);
+        __m128i inc = _mm_cmpgt_epi32(aErr[r], shifted);
+        uIncrease |= uint32_t(_mm_movemask_ps(_mm_castsi128_ps(inc))) << (r * 4);
+        prev = aErr[r];
+    }
+
+    alignas(16) int aErrors[16];
+    for (size_t r = 0; r < nRegs; ++r)
+        _mm_store_si128(reinterpret_cast<__m128i*>(aErrors) + r, aErr[r]);
+
+    const int best = aErrors[CountTrailingZeros(uIncrease) - 1];
+
+    if (pBestIndex)
+    {
+        const __m128i vBest = _mm_set1_epi32(best);
+        uint32_t uEqual = 0;
+        for (size_t r = 0; r < nRegs; ++r)
+        {
+            __m128i eq = _mm_cmpeq_epi32(aErr[r], vBest);
+            uEqual |= uint32_t(_mm_movemask_ps(_mm_castsi128_ps(eq))) << (r * 4);
+        }
+        *pBestIndex = CountTrailingZeros(uEqual);
+    }
+
+    return best;
+}
+
+inline int PixelError(const LDRColorA& pixel, const __m128i aPalette[], size_t nRegs, size_t nRegs2,
+    size_t* pBestIndex, size_t* pBestIndex2)
+{
+    __m128i aErr[4];
+    int32_t iPixel;
+    memcpy(&iPixel, &pixel, sizeof(iPixel));
+    const __m128i vPixel = _mm_set1_epi32(iPixel);
+
+    for (size_t r = 0; r < nRegs; ++r)
+        aErr[r] = ErrorRGBA(vPixel, aPalette[r]);
+    int err = SelectBest(aErr, nRegs, pBestIndex);
+
+    if (nRegs2)
+    {
+        const __m128i vAlpha = _mm_set1_epi32(pixel.a);
+        for (size_t r = 0; r < nRegs2; ++r)
+            aErr[r] = ErrorAlpha(vAlpha, aPalette[r]);
+        err += SelectBest(aErr, nRegs2, pBestIndex2);
+    }
+
+    return err;
+}
+
+}
+
+float ComputeErrorSSE41(const LDRColorA& pixel, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, size_t* pBestIndex, size_t* pBestIndex2)
+{
+    assert(uIndexPrec >= 2 && uIndexPrec <= 4);
+    const size_t nRegs = (size_t(1) << uIndexPrec) / 4;
+    const size_t nRegs2 = uIndexPrec2 ? (size_t(1) << uIndexPrec2) / 4 : 0;
+    const size_t nLoad = (nRegs > nRegs2) ? nRegs : nRegs2;
+
+    __m128i aPal[4];
+    for (size_t r = 0; r < nLoad; ++r)
+        aPal[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPalette) + r);
+
+    if (pBestIndex2)
+        *pBestIndex2 = 0;
+
+    return float(PixelError(pixel, aPal, nRegs, nRegs2, pBestIndex, pBestIndex2));
+}
+
+float MapColorsSSE41(const LDRColorA aColors[], size_t np, const LDRColorA aPalette[],
+    uint8_t uIndexPrec, uint8_t uIndexPrec2, float fMinErr)
+{
+    assert(uIndexPrec >= 2 && uIndexPrec <= 4);
+    const size_t nRegs = (size_t(1) << uIndexPrec) / 4;
+    const size_t nRegs2 = uIndexPrec2 ? (size_t(1) << uIndexPrec2) / 4 : 0;
+    const size_t nLoad = (nRegs > nRegs2) ? nRegs : nRegs2;
+
+    __m128i aPal[4];
+    for (size_t r = 0; r < nLoad; ++r)
+        aPal[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPalette) + r);
+
+    // The sum only grows, so testing every few pixels exits at the same result
+    int iTotalErr = 0;
+    for (size_t i = 0; i < np; ++i)
+    {
+        iTotalErr += PixelError(aColors[i], aPal, nRegs, nRegs2, nullptr, nullptr);
+        if ((i & 3) == 3 && float(iTotalErr) > fMinErr)
+            return FLT_MAX;
+    }
+
+    return (float(iTotalErr) > fMinErr) ? FLT_MAX : float(iTotalErr);
+}
+
+// Two palette entries per register as 16-bit channels, (c0 * (64 - w) + c1 * w + 32) >> 6
+void BuildPaletteSSE41(uint32_t *pPalette, const LDRColorA& c0, const LDRColorA& c1,
+    const int *pWeights, size_t nEntries)
+{
+    uint32_t u0, u1;
+    memcpy(&u0, &c0, sizeof(u0));
+    memcpy(&u1, &c1, sizeof(u1));
+    const __m128i e0 = _mm_cvtepu8_epi16(_mm_set1_epi32(int(u0)));
+    const __m128i e1 = _mm_cvtepu8_epi16(_mm_set1_epi32(int(u1)));
+    const __m128i wMax = _mm_set1_epi16(64);
+    const __m128i round = _mm_set1_epi16(32);
+
+    for (size_t i = 0; i < nEntries; i += 4)
+    {
+        __m128i aEntries[2];
+        for (size_t j = 0; j < 2; ++j)
+        {
+            const __m128i w = _mm_unpacklo_epi64(_mm_set1_epi16(short(pWeights[i + 2 * j])),
+                _mm_set1_epi16(short(pWeights[i + 2 * j + 1])));
+            const __m128i v = _mm_add_epi16(_mm_mullo_epi16(e0, _mm_sub_epi16(wMax, w)), _mm_mullo_epi16(e1, w));
+            aEntries[j] = _mm_srli_epi16(_mm_add_epi16(v, round), 6);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pPalette + i), _mm_packus_epi16(aEntries[0], aEntries[1]));
+    }
+}
+
+} // namespace
@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "CPUFeatures.hpp"
+
+#if defined(CROSSTEX_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace Tex {
+
+namespace {
+
+CPUFeatures DetectCPUFeatures()
+{
+    CPUFeatures features = {};
+
+#if defined(CROSSTEX_X86_SIMD)
+#if defined(_MSC_VER)
+    int aInfo[4];
+    __cpuid(aInfo, 0);
+    const int nIds = aInfo[0];
+
+    if (nIds >= 1)
+    {
+        __cpuid(aInfo, 1);
+        features.bSSE41 = (aInfo[2] & (1 << 19)) != 0;
+
+        // AVX2 also needs the OS to save the YMM registers
+        const bool bOSXSave = (aInfo[2] & (1 << 27)) != 0;
+        const bool bAVX = (aInfo[2] & (1 << 28)) != 0;
+        if (nIds >= 7 && bOSXSave && bAVX && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(aInfo, 7, 0);
+            features.bAVX2 = (aInfo[1] & (1 << 5)) != 0;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    features.bSSE41 = __builtin_cpu_supports("sse4.1") != 0;
+    features.bAVX2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+#endif
+
+    return features;
+}
+
+}
+
+const CPUFeatures& GetCPUFeatures()
+{
+    static const CPUFeatures features = DetectCPUFeatures();
+    return features;
+}
+
+} // namespace
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Tex {
+
+// Instruction set extensions usable by the SIMD kernels. Detected once on first
+// use; a flag is only set when both the CPU and the build support it.
+struct CPUFeatures
+{
+    bool bSSE41;
+    bool bAVX2;
+};
+
+const CPUFeatures& GetCPUFeatures();
+
+} // namespace
@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+
+#include "Container.hpp"
+
+
+namespace Tex {
+
+bool ResolveTextureDesc(const TextureDesc& desc, TextureDesc& resolved)
+{
+    if (GetBlockSize(desc.format) == 0 || desc.width == 0 || desc.height == 0 || desc.arraySize == 0
+        || desc.width > UINT32_MAX || desc.height > UINT32_MAX)
+        return false;
+    if (desc.srgb && desc.format != BC_FORMAT_BC1 && desc.format != BC_FORMAT_BC2
+        && desc.format != BC_FORMAT_BC3 && desc.format != BC_FORMAT_BC7)
+        return false;
+    if (desc.cubeMap && (desc.arraySize % 6 != 0 || desc.width != desc.height))
+        return false;
+
+    const size_t fullLevels = ComputeMipLevels(desc.width, desc.height);
+    if (desc.mipLevels > fullLevels)
+        return false;
+
+    resolved = desc;
+    if (resolved.mipLevels == 0)
+        resolved.mipLevels = fullLevels;
+    return true;
+}
+
+size_t ComputeLevelSize(const TextureDesc& desc, size_t level)
+{
+    return ComputeSurfaceSize(desc.format, std::max<size_t>(1, desc.width >> level),
+        std::max<size_t>(1, desc.height >> level));
+}
+
+size_t ComputeItemSize(const TextureDesc& desc)
+{
+    // The chain adds less than half of the top level again
+    const size_t blocksWide = (desc.width + 3) / 4;
+    const size_t blocksHigh = (desc.height + 3) / 4;
+    if (blocksWide > SIZE_MAX / 2 / GetBlockSize(desc.format) / blocksHigh)
+        return 0;
+
+    size_t size = 0;
+    for (size_t level = 0; level < desc.mipLevels; ++level)
+        size += ComputeLevelSize(desc, level);
+    return size;
+}
+
+} // namespace
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Surface.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Helpers shared by the DDS and KTX2 containers
+//-------------------------------------------------------------------------------------
+
+// Checks that desc describes a storable texture and resolves mipLevels = 0 to the
+// full chain
+bool ResolveTextureDesc(const TextureDesc& desc, TextureDesc& resolved);
+
+// Bytes of one surface of the given level
+size_t ComputeLevelSize(const TextureDesc& desc, size_t level);
+
+// Bytes of one array item with its mip chain, 0 when it does not fit a size_t
+size_t ComputeItemSize(const TextureDesc& desc);
+
+inline uint32_t LoadU32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint64_t LoadU64(const uint8_t *p)
+{
+    return uint64_t(LoadU32(p)) | (uint64_t(LoadU32(p + 4)) << 32);
+}
+
+inline void StoreU32(uint8_t *p, uint32_t v)
+{
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+inline void StoreU64(uint8_t *p, uint64_t v)
+{
+    StoreU32(p, uint32_t(v));
+    StoreU32(p + 4, uint32_t(v >> 32));
+}
+
+} // namespace
@@ -0,0 +1,373 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+
+#include "Container.hpp"
+#include "DDS.hpp"
+#include "MappedFile.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+//-------------------------------------------------------------------------------------
+// File format constants, see DDS.h of DirectXTex
+//-------------------------------------------------------------------------------------
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+const size_t DDS_HEADER_SIZE = 4 + 124;
+const size_t DDS_HEADER_DX10_SIZE = 20;
+
+const uint32_t DDSD_CAPS = 0x1;
+const uint32_t DDSD_HEIGHT = 0x2;
+const uint32_t DDSD_WIDTH = 0x4;
+const uint32_t DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDSD_DEPTH = 0x800000;
+
+const uint32_t DDPF_FOURCC = 0x4;
+
+const uint32_t DDSCAPS_COMPLEX = 0x8;
+const uint32_t DDSCAPS_TEXTURE = 0x1000;
+const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+const uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xfc00;
+const uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+// Byte offsets into the file
+const size_t DDS_OFFSET_FLAGS = 8;
+const size_t DDS_OFFSET_HEIGHT = 12;
+const size_t DDS_OFFSET_WIDTH = 16;
+const size_t DDS_OFFSET_LINEARSIZE = 20;
+const size_t DDS_OFFSET_DEPTH = 24;
+const size_t DDS_OFFSET_MIPMAPCOUNT = 28;
+const size_t DDS_OFFSET_PIXELFORMAT = 76;
+const size_t DDS_OFFSET_CAPS = 108;
+const size_t DDS_OFFSET_CAPS2 = 112;
+
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+struct FormatInfo
+{
+    BC_FORMAT format;
+    uint32_t uFourCC;       // Legacy header, 0 when only DX10 headers can hold it
+    uint32_t uDXGI;
+    uint32_t uDXGISRGB;     // 0 without an sRGB variant
+    uint32_t uDXGITypeless;
+};
+
+const FormatInfo g_aFormats[] =
+{
+    { BC_FORMAT_BC1,   MakeFourCC('D', 'X', 'T', '1'), 71, 72, 70 },
+    { BC_FORMAT_BC2,   MakeFourCC('D', 'X', 'T', '3'), 74, 75, 73 },
+    { BC_FORMAT_BC3,   MakeFourCC('D', 'X', 'T', '5'), 77, 78, 76 },
+    { BC_FORMAT_BC4U,  MakeFourCC('A', 'T', 'I', '1'), 80, 0,  79 },
+    { BC_FORMAT_BC4S,  MakeFourCC('B', 'C', '4', 'S'), 81, 0,  0 },
+    { BC_FORMAT_BC5U,  MakeFourCC('A', 'T', 'I', '2'), 83, 0,  82 },
+    { BC_FORMAT_BC5S,  MakeFourCC('B', 'C', '5', 'S'), 84, 0,  0 },
+    { BC_FORMAT_BC6HU, 0,                              95, 0,  94 },
+    { BC_FORMAT_BC6HS, 0,                              96, 0,  0 },
+    { BC_FORMAT_BC7,   0,                              98, 99, 97 },
+};
+
+// Other legacy codes written by older tools
+struct FourCCAlias
+{
+    uint32_t uFourCC;
+    BC_FORMAT format;
+};
+
+const FourCCAlias g_aFourCCAliases[] =
+{
+    { MakeFourCC('D', 'X', 'T', '2'), BC_FORMAT_BC2 },
+    { MakeFourCC('D', 'X', 'T', '4'), BC_FORMAT_BC3 },
+    { MakeFourCC('B', 'C', '4', 'U'), BC_FORMAT_BC4U },
+    { MakeFourCC('B', 'C', '5', 'U'), BC_FORMAT_BC5U },
+};
+
+const uint32_t FOURCC_DX10 = MakeFourCC('D', 'X', '1', '0');
+
+const FormatInfo* FindFormat(BC_FORMAT format)
+{
+    for (const FormatInfo& info : g_aFormats)
+    {
+        if (info.format == format)
+            return &info;
+    }
+    return nullptr;
+}
+
+bool NeedsDX10(const TextureDesc& desc)
+{
+    return !FindFormat(desc.format)->uFourCC || desc.srgb || desc.arraySize > (desc.cubeMap ? 6u : 1u);
+}
+
+size_t ComputeResolvedSize(const TextureDesc& desc)
+{
+    const size_t headerSize = NeedsDX10(desc) ? DDS_HEADER_SIZE + DDS_HEADER_DX10_SIZE : DDS_HEADER_SIZE;
+    const size_t itemSize = ComputeItemSize(desc);
+    if (itemSize == 0 || itemSize > (SIZE_MAX - headerSize) / desc.arraySize)
+        return 0;
+    return headerSize + itemSize * desc.arraySize;
+}
+
+size_t ComputeResolvedOffset(const TextureDesc& desc, size_t item, size_t level)
+{
+    assert(item < desc.arraySize && level < desc.mipLevels);
+
+    size_t offset = NeedsDX10(desc) ? DDS_HEADER_SIZE + DDS_HEADER_DX10_SIZE : DDS_HEADER_SIZE;
+    offset += ComputeItemSize(desc) * item;
+    for (size_t l = 0; l < level; ++l)
+        offset += ComputeLevelSize(desc, l);
+    return offset;
+}
+
+}
+
+size_t GetDDSHeaderSize(const TextureDesc& desc)
+{
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(desc, resolved))
+        return 0;
+    return NeedsDX10(resolved) ? DDS_HEADER_SIZE + DDS_HEADER_DX10_SIZE : DDS_HEADER_SIZE;
+}
+
+size_t ComputeDDSSize(const TextureDesc& desc)
+{
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(desc, resolved))
+        return 0;
+    return ComputeResolvedSize(resolved);
+}
+
+size_t GetDDSSurfaceOffset(const TextureDesc& desc, size_t item, size_t level)
+{
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(desc, resolved))
+    {
+        assert(false);
+        return 0;
+    }
+    return ComputeResolvedOffset(resolved, item, level);
+}
+
+size_t WriteDDSHeader(uint8_t *pDst, const TextureDesc& desc)
+{
+    assert(pDst);
+
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(desc, resolved))
+        return 0;
+
+    const FormatInfo* pInfo = FindFormat(resolved.format);
+    const bool bDX10 = NeedsDX10(resolved);
+    const size_t headerSize = bDX10 ? DDS_HEADER_SIZE + DDS_HEADER_DX10_SIZE : DDS_HEADER_SIZE;
+    memset(pDst, 0, headerSize);
+
+    uint32_t flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+    uint32_t caps = DDSCAPS_TEXTURE;
+    uint32_t caps2 = 0;
+    if (resolved.mipLevels > 1)
+    {
+        flags |= DDSD_MIPMAPCOUNT;
+        caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+    if (resolved.cubeMap)
+    {
+        caps |= DDSCAPS_COMPLEX;
+        caps2 |= DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_ALLFACES;
+    }
+
+    StoreU32(pDst, DDS_MAGIC);
+    StoreU32(pDst + 4, 124);
+    StoreU32(pDst + DDS_OFFSET_FLAGS, flags);
+    StoreU32(pDst + DDS_OFFSET_HEIGHT, uint32_t(resolved.height));
+    StoreU32(pDst + DDS_OFFSET_WIDTH, uint32_t(resolved.width));
+    StoreU32(pDst + DDS_OFFSET_LINEARSIZE, uint32_t(std::min<size_t>(ComputeLevelSize(resolved, 0), UINT32_MAX)));
+    StoreU32(pDst + DDS_OFFSET_MIPMAPCOUNT, uint32_t(resolved.mipLevels));
+    StoreU32(pDst + DDS_OFFSET_PIXELFORMAT, 32);
+    StoreU32(pDst + DDS_OFFSET_PIXELFORMAT + 4, DDPF_FOURCC);
+    StoreU32(pDst + DDS_OFFSET_PIXELFORMAT + 8, bDX10 ? FOURCC_DX10 : pInfo->uFourCC);
+    StoreU32(pDst + DDS_OFFSET_CAPS, caps);
+    StoreU32(pDst + DDS_OFFSET_CAPS2, caps2);
+
+    if (bDX10)
+    {
+        // The DX10 array size counts whole cubes
+        uint8_t *pDX10 = pDst + DDS_HEADER_SIZE;
+        StoreU32(pDX10, resolved.srgb ? pInfo->uDXGISRGB : pInfo->uDXGI);
+        StoreU32(pDX10 + 4, DDS_DIMENSION_TEXTURE2D);
+        StoreU32(pDX10 + 8, resolved.cubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0);
+        StoreU32(pDX10 + 12, uint32_t(resolved.cubeMap ? resolved.arraySize / 6 : resolved.arraySize));
+    }
+
+    return headerSize;
+}
+
+bool ReadDDSHeader(const uint8_t *pSrc, size_t size, TextureDesc& desc, size_t *pHeaderSize)
+{
+    assert(pSrc);
+    if (size < DDS_HEADER_SIZE || LoadU32(pSrc) != DDS_MAGIC || LoadU32(pSrc + 4) != 124
+        || LoadU32(pSrc + DDS_OFFSET_PIXELFORMAT) != 32)
+        return false;
+
+    const uint32_t flags = LoadU32(pSrc + DDS_OFFSET_FLAGS);
+    const uint32_t caps2 = LoadU32(pSrc + DDS_OFFSET_CAPS2);
+    if ((caps2 & DDSCAPS2_VOLUME) || ((flags & DDSD_DEPTH) && LoadU32(pSrc + DDS_OFFSET_DEPTH) > 1))
+        return false;
+    if (!(LoadU32(pSrc + DDS_OFFSET_PIXELFORMAT + 4) & DDPF_FOURCC))
+        return false;
+
+    TextureDesc parsed = {};
+    parsed.width = LoadU32(pSrc + DDS_OFFSET_WIDTH);
+    parsed.height = LoadU32(pSrc + DDS_OFFSET_HEIGHT);
+    parsed.mipLevels = std::max<uint32_t>(1, LoadU32(pSrc + DDS_OFFSET_MIPMAPCOUNT));
+    parsed.arraySize = 1;
+
+    const uint32_t uFourCC = LoadU32(pSrc + DDS_OFFSET_PIXELFORMAT + 8);
+    size_t headerSize = DDS_HEADER_SIZE;
+    if (uFourCC == FOURCC_DX10)
+    {
+        headerSize += DDS_HEADER_DX10_SIZE;
+        if (size < headerSize)
+            return false;
+
+        const uint8_t *pDX10 = pSrc + DDS_HEADER_SIZE;
+        const uint32_t uDXGI = LoadU32(pDX10);
+        for (const FormatInfo& info : g_aFormats)
+        {
+            if (uDXGI == info.uDXGI || uDXGI == info.uDXGITypeless)
+                parsed.format = info.format;
+            else if (info.uDXGISRGB && uDXGI == info.uDXGISRGB)
+            {
+                parsed.format = info.format;
+                parsed.srgb = true;
+            }
+        }
+
+        if (LoadU32(pDX10 + 4) != DDS_DIMENSION_TEXTURE2D || LoadU32(pDX10 + 12) == 0)
+            return false;
+
+        parsed.cubeMap = (LoadU32(pDX10 + 8) & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+        parsed.arraySize = LoadU32(pDX10 + 12);
+        if (parsed.cubeMap)
+            parsed.arraySize *= 6;
+    }
+    else
+    {
+        for (const FormatInfo& info : g_aFormats)
+        {
+            if (info.uFourCC && uFourCC == info.uFourCC)
+                parsed.format = info.format;
+        }
+        for (const FourCCAlias& alias : g_aFourCCAliases)
+        {
+            if (uFourCC == alias.uFourCC)
+                parsed.format = alias.format;
+        }
+
+        // Legacy cube maps have to store all six faces
+        if (caps2 & DDSCAPS2_CUBEMAP)
+        {
+            if ((caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES)
+                return false;
+            parsed.cubeMap = true;
+            parsed.arraySize = 6;
+        }
+    }
+
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(parsed, resolved))
+        return false;
+
+    const size_t fileSize = ComputeResolvedSize(resolved);
+    if (fileSize == 0 || fileSize - headerSize > size - headerSize)
+        return false;
+
+    desc = resolved;
+    if (pHeaderSize)
+        *pHeaderSize = headerSize;
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Memory mapped DDS files
+//-------------------------------------------------------------------------------------
+
+DDSReader::DDSReader() : m_pFile(new MappedFile), m_desc() {}
+
+DDSReader::~DDSReader() {}
+
+bool DDSReader::Open(const char *path)
+{
+    if (!m_pFile->OpenRead(path))
+        return false;
+
+    if (!ReadDDSHeader(m_pFile->GetData(), m_pFile->GetSize(), m_desc))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void DDSReader::Close()
+{
+    m_pFile->Close();
+    m_desc = TextureDesc();
+}
+
+const uint8_t *DDSReader::GetSurface(size_t item, size_t level) const
+{
+    assert(m_pFile->IsOpen());
+    return m_pFile->GetData() + ComputeResolvedOffset(m_desc, item, level);
+}
+
+DDSWriter::DDSWriter() : m_pFile(new MappedFile), m_desc() {}
+
+DDSWriter::~DDSWriter()
+{
+    Close();
+}
+
+bool DDSWriter::Create(const char *path, const TextureDesc& desc)
+{
+    Close();
+
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(desc, resolved))
+        return false;
+
+    const size_t size = ComputeResolvedSize(resolved);
+    if (size == 0 || !m_pFile->Create(path, size))
+        return false;
+
+    WriteDDSHeader(m_pFile->GetData(), resolved);
+    m_desc = resolved;
+    return true;
+}
+
+bool DDSWriter::Close()
+{
+    m_desc = TextureDesc();
+    return m_pFile->Close();
+}
+
+uint8_t *DDSWriter::GetSurface(size_t item, size_t level)
+{
+    assert(m_pFile->IsOpen());
+    return m_pFile->GetData() + ComputeResolvedOffset(m_desc, item, level);
+}
+
+} // namespace
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BC123_simd.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Palette construction shared by the BC1/BC2/BC3 RGBA8 decoder kernels
+//
+// Palette entries are RGBA8 texels stored as little endian words, red in the low
+// byte. These are in an anonymous namespace because the kernel files are compiled
+// with extra instruction set flags.
+//-------------------------------------------------------------------------------------
+
+namespace {
+
+inline uint32_t PackRGBA8(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// Fills the four colors of the BC1 block at pBC. Only real BC1 blocks use the
+// 3 color mode, its fourth entry is transparent black.
+inline void BuildPaletteBC1(uint32_t aPalette[4], const uint8_t *pBC, bool isbc1)
+{
+    const DecodeBC123Tables& t = g_DecodeBC123;
+    const uint32_t c0 = uint32_t(pBC[0]) | (uint32_t(pBC[1]) << 8);
+    const uint32_t c1 = uint32_t(pBC[2]) | (uint32_t(pBC[3]) << 8);
+    const uint32_t r0 = (c0 >> 11) & 31, g0 = (c0 >> 5) & 63, b0 = c0 & 31;
+    const uint32_t r1 = (c1 >> 11) & 31, g1 = (c1 >> 5) & 63, b1 = c1 & 31;
+
+    aPalette[0] = PackRGBA8(t.aExpand5[r0], t.aExpand6[g0], t.aExpand5[b0], 255);
+    aPalette[1] = PackRGBA8(t.aExpand5[r1], t.aExpand6[g1], t.aExpand5[b1], 255);
+
+    if (isbc1 && c0 <= c1)
+    {
+        aPalette[2] = PackRGBA8(t.aLerp5[2][r0][r1], t.aLerp6[2][g0][g1], t.aLerp5[2][b0][b1], 255);
+        aPalette[3] = 0;
+    }
+    else
+    {
+        aPalette[2] = PackRGBA8(t.aLerp5[0][r0][r1], t.aLerp6[0][g0][g1], t.aLerp5[0][b0][b1], 255);
+        aPalette[3] = PackRGBA8(t.aLerp5[1][r0][r1], t.aLerp6[1][g0][g1], t.aLerp5[1][b0][b1], 255);
+    }
+}
+
+// Fills the eight alphas of the BC3 alpha block at pBC. The integer weights round
+// exactly like the float decoder.
+inline void BuildAlphaPaletteBC3(uint8_t aAlpha[8], const uint8_t *pBC)
+{
+    const uint32_t a0 = pBC[0];
+    const uint32_t a1 = pBC[1];
+    aAlpha[0] = uint8_t(a0);
+    aAlpha[1] = uint8_t(a1);
+
+    if (a0 > a1)
+    {
+        for (uint32_t i = 1; i < 7; ++i)
+            aAlpha[i + 1] = uint8_t((2 * (a0 * (7 - i) + a1 * i) + 7) / 14);
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; ++i)
+            aAlpha[i + 1] = uint8_t((2 * (a0 * (5 - i) + a1 * i) + 5) / 10);
+
+        aAlpha[6] = 0;
+        aAlpha[7] = 255;
+    }
+}
+
+// The 48 bits of 3-bit alpha indices of a BC3 alpha block
+inline uint64_t LoadAlphaIndicesBC3(const uint8_t *pBC)
+{
+    uint64_t dw = 0;
+    for (size_t i = 0; i < 6; ++i)
+        dw |= uint64_t(pBC[2 + i]) << (8 * i);
+    return dw;
+}
+
+}
+
+} // namespace
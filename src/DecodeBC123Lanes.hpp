@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <smmintrin.h>
+
+#include "DecodeBC123.hpp"
+#include "DecodeLanes.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// 128-bit building blocks of the SSE4.1 and AVX2 RGBA8 decoders
+//
+// A block row is one byte shuffle of the palette: every 2-bit index selects the 4
+// bytes of a palette word. BC2/BC3 alphas are expanded to 16 bytes up front and
+// shuffled into the alpha byte of each texel.
+//-------------------------------------------------------------------------------------
+
+namespace {
+
+// One block ready for row expansion, the palette alpha is cleared when the block
+// carries its own alphas
+struct DecodeBlock
+{
+    __m128i palette;
+    __m128i alpha;      // 16 alphas in texel order
+    uint32_t bitmap;    // 2-bit color indices
+};
+
+inline uint32_t LoadBitmapBC1(const uint8_t *pBC)
+{
+    return uint32_t(pBC[4]) | (uint32_t(pBC[5]) << 8) | (uint32_t(pBC[6]) << 16) | (uint32_t(pBC[7]) << 24);
+}
+
+inline __m128i LoadPaletteBC1(const uint8_t *pBC, bool isbc1)
+{
+    alignas(16) uint32_t aPalette[4];
+    BuildPaletteBC1(aPalette, pBC, isbc1);
+    __m128i palette = _mm_load_si128(reinterpret_cast<const __m128i *>(aPalette));
+    if (!isbc1)
+        palette = _mm_and_si128(palette, _mm_set1_epi32(0x00ffffff));
+    return palette;
+}
+
+inline DecodeBlock LoadBlockBC1(const uint8_t *pBC)
+{
+    return { LoadPaletteBC1(pBC, true), _mm_setzero_si128(), LoadBitmapBC1(pBC) };
+}
+
+inline DecodeBlock LoadBlockBC2(const uint8_t *pBC)
+{
+    // Texel 2k is the low nibble of byte k, and n * 17 == n | n << 4
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pBC));
+    const __m128i lo = _mm_and_si128(v, mask);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i alpha = _mm_unpacklo_epi8(lo, hi);
+    alpha = _mm_or_si128(alpha, _mm_slli_epi16(alpha, 4));
+
+    return { LoadPaletteBC1(pBC + 8, false), alpha, LoadBitmapBC1(pBC + 8) };
+}
+
+inline DecodeBlock LoadBlockBC3(const uint8_t *pBC)
+{
+    const __m128i indices = ExpandIndices3(pBC);
+
+    uint8_t aAlphaPalette[16] = {};
+    BuildAlphaPaletteBC3(aAlphaPalette, pBC);
+    const __m128i alphaPalette = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aAlphaPalette));
+
+    return { LoadPaletteBC1(pBC + 8, false), _mm_shuffle_epi8(alphaPalette, indices), LoadBitmapBC1(pBC + 8) };
+}
+
+// Byte shuffle expanding the indices of row y
+inline __m128i LoadRowShuffle(uint32_t bitmap, size_t y)
+{
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(g_DecodeBC123.aShuffle[(bitmap >> (8 * y)) & 0xff]));
+}
+
+// Byte shuffle moving the 4 alphas of row y into the alpha bytes
+inline __m128i LoadRowAlphaShuffle(size_t y)
+{
+    const char b = char(4 * y);
+    return _mm_setr_epi8(-1, -1, -1, b, -1, -1, -1, char(b + 1), -1, -1, -1, char(b + 2), -1, -1, -1, char(b + 3));
+}
+
+template <bool bAlpha>
+inline __m128i ExpandRow(const DecodeBlock& block, size_t y)
+{
+    __m128i row = _mm_shuffle_epi8(block.palette, LoadRowShuffle(block.bitmap, y));
+    if (bAlpha)
+        row = _mm_or_si128(row, _mm_shuffle_epi8(block.alpha, LoadRowAlphaShuffle(y)));
+    return row;
+}
+
+}
+
+} // namespace
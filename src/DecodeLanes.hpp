@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <smmintrin.h>
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// 128-bit helpers shared by the SSE4.1 and AVX2 decoder kernels
+//-------------------------------------------------------------------------------------
+
+namespace {
+
+// The 16 3-bit indices of a BC3 alpha or BC4 block at pBC, one per byte. Index i
+// sits at bit 16 + 3 * i of the first 8 bytes; every 16-bit lane gets the two bytes
+// holding its index, and the multiply moves the index to bit 8.
+inline __m128i ExpandIndices3(const uint8_t *pBC)
+{
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pBC));
+    const __m128i shiftLo = _mm_setr_epi8(2, 3, 2, 3, 2, 3, 3, 4, 3, 4, 3, 4, 4, 5, 4, 5);
+    const __m128i shiftHi = _mm_setr_epi8(5, 6, 5, 6, 5, 6, 6, 7, 6, 7, 6, 7, 7, -1, 7, -1);
+    const __m128i scale = _mm_setr_epi16(256, 32, 4, 128, 16, 2, 64, 8);
+    const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, shiftLo), scale), 8);
+    const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, shiftHi), scale), 8);
+    return _mm_and_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi8(7));
+}
+
+}
+
+} // namespace
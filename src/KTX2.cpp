@@ -0,0 +1,542 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+
+#include "Container.hpp"
+#include "KTX2.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#ifdef CROSSTEX_ZLIB
+#include <zlib.h>
+#endif
+
+
+namespace Tex {
+
+namespace {
+
+//-------------------------------------------------------------------------------------
+// File format constants, see the KTX 2.0 and Khronos Data Format specifications
+//-------------------------------------------------------------------------------------
+
+const uint8_t KTX2_IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+const size_t KTX2_HEADER_SIZE = 80;
+const size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+// Byte offsets into the file
+const size_t KTX2_OFFSET_VKFORMAT = 12;
+const size_t KTX2_OFFSET_TYPESIZE = 16;
+const size_t KTX2_OFFSET_WIDTH = 20;
+const size_t KTX2_OFFSET_HEIGHT = 24;
+const size_t KTX2_OFFSET_DEPTH = 28;
+const size_t KTX2_OFFSET_LAYERCOUNT = 32;
+const size_t KTX2_OFFSET_FACECOUNT = 36;
+const size_t KTX2_OFFSET_LEVELCOUNT = 40;
+const size_t KTX2_OFFSET_SUPERCOMPRESSION = 44;
+const size_t KTX2_OFFSET_DFD = 48;
+const size_t KTX2_OFFSET_KVD = 56;
+
+const uint32_t KHR_DF_VERSION = 2;
+const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+const uint32_t KHR_DF_SAMPLE_SIGNED = 0x40;
+const uint32_t KHR_DF_SAMPLE_FLOAT = 0x80;
+
+const char KTX2_WRITER_KEY[] = "KTXwriter";
+const char KTX2_WRITER_VALUE[] = "crosstex";
+
+struct Sample
+{
+    uint32_t uBitOffset;
+    uint32_t uChannel;
+};
+
+struct FormatInfo
+{
+    BC_FORMAT format;
+    uint32_t uVkFormat;
+    uint32_t uVkFormatSRGB;     // 0 without an sRGB variant
+    uint32_t uModel;
+    uint32_t uQualifiers;
+    size_t nSamples;
+    Sample aSamples[2];         // BC1 RGBA is channel 1, BC2/BC3 put alpha (15) first
+};
+
+const FormatInfo g_aFormats[] =
+{
+    { BC_FORMAT_BC1,   133, 134, 128, 0,                                          1, { { 0, 1 } } },
+    { BC_FORMAT_BC2,   135, 136, 129, 0,                                          2, { { 0, 15 }, { 64, 0 } } },
+    { BC_FORMAT_BC3,   137, 138, 130, 0,                                          2, { { 0, 15 }, { 64, 0 } } },
+    { BC_FORMAT_BC4U,  139, 0,   131, 0,                                          1, { { 0, 0 } } },
+    { BC_FORMAT_BC4S,  140, 0,   131, KHR_DF_SAMPLE_SIGNED,                       1, { { 0, 0 } } },
+    { BC_FORMAT_BC5U,  141, 0,   132, 0,                                          2, { { 0, 0 }, { 64, 1 } } },
+    { BC_FORMAT_BC5S,  142, 0,   132, KHR_DF_SAMPLE_SIGNED,                       2, { { 0, 0 }, { 64, 1 } } },
+    { BC_FORMAT_BC6HU, 143, 0,   133, KHR_DF_SAMPLE_FLOAT,                        1, { { 0, 0 } } },
+    { BC_FORMAT_BC6HS, 144, 0,   133, KHR_DF_SAMPLE_FLOAT | KHR_DF_SAMPLE_SIGNED, 1, { { 0, 0 } } },
+    { BC_FORMAT_BC7,   145, 146, 134, 0,                                          1, { { 0, 0 } } },
+};
+
+// VK_FORMAT_BC1_RGB_UNORM_BLOCK and its sRGB twin decode like the RGBA formats
+const uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+const uint32_t VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132;
+
+const FormatInfo* FindFormat(BC_FORMAT format)
+{
+    for (const FormatInfo& info : g_aFormats)
+    {
+        if (info.format == format)
+            return &info;
+    }
+    return nullptr;
+}
+
+inline size_t AlignUp(size_t uOffset, size_t uAlignment)
+{
+    return (uOffset + uAlignment - 1) / uAlignment * uAlignment;
+}
+
+// Basic data format descriptor block, the planes are unsized for supercompressed data
+void AppendDFD(std::vector<uint8_t>& aDst, const TextureDesc& desc, KTX2_SUPERCOMPRESSION scheme)
+{
+    const FormatInfo* pInfo = FindFormat(desc.format);
+    const size_t blockSize = 24 + 16 * pInfo->nSamples;
+    const size_t uStart = aDst.size();
+    aDst.resize(uStart + 4 + blockSize, 0);
+
+    uint8_t *p = aDst.data() + uStart;
+    StoreU32(p, uint32_t(4 + blockSize));
+    StoreU32(p + 4, 0);
+    StoreU32(p + 8, KHR_DF_VERSION | uint32_t(blockSize << 16));
+    StoreU32(p + 12, pInfo->uModel | (KHR_DF_PRIMARIES_BT709 << 8)
+        | ((desc.srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+    StoreU32(p + 16, 3 | (3 << 8));
+    StoreU32(p + 20, scheme == KTX2_SUPERCOMPRESSION_NONE ? uint32_t(GetBlockSize(desc.format)) : 0);
+
+    const bool bSigned = (pInfo->uQualifiers & KHR_DF_SAMPLE_SIGNED) != 0;
+    const bool bFloat = (pInfo->uQualifiers & KHR_DF_SAMPLE_FLOAT) != 0;
+    const uint32_t uBits = uint32_t(GetBlockSize(desc.format) * 8 / pInfo->nSamples);
+    for (size_t i = 0; i < pInfo->nSamples; ++i)
+    {
+        uint8_t *pSample = p + 28 + 16 * i;
+        StoreU32(pSample, pInfo->aSamples[i].uBitOffset | ((uBits - 1) << 16)
+            | ((pInfo->aSamples[i].uChannel | pInfo->uQualifiers) << 24));
+        if (bFloat)
+        {
+            // -1.0f or 0.0f to 1.0f
+            StoreU32(pSample + 8, bSigned ? 0xbf800000 : 0);
+            StoreU32(pSample + 12, 0x3f800000);
+        }
+        else
+        {
+            StoreU32(pSample + 8, bSigned ? 0x80000000 : 0);
+            StoreU32(pSample + 12, bSigned ? 0x7fffffff : 0xffffffff);
+        }
+    }
+}
+
+void AppendKVD(std::vector<uint8_t>& aDst)
+{
+    const size_t uLength = sizeof(KTX2_WRITER_KEY) + sizeof(KTX2_WRITER_VALUE);
+    const size_t uStart = aDst.size();
+    aDst.resize(uStart + AlignUp(4 + uLength, 4), 0);
+
+    uint8_t *p = aDst.data() + uStart;
+    StoreU32(p, uint32_t(uLength));
+    memcpy(p + 4, KTX2_WRITER_KEY, sizeof(KTX2_WRITER_KEY));
+    memcpy(p + 4 + sizeof(KTX2_WRITER_KEY), KTX2_WRITER_VALUE, sizeof(KTX2_WRITER_VALUE));
+}
+
+// Everything up to the level data. The level index is filled in by the caller.
+std::vector<uint8_t> BuildHeader(const TextureDesc& desc, KTX2_SUPERCOMPRESSION scheme)
+{
+    const FormatInfo* pInfo = FindFormat(desc.format);
+    const size_t faces = desc.cubeMap ? 6 : 1;
+    const size_t layers = desc.arraySize / faces;
+
+    std::vector<uint8_t> aHeader(KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_ENTRY_SIZE * desc.mipLevels, 0);
+    uint8_t *p = aHeader.data();
+    memcpy(p, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    StoreU32(p + KTX2_OFFSET_VKFORMAT, desc.srgb ? pInfo->uVkFormatSRGB : pInfo->uVkFormat);
+    StoreU32(p + KTX2_OFFSET_TYPESIZE, 1);
+    StoreU32(p + KTX2_OFFSET_WIDTH, uint32_t(desc.width));
+    StoreU32(p + KTX2_OFFSET_HEIGHT, uint32_t(desc.height));
+    StoreU32(p + KTX2_OFFSET_DEPTH, 0);
+    StoreU32(p + KTX2_OFFSET_LAYERCOUNT, layers > 1 ? uint32_t(layers) : 0);
+    StoreU32(p + KTX2_OFFSET_FACECOUNT, uint32_t(faces));
+    StoreU32(p + KTX2_OFFSET_LEVELCOUNT, uint32_t(desc.mipLevels));
+    StoreU32(p + KTX2_OFFSET_SUPERCOMPRESSION, uint32_t(scheme));
+
+    const size_t uDFDOffset = aHeader.size();
+    AppendDFD(aHeader, desc, scheme);
+    const size_t uKVDOffset = aHeader.size();
+    AppendKVD(aHeader);
+
+    p = aHeader.data();
+    StoreU32(p + KTX2_OFFSET_DFD, uint32_t(uDFDOffset));
+    StoreU32(p + KTX2_OFFSET_DFD + 4, uint32_t(uKVDOffset - uDFDOffset));
+    StoreU32(p + KTX2_OFFSET_KVD, uint32_t(uKVDOffset));
+    StoreU32(p + KTX2_OFFSET_KVD + 4, uint32_t(aHeader.size() - uKVDOffset));
+    return aHeader;
+}
+
+void StoreLevelIndex(uint8_t *pHeader, size_t level, uint64_t uOffset, uint64_t uLength, uint64_t uUncompressed)
+{
+    uint8_t *p = pHeader + KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_ENTRY_SIZE * level;
+    StoreU64(p, uOffset);
+    StoreU64(p + 8, uLength);
+    StoreU64(p + 16, uUncompressed);
+}
+
+//-------------------------------------------------------------------------------------
+// Supercompression of a single level
+//-------------------------------------------------------------------------------------
+
+bool CompressLevel(std::vector<uint8_t>& aDst, const uint8_t *pSrc, size_t size,
+    KTX2_SUPERCOMPRESSION scheme, int compressionLevel)
+{
+#ifdef CROSSTEX_ZLIB
+    if (scheme == KTX2_SUPERCOMPRESSION_ZLIB)
+    {
+        if (uint64_t(size) > uint64_t(ULONG_MAX) / 2)
+            return false;
+
+        uLongf uLength = compressBound(uLong(size));
+        aDst.resize(uLength);
+        if (compress2(aDst.data(), &uLength, pSrc, uLong(size),
+            compressionLevel < 0 ? Z_DEFAULT_COMPRESSION : std::min(compressionLevel, 9)) != Z_OK)
+            return false;
+
+        aDst.resize(uLength);
+        return true;
+    }
+#endif
+    UNREFERENCED_PARAMETER(aDst);
+    UNREFERENCED_PARAMETER(pSrc);
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(scheme);
+    UNREFERENCED_PARAMETER(compressionLevel);
+    return false;
+}
+
+bool ExpandLevel(uint8_t *pDst, size_t size, const uint8_t *pSrc, size_t srcSize,
+    KTX2_SUPERCOMPRESSION scheme)
+{
+#ifdef CROSSTEX_ZLIB
+    if (scheme == KTX2_SUPERCOMPRESSION_ZLIB)
+    {
+        if (uint64_t(size) > uint64_t(ULONG_MAX) || uint64_t(srcSize) > uint64_t(ULONG_MAX))
+            return false;
+
+        // The stream has to fill the level and end exactly at the end of the data
+        uLongf uLength = uLong(size);
+        uLong uSrcLength = uLong(srcSize);
+        return uncompress2(pDst, &uLength, pSrc, &uSrcLength) == Z_OK && uLength == size && uSrcLength == srcSize;
+    }
+#endif
+    UNREFERENCED_PARAMETER(pDst);
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(pSrc);
+    UNREFERENCED_PARAMETER(srcSize);
+    UNREFERENCED_PARAMETER(scheme);
+    return false;
+}
+
+}
+
+bool IsKTX2SupercompressionSupported(KTX2_SUPERCOMPRESSION scheme)
+{
+    switch (scheme)
+    {
+    case KTX2_SUPERCOMPRESSION_NONE:
+        return true;
+#ifdef CROSSTEX_ZLIB
+    case KTX2_SUPERCOMPRESSION_ZLIB:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// KTX2Reader
+//-------------------------------------------------------------------------------------
+
+KTX2Reader::KTX2Reader()
+    : m_pFile(new MappedFile), m_pLevels(nullptr), m_desc(), m_scheme(KTX2_SUPERCOMPRESSION_NONE)
+{
+}
+
+KTX2Reader::~KTX2Reader() {}
+
+bool KTX2Reader::Open(const char *path, size_t threadCount)
+{
+    Close();
+    if (!m_pFile->OpenRead(path))
+        return false;
+
+    const uint8_t *pSrc = m_pFile->GetData();
+    const size_t size = m_pFile->GetSize();
+    if (size < KTX2_HEADER_SIZE || memcmp(pSrc, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    TextureDesc parsed = {};
+    const uint32_t uVkFormat = LoadU32(pSrc + KTX2_OFFSET_VKFORMAT);
+    for (const FormatInfo& info : g_aFormats)
+    {
+        if (uVkFormat == info.uVkFormat)
+            parsed.format = info.format;
+        else if (info.uVkFormatSRGB && uVkFormat == info.uVkFormatSRGB)
+        {
+            parsed.format = info.format;
+            parsed.srgb = true;
+        }
+    }
+    if (uVkFormat == VK_FORMAT_BC1_RGB_UNORM_BLOCK || uVkFormat == VK_FORMAT_BC1_RGB_SRGB_BLOCK)
+    {
+        parsed.format = BC_FORMAT_BC1;
+        parsed.srgb = uVkFormat == VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    }
+
+    const uint32_t faces = LoadU32(pSrc + KTX2_OFFSET_FACECOUNT);
+    const uint32_t layers = std::max<uint32_t>(1, LoadU32(pSrc + KTX2_OFFSET_LAYERCOUNT));
+    parsed.width = LoadU32(pSrc + KTX2_OFFSET_WIDTH);
+    parsed.height = LoadU32(pSrc + KTX2_OFFSET_HEIGHT);
+    parsed.mipLevels = std::max<uint32_t>(1, LoadU32(pSrc + KTX2_OFFSET_LEVELCOUNT));
+    parsed.arraySize = size_t(layers) * faces;
+    parsed.cubeMap = faces == 6;
+
+    const KTX2_SUPERCOMPRESSION scheme = KTX2_SUPERCOMPRESSION(LoadU32(pSrc + KTX2_OFFSET_SUPERCOMPRESSION));
+    TextureDesc resolved;
+    if (LoadU32(pSrc + KTX2_OFFSET_TYPESIZE) != 1 || LoadU32(pSrc + KTX2_OFFSET_DEPTH) != 0
+        || (faces != 1 && faces != 6) || !IsKTX2SupercompressionSupported(scheme)
+        || !ResolveTextureDesc(parsed, resolved)
+        || (size - KTX2_HEADER_SIZE) / KTX2_LEVEL_INDEX_ENTRY_SIZE < resolved.mipLevels)
+    {
+        Close();
+        return false;
+    }
+
+    // Checks every level against the layout implied by the header. Uncompressed
+    // levels start past the level index, aligned to a block.
+    const uint8_t *pIndex = pSrc + KTX2_HEADER_SIZE;
+    const size_t indexEnd = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_ENTRY_SIZE * resolved.mipLevels;
+    const size_t blockSize = GetBlockSize(resolved.format);
+    size_t expandedSize = 0;
+    m_aLevelOffsets.resize(resolved.mipLevels);
+    for (size_t level = 0; level < resolved.mipLevels; ++level)
+    {
+        const uint8_t *pEntry = pIndex + KTX2_LEVEL_INDEX_ENTRY_SIZE * level;
+        const uint64_t uOffset = LoadU64(pEntry);
+        const uint64_t uLength = LoadU64(pEntry + 8);
+        const uint64_t uUncompressed = LoadU64(pEntry + 16);
+        const size_t levelSize = ComputeLevelSize(resolved, level);
+        if (levelSize == 0 || uOffset > size || uLength > size - uOffset
+            || uUncompressed / levelSize != resolved.arraySize || uUncompressed % levelSize != 0
+            || uOffset < indexEnd
+            || (scheme == KTX2_SUPERCOMPRESSION_NONE && (uLength != uUncompressed || uOffset % blockSize != 0)))
+        {
+            Close();
+            return false;
+        }
+
+        m_aLevelOffsets[level] = (scheme == KTX2_SUPERCOMPRESSION_NONE) ? size_t(uOffset) : expandedSize;
+        expandedSize += size_t(uUncompressed);
+    }
+
+    if (scheme == KTX2_SUPERCOMPRESSION_NONE)
+    {
+        m_pLevels = pSrc;
+    }
+    else
+    {
+        m_aExpanded.resize(expandedSize);
+        std::atomic<bool> bOk(true);
+        ThreadPool::GetShared().ParallelFor(resolved.mipLevels, 1,
+            ThreadPool::ResolveThreadCount(threadCount),
+            [&](size_t uBegin, size_t uEnd)
+            {
+                for (size_t level = uBegin; level < uEnd; ++level)
+                {
+                    const uint8_t *pEntry = pIndex + KTX2_LEVEL_INDEX_ENTRY_SIZE * level;
+                    if (!ExpandLevel(m_aExpanded.data() + m_aLevelOffsets[level], size_t(LoadU64(pEntry + 16)),
+                        pSrc + LoadU64(pEntry), size_t(LoadU64(pEntry + 8)), scheme))
+                        bOk = false;
+                }
+            });
+
+        // The expanded levels no longer need the file
+        m_pFile->Close();
+        if (!bOk)
+        {
+            Close();
+            return false;
+        }
+        m_pLevels = m_aExpanded.data();
+    }
+
+    m_desc = resolved;
+    m_scheme = scheme;
+    return true;
+}
+
+void KTX2Reader::Close()
+{
+    m_pFile->Close();
+    std::vector<uint8_t>().swap(m_aExpanded);
+    m_aLevelOffsets.clear();
+    m_pLevels = nullptr;
+    m_desc = TextureDesc();
+    m_scheme = KTX2_SUPERCOMPRESSION_NONE;
+}
+
+const uint8_t *KTX2Reader::GetSurface(size_t item, size_t level) const
+{
+    assert(m_pLevels && item < m_desc.arraySize && level < m_desc.mipLevels);
+    return m_pLevels + m_aLevelOffsets[level] + item * ComputeLevelSize(m_desc, level);
+}
+
+//-------------------------------------------------------------------------------------
+// KTX2Writer
+//-------------------------------------------------------------------------------------
+
+KTX2Writer::KTX2Writer()
+    : m_pFile(new MappedFile), m_pLevels(nullptr), m_desc(), m_scheme(KTX2_SUPERCOMPRESSION_NONE),
+    m_compressionLevel(-1)
+{
+}
+
+KTX2Writer::~KTX2Writer()
+{
+    Close();
+}
+
+bool KTX2Writer::Create(const char *path, const TextureDesc& desc, KTX2_SUPERCOMPRESSION scheme,
+    int compressionLevel)
+{
+    Close();
+
+    TextureDesc resolved;
+    if (!ResolveTextureDesc(desc, resolved) || !IsKTX2SupercompressionSupported(scheme))
+        return false;
+
+    const size_t itemSize = ComputeItemSize(resolved);
+    if (itemSize == 0 || itemSize > SIZE_MAX / 2 / resolved.arraySize)
+        return false;
+
+    m_aLevelOffsets.resize(resolved.mipLevels);
+    if (scheme == KTX2_SUPERCOMPRESSION_NONE)
+    {
+        // Levels go from the smallest to the largest, each aligned to a block
+        std::vector<uint8_t> aHeader = BuildHeader(resolved, scheme);
+        const size_t blockSize = GetBlockSize(resolved.format);
+        size_t uOffset = aHeader.size();
+        for (size_t level = resolved.mipLevels; level-- > 0;)
+        {
+            const size_t levelSize = ComputeLevelSize(resolved, level) * resolved.arraySize;
+            uOffset = AlignUp(uOffset, blockSize);
+            m_aLevelOffsets[level] = uOffset;
+            StoreLevelIndex(aHeader.data(), level, uOffset, levelSize, levelSize);
+            uOffset += levelSize;
+        }
+
+        if (!m_pFile->Create(path, uOffset))
+            return false;
+
+        memcpy(m_pFile->GetData(), aHeader.data(), aHeader.size());
+        m_pLevels = m_pFile->GetData();
+    }
+    else
+    {
+        size_t uOffset = 0;
+        for (size_t level = 0; level < resolved.mipLevels; ++level)
+        {
+            m_aLevelOffsets[level] = uOffset;
+            uOffset += ComputeLevelSize(resolved, level) * resolved.arraySize;
+        }
+
+        m_aLevels.resize(uOffset);
+        m_pLevels = m_aLevels.data();
+        m_path = path;
+    }
+
+    m_desc = resolved;
+    m_scheme = scheme;
+    m_compressionLevel = compressionLevel;
+    return true;
+}
+
+bool KTX2Writer::Close(size_t threadCount)
+{
+    bool bOk = true;
+    if (m_pFile->IsOpen())
+    {
+        bOk = m_pFile->Close();
+    }
+    else if (m_pLevels)
+    {
+        // Supercompresses the levels, then lays them out back to back from the
+        // smallest to the largest
+        std::vector<std::vector<uint8_t>> aCompressed(m_desc.mipLevels);
+        std::atomic<bool> bCompressed(true);
+        ThreadPool::GetShared().ParallelFor(m_desc.mipLevels, 1,
+            ThreadPool::ResolveThreadCount(threadCount),
+            [&](size_t uBegin, size_t uEnd)
+            {
+                for (size_t level = uBegin; level < uEnd; ++level)
+                {
+                    const size_t levelSize = ComputeLevelSize(m_desc, level) * m_desc.arraySize;
+                    if (!CompressLevel(aCompressed[level], m_pLevels + m_aLevelOffsets[level], levelSize,
+                        m_scheme, m_compressionLevel))
+                        bCompressed = false;
+                }
+            });
+
+        std::vector<uint8_t> aHeader = BuildHeader(m_desc, m_scheme);
+        size_t uOffset = aHeader.size();
+        for (size_t level = m_desc.mipLevels; level-- > 0;)
+        {
+            const size_t levelSize = ComputeLevelSize(m_desc, level) * m_desc.arraySize;
+            StoreLevelIndex(aHeader.data(), level, uOffset, aCompressed[level].size(), levelSize);
+            uOffset += aCompressed[level].size();
+        }
+
+        FILE *pFile = bCompressed ? fopen(m_path.c_str(), "wb") : nullptr;
+        bOk = pFile && fwrite(aHeader.data(), 1, aHeader.size(), pFile) == aHeader.size();
+        for (size_t level = m_desc.mipLevels; bOk && level-- > 0;)
+            bOk = fwrite(aCompressed[level].data(), 1, aCompressed[level].size(), pFile) == aCompressed[level].size();
+        if (pFile)
+            bOk = (fclose(pFile) == 0) && bOk;
+
+        // Like a failed MappedFile::Create, a failed write leaves no file behind
+        if (!bOk && pFile)
+            remove(m_path.c_str());
+    }
+
+    std::vector<uint8_t>().swap(m_aLevels);
+    m_aLevelOffsets.clear();
+    m_pLevels = nullptr;
+    m_path.clear();
+    m_desc = TextureDesc();
+    m_scheme = KTX2_SUPERCOMPRESSION_NONE;
+    return bOk;
+}
+
+uint8_t *KTX2Writer::GetSurface(size_t item, size_t level)
+{
+    assert(m_pLevels && item < m_desc.arraySize && level < m_desc.mipLevels);
+    return m_pLevels + m_aLevelOffsets[level] + item * ComputeLevelSize(m_desc, level);
+}
+
+} // namespace
@@ -0,0 +1,204 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace Tex {
+
+MappedFile::MappedFile()
+    : m_pData(nullptr), m_uSize(0), m_bWritable(false)
+#ifdef _WIN32
+    , m_hFile(INVALID_HANDLE_VALUE), m_hMapping(nullptr)
+#else
+    , m_fd(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::OpenRead(const char *path)
+{
+    Close();
+
+    m_hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (m_hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_hFile, &size) || size.QuadPart <= 0
+        || uint64_t(size.QuadPart) > SIZE_MAX)
+    {
+        Close();
+        return false;
+    }
+
+    m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* pView = m_hMapping ? MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!pView)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<uint8_t*>(pView);
+    m_uSize = size_t(size.QuadPart);
+    return true;
+}
+
+bool MappedFile::Create(const char *path, size_t uSize)
+{
+    Close();
+    if (uSize == 0)
+        return false;
+
+    m_hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    // Mapping more than the file holds grows it
+    const uint64_t uSize64 = uSize;
+    m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READWRITE,
+        DWORD(uSize64 >> 32), DWORD(uSize64 & 0xffffffff), nullptr);
+    void* pView = m_hMapping ? MapViewOfFile(m_hMapping, FILE_MAP_WRITE, 0, 0, uSize) : nullptr;
+    if (!pView)
+    {
+        Close();
+        DeleteFileA(path);
+        return false;
+    }
+
+    m_pData = static_cast<uint8_t*>(pView);
+    m_uSize = uSize;
+    m_bWritable = true;
+    return true;
+}
+
+bool MappedFile::Close()
+{
+    bool bOk = true;
+    if (m_pData && m_bWritable)
+        bOk = FlushViewOfFile(m_pData, 0) != 0 && FlushFileBuffers(m_hFile) != 0;
+    if (m_pData)
+        bOk = (UnmapViewOfFile(m_pData) != 0) && bOk;
+    if (m_hMapping)
+        CloseHandle(m_hMapping);
+    if (m_hFile != INVALID_HANDLE_VALUE)
+        bOk = (CloseHandle(m_hFile) != 0) && bOk;
+
+    m_pData = nullptr;
+    m_uSize = 0;
+    m_bWritable = false;
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_hMapping = nullptr;
+    return bOk;
+}
+
+#else
+
+bool MappedFile::OpenRead(const char *path)
+{
+    Close();
+
+    m_fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (m_fd < 0 || fstat(m_fd, &st) != 0 || st.st_size <= 0 || uint64_t(st.st_size) > SIZE_MAX)
+    {
+        Close();
+        return false;
+    }
+
+    void* pView = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, m_fd, 0);
+    if (pView == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<uint8_t*>(pView);
+    m_uSize = size_t(st.st_size);
+    return true;
+}
+
+bool MappedFile::Create(const char *path, size_t uSize)
+{
+    Close();
+    if (uSize == 0 || uint64_t(uSize) > uint64_t(INT64_MAX))
+        return false;
+
+    m_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (m_fd < 0)
+        return false;
+
+    if (ftruncate(m_fd, off_t(uSize)) != 0)
+    {
+        Close();
+        unlink(path);
+        return false;
+    }
+
+#ifdef __linux__
+    // Reserves the blocks so a full disk fails here instead of raising SIGBUS
+    // halfway through the encode. Some file systems cannot preallocate, they
+    // fall back to the sparse file.
+    const int err = posix_fallocate(m_fd, 0, off_t(uSize));
+    if (err == ENOSPC || err == EFBIG)
+    {
+        Close();
+        unlink(path);
+        return false;
+    }
+#endif
+
+    void* pView = mmap(nullptr, uSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (pView == MAP_FAILED)
+    {
+        Close();
+        unlink(path);
+        return false;
+    }
+
+    m_pData = static_cast<uint8_t*>(pView);
+    m_uSize = uSize;
+    m_bWritable = true;
+    return true;
+}
+
+bool MappedFile::Close()
+{
+    bool bOk = true;
+    if (m_pData && m_bWritable)
+        bOk = msync(m_pData, m_uSize, MS_SYNC) == 0;
+    if (m_pData)
+        bOk = (munmap(m_pData, m_uSize) == 0) && bOk;
+    if (m_fd >= 0)
+        bOk = (close(m_fd) == 0) && bOk;
+
+    m_pData = nullptr;
+    m_uSize = 0;
+    m_bWritable = false;
+    m_fd = -1;
+    return bOk;
+}
+
+#endif
+
+} // namespace
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Memory mapped file
+//
+// Container readers hand out pointers into the mapping so blocks are decoded in
+// place, writers size the file up front and the encoders fill the mapping
+// directly. The kernel pages data in and writes it back, there are no
+// intermediate buffers or write calls.
+//-------------------------------------------------------------------------------------
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps an existing file read only
+    bool OpenRead(const char *path);
+
+    // Creates or truncates the file at path, sizes it to uSize bytes and maps it
+    // writable. The contents start out zeroed. A file that could not be sized or
+    // mapped is deleted again.
+    bool Create(const char *path, size_t uSize);
+
+    // Unmaps and closes the file. A writable mapping is flushed to disk first,
+    // false if the data could not be written back.
+    bool Close();
+
+    bool IsOpen() const { return m_pData != nullptr; }
+    uint8_t* GetData() const { return m_pData; }
+    size_t GetSize() const { return m_uSize; }
+
+private:
+    uint8_t* m_pData;
+    size_t m_uSize;
+    bool m_bWritable;
+#ifdef _WIN32
+    void* m_hFile;
+    void* m_hMapping;
+#else
+    int m_fd;
+#endif
+};
+
+} // namespace
@@ -0,0 +1,332 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+#include "Mipmap.hpp"
+#include "Colors.hpp"
+#include "ThreadPool.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+//-------------------------------------------------------------------------------------
+// Filter kernels, t is in units of output texels
+//-------------------------------------------------------------------------------------
+
+const float FILTER_PI = 3.14159265358979f;
+const float KAISER_WIDTH = 3.0f;
+const float KAISER_ALPHA = 4.0f;
+const float LANCZOS_WIDTH = 3.0f;
+
+inline float Sinc(float x)
+{
+    if (fabsf(x) < 1e-6f)
+        return 1.0f;
+    x *= FILTER_PI;
+    return sinf(x) / x;
+}
+
+// Modified Bessel function of the first kind, order 0
+float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    const float q = x * x * 0.25f;
+    for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+    {
+        term *= q / float(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+float FilterRadius(MIP_FILTER filter)
+{
+    switch (filter)
+    {
+    case MIP_FILTER_KAISER:
+        return KAISER_WIDTH;
+    case MIP_FILTER_LANCZOS:
+        return LANCZOS_WIDTH;
+    default:
+        return 0.5f;
+    }
+}
+
+float FilterWeight(MIP_FILTER filter, float t)
+{
+    t = fabsf(t);
+    switch (filter)
+    {
+    case MIP_FILTER_KAISER:
+    {
+        if (t >= KAISER_WIDTH)
+            return 0.0f;
+        const float r = t / KAISER_WIDTH;
+        return Sinc(t) * BesselI0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / BesselI0(KAISER_ALPHA);
+    }
+    case MIP_FILTER_LANCZOS:
+        return (t < LANCZOS_WIDTH) ? Sinc(t) * Sinc(t / LANCZOS_WIDTH) : 0.0f;
+    default:
+        return (t <= 0.5f) ? 1.0f : 0.0f;
+    }
+}
+
+// Normalized taps of a 1D downsample from srcSize to dstSize texels. Taps past
+// the edges are clamped or wrapped to the texels they read.
+struct FilterTaps
+{
+    std::vector<uint32_t> aFirst;   // First tap of every output texel, plus the end
+    std::vector<uint32_t> aIndex;
+    std::vector<float> aWeight;
+
+    FilterTaps(MIP_FILTER filter, size_t srcSize, size_t dstSize, bool bWrap)
+    {
+        const float scale = float(srcSize) / float(dstSize);
+        const float radius = FilterRadius(filter) * std::max(scale, 1.0f);
+
+        aFirst.reserve(dstSize + 1);
+        for (size_t x = 0; x < dstSize; ++x)
+        {
+            aFirst.push_back(uint32_t(aIndex.size()));
+
+            const float center = (float(x) + 0.5f) * scale;
+            const ptrdiff_t iBegin = ptrdiff_t(floorf(center - radius));
+            const ptrdiff_t iEnd = ptrdiff_t(ceilf(center + radius));
+            float sum = 0.0f;
+            for (ptrdiff_t i = iBegin; i <= iEnd; ++i)
+            {
+                const float w = FilterWeight(filter, (float(i) + 0.5f - center) / scale);
+                if (w == 0.0f)
+                    continue;
+
+                const ptrdiff_t n = ptrdiff_t(srcSize);
+                const ptrdiff_t uSrc = bWrap ? ((i % n) + n) % n : std::min(std::max<ptrdiff_t>(i, 0), n - 1);
+                aIndex.push_back(uint32_t(uSrc));
+                aWeight.push_back(w);
+                sum += w;
+            }
+
+            for (size_t k = aFirst.back(); k < aWeight.size(); ++k)
+                aWeight[k] /= sum;
+        }
+        aFirst.push_back(uint32_t(aIndex.size()));
+    }
+};
+
+//-------------------------------------------------------------------------------------
+// Color space conversion
+//-------------------------------------------------------------------------------------
+
+inline float SRGBToLinear(float v)
+{
+    return (v <= 0.04045f) ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float LinearToSRGB(float v)
+{
+    v = std::max(v, 0.0f);
+    return (v <= 0.0031308f) ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+}
+
+struct SRGBTable
+{
+    float aToLinear[256];
+
+    SRGBTable()
+    {
+        for (size_t i = 0; i < 256; ++i)
+            aToLinear[i] = SRGBToLinear(float(i) / 255.0f);
+    }
+};
+
+const SRGBTable g_SRGB;
+
+inline HDRColorA ToLinear(const HDRColorA& c, bool bSRGB)
+{
+    if (!bSRGB)
+        return c;
+    return HDRColorA(SRGBToLinear(c.r), SRGBToLinear(c.g), SRGBToLinear(c.b), c.a);
+}
+
+inline HDRColorA ToLinear(const LDRColorA& c, bool bSRGB)
+{
+    if (bSRGB)
+        return HDRColorA(g_SRGB.aToLinear[c.r], g_SRGB.aToLinear[c.g], g_SRGB.aToLinear[c.b], c.a / 255.0f);
+    return HDRColorA(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f);
+}
+
+inline void FromLinear(HDRColorA& dst, const HDRColorA& c, bool bSRGB)
+{
+    dst = bSRGB ? HDRColorA(LinearToSRGB(c.r), LinearToSRGB(c.g), LinearToSRGB(c.b), c.a) : c;
+}
+
+inline uint8_t ToUNorm8(float f)
+{
+    return static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, f)) * 255.0f + 0.5f);
+}
+
+inline void FromLinear(LDRColorA& dst, const HDRColorA& c, bool bSRGB)
+{
+    HDRColorA v;
+    FromLinear(v, c, bSRGB);
+    dst = LDRColorA(ToUNorm8(v.r), ToUNorm8(v.g), ToUNorm8(v.b), ToUNorm8(v.a));
+}
+
+//-------------------------------------------------------------------------------------
+// Pipeline
+//-------------------------------------------------------------------------------------
+
+template <typename Color>
+inline const Color* GetRow(const Color *pSrc, size_t rowPitch, size_t y)
+{
+    return reinterpret_cast<const Color*>(reinterpret_cast<const uint8_t*>(pSrc) + y * rowPitch);
+}
+
+// First row of a level of dstSize rows whose center lies at or below row pos of
+// the srcSize rows above it
+inline size_t FirstRowFrom(size_t pos, size_t srcSize, size_t dstSize)
+{
+    const size_t num = 2 * pos * dstSize;
+    if (num <= srcSize)
+        return 0;
+    return std::min(dstSize, (num - srcSize + 2 * srcSize - 1) / (2 * srcSize));
+}
+
+// Filters rows [yBegin, yEnd) of the next level, vertically into pAcc first so
+// every source texel is read once per output row
+template <typename Color>
+void FilterRows(HDRColorA *pDst, size_t dstWidth, size_t yBegin, size_t yEnd,
+    const Color *pSrc, size_t srcWidth, size_t rowPitch, bool bSRGB,
+    const FilterTaps& horz, const FilterTaps& vert, HDRColorA *pAcc)
+{
+    for (size_t y = yBegin; y < yEnd; ++y)
+    {
+        std::fill(pAcc, pAcc + srcWidth, HDRColorA(0.0f, 0.0f, 0.0f, 0.0f));
+        for (size_t k = vert.aFirst[y]; k < vert.aFirst[y + 1]; ++k)
+        {
+            const Color *pRow = GetRow(pSrc, rowPitch, vert.aIndex[k]);
+            const float w = vert.aWeight[k];
+            for (size_t x = 0; x < srcWidth; ++x)
+                pAcc[x] += ToLinear(pRow[x], bSRGB) * w;
+        }
+
+        HDRColorA *pOut = pDst + y * dstWidth;
+        for (size_t x = 0; x < dstWidth; ++x)
+        {
+            HDRColorA c(0.0f, 0.0f, 0.0f, 0.0f);
+            for (size_t k = horz.aFirst[x]; k < horz.aFirst[x + 1]; ++k)
+                c += pAcc[horz.aIndex[k]] * horz.aWeight[k];
+            pOut[x] = c;
+        }
+    }
+}
+
+// Levels past the top are kept as linear HDRColorA and converted back to Color
+// one block row at a time for the encoder
+template <typename Color>
+void EncodeMipChainImpl(BC_FORMAT format, const Color *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t mipLevels, uint8_t *const apDst[], MIP_FILTER filter,
+    uint32_t mipFlags, uint32_t flags, size_t threadCount)
+{
+    assert(pSrc && apDst);
+    assert(rowPitch >= width * sizeof(Color));
+
+    const size_t blockSize = GetBlockSize(format);
+    assert(blockSize);
+    if (!blockSize || width == 0 || height == 0)
+        return;
+
+    const size_t levels = mipLevels ? mipLevels : ComputeMipLevels(width, height);
+    assert(levels <= ComputeMipLevels(width, height));
+
+    const bool bSRGB = (mipFlags & MIP_FLAGS_SRGB) != 0;
+    const bool bWrap = (mipFlags & MIP_FLAGS_WRAP) != 0;
+
+    // Linear texels of the current and the next level
+    std::vector<HDRColorA> aLevels[2];
+
+    ThreadPool& pool = ThreadPool::GetShared();
+    for (size_t level = 0; level < levels; ++level)
+    {
+        const size_t w = std::max<size_t>(1, width >> level);
+        const size_t h = std::max<size_t>(1, height >> level);
+        const bool bNext = level + 1 < levels;
+        const size_t nextW = std::max<size_t>(1, w >> 1);
+        const size_t nextH = std::max<size_t>(1, h >> 1);
+
+        const HDRColorA *pLinear = aLevels[level & 1].data();
+        HDRColorA *pNext = nullptr;
+        if (bNext)
+        {
+            aLevels[(level + 1) & 1].resize(nextW * nextH);
+            pNext = aLevels[(level + 1) & 1].data();
+        }
+
+        const FilterTaps horz(filter, w, bNext ? nextW : 1, bWrap);
+        const FilterTaps vert(filter, h, bNext ? nextH : 1, bWrap);
+        const size_t blocksWide = (w + 3) / 4;
+        const size_t blocksHigh = (h + 3) / 4;
+
+        pool.ParallelFor(blocksHigh, 1, ThreadPool::ResolveThreadCount(threadCount),
+            [&](size_t uBegin, size_t uEnd)
+            {
+                std::vector<Color> aBand(level ? 4 * w : 0);
+                std::vector<HDRColorA> aAcc(bNext ? w : 0);
+
+                for (size_t by = uBegin; by < uEnd; ++by)
+                {
+                    const size_t y0 = by * 4;
+                    const size_t rows = std::min<size_t>(4, h - y0);
+                    uint8_t *pDst = apDst[level] + by * blocksWide * blockSize;
+
+                    // Nested on the pool, so these run on this thread
+                    if (level == 0)
+                    {
+                        EncodeSurface(format, GetRow(pSrc, rowPitch, y0), w, rows, rowPitch, pDst, flags, 1);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < rows * w; ++i)
+                            FromLinear(aBand[i], pLinear[y0 * w + i], bSRGB);
+                        EncodeSurface(format, aBand.data(), w, rows, w * sizeof(Color), pDst, flags, 1);
+                    }
+
+                    if (!bNext)
+                        continue;
+
+                    const size_t yBegin = FirstRowFrom(y0, h, nextH);
+                    const size_t yEnd = FirstRowFrom(y0 + 4, h, nextH);
+                    if (level == 0)
+                        FilterRows(pNext, nextW, yBegin, yEnd, pSrc, w, rowPitch, bSRGB, horz, vert, aAcc.data());
+                    else
+                        FilterRows(pNext, nextW, yBegin, yEnd, pLinear, w, w * sizeof(HDRColorA), false, horz, vert, aAcc.data());
+                }
+            });
+    }
+}
+
+}
+
+void EncodeMipChain(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t mipLevels, uint8_t *const apDst[], MIP_FILTER filter,
+    uint32_t mipFlags, uint32_t flags, size_t threadCount)
+{
+    EncodeMipChainImpl(format, pSrc, width, height, rowPitch, mipLevels, apDst, filter,
+        mipFlags, flags, threadCount);
+}
+
+void EncodeMipChain(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t mipLevels, uint8_t *const apDst[], MIP_FILTER filter,
+    uint32_t mipFlags, uint32_t flags, size_t threadCount)
+{
+    EncodeMipChainImpl(format, pSrc, width, height, rowPitch, mipLevels, apDst, filter,
+        mipFlags, flags, threadCount);
+}
+
+} // namespace
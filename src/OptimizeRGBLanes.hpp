@@ -0,0 +1,226 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <float.h>
+
+#include "BC.hpp"
+#include "BC123_shared.hpp"
+
+
+namespace Tex {
+
+// OptimizeRGB for V::WIDTH blocks at once, one block per lane. V wraps a float
+// vector type; comparisons return all-ones lane masks. Each lane runs exactly the
+// operations of the scalar version, lanes that finish early are masked off.
+template <class V>
+void OptimizeRGBLanes(HDRColorA *pX, HDRColorA *pY, const HDRColorA *const *ppPoints,
+    const size_t *pSteps, size_t nBlocks, uint32_t flags)
+{
+    typedef typename V::F F;
+    const size_t W = V::WIDTH;
+    assert(nBlocks > 0 && nBlocks <= W);
+
+    static const float fEpsilon = (0.25f / 64.0f) * (0.25f / 64.0f);
+    static const float pC3[] = { 2.0f / 2.0f, 1.0f / 2.0f, 0.0f / 2.0f, 0.0f / 2.0f };
+    static const float pD3[] = { 0.0f / 2.0f, 1.0f / 2.0f, 2.0f / 2.0f, 2.0f / 2.0f };
+    static const float pC4[] = { 3.0f / 3.0f, 2.0f / 3.0f, 1.0f / 3.0f, 0.0f / 3.0f };
+    static const float pD4[] = { 0.0f / 3.0f, 1.0f / 3.0f, 2.0f / 3.0f, 3.0f / 3.0f };
+
+    // Transpose the blocks, unused lanes repeat the first block. Three step lanes
+    // repeat their last weight in slot 3, which is then the clamp target for both.
+    alignas(32) float aR[NUM_PIXELS_PER_BLOCK][W];
+    alignas(32) float aG[NUM_PIXELS_PER_BLOCK][W];
+    alignas(32) float aB[NUM_PIXELS_PER_BLOCK][W];
+    alignas(32) float aC[4][W];
+    alignas(32) float aD[4][W];
+    alignas(32) float aSteps[W];
+
+    for (size_t l = 0; l < W; ++l)
+    {
+        const size_t uBlock = (l < nBlocks) ? l : 0;
+        const HDRColorA *pPoints = ppPoints[uBlock];
+        const size_t cSteps = pSteps[uBlock];
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            aR[i][l] = pPoints[i].r;
+            aG[i][l] = pPoints[i].g;
+            aB[i][l] = pPoints[i].b;
+        }
+        for (size_t k = 0; k < 4; ++k)
+        {
+            aC[k][l] = (3 == cSteps) ? pC3[k] : pC4[k];
+            aD[k][l] = (3 == cSteps) ? pD3[k] : pD4[k];
+        }
+        aSteps[l] = (float)(cSteps - 1);
+    }
+
+    const F zero = V::Zero();
+    const F all = V::CmpEQ(zero, zero);
+
+    // Find Min and Max points, as starting point
+    F Xr = V::Set1((flags & BC_FLAGS_UNIFORM) ? 1.f : g_Luminance.r);
+    F Xg = V::Set1((flags & BC_FLAGS_UNIFORM) ? 1.f : g_Luminance.g);
+    F Xb = V::Set1((flags & BC_FLAGS_UNIFORM) ? 1.f : g_Luminance.b);
+    F Yr = zero, Yg = zero, Yb = zero;
+
+    for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+    {
+        const F r = V::Load(aR[iPoint]), g = V::Load(aG[iPoint]), b = V::Load(aB[iPoint]);
+        Xr = V::Min(r, Xr); Xg = V::Min(g, Xg); Xb = V::Min(b, Xb);
+        Yr = V::Max(r, Yr); Yg = V::Max(g, Yg); Yb = V::Max(b, Yb);
+    }
+
+    // Diagonal axis
+    const F ABr = V::Sub(Yr, Xr), ABg = V::Sub(Yg, Xg), ABb = V::Sub(Yb, Xb);
+    const F fAB = V::Add(V::Add(V::Mul(ABr, ABr), V::Mul(ABg, ABg)), V::Mul(ABb, ABb));
+
+    // Single color lanes are done
+    F active = V::AndNot(V::CmpLT(fAB, V::Set1(FLT_MIN)), all);
+
+    if (V::MoveMask(active))
+    {
+        // Try all four axis directions, to determine which diagonal best fits data
+        const F fABInv = V::Div(V::Set1(1.0f), fAB);
+        const F Dr = V::Mul(ABr, fABInv), Dg = V::Mul(ABg, fABInv), Db = V::Mul(ABb, fABInv);
+        const F half = V::Set1(0.5f);
+        const F Mr = V::Mul(V::Add(Xr, Yr), half), Mg = V::Mul(V::Add(Xg, Yg), half), Mb = V::Mul(V::Add(Xb, Yb), half);
+
+        F fDir0 = zero, fDir1 = zero, fDir2 = zero, fDir3 = zero;
+        for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+        {
+            const F Ptr = V::Mul(V::Sub(V::Load(aR[iPoint]), Mr), Dr);
+            const F Ptg = V::Mul(V::Sub(V::Load(aG[iPoint]), Mg), Dg);
+            const F Ptb = V::Mul(V::Sub(V::Load(aB[iPoint]), Mb), Db);
+
+            const F fSum = V::Add(Ptr, Ptg), fDiff = V::Sub(Ptr, Ptg);
+            F f;
+            f = V::Add(fSum, Ptb);  fDir0 = V::Add(fDir0, V::Mul(f, f));
+            f = V::Sub(fSum, Ptb);  fDir1 = V::Add(fDir1, V::Mul(f, f));
+            f = V::Add(fDiff, Ptb); fDir2 = V::Add(fDir2, V::Mul(f, f));
+            f = V::Sub(fDiff, Ptb); fDir3 = V::Add(fDir3, V::Mul(f, f));
+        }
+
+        // Bit 1 of the winning direction swaps green, bit 0 swaps blue
+        F fDirMax = fDir0, bSwapG = zero, bSwapB = zero, gt;
+        gt = V::CmpGT(fDir1, fDirMax); fDirMax = V::Select(fDirMax, fDir1, gt);
+        bSwapG = V::AndNot(gt, bSwapG); bSwapB = V::Or(bSwapB, gt);
+        gt = V::CmpGT(fDir2, fDirMax); fDirMax = V::Select(fDirMax, fDir2, gt);
+        bSwapG = V::Or(bSwapG, gt); bSwapB = V::AndNot(gt, bSwapB);
+        gt = V::CmpGT(fDir3, fDirMax);
+        bSwapG = V::Or(bSwapG, gt); bSwapB = V::Or(bSwapB, gt);
+
+        bSwapG = V::And(bSwapG, active);
+        bSwapB = V::And(bSwapB, active);
+        F t;
+        t = Xg; Xg = V::Select(Xg, Yg, bSwapG); Yg = V::Select(Yg, t, bSwapG);
+        t = Xb; Xb = V::Select(Xb, Yb, bSwapB); Yb = V::Select(Yb, t, bSwapB);
+
+        // Two color lanes are done
+        active = V::AndNot(V::CmpLT(fAB, V::Set1(1.0f / 4096.0f)), active);
+
+        // Use Newton's Method to find local minima of sum-of-squares error.
+        const F fSteps = V::Load(aSteps);
+        F C[4], D[4];
+        for (size_t k = 0; k < 4; ++k)
+        {
+            C[k] = V::Load(aC[k]);
+            D[k] = V::Load(aD[k]);
+        }
+
+        for (size_t iIteration = 0; iIteration < 8 && V::MoveMask(active); iIteration++)
+        {
+            // Calculate new steps
+            F Sr[4], Sg[4], Sb[4];
+            for (size_t k = 0; k < 4; ++k)
+            {
+                Sr[k] = V::Add(V::Mul(Xr, C[k]), V::Mul(Yr, D[k]));
+                Sg[k] = V::Add(V::Mul(Xg, C[k]), V::Mul(Yg, D[k]));
+                Sb[k] = V::Add(V::Mul(Xb, C[k]), V::Mul(Yb, D[k]));
+            }
+
+            // Calculate color direction
+            F Vr = V::Sub(Yr, Xr), Vg = V::Sub(Yg, Xg), Vb = V::Sub(Yb, Xb);
+            const F fLen = V::Add(V::Add(V::Mul(Vr, Vr), V::Mul(Vg, Vg)), V::Mul(Vb, Vb));
+
+            active = V::AndNot(V::CmpLT(fLen, V::Set1(1.0f / 4096.0f)), active);
+            if (!V::MoveMask(active))
+                break;
+
+            const F fScale = V::Div(fSteps, fLen);
+            Vr = V::Mul(Vr, fScale); Vg = V::Mul(Vg, fScale); Vb = V::Mul(Vb, fScale);
+
+            // Evaluate function, and derivatives
+            F d2X = zero, d2Y = zero;
+            F dXr = zero, dXg = zero, dXb = zero, dYr = zero, dYg = zero, dYb = zero;
+            const F eighth = V::Set1(1.0f / 8.0f);
+
+            for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+            {
+                const F r = V::Load(aR[iPoint]), g = V::Load(aG[iPoint]), b = V::Load(aB[iPoint]);
+                const F fDot = V::Add(V::Add(V::Mul(V::Sub(r, Xr), Vr), V::Mul(V::Sub(g, Xg), Vg)),
+                    V::Mul(V::Sub(b, Xb), Vb));
+
+                // Rounded step as a chain of selects, clamped steps select slot 3
+                const F bClamp = V::CmpGE(fDot, fSteps);
+                const F fRound = V::Add(fDot, half);
+                F m, Cs = C[0], Ds = D[0], Pr = Sr[0], Pg = Sg[0], Pb = Sb[0];
+                for (size_t k = 1; k < 4; ++k)
+                {
+                    m = V::Or(V::CmpGE(fRound, V::Set1((float)k)), bClamp);
+                    Cs = V::Select(Cs, C[k], m);
+                    Ds = V::Select(Ds, D[k], m);
+                    Pr = V::Select(Pr, Sr[k], m);
+                    Pg = V::Select(Pg, Sg[k], m);
+                    Pb = V::Select(Pb, Sb[k], m);
+                }
+
+                const F Diffr = V::Sub(Pr, r), Diffg = V::Sub(Pg, g), Diffb = V::Sub(Pb, b);
+                const F fC = V::Mul(Cs, eighth);
+                const F fD = V::Mul(Ds, eighth);
+
+                d2X = V::Add(d2X, V::Mul(fC, Cs));
+                dXr = V::Add(dXr, V::Mul(fC, Diffr));
+                dXg = V::Add(dXg, V::Mul(fC, Diffg));
+                dXb = V::Add(dXb, V::Mul(fC, Diffb));
+
+                d2Y = V::Add(d2Y, V::Mul(fD, Ds));
+                dYr = V::Add(dYr, V::Mul(fD, Diffr));
+                dYg = V::Add(dYg, V::Mul(fD, Diffg));
+                dYb = V::Add(dYb, V::Mul(fD, Diffb));
+            }
+
+            // Move endpoints
+            const F fMinusOne = V::Set1(-1.0f);
+            const F bMoveX = V::And(V::CmpGT(d2X, zero), active);
+            const F fX = V::Div(fMinusOne, d2X);
+            Xr = V::Select(Xr, V::Add(Xr, V::Mul(dXr, fX)), bMoveX);
+            Xg = V::Select(Xg, V::Add(Xg, V::Mul(dXg, fX)), bMoveX);
+            Xb = V::Select(Xb, V::Add(Xb, V::Mul(dXb, fX)), bMoveX);
+
+            const F bMoveY = V::And(V::CmpGT(d2Y, zero), active);
+            const F fY = V::Div(fMinusOne, d2Y);
+            Yr = V::Select(Yr, V::Add(Yr, V::Mul(dYr, fY)), bMoveY);
+            Yg = V::Select(Yg, V::Add(Yg, V::Mul(dYg, fY)), bMoveY);
+            Yb = V::Select(Yb, V::Add(Yb, V::Mul(dYb, fY)), bMoveY);
+
+            const F eps = V::Set1(fEpsilon);
+            F bConverged = V::And(V::CmpLT(V::Mul(dXr, dXr), eps), V::CmpLT(V::Mul(dXg, dXg), eps));
+            bConverged = V::And(bConverged, V::CmpLT(V::Mul(dXb, dXb), eps));
+            bConverged = V::And(bConverged, V::CmpLT(V::Mul(dYr, dYr), eps));
+            bConverged = V::And(bConverged, V::CmpLT(V::Mul(dYg, dYg), eps));
+            bConverged = V::And(bConverged, V::CmpLT(V::Mul(dYb, dYb), eps));
+            active = V::AndNot(bConverged, active);
+        }
+    }
+
+    alignas(32) float aOut[6][W];
+    V::Store(aOut[0], Xr); V::Store(aOut[1], Xg); V::Store(aOut[2], Xb);
+    V::Store(aOut[3], Yr); V::Store(aOut[4], Yg); V::Store(aOut[5], Yb);
+    for (size_t l = 0; l < nBlocks; ++l)
+    {
+        pX[l].r = aOut[0][l]; pX[l].g = aOut[1][l]; pX[l].b = aOut[2][l];
+        pY[l].r = aOut[3][l]; pY[l].g = aOut[4][l]; pY[l].b = aOut[5][l];
+    }
+}
+
+} // namespace
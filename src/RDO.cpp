@@ -0,0 +1,432 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+
+#include "Surface.hpp"
+#include "Colors.hpp"
+#include "ThreadPool.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+//-------------------------------------------------------------------------------------
+// Rate-distortion post-pass
+//
+// Blocks are revisited in raster order and may be rewritten to repeat bytes of
+// one of the RDO_WINDOW blocks before them, which an LZ coder then stores as a
+// short match. Every candidate is scored as J = D + lambda * R, D being the
+// squared error of the decoded block against the source in 8-bit units and R an
+// estimate of the bits the coder spends on it: 8 per literal byte, RDO_MATCH_BITS
+// per run of bytes found in the window.
+//
+// BC1 blocks and the color and alpha halves of BC3 blocks are units of endpoint
+// bytes followed by index bytes. A unit may be copied whole from the window, may
+// take the endpoints of a window block with indices refitted to the source, or
+// may keep its endpoints and take the indices of a window block. BC7 blocks may
+// be copied whole, or take the header and endpoints or the index bits of a window
+// block of the same mode and partition.
+//
+// The surface is split in chunks of RDO_CHUNK blocks whose windows do not reach
+// into the chunk before, so chunks run in parallel and the result does not depend
+// on the thread count.
+//-------------------------------------------------------------------------------------
+
+const size_t RDO_WINDOW = 64;
+const size_t RDO_CHUNK = 1024;
+const uint32_t RDO_MATCH_BITS = 16;
+
+inline uint8_t ToUNorm8(float f)
+{
+    return static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, f)) * 255.0f + 0.5f);
+}
+
+inline LDRColorA ToLDR(const LDRColorA& c)
+{
+    return c;
+}
+
+inline LDRColorA ToLDR(const HDRColorA& c)
+{
+    return LDRColorA(ToUNorm8(c.r), ToUNorm8(c.g), ToUNorm8(c.b), ToUNorm8(c.a));
+}
+
+template <typename Color>
+void GatherBlock(LDRColorA aBlock[], const Color *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t bx, size_t by)
+{
+    for (size_t y = 0; y < 4; ++y)
+    {
+        const size_t sy = std::min(by * 4 + y, height - 1);
+        auto pRow = reinterpret_cast<const Color *>(reinterpret_cast<const uint8_t *>(pSrc) + sy * rowPitch);
+        for (size_t x = 0; x < 4; ++x)
+            aBlock[y * 4 + x] = ToLDR(pRow[std::min(bx * 4 + x, width - 1)]);
+    }
+}
+
+inline uint32_t TexelError(const LDRColorA& a, const LDRColorA& b)
+{
+    const int dr = int(a.r) - int(b.r);
+    const int dg = int(a.g) - int(b.g);
+    const int db = int(a.b) - int(b.b);
+    const int da = int(a.a) - int(b.a);
+    return uint32_t(dr * dr + dg * dg + db * db + da * da);
+}
+
+uint32_t BlockError(BC_FORMAT format, const uint8_t *pBC, const LDRColorA aSrc[])
+{
+    LDRColorA aDecoded[NUM_PIXELS_PER_BLOCK];
+    switch (format)
+    {
+    case BC_FORMAT_BC1: DecodeBC1(aDecoded, pBC); break;
+    case BC_FORMAT_BC3: DecodeBC3(aDecoded, pBC); break;
+    default:            DecodeBC7(aDecoded, pBC); break;
+    }
+
+    uint32_t error = 0;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        error += TexelError(aDecoded[i], aSrc[i]);
+    return error;
+}
+
+// Best candidate of a block so far
+struct Choice
+{
+    uint8_t aBlock[16];
+    float cost;
+};
+
+inline void Consider(Choice& best, BC_FORMAT format, const uint8_t *pCandidate, size_t blockSize,
+    const LDRColorA aSrc[], uint32_t bits, float lambda)
+{
+    const float cost = float(BlockError(format, pCandidate, aSrc)) + lambda * float(bits);
+    if (cost < best.cost)
+    {
+        memcpy(best.aBlock, pCandidate, blockSize);
+        best.cost = cost;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// BC1/BC3 units
+//-------------------------------------------------------------------------------------
+
+struct UnitLayout
+{
+    size_t uOffset;             // Of the unit within the block
+    size_t nEndpointBytes;
+    size_t nIndexBits;          // Per texel
+    size_t nPalette;
+    bool bAlpha;                // Indices select alphas
+};
+
+const UnitLayout g_ColorUnitBC1 = { 0, 4, 2, 4, false };
+const UnitLayout g_AlphaUnitBC3 = { 0, 2, 3, 8, true };
+const UnitLayout g_ColorUnitBC3 = { 8, 4, 2, 4, false };
+
+inline uint64_t LoadIndices(const uint8_t *pUnit, const UnitLayout& unit)
+{
+    uint64_t v = 0;
+    for (size_t i = unit.nEndpointBytes; i < 8; ++i)
+        v |= uint64_t(pUnit[i]) << (8 * (i - unit.nEndpointBytes));
+    return v;
+}
+
+inline void StoreIndices(uint8_t *pUnit, const UnitLayout& unit, uint64_t v)
+{
+    for (size_t i = unit.nEndpointBytes; i < 8; ++i)
+        pUnit[i] = uint8_t(v >> (8 * (i - unit.nEndpointBytes)));
+}
+
+// Picks the palette entry closest to every source texel for the endpoints the
+// unit holds. The palette is read back by decoding texel k with index k.
+void RefitIndices(BC_FORMAT format, uint8_t *pBC, const UnitLayout& unit, const LDRColorA aSrc[])
+{
+    uint8_t *pUnit = pBC + unit.uOffset;
+    uint64_t ramp = 0;
+    for (size_t k = 0; k < unit.nPalette; ++k)
+        ramp |= uint64_t(k) << (k * unit.nIndexBits);
+    StoreIndices(pUnit, unit, ramp);
+
+    LDRColorA aDecoded[NUM_PIXELS_PER_BLOCK];
+    if (format == BC_FORMAT_BC1)
+        DecodeBC1(aDecoded, pBC);
+    else
+        DecodeBC3(aDecoded, pBC);
+
+    uint64_t indices = 0;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        size_t uBest = 0;
+        uint32_t bestError = UINT32_MAX;
+        for (size_t k = 0; k < unit.nPalette; ++k)
+        {
+            uint32_t error;
+            if (unit.bAlpha)
+            {
+                const int da = int(aDecoded[k].a) - int(aSrc[i].a);
+                error = uint32_t(da * da);
+            }
+            else
+            {
+                LDRColorA c = aDecoded[k];
+                if (format != BC_FORMAT_BC1)
+                    c.a = aSrc[i].a;
+                error = TexelError(c, aSrc[i]);
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                uBest = k;
+            }
+        }
+        indices |= uint64_t(uBest) << (i * unit.nIndexBits);
+    }
+    StoreIndices(pUnit, unit, indices);
+}
+
+// Bits an LZ coder spends on the unit given the window before it
+uint32_t UnitBits(const uint8_t *pUnit, const UnitLayout& unit, const uint8_t *pWindow,
+    size_t nWindow, size_t blockSize)
+{
+    bool bEndpoints = false;
+    bool bIndices = false;
+    for (size_t j = 0; j < nWindow; ++j)
+    {
+        const uint8_t *pOther = pWindow + j * blockSize + unit.uOffset;
+        const bool bSameEndpoints = memcmp(pUnit, pOther, unit.nEndpointBytes) == 0;
+        const bool bSameIndices = memcmp(pUnit + unit.nEndpointBytes, pOther + unit.nEndpointBytes,
+            8 - unit.nEndpointBytes) == 0;
+        if (bSameEndpoints && bSameIndices)
+            return RDO_MATCH_BITS;
+        bEndpoints |= bSameEndpoints;
+        bIndices |= bSameIndices;
+    }
+
+    return (bEndpoints ? RDO_MATCH_BITS : uint32_t(8 * unit.nEndpointBytes))
+        + (bIndices ? RDO_MATCH_BITS : uint32_t(8 * (8 - unit.nEndpointBytes)));
+}
+
+void OptimizeUnit(BC_FORMAT format, uint8_t *pBC, size_t blockSize, const UnitLayout& unit,
+    const uint8_t *pWindow, size_t nWindow, const LDRColorA aSrc[], float lambda)
+{
+    Choice best;
+    memcpy(best.aBlock, pBC, blockSize);
+    best.cost = float(BlockError(format, pBC, aSrc))
+        + lambda * float(UnitBits(pBC + unit.uOffset, unit, pWindow, nWindow, blockSize));
+
+    uint8_t aCandidate[16];
+    for (size_t j = 0; j < nWindow; ++j)
+    {
+        const uint8_t *pOther = pWindow + j * blockSize + unit.uOffset;
+        uint8_t *pUnit = aCandidate + unit.uOffset;
+
+        // The whole unit
+        memcpy(aCandidate, pBC, blockSize);
+        memcpy(pUnit, pOther, 8);
+        Consider(best, format, aCandidate, blockSize, aSrc,
+            UnitBits(pUnit, unit, pWindow, nWindow, blockSize), lambda);
+
+        // Its endpoints with refitted indices
+        RefitIndices(format, aCandidate, unit, aSrc);
+        Consider(best, format, aCandidate, blockSize, aSrc,
+            UnitBits(pUnit, unit, pWindow, nWindow, blockSize), lambda);
+
+        // Its indices with our endpoints
+        memcpy(aCandidate, pBC, blockSize);
+        StoreIndices(pUnit, unit, LoadIndices(pOther, unit));
+        Consider(best, format, aCandidate, blockSize, aSrc,
+            UnitBits(pUnit, unit, pWindow, nWindow, blockSize), lambda);
+    }
+
+    memcpy(pBC, best.aBlock, blockSize);
+}
+
+//-------------------------------------------------------------------------------------
+// BC7 blocks
+//-------------------------------------------------------------------------------------
+
+struct ModeLayoutBC7
+{
+    size_t nModeBits;
+    size_t nPartitionBits;      // Follow the mode bits
+    size_t nIndexBits;          // At the end of the block
+};
+
+const ModeLayoutBC7 g_aModesBC7[8] =
+{
+    { 1, 4, 45 },
+    { 2, 6, 46 },
+    { 3, 6, 29 },
+    { 4, 6, 30 },
+    { 5, 0, 78 },
+    { 6, 0, 62 },
+    { 7, 0, 63 },
+    { 8, 6, 30 },
+};
+
+// Mode of a BC7 block, 8 for the reserved mode
+inline size_t GetModeBC7(const uint8_t *pBC)
+{
+    for (size_t uMode = 0; uMode < 8; ++uMode)
+    {
+        if (pBC[0] & (1 << uMode))
+            return uMode;
+    }
+    return 8;
+}
+
+// Whether two blocks share mode and partition, so their index bits mean the same
+inline bool SameLayoutBC7(const uint8_t *pA, const uint8_t *pB, size_t uMode)
+{
+    const size_t nBits = g_aModesBC7[uMode].nModeBits + g_aModesBC7[uMode].nPartitionBits;
+    const uint16_t mask = uint16_t((1u << nBits) - 1);
+    const uint16_t a = uint16_t(pA[0] | (pA[1] << 8));
+    const uint16_t b = uint16_t(pB[0] | (pB[1] << 8));
+    return GetModeBC7(pB) == uMode && ((a ^ b) & mask) == 0;
+}
+
+// Copies bits [uBegin, 128) of pSrc over pDst
+inline void CopyTailBits(uint8_t *pDst, const uint8_t *pSrc, size_t uBegin)
+{
+    const size_t uByte = uBegin / 8;
+    const uint8_t mask = uint8_t(0xff << (uBegin % 8));
+    pDst[uByte] = uint8_t((pDst[uByte] & ~mask) | (pSrc[uByte] & mask));
+    memcpy(pDst + uByte + 1, pSrc + uByte + 1, 15 - uByte);
+}
+
+inline bool SameTailBits(const uint8_t *pA, const uint8_t *pB, size_t uBegin)
+{
+    const size_t uByte = uBegin / 8;
+    const uint8_t mask = uint8_t(0xff << (uBegin % 8));
+    return ((pA[uByte] ^ pB[uByte]) & mask) == 0 && memcmp(pA + uByte + 1, pB + uByte + 1, 15 - uByte) == 0;
+}
+
+uint32_t BlockBitsBC7(const uint8_t *pBC, const uint8_t *pWindow, size_t nWindow)
+{
+    const size_t uMode = GetModeBC7(pBC);
+    if (uMode == 8)
+        return 128;
+
+    const size_t uIndexStart = 128 - g_aModesBC7[uMode].nIndexBits;
+    bool bHeader = false;
+    bool bIndices = false;
+    for (size_t j = 0; j < nWindow; ++j)
+    {
+        const uint8_t *pOther = pWindow + j * 16;
+        if (memcmp(pBC, pOther, 16) == 0)
+            return RDO_MATCH_BITS;
+        if (!SameLayoutBC7(pBC, pOther, uMode))
+            continue;
+
+        bIndices |= SameTailBits(pBC, pOther, uIndexStart);
+        uint8_t aHeader[16];
+        memcpy(aHeader, pOther, 16);
+        CopyTailBits(aHeader, pBC, uIndexStart);
+        bHeader |= memcmp(aHeader, pBC, 16) == 0;
+    }
+
+    return (bHeader ? RDO_MATCH_BITS : uint32_t(uIndexStart))
+        + (bIndices ? RDO_MATCH_BITS : uint32_t(128 - uIndexStart));
+}
+
+void OptimizeBlockBC7(uint8_t *pBC, const uint8_t *pWindow, size_t nWindow, const LDRColorA aSrc[],
+    float lambda)
+{
+    Choice best;
+    memcpy(best.aBlock, pBC, 16);
+    best.cost = float(BlockError(BC_FORMAT_BC7, pBC, aSrc)) + lambda * float(BlockBitsBC7(pBC, pWindow, nWindow));
+
+    const size_t uMode = GetModeBC7(pBC);
+    uint8_t aCandidate[16];
+    for (size_t j = 0; j < nWindow; ++j)
+    {
+        const uint8_t *pOther = pWindow + j * 16;
+        Consider(best, BC_FORMAT_BC7, pOther, 16, aSrc, RDO_MATCH_BITS, lambda);
+
+        if (uMode == 8 || !SameLayoutBC7(pBC, pOther, uMode))
+            continue;
+
+        const size_t uIndexStart = 128 - g_aModesBC7[uMode].nIndexBits;
+
+        // Its header and endpoints with our indices
+        memcpy(aCandidate, pOther, 16);
+        CopyTailBits(aCandidate, pBC, uIndexStart);
+        Consider(best, BC_FORMAT_BC7, aCandidate, 16, aSrc, BlockBitsBC7(aCandidate, pWindow, nWindow), lambda);
+
+        // Our header and endpoints with its indices
+        memcpy(aCandidate, pBC, 16);
+        CopyTailBits(aCandidate, pOther, uIndexStart);
+        Consider(best, BC_FORMAT_BC7, aCandidate, 16, aSrc, BlockBitsBC7(aCandidate, pWindow, nWindow), lambda);
+    }
+
+    memcpy(pBC, best.aBlock, 16);
+}
+
+template <typename Color>
+void OptimizeSurfaceRDOImpl(BC_FORMAT format, const Color *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, float lambda, size_t threadCount)
+{
+    assert(pSrc && pBlocks);
+    assert(rowPitch >= width * sizeof(Color));
+    if ((format != BC_FORMAT_BC1 && format != BC_FORMAT_BC3 && format != BC_FORMAT_BC7)
+        || width == 0 || height == 0 || !(lambda > 0.0f))
+        return;
+
+    const size_t blockSize = GetBlockSize(format);
+    const size_t blocksWide = (width + 3) / 4;
+    const size_t nBlocks = blocksWide * ((height + 3) / 4);
+    const size_t nChunks = (nBlocks + RDO_CHUNK - 1) / RDO_CHUNK;
+
+    ThreadPool::GetShared().ParallelFor(nChunks, 1, ThreadPool::ResolveThreadCount(threadCount),
+        [&](size_t uBegin, size_t uEnd)
+        {
+            LDRColorA aSrc[NUM_PIXELS_PER_BLOCK];
+            for (size_t uChunk = uBegin; uChunk < uEnd; ++uChunk)
+            {
+                const size_t uFirst = uChunk * RDO_CHUNK;
+                const size_t uLast = std::min(nBlocks, uFirst + RDO_CHUNK);
+                for (size_t i = uFirst; i < uLast; ++i)
+                {
+                    const size_t nWindow = std::min(RDO_WINDOW, i - uFirst);
+                    uint8_t *pBC = pBlocks + i * blockSize;
+                    const uint8_t *pWindow = pBC - nWindow * blockSize;
+                    GatherBlock(aSrc, pSrc, width, height, rowPitch, i % blocksWide, i / blocksWide);
+
+                    switch (format)
+                    {
+                    case BC_FORMAT_BC1:
+                        OptimizeUnit(format, pBC, blockSize, g_ColorUnitBC1, pWindow, nWindow, aSrc, lambda);
+                        break;
+                    case BC_FORMAT_BC3:
+                        OptimizeUnit(format, pBC, blockSize, g_AlphaUnitBC3, pWindow, nWindow, aSrc, lambda);
+                        OptimizeUnit(format, pBC, blockSize, g_ColorUnitBC3, pWindow, nWindow, aSrc, lambda);
+                        break;
+                    default:
+                        OptimizeBlockBC7(pBC, pWindow, nWindow, aSrc, lambda);
+                        break;
+                    }
+                }
+            }
+        });
+}
+
+}
+
+void OptimizeSurfaceRDO(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, float lambda, size_t threadCount)
+{
+    OptimizeSurfaceRDOImpl(format, pSrc, width, height, rowPitch, pBlocks, lambda, threadCount);
+}
+
+void OptimizeSurfaceRDO(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, float lambda, size_t threadCount)
+{
+    OptimizeSurfaceRDOImpl(format, pSrc, width, height, rowPitch, pBlocks, lambda, threadCount);
+}
+
+} // namespace
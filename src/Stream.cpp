@@ -0,0 +1,184 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Stream.hpp"
+#include "Colors.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Band buffers cycle from the free list to the caller, which fills them, to the
+// ready queue and back through the encoder thread. Only the fill position is
+// touched by the caller alone, everything else is guarded by the mutex.
+//-------------------------------------------------------------------------------------
+
+template <typename Color>
+struct StreamEncoder<Color>::State
+{
+    struct Band
+    {
+        std::vector<Color> aTexels;
+        size_t rows;
+        size_t index;
+    };
+
+    BC_FORMAT format;
+    size_t width;
+    uint32_t flags;
+    BC_BAND_SINK sink;
+    size_t threadCount;
+
+    std::vector<Band> aBands;
+    std::deque<size_t> freeBands;
+    std::deque<size_t> readyBands;
+    size_t uFilling;
+    size_t uNextBand;
+    bool bFinishing;
+    bool bFinished;
+
+    std::mutex mutex;
+    std::condition_variable freeCV;
+    std::condition_variable readyCV;
+    std::thread encoder;
+
+    void EncoderMain();
+    void Submit(size_t uBand);
+};
+
+template <typename Color>
+void StreamEncoder<Color>::State::EncoderMain()
+{
+    std::vector<uint8_t> aBlocks(ComputeSurfaceSize(format, width, 4));
+    for (;;)
+    {
+        size_t uBand;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyCV.wait(lock, [this]() { return !readyBands.empty() || bFinishing; });
+            if (readyBands.empty())
+                return;
+            uBand = readyBands.front();
+            readyBands.pop_front();
+        }
+
+        Band& band = aBands[uBand];
+        EncodeSurface(format, band.aTexels.data(), width, band.rows, width * sizeof(Color),
+            aBlocks.data(), flags, threadCount);
+        sink(band.index, aBlocks.data(), aBlocks.size());
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBands.push_back(uBand);
+        }
+        freeCV.notify_one();
+    }
+}
+
+template <typename Color>
+void StreamEncoder<Color>::State::Submit(size_t uBand)
+{
+    aBands[uBand].index = uNextBand++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readyBands.push_back(uBand);
+    }
+    readyCV.notify_one();
+    uFilling = SIZE_MAX;
+}
+
+template <typename Color>
+StreamEncoder<Color>::StreamEncoder(BC_FORMAT format, size_t width, uint32_t flags,
+    const BC_BAND_SINK& sink, size_t threadCount, size_t maxBands)
+    : m_pState(new State)
+{
+    assert(GetBlockSize(format) && width > 0 && sink);
+
+    State& s = *m_pState;
+    s.format = format;
+    s.width = width;
+    s.flags = flags;
+    s.sink = sink;
+    s.threadCount = threadCount;
+
+    // One band is filled while another one is encoded
+    s.aBands.resize(std::max<size_t>(maxBands, 2));
+    for (size_t i = 0; i < s.aBands.size(); ++i)
+    {
+        s.aBands[i].aTexels.resize(4 * width);
+        s.aBands[i].rows = 0;
+        s.aBands[i].index = 0;
+        s.freeBands.push_back(i);
+    }
+
+    s.uFilling = SIZE_MAX;
+    s.uNextBand = 0;
+    s.bFinishing = false;
+    s.bFinished = false;
+    s.encoder = std::thread(&State::EncoderMain, &s);
+}
+
+template <typename Color>
+StreamEncoder<Color>::~StreamEncoder()
+{
+    Finish();
+}
+
+template <typename Color>
+void StreamEncoder<Color>::AddRows(const Color *pSrc, size_t rows, size_t rowPitch)
+{
+    State& s = *m_pState;
+    assert(!s.bFinished);
+    assert(pSrc || rows == 0);
+    assert(rowPitch >= s.width * sizeof(Color) || rows <= 1);
+
+    const uint8_t *pRow = reinterpret_cast<const uint8_t*>(pSrc);
+    for (size_t y = 0; y < rows; ++y, pRow += rowPitch)
+    {
+        if (s.uFilling == SIZE_MAX)
+        {
+            std::unique_lock<std::mutex> lock(s.mutex);
+            s.freeCV.wait(lock, [&s]() { return !s.freeBands.empty(); });
+            s.uFilling = s.freeBands.front();
+            s.freeBands.pop_front();
+            s.aBands[s.uFilling].rows = 0;
+        }
+
+        typename State::Band& band = s.aBands[s.uFilling];
+        memcpy(band.aTexels.data() + band.rows * s.width, pRow, s.width * sizeof(Color));
+        if (++band.rows == 4)
+            s.Submit(s.uFilling);
+    }
+}
+
+template <typename Color>
+void StreamEncoder<Color>::Finish()
+{
+    State& s = *m_pState;
+    if (s.bFinished)
+        return;
+
+    if (s.uFilling != SIZE_MAX && s.aBands[s.uFilling].rows > 0)
+        s.Submit(s.uFilling);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.bFinishing = true;
+    }
+    s.readyCV.notify_one();
+    s.encoder.join();
+    s.bFinished = true;
+}
+
+template class StreamEncoder<HDRColorA>;
+template class StreamEncoder<LDRColorA>;
+
+} // namespace
@@ -0,0 +1,1027 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "BC.hpp"
+#include "BC123_shared.hpp"
+#include "BC45_shared.hpp"
+#include "BC45_simd.hpp"
+#include "Surface.hpp"
+#include "Async.hpp"
+#include "AsyncJob.hpp"
+#include "Colors.hpp"
+#include "ThreadPool.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+BC_ENCODE GetEncoder(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return EncodeBC1;
+    case BC_FORMAT_BC2: return EncodeBC2;
+    case BC_FORMAT_BC3: return EncodeBC3;
+    case BC_FORMAT_BC4U: return EncodeBC4U;
+    case BC_FORMAT_BC4S: return EncodeBC4S;
+    case BC_FORMAT_BC5U: return EncodeBC5U;
+    case BC_FORMAT_BC5S: return EncodeBC5S;
+    case BC_FORMAT_BC6HU: return EncodeBC6HU;
+    case BC_FORMAT_BC6HS: return EncodeBC6HS;
+    case BC_FORMAT_BC7: return EncodeBC7;
+    default: return nullptr;
+    }
+}
+
+BC_ENCODE_LDR GetEncoderLDR(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return EncodeBC1;
+    case BC_FORMAT_BC2: return EncodeBC2;
+    case BC_FORMAT_BC3: return EncodeBC3;
+    case BC_FORMAT_BC7: return EncodeBC7;
+    default: return nullptr;
+    }
+}
+
+typedef void (*BC_ENCODE_BLOCKS)(uint8_t *pBC, const HDRColorA *pColor, size_t nBlocks, uint32_t flags);
+typedef void (*BC_ENCODE_BLOCKS_LDR)(uint8_t *pBC, const LDRColorA *pColor, size_t nBlocks, uint32_t flags);
+
+// Formats that encode several blocks per call faster than one at a time
+BC_ENCODE_BLOCKS GetBlockEncoder(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return EncodeBC1Blocks;
+    case BC_FORMAT_BC2: return EncodeBC2Blocks;
+    case BC_FORMAT_BC3: return EncodeBC3Blocks;
+    case BC_FORMAT_BC4U: return EncodeBC4UBlocks;
+    case BC_FORMAT_BC4S: return EncodeBC4SBlocks;
+    case BC_FORMAT_BC5U: return EncodeBC5UBlocks;
+    case BC_FORMAT_BC5S: return EncodeBC5SBlocks;
+    default: return nullptr;
+    }
+}
+
+BC_ENCODE_BLOCKS_LDR GetBlockEncoderLDR(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return EncodeBC1Blocks;
+    case BC_FORMAT_BC2: return EncodeBC2Blocks;
+    case BC_FORMAT_BC3: return EncodeBC3Blocks;
+    default: return nullptr;
+    }
+}
+
+BC_DECODE GetDecoder(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return DecodeBC1;
+    case BC_FORMAT_BC2: return DecodeBC2;
+    case BC_FORMAT_BC3: return DecodeBC3;
+    case BC_FORMAT_BC4U: return DecodeBC4U;
+    case BC_FORMAT_BC4S: return DecodeBC4S;
+    case BC_FORMAT_BC5U: return DecodeBC5U;
+    case BC_FORMAT_BC5S: return DecodeBC5S;
+    case BC_FORMAT_BC6HU: return DecodeBC6HU;
+    case BC_FORMAT_BC6HS: return DecodeBC6HS;
+    case BC_FORMAT_BC7: return DecodeBC7;
+    default: return nullptr;
+    }
+}
+
+// Decoding is cheap enough that per item overhead dominates below a few hundred blocks
+const size_t DECODE_GRAIN = 256;
+
+// Blocks handed out per work item. BC6H/BC7 blocks cost milliseconds each, so
+// small grains keep the tail short; the cheap formats want bigger batches.
+size_t GetGrain(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC6HU:
+    case BC_FORMAT_BC6HS:
+    case BC_FORMAT_BC7:
+        return 4;
+    default:
+        return 64;
+    }
+}
+
+// Runs the range functions of one call, on the shared pool or, for the Async entry
+// points, as tasks of the caller's job system. The functions must not refer to the
+// caller's stack, async tasks outlive the call.
+class Dispatch
+{
+public:
+    explicit Dispatch(size_t threadCount) :
+        m_threadCount(threadCount),
+        m_pSubmitter(nullptr),
+        m_pOnComplete(nullptr),
+        m_bStarted(false)
+    {
+    }
+
+    Dispatch(const BC_TASK_SUBMITTER& submitter, const BC_ASYNC_CALLBACK& onComplete) :
+        m_threadCount(0),
+        m_pSubmitter(&submitter),
+        m_pOnComplete(&onComplete),
+        m_bStarted(false)
+    {
+    }
+
+    bool IsAsync() const
+    {
+        return m_pSubmitter != nullptr;
+    }
+
+    // An async dispatch runs one job only
+    void Run(size_t count, size_t grain, const ThreadPool::RangeFunc& func)
+    {
+        if (!m_pSubmitter)
+        {
+            ThreadPool::GetShared().ParallelFor(count, grain,
+                ThreadPool::ResolveThreadCount(m_threadCount), func);
+            return;
+        }
+
+        assert(!m_bStarted);
+        m_handle = AsyncJob::Start(count, grain, func, *m_pSubmitter, *m_pOnComplete);
+        m_bStarted = true;
+    }
+
+    // Handle of the async job, an empty finished job if nothing was run so the
+    // completion callback still fires
+    AsyncHandle Finish()
+    {
+        if (!m_bStarted)
+            Run(0, 1, [](size_t, size_t) {});
+        return m_handle;
+    }
+
+private:
+    size_t m_threadCount;
+    const BC_TASK_SUBMITTER *m_pSubmitter;
+    const BC_ASYNC_CALLBACK *m_pOnComplete;
+    AsyncHandle m_handle;
+    bool m_bStarted;
+};
+
+// Gathers the 4x4 block at (bx, by), replicating the last column/row for blocks
+// that hang over the image edge
+template <typename Color>
+void GatherBlock(Color *pBlock, const Color *pSrc, size_t width, size_t height,
+    size_t rowPitch, size_t bx, size_t by)
+{
+    for (size_t y = 0; y < 4; ++y)
+    {
+        size_t sy = std::min(by * 4 + y, height - 1);
+        auto pRow = reinterpret_cast<const Color *>(
+            reinterpret_cast<const uint8_t *>(pSrc) + sy * rowPitch);
+        for (size_t x = 0; x < 4; ++x)
+        {
+            size_t sx = std::min(bx * 4 + x, width - 1);
+            pBlock[y * 4 + x] = pRow[sx];
+        }
+    }
+}
+
+// Writes the visible part of a decoded block at (bx, by)
+template <typename Color>
+void ScatterBlock(Color *pDst, const Color *pBlock, size_t width, size_t height,
+    size_t dstRowPitch, size_t bx, size_t by)
+{
+    size_t cx = std::min<size_t>(4, width - bx * 4);
+    size_t cy = std::min<size_t>(4, height - by * 4);
+    for (size_t y = 0; y < cy; ++y)
+    {
+        auto pRow = reinterpret_cast<Color *>(
+            reinterpret_cast<uint8_t *>(pDst) + (by * 4 + y) * dstRowPitch) + bx * 4;
+        memcpy(pRow, pBlock + y * 4, cx * sizeof(Color));
+    }
+}
+
+// One RGBA16F texel
+struct Half4
+{
+    uint16_t c[4];
+};
+
+// Hash of the raw texels of one block
+uint64_t HashBlock(const void *pBlock, size_t size)
+{
+    assert(size % sizeof(uint64_t) == 0);
+    auto pBytes = static_cast<const uint8_t *>(pBlock);
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t))
+    {
+        uint64_t w;
+        memcpy(&w, pBytes + i, sizeof(w));
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 29);
+}
+
+// Lock free map from block contents to the first block of the surface that had
+// them, shared by the workers of one EncodeSurface call. The flags are the same
+// for the whole call, so the texels alone decide the compressed result.
+//
+// Each slot holds the upper half of the hash, the owner block and whether its
+// compressed result has been written. Slots are claimed once and never reused;
+// a full table or a long probe simply leaves the block uncached.
+class BlockCache
+{
+public:
+    struct Lookup
+    {
+        size_t uOwner;  // Block holding the same texels, the queried block if it was inserted
+        size_t uSlot;   // Slot to mark ready once the owner is written, SIZE_MAX if none
+        bool bReady;    // The owner's compressed result can be copied
+    };
+
+    static bool CanHold(size_t nBlocks)
+    {
+        return nBlocks < INDEX_MASK;
+    }
+
+    explicit BlockCache(size_t nBlocks) :
+        m_uMask(0)
+    {
+        size_t uSize = 64;
+        while (uSize < nBlocks * 2 && uSize < MAX_SLOTS)
+            uSize *= 2;
+        m_aSlots.reset(new std::atomic<uint64_t>[uSize]);
+        for (size_t i = 0; i < uSize; ++i)
+            m_aSlots[i].store(0, std::memory_order_relaxed);
+        m_uMask = uSize - 1;
+    }
+
+    // fnEqual(uOther) compares the texels of block uOther with the queried block
+    template <typename EqualFn>
+    Lookup FindOrInsert(uint64_t uHash, size_t uBlock, EqualFn fnEqual)
+    {
+        const uint64_t uTag = uHash >> 32;
+        const uint64_t uNew = (uTag << 32) | (uBlock + 1);
+
+        size_t uSlot = size_t(uHash) & m_uMask;
+        for (size_t uProbe = 0; uProbe < MAX_PROBES; ++uProbe, uSlot = (uSlot + 1) & m_uMask)
+        {
+            uint64_t uValue = m_aSlots[uSlot].load(std::memory_order_acquire);
+            if (uValue == 0)
+            {
+                if (m_aSlots[uSlot].compare_exchange_strong(uValue, uNew, std::memory_order_acq_rel))
+                    return Lookup{ uBlock, uSlot, false };
+                // Lost the race, uValue now holds the winner
+            }
+
+            if ((uValue >> 32) != uTag)
+                continue;
+
+            const size_t uOwner = size_t(uValue & INDEX_MASK) - 1;
+            if (fnEqual(uOwner))
+                return Lookup{ uOwner, SIZE_MAX, (uValue & READY_BIT) != 0 };
+        }
+
+        return Lookup{ uBlock, SIZE_MAX, false };
+    }
+
+    // Publishes the owner's compressed result, which must already be in place
+    void MarkReady(size_t uSlot)
+    {
+        m_aSlots[uSlot].fetch_or(READY_BIT, std::memory_order_release);
+    }
+
+private:
+    static const uint64_t READY_BIT = 0x80000000ull;
+    static const uint64_t INDEX_MASK = 0x7FFFFFFFull;
+    static const size_t MAX_SLOTS = size_t(1) << 22;
+    static const size_t MAX_PROBES = 16;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_aSlots;
+    size_t m_uMask;
+};
+
+// Lookups made before judging whether the cache pays off
+const size_t CACHE_SAMPLE = 4096;
+
+// Blocks gathered before each encoder call, lets BC1-5 batch their endpoint search
+const size_t ENCODE_BATCH = (BC1_MAX_BATCH > BC4_MAX_BATCH) ? BC1_MAX_BATCH : BC4_MAX_BATCH;
+
+// Block cache and its hit counters, shared by the workers of one call
+struct EncodeState
+{
+    std::unique_ptr<BlockCache> pCache;
+    std::atomic<size_t> uLookups;
+    std::atomic<size_t> uCachedBlocks;
+    std::atomic<bool> bCacheOff;
+};
+
+// Runs pfnEncode(pBC, aBlocks, nBlocks) over runs of consecutive blocks of the
+// image. Repeated blocks are looked up in a BlockCache and copied instead of
+// encoded. pStats is filled in by synchronous dispatches only.
+template <typename Color, typename EncodeFn>
+void EncodeBlocks(BC_FORMAT format, const Color *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, Dispatch& dispatch, SurfaceStats *pStats,
+    EncodeFn pfnEncode)
+{
+    assert(!pStats || !dispatch.IsAsync());
+
+    const size_t blockSize = GetBlockSize(format);
+    const size_t blocksWide = (width + 3) / 4;
+    const size_t blocksHigh = (height + 3) / 4;
+    const size_t nBlocks = blocksWide * blocksHigh;
+
+    std::shared_ptr<EncodeState> pState = std::make_shared<EncodeState>();
+    if (!(flags & BC_FLAGS_NO_BLOCK_CACHE) && nBlocks > 1 && BlockCache::CanHold(nBlocks))
+        pState->pCache.reset(new BlockCache(nBlocks));
+    pState->uLookups = 0;
+    pState->uCachedBlocks = 0;
+    pState->bCacheOff = !pState->pCache;
+
+    // A lookup costs about as much as encoding a BC1-5 block, so for those formats
+    // the cache is dropped when the first lookups find few repeats
+    const bool bAdaptive = (format != BC_FORMAT_BC6HU && format != BC_FORMAT_BC6HS
+        && format != BC_FORMAT_BC7);
+
+    dispatch.Run(nBlocks, GetGrain(format),
+        [=](size_t uBegin, size_t uEnd)
+        {
+            BlockCache *pCache = pState->pCache.get();
+            Color blocks[ENCODE_BATCH * NUM_PIXELS_PER_BLOCK];
+
+            // Blocks that miss are packed at the front of the batch and encoded
+            // together; repeats of a block in the same batch wait for it
+            uint8_t aEncoded[ENCODE_BATCH * 16];
+            size_t aMiss[ENCODE_BATCH];
+            size_t aMissSlot[ENCODE_BATCH];
+            size_t aRepeat[ENCODE_BATCH];
+            size_t aRepeatOwner[ENCODE_BATCH];
+
+            for (size_t i = uBegin; i < uEnd; i += ENCODE_BATCH)
+            {
+                const size_t nBatch = std::min(ENCODE_BATCH, uEnd - i);
+                if (pState->bCacheOff.load(std::memory_order_relaxed))
+                {
+                    for (size_t j = 0; j < nBatch; ++j)
+                    {
+                        GatherBlock(blocks + j * NUM_PIXELS_PER_BLOCK, pSrc, width, height, rowPitch,
+                            (i + j) % blocksWide, (i + j) / blocksWide);
+                    }
+                    pfnEncode(pDst + i * blockSize, blocks, nBatch);
+                    continue;
+                }
+
+                size_t nMiss = 0;
+                size_t nRepeat = 0;
+                size_t nCached = 0;
+                for (size_t j = 0; j < nBatch; ++j)
+                {
+                    const size_t uBlock = i + j;
+                    Color *pBlock = blocks + nMiss * NUM_PIXELS_PER_BLOCK;
+                    GatherBlock(pBlock, pSrc, width, height, rowPitch,
+                        uBlock % blocksWide, uBlock / blocksWide);
+
+                    const BlockCache::Lookup lookup = pCache->FindOrInsert(
+                        HashBlock(pBlock, sizeof(Color) * NUM_PIXELS_PER_BLOCK), uBlock,
+                        [&](size_t uOther)
+                        {
+                            Color other[NUM_PIXELS_PER_BLOCK];
+                            GatherBlock(other, pSrc, width, height, rowPitch,
+                                uOther % blocksWide, uOther / blocksWide);
+                            return memcmp(other, pBlock, sizeof(other)) == 0;
+                        });
+
+                    if (lookup.bReady)
+                    {
+                        memcpy(pDst + uBlock * blockSize, pDst + lookup.uOwner * blockSize, blockSize);
+                        ++nCached;
+                    }
+                    else if (lookup.uOwner >= i && lookup.uOwner < uBlock)
+                    {
+                        aRepeat[nRepeat] = uBlock;
+                        aRepeatOwner[nRepeat++] = lookup.uOwner;
+                        ++nCached;
+                    }
+                    else
+                    {
+                        // Also taken when another thread is still encoding the owner
+                        aMiss[nMiss] = uBlock;
+                        aMissSlot[nMiss++] = (lookup.uOwner == uBlock) ? lookup.uSlot : SIZE_MAX;
+                    }
+                }
+
+                if (nMiss)
+                    pfnEncode(aEncoded, blocks, nMiss);
+
+                for (size_t k = 0; k < nMiss; ++k)
+                {
+                    memcpy(pDst + aMiss[k] * blockSize, aEncoded + k * blockSize, blockSize);
+                    if (aMissSlot[k] != SIZE_MAX)
+                        pCache->MarkReady(aMissSlot[k]);
+                }
+
+                for (size_t k = 0; k < nRepeat; ++k)
+                    memcpy(pDst + aRepeat[k] * blockSize, pDst + aRepeatOwner[k] * blockSize, blockSize);
+
+                const size_t uTotal = pState->uLookups.fetch_add(nBatch, std::memory_order_relaxed) + nBatch;
+                const size_t uCached = pState->uCachedBlocks.fetch_add(nCached, std::memory_order_relaxed) + nCached;
+                if (bAdaptive && uTotal >= CACHE_SAMPLE && uCached * 8 < uTotal)
+                    pState->bCacheOff.store(true, std::memory_order_relaxed);
+            }
+        });
+
+    if (pStats)
+    {
+        pStats->blocks = nBlocks;
+        pStats->cachedBlocks = pState->uCachedBlocks.load();
+    }
+}
+
+// Indices of the blocks any of the rectangles touch, in ascending order
+std::vector<size_t> CollectDirtyBlocks(size_t width, size_t height, const SurfaceRect *pRects, size_t nRects)
+{
+    const size_t blocksWide = (width + 3) / 4;
+    std::vector<size_t> blocks;
+    for (size_t r = 0; r < nRects; ++r)
+    {
+        const SurfaceRect& rect = pRects[r];
+        if (rect.x >= width || rect.y >= height || rect.width == 0 || rect.height == 0)
+            continue;
+
+        const size_t x1 = rect.x + std::min(rect.width, width - rect.x);
+        const size_t y1 = rect.y + std::min(rect.height, height - rect.y);
+        for (size_t by = rect.y / 4; by <= (y1 - 1) / 4; ++by)
+        {
+            for (size_t bx = rect.x / 4; bx <= (x1 - 1) / 4; ++bx)
+                blocks.push_back(by * blocksWide + bx);
+        }
+    }
+
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    return blocks;
+}
+
+// Runs pfnEncode(pBC, aBlock) over the blocks the rectangles touch, pBC pointing
+// at the previous encoding of the block
+template <typename Color, typename EncodeFn>
+void UpdateBlocks(BC_FORMAT format, const Color *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, size_t threadCount,
+    EncodeFn pfnEncode)
+{
+    const size_t blockSize = GetBlockSize(format);
+    const size_t blocksWide = (width + 3) / 4;
+    const std::vector<size_t> blocks = CollectDirtyBlocks(width, height, pRects, nRects);
+
+    ThreadPool::GetShared().ParallelFor(blocks.size(), GetGrain(format),
+        ThreadPool::ResolveThreadCount(threadCount),
+        [&](size_t uBegin, size_t uEnd)
+        {
+            Color block[NUM_PIXELS_PER_BLOCK];
+            for (size_t i = uBegin; i < uEnd; ++i)
+            {
+                const size_t uBlock = blocks[i];
+                GatherBlock(block, pSrc, width, height, rowPitch, uBlock % blocksWide, uBlock / blocksWide);
+                pfnEncode(pBlocks + uBlock * blockSize, block);
+            }
+        });
+}
+
+// Encodes one block over its previous contents, starting from them for BC6H/BC7
+void EncodeSeeded(BC_FORMAT format, uint8_t *pBC, const HDRColorA *pBlock, uint32_t flags, BC_ENCODE pfEncode)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC6HU: EncodeBC6HUSeeded(pBC, pBlock, pBC, flags); break;
+    case BC_FORMAT_BC6HS: EncodeBC6HSSeeded(pBC, pBlock, pBC, flags); break;
+    case BC_FORMAT_BC7: EncodeBC7Seeded(pBC, pBlock, pBC, flags); break;
+    default: pfEncode(pBC, pBlock, flags); break;
+    }
+}
+
+// Runs pfnDecode(aBlock, pBC) for every block and stores the visible texels
+template <typename Color, typename DecodeFn>
+void DecodeBlocks(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    Color *pDst, size_t dstRowPitch, Dispatch& dispatch, DecodeFn pfnDecode)
+{
+    const size_t blockSize = GetBlockSize(format);
+    const size_t blocksWide = (width + 3) / 4;
+    const size_t blocksHigh = (height + 3) / 4;
+
+    dispatch.Run(blocksWide * blocksHigh, DECODE_GRAIN,
+        [=](size_t uBegin, size_t uEnd)
+        {
+            Color block[NUM_PIXELS_PER_BLOCK];
+            for (size_t i = uBegin; i < uEnd; ++i)
+            {
+                pfnDecode(block, pSrc + i * blockSize);
+                ScatterBlock(pDst, block, width, height, dstRowPitch, i % blocksWide, i / blocksWide);
+            }
+        });
+}
+
+typedef void (*BC_DECODE_ROW)(uint8_t *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+BC_DECODE_ROW GetRowDecoderLDR(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return DecodeBC1Row;
+    case BC_FORMAT_BC2: return DecodeBC2Row;
+    case BC_FORMAT_BC3: return DecodeBC3Row;
+    case BC_FORMAT_BC7: return DecodeBC7Row;
+    default: return nullptr;
+    }
+}
+
+// Decodes block rows straight into the destination, only the blocks hanging over
+// the right or bottom edge go through a temporary block
+template <typename Color, typename DecodeRowFn>
+void DecodeBlockRows(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    Color *pDst, size_t dstRowPitch, Dispatch& dispatch, DecodeRowFn pfnDecodeRow)
+{
+    const size_t blockSize = GetBlockSize(format);
+    const size_t blocksWide = (width + 3) / 4;
+    const size_t blocksHigh = (height + 3) / 4;
+
+    dispatch.Run(blocksHigh, std::max<size_t>(1, DECODE_GRAIN / blocksWide),
+        [=](size_t uBegin, size_t uEnd)
+        {
+            Color block[NUM_PIXELS_PER_BLOCK];
+            for (size_t by = uBegin; by < uEnd; ++by)
+            {
+                const uint8_t *pBC = pSrc + by * blocksWide * blockSize;
+                const size_t nFull = (by * 4 + 4 <= height) ? width / 4 : 0;
+                if (nFull)
+                {
+                    pfnDecodeRow(reinterpret_cast<uint8_t *>(pDst) + by * 4 * dstRowPitch, dstRowPitch,
+                        pBC, nFull);
+                }
+
+                for (size_t bx = nFull; bx < blocksWide; ++bx)
+                {
+                    pfnDecodeRow(reinterpret_cast<uint8_t *>(block), 4 * sizeof(Color),
+                        pBC + bx * blockSize, 1);
+                    ScatterBlock(pDst, block, width, height, dstRowPitch, bx, by);
+                }
+            }
+        });
+}
+
+inline uint8_t ToUNorm8(float f)
+{
+    return static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, f)) * 255.0f + 0.5f);
+}
+
+// Bodies of the EncodeSurface/DecodeSurface overloads and their Async variants
+
+void EncodeSurfaceWith(Dispatch& dispatch, BC_FORMAT format, const HDRColorA *pSrc,
+    size_t width, size_t height, size_t rowPitch, uint8_t *pDst, uint32_t flags, SurfaceStats *pStats)
+{
+    assert(pSrc && pDst);
+    assert(rowPitch >= width * sizeof(HDRColorA));
+
+    BC_ENCODE pfEncode = GetEncoder(format);
+    BC_ENCODE_BLOCKS pfEncodeBlocks = GetBlockEncoder(format);
+    assert(pfEncode);
+    if (!pfEncode || width == 0 || height == 0)
+        return;
+
+    const size_t blockSize = GetBlockSize(format);
+
+    EncodeBlocks(format, pSrc, width, height, rowPitch, pDst, flags, dispatch, pStats,
+        [=](uint8_t *pBC, const HDRColorA *pBlocks, size_t nBlocks)
+        {
+            if (pfEncodeBlocks)
+            {
+                pfEncodeBlocks(pBC, pBlocks, nBlocks, flags);
+                return;
+            }
+
+            for (size_t i = 0; i < nBlocks; ++i)
+                pfEncode(pBC + i * blockSize, pBlocks + i * NUM_PIXELS_PER_BLOCK, flags);
+        });
+}
+
+void EncodeSurfaceWith(Dispatch& dispatch, BC_FORMAT format, const LDRColorA *pSrc,
+    size_t width, size_t height, size_t rowPitch, uint8_t *pDst, uint32_t flags, SurfaceStats *pStats)
+{
+    assert(pSrc && pDst);
+    assert(rowPitch >= width * sizeof(LDRColorA));
+
+    BC_ENCODE_LDR pfEncodeLDR = GetEncoderLDR(format);
+    BC_ENCODE_BLOCKS_LDR pfEncodeBlocksLDR = GetBlockEncoderLDR(format);
+    BC_ENCODE pfEncode = GetEncoder(format);
+    BC_ENCODE_BLOCKS pfEncodeBlocks = GetBlockEncoder(format);
+    assert(pfEncode);
+    if (!pfEncode || width == 0 || height == 0)
+        return;
+
+    const size_t blockSize = GetBlockSize(format);
+
+    EncodeBlocks(format, pSrc, width, height, rowPitch, pDst, flags, dispatch, pStats,
+        [=](uint8_t *pBC, const LDRColorA *pBlocks, size_t nBlocks)
+        {
+            if (pfEncodeBlocksLDR)
+            {
+                pfEncodeBlocksLDR(pBC, pBlocks, nBlocks, flags);
+                return;
+            }
+
+            if (pfEncodeLDR)
+            {
+                for (size_t i = 0; i < nBlocks; ++i)
+                    pfEncodeLDR(pBC + i * blockSize, pBlocks + i * NUM_PIXELS_PER_BLOCK, flags);
+                return;
+            }
+
+            HDRColorA blocksF[ENCODE_BATCH * NUM_PIXELS_PER_BLOCK];
+            for (size_t j = 0; j < nBlocks * NUM_PIXELS_PER_BLOCK; ++j)
+                blocksF[j] = pBlocks[j].ToHDRColorA();
+
+            if (pfEncodeBlocks)
+            {
+                pfEncodeBlocks(pBC, blocksF, nBlocks, flags);
+                return;
+            }
+
+            for (size_t i = 0; i < nBlocks; ++i)
+                pfEncode(pBC + i * blockSize, blocksF + i * NUM_PIXELS_PER_BLOCK, flags);
+        });
+}
+
+void EncodeSurfaceWith(Dispatch& dispatch, BC_FORMAT format, const uint16_t *pSrc,
+    size_t width, size_t height, size_t rowPitch, uint8_t *pDst, uint32_t flags, SurfaceStats *pStats)
+{
+    assert(pSrc && pDst);
+    assert(rowPitch >= width * sizeof(Half4));
+
+    BC_ENCODE pfEncode = GetEncoder(format);
+    assert(pfEncode);
+    if (!pfEncode || width == 0 || height == 0)
+        return;
+
+    const bool bBC6H = (format == BC_FORMAT_BC6HU || format == BC_FORMAT_BC6HS);
+    const bool bSigned = (format == BC_FORMAT_BC6HS);
+    const size_t blockSize = GetBlockSize(format);
+
+    EncodeBlocks(format, reinterpret_cast<const Half4 *>(pSrc), width, height, rowPitch, pDst, flags, dispatch, pStats,
+        [=](uint8_t *pBC, const Half4 *pBlocks, size_t nBlocks)
+        {
+            for (size_t i = 0; i < nBlocks; ++i, pBC += blockSize, pBlocks += NUM_PIXELS_PER_BLOCK)
+            {
+                if (bBC6H)
+                {
+                    if (bSigned)
+                        EncodeBC6HS(pBC, pBlocks[0].c, flags);
+                    else
+                        EncodeBC6HU(pBC, pBlocks[0].c, flags);
+                    continue;
+                }
+
+                HDRColorA blockF[NUM_PIXELS_PER_BLOCK];
+                for (size_t j = 0; j < NUM_PIXELS_PER_BLOCK; ++j)
+                {
+                    blockF[j] = HDRColorA(
+                        INTColor::HalfToFloat(pBlocks[j].c[0]), INTColor::HalfToFloat(pBlocks[j].c[1]),
+                        INTColor::HalfToFloat(pBlocks[j].c[2]), INTColor::HalfToFloat(pBlocks[j].c[3]));
+                }
+                pfEncode(pBC, blockF, flags);
+            }
+        });
+}
+
+void DecodeSurfaceWith(Dispatch& dispatch, BC_FORMAT format, const uint8_t *pSrc,
+    size_t width, size_t height, HDRColorA *pDst, size_t dstRowPitch)
+{
+    assert(pSrc && pDst);
+    assert(dstRowPitch >= width * sizeof(HDRColorA));
+
+    BC_DECODE pfDecode = GetDecoder(format);
+    assert(pfDecode);
+    if (!pfDecode || width == 0 || height == 0)
+        return;
+
+    if (format == BC_FORMAT_BC6HU || format == BC_FORMAT_BC6HS)
+    {
+        const bool bSigned = (format == BC_FORMAT_BC6HS);
+        DecodeBlockRows(format, pSrc, width, height, pDst, dstRowPitch, dispatch,
+            [=](uint8_t *pRows, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+            {
+                if (bSigned)
+                    DecodeBC6HSRow(reinterpret_cast<float *>(pRows), rowPitch, pBC, nBlocks);
+                else
+                    DecodeBC6HURow(reinterpret_cast<float *>(pRows), rowPitch, pBC, nBlocks);
+            });
+        return;
+    }
+
+    DecodeBlocks(format, pSrc, width, height, pDst, dstRowPitch, dispatch, pfDecode);
+}
+
+void DecodeSurfaceWith(Dispatch& dispatch, BC_FORMAT format, const uint8_t *pSrc,
+    size_t width, size_t height, uint16_t *pDst, size_t dstRowPitch)
+{
+    assert(pSrc && pDst);
+    assert(dstRowPitch >= width * sizeof(Half4));
+
+    BC_DECODE pfDecode = GetDecoder(format);
+    assert(pfDecode);
+    if (!pfDecode || width == 0 || height == 0)
+        return;
+
+    if (format == BC_FORMAT_BC6HU || format == BC_FORMAT_BC6HS)
+    {
+        const bool bSigned = (format == BC_FORMAT_BC6HS);
+        DecodeBlockRows(format, pSrc, width, height, reinterpret_cast<Half4 *>(pDst), dstRowPitch, dispatch,
+            [=](uint8_t *pRows, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+            {
+                if (bSigned)
+                    DecodeBC6HSRow(reinterpret_cast<uint16_t *>(pRows), rowPitch, pBC, nBlocks);
+                else
+                    DecodeBC6HURow(reinterpret_cast<uint16_t *>(pRows), rowPitch, pBC, nBlocks);
+            });
+        return;
+    }
+
+    DecodeBlocks(format, pSrc, width, height, reinterpret_cast<Half4 *>(pDst), dstRowPitch, dispatch,
+        [=](Half4 *pBlock, const uint8_t *pBC)
+        {
+            HDRColorA blockF[NUM_PIXELS_PER_BLOCK];
+            pfDecode(blockF, pBC);
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                pBlock[i].c[0] = INTColor::FloatToHalf(blockF[i].r);
+                pBlock[i].c[1] = INTColor::FloatToHalf(blockF[i].g);
+                pBlock[i].c[2] = INTColor::FloatToHalf(blockF[i].b);
+                pBlock[i].c[3] = INTColor::FloatToHalf(blockF[i].a);
+            }
+        });
+}
+
+void DecodeSurfaceWith(Dispatch& dispatch, BC_FORMAT format, const uint8_t *pSrc,
+    size_t width, size_t height, LDRColorA *pDst, size_t dstRowPitch)
+{
+    assert(pSrc && pDst);
+    assert(dstRowPitch >= width * sizeof(LDRColorA));
+
+    BC_DECODE pfDecode = GetDecoder(format);
+    assert(pfDecode);
+    if (!pfDecode || width == 0 || height == 0)
+        return;
+
+    BC_DECODE_ROW pfnDecodeRow = GetRowDecoderLDR(format);
+    if (pfnDecodeRow)
+    {
+        DecodeBlockRows(format, pSrc, width, height, pDst, dstRowPitch, dispatch, pfnDecodeRow);
+        return;
+    }
+
+    DecodeBlocks(format, pSrc, width, height, pDst, dstRowPitch, dispatch,
+        [=](LDRColorA *pBlock, const uint8_t *pBC)
+        {
+            HDRColorA blockF[NUM_PIXELS_PER_BLOCK];
+            pfDecode(blockF, pBC);
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                pBlock[i] = LDRColorA(ToUNorm8(blockF[i].r), ToUNorm8(blockF[i].g),
+                    ToUNorm8(blockF[i].b), ToUNorm8(blockF[i].a));
+            }
+        });
+}
+
+}
+
+size_t GetBlockSize(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1:
+    case BC_FORMAT_BC4U:
+    case BC_FORMAT_BC4S:
+        return 8;
+    case BC_FORMAT_BC2:
+    case BC_FORMAT_BC3:
+    case BC_FORMAT_BC5U:
+    case BC_FORMAT_BC5S:
+    case BC_FORMAT_BC6HU:
+    case BC_FORMAT_BC6HS:
+    case BC_FORMAT_BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t ComputeSurfaceSize(BC_FORMAT format, size_t width, size_t height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+size_t ComputeMipLevels(size_t width, size_t height)
+{
+    size_t levels = 1;
+    for (size_t size = std::max(width, height); size > 1; size >>= 1)
+        ++levels;
+    return levels;
+}
+
+void EncodeSurface(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, size_t threadCount, SurfaceStats *pStats)
+{
+    Dispatch dispatch(threadCount);
+    EncodeSurfaceWith(dispatch, format, pSrc, width, height, rowPitch, pDst, flags, pStats);
+}
+
+void EncodeSurface(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, size_t threadCount, SurfaceStats *pStats)
+{
+    Dispatch dispatch(threadCount);
+    EncodeSurfaceWith(dispatch, format, pSrc, width, height, rowPitch, pDst, flags, pStats);
+}
+
+void EncodeSurface(BC_FORMAT format, const uint16_t *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, size_t threadCount, SurfaceStats *pStats)
+{
+    Dispatch dispatch(threadCount);
+    EncodeSurfaceWith(dispatch, format, pSrc, width, height, rowPitch, pDst, flags, pStats);
+}
+
+void UpdateSurface(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, uint32_t flags,
+    size_t threadCount)
+{
+    assert(pSrc && pBlocks && (pRects || nRects == 0));
+    assert(rowPitch >= width * sizeof(HDRColorA));
+
+    BC_ENCODE pfEncode = GetEncoder(format);
+    assert(pfEncode);
+    if (!pfEncode || width == 0 || height == 0)
+        return;
+
+    UpdateBlocks(format, pSrc, width, height, rowPitch, pBlocks, pRects, nRects, threadCount,
+        [=](uint8_t *pBC, const HDRColorA *pBlock)
+        {
+            EncodeSeeded(format, pBC, pBlock, flags, pfEncode);
+        });
+}
+
+void UpdateSurface(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, uint32_t flags,
+    size_t threadCount)
+{
+    assert(pSrc && pBlocks && (pRects || nRects == 0));
+    assert(rowPitch >= width * sizeof(LDRColorA));
+
+    BC_ENCODE_LDR pfEncodeLDR = GetEncoderLDR(format);
+    BC_ENCODE pfEncode = GetEncoder(format);
+    assert(pfEncode);
+    if (!pfEncode || width == 0 || height == 0)
+        return;
+
+    UpdateBlocks(format, pSrc, width, height, rowPitch, pBlocks, pRects, nRects, threadCount,
+        [=](uint8_t *pBC, const LDRColorA *pBlock)
+        {
+            if (format == BC_FORMAT_BC7)
+            {
+                EncodeBC7Seeded(pBC, pBlock, pBC, flags);
+                return;
+            }
+
+            if (pfEncodeLDR)
+            {
+                pfEncodeLDR(pBC, pBlock, flags);
+                return;
+            }
+
+            HDRColorA blockF[NUM_PIXELS_PER_BLOCK];
+            for (size_t j = 0; j < NUM_PIXELS_PER_BLOCK; ++j)
+                blockF[j] = pBlock[j].ToHDRColorA();
+            EncodeSeeded(format, pBC, blockF, flags, pfEncode);
+        });
+}
+
+void UpdateSurface(BC_FORMAT format, const uint16_t *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pBlocks, const SurfaceRect *pRects, size_t nRects, uint32_t flags,
+    size_t threadCount)
+{
+    assert(pSrc && pBlocks && (pRects || nRects == 0));
+    assert(rowPitch >= width * sizeof(Half4));
+
+    BC_ENCODE pfEncode = GetEncoder(format);
+    assert(pfEncode);
+    if (!pfEncode || width == 0 || height == 0)
+        return;
+
+    UpdateBlocks(format, reinterpret_cast<const Half4 *>(pSrc), width, height, rowPitch, pBlocks, pRects, nRects,
+        threadCount,
+        [=](uint8_t *pBC, const Half4 *pBlock)
+        {
+            if (format == BC_FORMAT_BC6HU || format == BC_FORMAT_BC6HS)
+            {
+                if (format == BC_FORMAT_BC6HS)
+                    EncodeBC6HSSeeded(pBC, pBlock[0].c, pBC, flags);
+                else
+                    EncodeBC6HUSeeded(pBC, pBlock[0].c, pBC, flags);
+                return;
+            }
+
+            HDRColorA blockF[NUM_PIXELS_PER_BLOCK];
+            for (size_t j = 0; j < NUM_PIXELS_PER_BLOCK; ++j)
+            {
+                blockF[j] = HDRColorA(
+                    INTColor::HalfToFloat(pBlock[j].c[0]), INTColor::HalfToFloat(pBlock[j].c[1]),
+                    INTColor::HalfToFloat(pBlock[j].c[2]), INTColor::HalfToFloat(pBlock[j].c[3]));
+            }
+            EncodeSeeded(format, pBC, blockF, flags, pfEncode);
+        });
+}
+
+void DecodeSurface(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    HDRColorA *pDst, size_t dstRowPitch, size_t threadCount)
+{
+    Dispatch dispatch(threadCount);
+    DecodeSurfaceWith(dispatch, format, pSrc, width, height, pDst, dstRowPitch);
+}
+
+void DecodeSurface(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    uint16_t *pDst, size_t dstRowPitch, size_t threadCount)
+{
+    Dispatch dispatch(threadCount);
+    DecodeSurfaceWith(dispatch, format, pSrc, width, height, pDst, dstRowPitch);
+}
+
+void DecodeSurface(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    LDRColorA *pDst, size_t dstRowPitch, size_t threadCount)
+{
+    Dispatch dispatch(threadCount);
+    DecodeSurfaceWith(dispatch, format, pSrc, width, height, pDst, dstRowPitch);
+}
+
+AsyncHandle EncodeSurfaceAsync(BC_FORMAT format, const HDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete)
+{
+    Dispatch dispatch(submitter, onComplete);
+    EncodeSurfaceWith(dispatch, format, pSrc, width, height, rowPitch, pDst, flags, nullptr);
+    return dispatch.Finish();
+}
+
+AsyncHandle EncodeSurfaceAsync(BC_FORMAT format, const LDRColorA *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete)
+{
+    Dispatch dispatch(submitter, onComplete);
+    EncodeSurfaceWith(dispatch, format, pSrc, width, height, rowPitch, pDst, flags, nullptr);
+    return dispatch.Finish();
+}
+
+AsyncHandle EncodeSurfaceAsync(BC_FORMAT format, const uint16_t *pSrc, size_t width, size_t height,
+    size_t rowPitch, uint8_t *pDst, uint32_t flags, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete)
+{
+    Dispatch dispatch(submitter, onComplete);
+    EncodeSurfaceWith(dispatch, format, pSrc, width, height, rowPitch, pDst, flags, nullptr);
+    return dispatch.Finish();
+}
+
+AsyncHandle DecodeSurfaceAsync(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    HDRColorA *pDst, size_t dstRowPitch, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete)
+{
+    Dispatch dispatch(submitter, onComplete);
+    DecodeSurfaceWith(dispatch, format, pSrc, width, height, pDst, dstRowPitch);
+    return dispatch.Finish();
+}
+
+AsyncHandle DecodeSurfaceAsync(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    uint16_t *pDst, size_t dstRowPitch, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete)
+{
+    Dispatch dispatch(submitter, onComplete);
+    DecodeSurfaceWith(dispatch, format, pSrc, width, height, pDst, dstRowPitch);
+    return dispatch.Finish();
+}
+
+AsyncHandle DecodeSurfaceAsync(BC_FORMAT format, const uint8_t *pSrc, size_t width, size_t height,
+    LDRColorA *pDst, size_t dstRowPitch, const BC_TASK_SUBMITTER& submitter,
+    const BC_ASYNC_CALLBACK& onComplete)
+{
+    Dispatch dispatch(submitter, onComplete);
+    DecodeSurfaceWith(dispatch, format, pSrc, width, height, pDst, dstRowPitch);
+    return dispatch.Finish();
+}
+
+} // namespace
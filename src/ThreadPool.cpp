@@ -0,0 +1,250 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+
+#include "ThreadPool.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+// Set while a thread works on a job so nested ParallelFor calls run inline
+// instead of deadlocking on the submit lock
+thread_local bool t_bInJob = false;
+
+// Largest count a single job can hold
+const uint64_t RANGE_LIMIT = 0xffffffff;
+
+inline uint64_t PackRange(size_t uBegin, size_t uEnd)
+{
+    return (static_cast<uint64_t>(uBegin) << 32) | static_cast<uint64_t>(uEnd);
+}
+
+inline void UnpackRange(uint64_t v, size_t& uBegin, size_t& uEnd)
+{
+    uBegin = static_cast<size_t>(v >> 32);
+    uEnd = static_cast<size_t>(v & 0xffffffff);
+}
+
+}
+
+ThreadPool::ThreadPool(size_t uWorkers) :
+    m_pJob(nullptr),
+    m_uGeneration(0),
+    m_bShutdown(false)
+{
+    m_aWorkers.reserve(uWorkers);
+    for (size_t i = 0; i < uWorkers; ++i)
+    {
+        m_aWorkers.emplace_back(&ThreadPool::WorkerMain, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bShutdown = true;
+    }
+    m_wakeCV.notify_all();
+    for (auto& worker : m_aWorkers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+    static ThreadPool pool(ResolveThreadCount(0) - 1);
+    return pool;
+}
+
+size_t ThreadPool::ResolveThreadCount(size_t uThreads)
+{
+    if (uThreads == 0)
+    {
+        uThreads = std::thread::hardware_concurrency();
+    }
+    return std::max<size_t>(uThreads, 1);
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, size_t uThreads, const RangeFunc& func)
+{
+    if (count == 0)
+        return;
+
+    grain = std::max<size_t>(grain, 1);
+    if (uThreads == 0)
+        uThreads = GetConcurrency();
+
+    size_t uParticipants = std::min(std::min(uThreads, GetConcurrency()), (count + grain - 1) / grain);
+    if (uParticipants <= 1 || t_bInJob)
+    {
+        func(0, count);
+        return;
+    }
+
+    // Slots pack their ranges into 32-bit halves, larger jobs run as several passes
+    if (uint64_t(count) > RANGE_LIMIT)
+    {
+        for (size_t uBase = 0; uBase < count;)
+        {
+            const size_t uPass = size_t(std::min<uint64_t>(count - uBase, RANGE_LIMIT));
+            ParallelFor(uPass, grain, uThreads,
+                [&func, uBase](size_t uBegin, size_t uEnd) { func(uBase + uBegin, uBase + uEnd); });
+            uBase += uPass;
+        }
+        return;
+    }
+
+    // One job at a time; concurrent submitters simply queue up here
+    std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+    std::unique_ptr<Slot[]> aSlots(new Slot[uParticipants]);
+    for (size_t i = 0; i < uParticipants; ++i)
+    {
+        size_t uBegin = count * i / uParticipants;
+        size_t uEnd = count * (i + 1) / uParticipants;
+        aSlots[i].range.store(PackRange(uBegin, uEnd), std::memory_order_relaxed);
+    }
+
+    Job job;
+    job.pFunc = &func;
+    job.pSlots = aSlots.get();
+    job.uParticipants = uParticipants;
+    job.uNextSlot = 1;              // slot 0 belongs to the caller
+    job.uActive = 0;
+    job.uGrain = grain;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pJob = &job;
+        ++m_uGeneration;
+    }
+    m_wakeCV.notify_all();
+
+    RunParticipant(job, 0);
+
+    // Stop late joiners, then wait for every worker still holding a range
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pJob = nullptr;
+    m_doneCV.wait(lock, [&job]() { return job.uActive == 0; });
+}
+
+void ThreadPool::WorkerMain()
+{
+    uint64_t uSeen = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wakeCV.wait(lock, [this, uSeen]() { return m_bShutdown || m_uGeneration != uSeen; });
+        if (m_bShutdown)
+            return;
+
+        uSeen = m_uGeneration;
+        Job* pJob = m_pJob;
+        if (!pJob || pJob->uNextSlot >= pJob->uParticipants)
+            continue;
+
+        size_t uSlot = pJob->uNextSlot++;
+        ++pJob->uActive;
+        lock.unlock();
+
+        RunParticipant(*pJob, uSlot);
+
+        lock.lock();
+        if (--pJob->uActive == 0)
+        {
+            m_doneCV.notify_all();
+        }
+    }
+}
+
+void ThreadPool::RunParticipant(Job& job, size_t uSlot)
+{
+    Slot& own = job.pSlots[uSlot];
+    size_t uBegin, uEnd;
+    t_bInJob = true;
+
+    for (;;)
+    {
+        while (PopRange(own, job.uGrain, uBegin, uEnd))
+        {
+            (*job.pFunc)(uBegin, uEnd);
+        }
+
+        if (!StealRange(job, uSlot, uBegin, uEnd))
+            break;
+
+        // Only the owner ever grows its slot, so a plain store is safe here
+        own.range.store(PackRange(uBegin, uEnd), std::memory_order_release);
+    }
+    t_bInJob = false;
+}
+
+bool ThreadPool::PopRange(Slot& slot, size_t uGrain, size_t& uBegin, size_t& uEnd)
+{
+    uint64_t v = slot.range.load(std::memory_order_acquire);
+    for (;;)
+    {
+        size_t b, e;
+        UnpackRange(v, b, e);
+        if (b >= e)
+            return false;
+
+        size_t nb = std::min(b + uGrain, e);
+        if (slot.range.compare_exchange_weak(v, PackRange(nb, e), std::memory_order_acq_rel))
+        {
+            uBegin = b;
+            uEnd = nb;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::StealRange(Job& job, size_t uSelf, size_t& uBegin, size_t& uEnd)
+{
+    for (;;)
+    {
+        // Pick the victim with the most work left
+        size_t uVictim = job.uParticipants;
+        size_t uBest = 0;
+        for (size_t i = 0; i < job.uParticipants; ++i)
+        {
+            if (i == uSelf)
+                continue;
+            size_t b, e;
+            UnpackRange(job.pSlots[i].range.load(std::memory_order_relaxed), b, e);
+            if (e > b && e - b > uBest)
+            {
+                uBest = e - b;
+                uVictim = i;
+            }
+        }
+
+        if (uVictim == job.uParticipants)
+            return false;
+
+        Slot& victim = job.pSlots[uVictim];
+        uint64_t v = victim.range.load(std::memory_order_acquire);
+        size_t b, e;
+        UnpackRange(v, b, e);
+        if (b >= e)
+            continue;
+
+        // Take the back half, or everything if the remainder fits in one grain
+        size_t mid = (e - b > job.uGrain) ? b + (e - b) / 2 : b;
+        if (victim.range.compare_exchange_strong(v, PackRange(b, mid), std::memory_order_acq_rel))
+        {
+            uBegin = mid;
+            uEnd = e;
+            return true;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Persistent worker pool with range based work stealing
+//
+// ParallelFor splits [0, count) evenly over the participating threads. Every
+// participant pulls grain sized chunks from the front of its own range; once it
+// runs dry it steals the back half of the largest remaining range. The calling
+// thread always participates, so a pool without workers degrades to a plain loop.
+//-------------------------------------------------------------------------------------
+
+class ThreadPool
+{
+public:
+    typedef std::function<void(size_t uBegin, size_t uEnd)> RangeFunc;
+
+    explicit ThreadPool(size_t uWorkers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that can work on a job, including the caller
+    size_t GetConcurrency() const { return m_aWorkers.size() + 1; }
+
+    // Runs func over [0, count) on at most uThreads threads (0 = all) and blocks
+    // until every item has been processed
+    void ParallelFor(size_t count, size_t grain, size_t uThreads, const RangeFunc& func);
+
+    // Process wide pool sized to the hardware concurrency
+    static ThreadPool& GetShared();
+
+    // Resolves a user supplied thread count, 0 meaning one per hardware thread
+    static size_t ResolveThreadCount(size_t uThreads);
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> range;    // begin << 32 | end
+    };
+
+    struct Job
+    {
+        const RangeFunc* pFunc;
+        Slot* pSlots;
+        size_t uParticipants;
+        size_t uNextSlot;
+        size_t uActive;
+        size_t uGrain;
+    };
+
+    void WorkerMain();
+    static void RunParticipant(Job& job, size_t uSlot);
+    static bool PopRange(Slot& slot, size_t uGrain, size_t& uBegin, size_t& uEnd);
+    static bool StealRange(Job& job, size_t uSelf, size_t& uBegin, size_t& uEnd);
+
+    std::vector<std::thread> m_aWorkers;
+    std::mutex m_submitMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCV;
+    std::condition_variable m_doneCV;
+    Job* m_pJob;
+    uint64_t m_uGeneration;
+    bool m_bShutdown;
+};
+
+} // namespace
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <immintrin.h>
+
+
+namespace Tex {
+
+// 8 x float lanes for the lane templates, AVX2. Only include from files built with the
+// matching instruction set flags; the anonymous namespace keeps every
+// instantiation local.
+namespace {
+
+struct VecAVX2
+{
+    typedef __m256 F;
+    static const size_t WIDTH = 8;
+
+    static F Zero() { return _mm256_setzero_ps(); }
+    static F Set1(float f) { return _mm256_set1_ps(f); }
+    static F Load(const float *p) { return _mm256_load_ps(p); }
+    static void Store(float *p, F a) { _mm256_store_ps(p, a); }
+    static F Add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F Div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F Abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static F Trunc(F a) { return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+    static F Min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F Max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F CmpEQ(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static F CmpLT(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static F CmpGT(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static F CmpLE(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static F CmpGE(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static F And(F a, F b) { return _mm256_and_ps(a, b); }
+    static F Or(F a, F b) { return _mm256_or_ps(a, b); }
+    static F AndNot(F a, F b) { return _mm256_andnot_ps(a, b); }
+    static F Select(F a, F b, F mask) { return _mm256_blendv_ps(a, b, mask); }
+    static int MoveMask(F a) { return _mm256_movemask_ps(a); }
+};
+
+}
+
+} // namespace
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <smmintrin.h>
+
+
+namespace Tex {
+
+// 4 x float lanes for the lane templates, SSE4.1. Only include from files built with the
+// matching instruction set flags; the anonymous namespace keeps every
+// instantiation local.
+namespace {
+
+struct VecSSE41
+{
+    typedef __m128 F;
+    static const size_t WIDTH = 4;
+
+    static F Zero() { return _mm_setzero_ps(); }
+    static F Set1(float f) { return _mm_set1_ps(f); }
+    static F Load(const float *p) { return _mm_load_ps(p); }
+    static void Store(float *p, F a) { _mm_store_ps(p, a); }
+    static F Add(F a, F b) { return _mm_add_ps(a, b); }
+    static F Sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F Mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F Div(F a, F b) { return _mm_div_ps(a, b); }
+    static F Abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static F Trunc(F a) { return _mm_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+    static F Min(F a, F b) { return _mm_min_ps(a, b); }
+    static F Max(F a, F b) { return _mm_max_ps(a, b); }
+    static F CmpEQ(F a, F b) { return _mm_cmpeq_ps(a, b); }
+    static F CmpLT(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static F CmpGT(F a, F b) { return _mm_cmpgt_ps(a, b); }
+    static F CmpLE(F a, F b) { return _mm_cmple_ps(a, b); }
+    static F CmpGE(F a, F b) { return _mm_cmpge_ps(a, b); }
+    static F And(F a, F b) { return _mm_and_ps(a, b); }
+    static F Or(F a, F b) { return _mm_or_ps(a, b); }
+    static F AndNot(F a, F b) { return _mm_andnot_ps(a, b); }
+    static F Select(F a, F b, F mask) { return _mm_blendv_ps(a, b, mask); }
+    static int MoveMask(F a) { return _mm_movemask_ps(a); }
+};
+
+}
+
+} // namespace
@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Codecs.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+// BC1 picks its overload by the input type, these pin the HDRColorA/LDRColorA ones
+void EncodeBC1HDR(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags) { EncodeBC1(pBC, pColor, flags); }
+void EncodeBC1LDR(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags) { EncodeBC1(pBC, pColor, flags); }
+void EncodeBC2HDR(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags) { EncodeBC2(pBC, pColor, flags); }
+void EncodeBC2LDR(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags) { EncodeBC2(pBC, pColor, flags); }
+void EncodeBC3HDR(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags) { EncodeBC3(pBC, pColor, flags); }
+void EncodeBC3LDR(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags) { EncodeBC3(pBC, pColor, flags); }
+void EncodeBC6HUHDR(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags) { EncodeBC6HU(pBC, pColor, flags); }
+void EncodeBC6HUHalf(uint8_t *pBC, const uint16_t *pColor, uint32_t flags) { EncodeBC6HU(pBC, pColor, flags); }
+void EncodeBC6HSHDR(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags) { EncodeBC6HS(pBC, pColor, flags); }
+void EncodeBC6HSHalf(uint8_t *pBC, const uint16_t *pColor, uint32_t flags) { EncodeBC6HS(pBC, pColor, flags); }
+void EncodeBC7HDR(uint8_t *pBC, const HDRColorA *pColor, uint32_t flags) { EncodeBC7(pBC, pColor, flags); }
+void EncodeBC7LDR(uint8_t *pBC, const LDRColorA *pColor, uint32_t flags) { EncodeBC7(pBC, pColor, flags); }
+void DecodeBC6HUHDR(HDRColorA *pColor, const uint8_t *pBC) { DecodeBC6HU(pColor, pBC); }
+void DecodeBC6HUHalf(uint16_t *pColor, const uint8_t *pBC) { DecodeBC6HU(pColor, pBC); }
+void DecodeBC6HSHDR(HDRColorA *pColor, const uint8_t *pBC) { DecodeBC6HS(pColor, pBC); }
+void DecodeBC6HSHalf(uint16_t *pColor, const uint8_t *pBC) { DecodeBC6HS(pColor, pBC); }
+void DecodeBC1LDR(LDRColorA *pColor, const uint8_t *pBC) { DecodeBC1(pColor, pBC); }
+void DecodeBC2LDR(LDRColorA *pColor, const uint8_t *pBC) { DecodeBC2(pColor, pBC); }
+void DecodeBC3LDR(LDRColorA *pColor, const uint8_t *pBC) { DecodeBC3(pColor, pBC); }
+void DecodeBC7LDR(LDRColorA *pColor, const uint8_t *pBC) { DecodeBC7(pColor, pBC); }
+
+// Row decoders behind the untyped BC_DECODE_ROW signature
+template <typename T, void (*Fn)(T *, size_t, const uint8_t *, size_t)>
+void DecodeRow(void *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    Fn(static_cast<T *>(pDst), rowPitch, pBC, nBlocks);
+}
+
+const struct FlagName
+{
+    uint32_t flag;
+    const char *name;
+} g_aFlagNames[] =
+{
+    { BC_FLAGS_DITHER_RGB, "DITHER_RGB" },
+    { BC_FLAGS_DITHER_A, "DITHER_A" },
+    { BC_FLAGS_UNIFORM, "UNIFORM" },
+    { BC_FLAGS_USE_3SUBSETS, "USE_3SUBSETS" },
+    { BC_FLAGS_FORCE_BC7_MODE6, "FORCE_BC7_MODE6" },
+    { BC_FLAGS_NO_BLOCK_CACHE, "NO_BLOCK_CACHE" },
+};
+
+const char *g_aEffortNames[] = { "EFFORT_NORMAL", "EFFORT_FAST", "EFFORT_SLOW", "EFFORT_EXHAUSTIVE" };
+
+}
+
+const std::vector<CodecInfo>& GetCodecs()
+{
+    static const std::vector<CodecInfo> codecs =
+    {
+        { "bc1", BC_FORMAT_BC1, 8, EncodeBC1HDR, EncodeBC1LDR, nullptr, nullptr, nullptr, DecodeBC1, nullptr, false, 4, DecodeBC1LDR,
+            { { "decode_row", DecodeRow<uint8_t, DecodeBC1Row>, 4 } } },
+        { "bc2", BC_FORMAT_BC2, 16, EncodeBC2HDR, EncodeBC2LDR, nullptr, nullptr, nullptr, DecodeBC2, nullptr, false, 4, DecodeBC2LDR,
+            { { "decode_row", DecodeRow<uint8_t, DecodeBC2Row>, 4 } } },
+        { "bc3", BC_FORMAT_BC3, 16, EncodeBC3HDR, EncodeBC3LDR, nullptr, nullptr, nullptr, DecodeBC3, nullptr, false, 4, DecodeBC3LDR,
+            { { "decode_row", DecodeRow<uint8_t, DecodeBC3Row>, 4 } } },
+        { "bc4u", BC_FORMAT_BC4U, 8, EncodeBC4U, nullptr, nullptr, EncodeBC4UBatch, nullptr, DecodeBC4U, nullptr, false, 1, nullptr,
+            { { "decode_row", DecodeRow<uint8_t, DecodeBC4URow>, 1 },
+              { "decode_row_16", DecodeRow<uint16_t, DecodeBC4URow>, 2 },
+              { "decode_row_float", DecodeRow<float, DecodeBC4URow>, 4 } } },
+        { "bc4s", BC_FORMAT_BC4S, 8, EncodeBC4S, nullptr, nullptr, EncodeBC4SBatch, nullptr, DecodeBC4S, nullptr, false, 1, nullptr,
+            { { "decode_row", DecodeRow<int8_t, DecodeBC4SRow>, 1 },
+              { "decode_row_16", DecodeRow<int16_t, DecodeBC4SRow>, 2 },
+              { "decode_row_float", DecodeRow<float, DecodeBC4SRow>, 4 } } },
+        { "bc5u", BC_FORMAT_BC5U, 16, EncodeBC5U, nullptr, nullptr, nullptr, EncodeBC5UBatch, DecodeBC5U, nullptr, false, 2, nullptr,
+            { { "decode_row", DecodeRow<uint8_t, DecodeBC5URow>, 2 },
+              { "decode_row_16", DecodeRow<uint16_t, DecodeBC5URow>, 4 },
+              { "decode_row_float", DecodeRow<float, DecodeBC5URow>, 8 } } },
+        { "bc5s", BC_FORMAT_BC5S, 16, EncodeBC5S, nullptr, nullptr, nullptr, EncodeBC5SBatch, DecodeBC5S, nullptr, false, 2, nullptr,
+            { { "decode_row", DecodeRow<int8_t, DecodeBC5SRow>, 2 },
+              { "decode_row_16", DecodeRow<int16_t, DecodeBC5SRow>, 4 },
+              { "decode_row_float", DecodeRow<float, DecodeBC5SRow>, 8 } } },
+        { "bc6hu", BC_FORMAT_BC6HU, 16, EncodeBC6HUHDR, nullptr, EncodeBC6HUHalf, nullptr, nullptr, DecodeBC6HUHDR, DecodeBC6HUHalf, true, 3, nullptr,
+            { { "decode_row_half", DecodeRow<uint16_t, DecodeBC6HURow>, 8 },
+              { "decode_row_float", DecodeRow<float, DecodeBC6HURow>, 16 } } },
+        { "bc6hs", BC_FORMAT_BC6HS, 16, EncodeBC6HSHDR, nullptr, EncodeBC6HSHalf, nullptr, nullptr, DecodeBC6HSHDR, DecodeBC6HSHalf, true, 3, nullptr,
+            { { "decode_row_half", DecodeRow<uint16_t, DecodeBC6HSRow>, 8 },
+              { "decode_row_float", DecodeRow<float, DecodeBC6HSRow>, 16 } } },
+        { "bc7", BC_FORMAT_BC7, 16, EncodeBC7HDR, EncodeBC7LDR, nullptr, nullptr, nullptr, DecodeBC7, nullptr, false, 4, DecodeBC7LDR,
+            { { "decode_row", DecodeRow<uint8_t, DecodeBC7Row>, 4 } } },
+    };
+    return codecs;
+}
+
+const CodecInfo *FindCodec(const char *name)
+{
+    for (const CodecInfo& codec : GetCodecs())
+    {
+        if (strcmp(codec.name, name) == 0)
+            return &codec;
+    }
+    return nullptr;
+}
+
+std::vector<uint32_t> GetFlagSets(BC_FORMAT format)
+{
+    std::vector<uint32_t> sets;
+    switch (format)
+    {
+    case BC_FORMAT_BC1:
+        for (uint32_t uniform : { 0u, uint32_t(BC_FLAGS_UNIFORM) })
+        {
+            for (uint32_t dither : { 0u, uint32_t(BC_FLAGS_DITHER_RGB) })
+                sets.push_back(uniform | dither);
+        }
+        break;
+
+    case BC_FORMAT_BC2:
+    case BC_FORMAT_BC3:
+        for (uint32_t uniform : { 0u, uint32_t(BC_FLAGS_UNIFORM) })
+        {
+            for (uint32_t dither : { 0u, uint32_t(BC_FLAGS_DITHER_RGB), uint32_t(BC_FLAGS_DITHER_A),
+                uint32_t(BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A) })
+            {
+                sets.push_back(uniform | dither);
+            }
+        }
+        break;
+
+    case BC_FORMAT_BC6HU:
+    case BC_FORMAT_BC6HS:
+        sets.push_back(BC_FLAGS_EFFORT_NORMAL);
+        sets.push_back(BC_FLAGS_EFFORT_FAST);
+        break;
+
+    case BC_FORMAT_BC7:
+        for (uint32_t effort : { uint32_t(BC_FLAGS_EFFORT_NORMAL), uint32_t(BC_FLAGS_EFFORT_FAST),
+            uint32_t(BC_FLAGS_EFFORT_SLOW), uint32_t(BC_FLAGS_EFFORT_EXHAUSTIVE) })
+        {
+            for (uint32_t modes : { 0u, uint32_t(BC_FLAGS_USE_3SUBSETS), uint32_t(BC_FLAGS_FORCE_BC7_MODE6) })
+                sets.push_back(effort | modes);
+        }
+        break;
+
+    default:
+        sets.push_back(BC_FLAGS_NONE);
+        break;
+    }
+    return sets;
+}
+
+std::string FormatFlags(uint32_t flags)
+{
+    std::string text;
+    for (const FlagName& entry : g_aFlagNames)
+    {
+        if (flags & entry.flag)
+        {
+            if (!text.empty())
+                text += '|';
+            text += entry.name;
+        }
+    }
+
+    const uint32_t effort = (flags & BC_FLAGS_EFFORT_MASK) >> 21;
+    if (effort)
+    {
+        if (!text.empty())
+            text += '|';
+        text += g_aEffortNames[effort];
+    }
+
+    return text.empty() ? "NONE" : text;
+}
+
+bool ParseFlags(const char *text, uint32_t& flags)
+{
+    flags = BC_FLAGS_NONE;
+    while (*text)
+    {
+        const char *pEnd = strchr(text, '|');
+        const size_t len = pEnd ? size_t(pEnd - text) : strlen(text);
+        const std::string name(text, len);
+        text += len + (pEnd ? 1 : 0);
+
+        if (name == "NONE")
+            continue;
+
+        bool bFound = false;
+        for (const FlagName& entry : g_aFlagNames)
+        {
+            if (name == entry.name)
+            {
+                flags |= entry.flag;
+                bFound = true;
+            }
+        }
+        for (uint32_t effort = 0; effort < 4; ++effort)
+        {
+            if (name == g_aEffortNames[effort])
+            {
+                flags = (flags & ~uint32_t(BC_FLAGS_EFFORT_MASK)) | (effort << 21);
+                bFound = true;
+            }
+        }
+        if (!bFound)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
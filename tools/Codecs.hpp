@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "crosstex/BC.hpp"
+#include "crosstex/Surface.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Entry points of each codec, so the tools can loop over them
+//-------------------------------------------------------------------------------------
+
+typedef void (*BC_ENCODE_HALF)(uint8_t *pBC, const uint16_t *pColor, uint32_t flags);
+typedef void (*BC_DECODE_HALF)(uint16_t *pColor, const uint8_t *pBC);
+typedef void (*BC_ENCODE_BATCH1)(uint8_t *pBC, const float *pRed, size_t nBlocks, uint32_t flags);
+typedef void (*BC_ENCODE_BATCH2)(uint8_t *pBC, const float *pRed, const float *pGreen, size_t nBlocks, uint32_t flags);
+typedef void (*BC_DECODE_LDR)(LDRColorA *pColor, const uint8_t *pBC);
+
+// Decodes nBlocks blocks side by side like DecodeBC1Row, pDst points to the
+// texel type of the variant
+typedef void (*BC_DECODE_ROW)(void *pDst, size_t rowPitch, const uint8_t *pBC, size_t nBlocks);
+
+struct RowDecoder
+{
+    const char *api;                    // Bench entry point name, "decode_row" ...
+    BC_DECODE_ROW pfDecode;
+    size_t texelSize;                   // Destination bytes per texel
+};
+
+struct CodecInfo
+{
+    const char *name;
+    BC_FORMAT format;
+    size_t blockSize;
+    BC_ENCODE pfEncode;
+    BC_ENCODE_LDR pfEncodeLDR;          // nullptr when the codec has no RGBA8 entry point
+    BC_ENCODE_HALF pfEncodeHalf;        // nullptr when the codec has no RGBA16F entry point
+    BC_ENCODE_BATCH1 pfEncodeBatch1;    // Planar BC4 batch
+    BC_ENCODE_BATCH2 pfEncodeBatch2;    // Planar BC5 batch
+    BC_DECODE pfDecode;
+    BC_DECODE_HALF pfDecodeHalf;
+    bool bHDR;                          // Keeps values outside [0, 1]
+    size_t channels;                    // Channels the codec stores, from red on
+    BC_DECODE_LDR pfDecodeLDR;          // nullptr when the codec has no RGBA8 decoder
+    std::vector<RowDecoder> rowDecoders;
+};
+
+// Every codec of the library
+const std::vector<CodecInfo>& GetCodecs();
+
+// nullptr for unknown names, names are lower case ("bc1", "bc6hu", ...)
+const CodecInfo *FindCodec(const char *name);
+
+// The combinations of the flags that change how the codec encodes; the first
+// entry is the default
+std::vector<uint32_t> GetFlagSets(BC_FORMAT format);
+
+// "NONE" or the flag names joined by '|'
+std::string FormatFlags(uint32_t flags);
+
+// Parses a name list as printed by FormatFlags, returns false on unknown names
+bool ParseFlags(const char *text, uint32_t& flags);
+
+} // namespace
@@ -0,0 +1,291 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "Corpus.hpp"
+
+
+namespace Tex {
+
+namespace {
+
+// Small LCG so the corpus does not depend on the C library's rand()
+class Random
+{
+public:
+    explicit Random(uint32_t uSeed) : m_uState(uSeed) {}
+
+    uint32_t Next()
+    {
+        m_uState = m_uState * 1664525u + 1013904223u;
+        return m_uState >> 8;
+    }
+
+    uint8_t NextByte() { return uint8_t(Next() >> 8); }
+
+    float NextFloat() { return float(Next() & 0xFFFF) * (1.0f / 65535.0f); }
+
+private:
+    uint32_t m_uState;
+};
+
+uint8_t ToByte(float f)
+{
+    return uint8_t(std::min(std::max(f, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+CorpusImage NewImage(const char *name, size_t width, size_t height, bool bHDR)
+{
+    CorpusImage image;
+    image.name = name;
+    image.width = width;
+    image.height = height;
+    image.bHDR = bHDR;
+    image.texels.resize(width * height);
+    image.texelsLDR.resize(width * height);
+    image.texelsHalf.resize(width * height * 4);
+    return image;
+}
+
+// Derives the float and half texels from the 8-bit ones
+void FinishLDR(CorpusImage& image)
+{
+    for (size_t i = 0; i < image.texelsLDR.size(); ++i)
+        image.texels[i] = image.texelsLDR[i].ToHDRColorA();
+    for (size_t i = 0; i < image.texels.size(); ++i)
+    {
+        image.texelsHalf[i * 4 + 0] = INTColor::FloatToHalf(image.texels[i].r);
+        image.texelsHalf[i * 4 + 1] = INTColor::FloatToHalf(image.texels[i].g);
+        image.texelsHalf[i * 4 + 2] = INTColor::FloatToHalf(image.texels[i].b);
+        image.texelsHalf[i * 4 + 3] = INTColor::FloatToHalf(image.texels[i].a);
+    }
+}
+
+// Derives the 8-bit and half texels from the float ones
+void FinishHDR(CorpusImage& image)
+{
+    for (size_t i = 0; i < image.texels.size(); ++i)
+    {
+        const HDRColorA& c = image.texels[i];
+        image.texelsLDR[i] = LDRColorA(ToByte(c.r), ToByte(c.g), ToByte(c.b), ToByte(c.a));
+        image.texelsHalf[i * 4 + 0] = INTColor::FloatToHalf(c.r);
+        image.texelsHalf[i * 4 + 1] = INTColor::FloatToHalf(c.g);
+        image.texelsHalf[i * 4 + 2] = INTColor::FloatToHalf(c.b);
+        image.texelsHalf[i * 4 + 3] = INTColor::FloatToHalf(c.a);
+    }
+}
+
+// Smooth ramps in every channel, the easy case for all codecs
+CorpusImage BuildGradient(size_t size)
+{
+    CorpusImage image = NewImage("gradient", size, size, false);
+    const float fScale = 1.0f / float(size > 1 ? size - 1 : 1);
+    for (size_t y = 0; y < size; ++y)
+    {
+        for (size_t x = 0; x < size; ++x)
+        {
+            const float u = float(x) * fScale;
+            const float v = float(y) * fScale;
+            image.texelsLDR[y * size + x] = LDRColorA(ToByte(u), ToByte(v), ToByte(1.0f - 0.5f * (u + v)),
+                ToByte(0.25f + 0.75f * u * v));
+        }
+    }
+    FinishLDR(image);
+    return image;
+}
+
+// Uniform white noise, the worst case for the endpoint searches
+CorpusImage BuildNoise(size_t size)
+{
+    CorpusImage image = NewImage("noise", size, size, false);
+    Random rng(0x6E6F6973);
+    for (LDRColorA& c : image.texelsLDR)
+        c = LDRColorA(rng.NextByte(), rng.NextByte(), rng.NextByte(), rng.NextByte());
+    FinishLDR(image);
+    return image;
+}
+
+// Tangent space normals of a rolling height field, stored as 0.5 + 0.5 * n
+CorpusImage BuildNormalMap(size_t size)
+{
+    CorpusImage image = NewImage("normalmap", size, size, false);
+    const float fFreq = 6.2831853f / float(size) * 3.0f;
+    for (size_t y = 0; y < size; ++y)
+    {
+        for (size_t x = 0; x < size; ++x)
+        {
+            const float dx = 0.8f * cosf(float(x) * fFreq) * cosf(float(y) * fFreq * 0.5f)
+                + 0.3f * cosf(float(x + y) * fFreq * 2.3f);
+            const float dy = -0.4f * sinf(float(x) * fFreq) * sinf(float(y) * fFreq * 0.5f)
+                + 0.3f * cosf(float(x + y) * fFreq * 2.3f);
+            const float fLen = sqrtf(dx * dx + dy * dy + 1.0f);
+            image.texelsLDR[y * size + x] = LDRColorA(ToByte(0.5f - 0.5f * dx / fLen),
+                ToByte(0.5f - 0.5f * dy / fLen), ToByte(0.5f + 0.5f / fLen), 255);
+        }
+    }
+    FinishLDR(image);
+    return image;
+}
+
+// Textured discs with binary alpha, the foliage/decal case for BC1 color keying
+CorpusImage BuildCutout(size_t size)
+{
+    CorpusImage image = NewImage("cutout", size, size, false);
+    Random rng(0x63757420);
+    const size_t uCell = std::max<size_t>(size / 8, 4);
+    for (size_t y = 0; y < size; ++y)
+    {
+        for (size_t x = 0; x < size; ++x)
+        {
+            const float cx = float(x % uCell) - 0.5f * float(uCell);
+            const float cy = float(y % uCell) - 0.5f * float(uCell);
+            const bool bInside = (cx * cx + cy * cy) < 0.16f * float(uCell * uCell);
+            const uint8_t uDetail = rng.NextByte() >> 3;
+            image.texelsLDR[y * size + x] = LDRColorA(uint8_t(40 + uDetail), uint8_t(120 + uDetail * 2),
+                uint8_t(30 + (x * 64) / size), bInside ? 255 : 0);
+        }
+    }
+    FinishLDR(image);
+    return image;
+}
+
+// Sky dome gradient with a sun several stops above white, for BC6H
+CorpusImage BuildHDRSky(size_t size)
+{
+    CorpusImage image = NewImage("hdrsky", size, size, true);
+    const float fScale = 1.0f / float(size);
+    const float sx = 0.7f;
+    const float sy = 0.25f;
+    for (size_t y = 0; y < size; ++y)
+    {
+        for (size_t x = 0; x < size; ++x)
+        {
+            const float u = (float(x) + 0.5f) * fScale;
+            const float v = (float(y) + 0.5f) * fScale;
+            const float d2 = (u - sx) * (u - sx) + (v - sy) * (v - sy);
+            const float fSun = 24.0f * expf(-d2 * 900.0f) + 1.5f * expf(-d2 * 40.0f);
+            image.texels[y * size + x] = HDRColorA(0.15f + 0.3f * v + fSun, 0.3f + 0.35f * v + fSun * 0.9f,
+                0.9f - 0.4f * v + fSun * 0.7f, 1.0f);
+        }
+    }
+    FinishHDR(image);
+    return image;
+}
+
+bool ReadFile(const char *path, std::vector<uint8_t>& data)
+{
+    FILE *pFile = fopen(path, "rb");
+    if (!pFile)
+        return false;
+
+    uint8_t aBuffer[65536];
+    size_t uRead;
+    while ((uRead = fread(aBuffer, 1, sizeof(aBuffer), pFile)) > 0)
+        data.insert(data.end(), aBuffer, aBuffer + uRead);
+
+    const bool bOK = !ferror(pFile);
+    fclose(pFile);
+    return bOK;
+}
+
+}
+
+std::vector<CorpusImage> BuildSyntheticCorpus(size_t size)
+{
+    std::vector<CorpusImage> corpus;
+    corpus.push_back(BuildGradient(size));
+    corpus.push_back(BuildNoise(size));
+    corpus.push_back(BuildNormalMap(size));
+    corpus.push_back(BuildCutout(size));
+    corpus.push_back(BuildHDRSky(size));
+    return corpus;
+}
+
+bool LoadRawImage(const char *spec, CorpusImage& image, std::string& error)
+{
+    const char *pSize = strrchr(spec, ':');
+    const char *pFormat = pSize;
+    if (pSize)
+    {
+        pSize = nullptr;
+        for (const char *p = pFormat - 1; p >= spec; --p)
+        {
+            if (*p == ':')
+            {
+                pSize = p;
+                break;
+            }
+        }
+    }
+
+    unsigned long width = 0;
+    unsigned long height = 0;
+    if (!pSize || sscanf(pSize + 1, "%lux%lu", &width, &height) != 2 || width == 0 || height == 0)
+    {
+        error = std::string("expected path:WIDTHxHEIGHT:format, got ") + spec;
+        return false;
+    }
+
+    const std::string path(spec, pSize);
+    const std::string format(pFormat + 1);
+    size_t texelSize;
+    if (format == "rgba8")
+        texelSize = 4;
+    else if (format == "rgba16f")
+        texelSize = 8;
+    else if (format == "rgba32f")
+        texelSize = 16;
+    else
+    {
+        error = "unknown raw format " + format;
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    if (!ReadFile(path.c_str(), data))
+    {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    const size_t nTexels = size_t(width) * size_t(height);
+    if (data.size() != nTexels * texelSize)
+    {
+        error = path + " does not hold " + std::to_string(nTexels) + " " + format + " texels";
+        return false;
+    }
+
+    const size_t uSlash = path.find_last_of("/\\");
+    const bool bHDR = (format != "rgba8");
+    image = NewImage(path.c_str() + (uSlash == std::string::npos ? 0 : uSlash + 1), width, height, bHDR);
+
+    if (format == "rgba8")
+    {
+        memcpy(image.texelsLDR.data(), data.data(), data.size());
+        FinishLDR(image);
+    }
+    else if (format == "rgba16f")
+    {
+        memcpy(image.texelsHalf.data(), data.data(), data.size());
+        for (size_t i = 0; i < nTexels; ++i)
+        {
+            const uint16_t *pHalf = &image.texelsHalf[i * 4];
+            image.texels[i] = HDRColorA(INTColor::HalfToFloat(pHalf[0]), INTColor::HalfToFloat(pHalf[1]),
+                INTColor::HalfToFloat(pHalf[2]), INTColor::HalfToFloat(pHalf[3]));
+        }
+        FinishHDR(image);
+    }
+    else
+    {
+        memcpy(image.texels.data(), data.data(), data.size());
+        FinishHDR(image);
+    }
+
+    return true;
+}
+
+} // namespace
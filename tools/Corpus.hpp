@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "crosstex/Colors.hpp"
+
+
+namespace Tex {
+
+//-------------------------------------------------------------------------------------
+// Test images shared by the benchmark and quality tools
+//
+// Every image carries its texels in the three input formats of the library. LDR
+// images are generated as 8-bit texels and widened exactly, so all encoder
+// entry points see the same values; HDR images are clamped and rounded for the
+// 8-bit copy.
+//-------------------------------------------------------------------------------------
+
+struct CorpusImage
+{
+    std::string name;
+    size_t width;
+    size_t height;
+    bool bHDR;                          // Texels leave [0, 1]
+    std::vector<HDRColorA> texels;      // Row major, width * height
+    std::vector<LDRColorA> texelsLDR;
+    std::vector<uint16_t> texelsHalf;   // RGBA16F, 4 halves per texel
+};
+
+// Deterministic synthetic images of size x size texels: "gradient", "noise",
+// "normalmap", "cutout" and "hdrsky"
+std::vector<CorpusImage> BuildSyntheticCorpus(size_t size);
+
+// Loads a headerless image described as "path:WIDTHxHEIGHT:format", format being
+// rgba8, rgba16f or rgba32f. Returns false with a message in error on failure.
+bool LoadRawImage(const char *spec, CorpusImage& image, std::string& error);
+
+// Gathers the 4x4 blocks of an image row by row, replicating the last column/row
+// for blocks that hang over the edge, the order used by EncodeSurface
+template <typename Color>
+std::vector<Color> GatherBlocks(const Color *pTexels, size_t width, size_t height)
+{
+    const size_t blocksWide = (width + 3) / 4;
+    const size_t blocksHigh = (height + 3) / 4;
+    std::vector<Color> blocks(blocksWide * blocksHigh * 16);
+    Color *pBlock = blocks.data();
+    for (size_t by = 0; by < blocksHigh; ++by)
+    {
+        for (size_t bx = 0; bx < blocksWide; ++bx)
+        {
+            for (size_t i = 0; i < 16; ++i)
+            {
+                const size_t x = std::min(bx * 4 + (i & 3), width - 1);
+                const size_t y = std::min(by * 4 + (i >> 2), height - 1);
+                *pBlock++ = pTexels[y * width + x];
+            }
+        }
+    }
+    return blocks;
+}
+
+} // namespace
@@ -0,0 +1,587 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "crosstex/BC.hpp"
+#include "crosstex/Surface.hpp"
+#include "Codecs.hpp"
+#include "Corpus.hpp"
+#include "ThreadPool.hpp"
+
+using namespace Tex;
+
+
+//-------------------------------------------------------------------------------------
+// crosstex_bench: throughput of every encode/decode entry point
+//
+// Each case runs repeatedly until --min-time has passed and reports the mean
+// time of one run. Per block entry points run on the calling thread; the surface
+// entry points run once per --threads value, which gives the scaling curves.
+//-------------------------------------------------------------------------------------
+
+namespace {
+
+struct Options
+{
+    size_t size = 256;
+    double minTime = 0.25;
+    bool bAllFlags = true;
+    bool bNoCache = false;
+    bool bSynthetic = true;
+    std::vector<size_t> threads;
+    std::vector<std::string> images;
+    std::vector<std::string> codecs;
+    std::vector<std::string> apis;
+    std::vector<std::string> raws;
+    std::string jsonPath;
+};
+
+struct Result
+{
+    std::string image;
+    size_t width;
+    size_t height;
+    std::string codec;
+    std::string api;
+    uint32_t flags;
+    size_t threads;
+    size_t blocks;
+    size_t iterations;
+    double seconds;     // Per iteration
+    double speedup;     // Against the first thread count, 0 for per block entry points
+};
+
+void PrintUsage()
+{
+    printf(
+        "usage: crosstex_bench [options]\n"
+        "  --size N            edge of the synthetic images (256)\n"
+        "  --image NAME        only this corpus image, repeatable\n"
+        "  --raw SPEC          add path:WIDTHxHEIGHT:rgba8|rgba16f|rgba32f, repeatable\n"
+        "  --no-synthetic      skip the synthetic corpus\n"
+        "  --codec NAME        only this codec (bc1 ... bc7), repeatable\n"
+        "  --api NAME          only this entry point, repeatable:\n"
+        "                      encode, encode_ldr, encode_half, encode_threshold, encode_batch,\n"
+        "                      decode, decode_half, decode_ldr, decode_row, decode_row_16,\n"
+        "                      decode_row_half, decode_row_float, encode_surface, encode_surface_ldr,\n"
+        "                      encode_surface_half, decode_surface, decode_surface_half,\n"
+        "                      decode_surface_ldr\n"
+        "  --default-flags     only the default flags instead of every combination\n"
+        "  --no-cache          add BC_FLAGS_NO_BLOCK_CACHE to the surface encoders\n"
+        "  --threads LIST      comma separated thread counts for the surface entry points\n"
+        "                      (1, 2, 4, ... up to the pool threads); larger counts are\n"
+        "                      clamped to the thread pool size\n"
+        "  --min-time S        seconds each case runs for at least (0.25)\n"
+        "  --json PATH         also write the results as JSON\n");
+}
+
+bool Contains(const std::vector<std::string>& list, const std::string& value)
+{
+    if (list.empty())
+        return true;
+    for (const std::string& entry : list)
+    {
+        if (entry == value)
+            return true;
+    }
+    return false;
+}
+
+bool ParseOptions(int argc, char **argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool bHasValue = (i + 1 < argc);
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            exit(0);
+        }
+        else if (arg == "--no-synthetic")
+            options.bSynthetic = false;
+        else if (arg == "--default-flags")
+            options.bAllFlags = false;
+        else if (arg == "--no-cache")
+            options.bNoCache = true;
+        else if (!bHasValue)
+        {
+            fprintf(stderr, "unknown option or missing value: %s\n", arg.c_str());
+            return false;
+        }
+        else if (arg == "--size")
+            options.size = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--image")
+            options.images.push_back(argv[++i]);
+        else if (arg == "--raw")
+            options.raws.push_back(argv[++i]);
+        else if (arg == "--codec")
+            options.codecs.push_back(argv[++i]);
+        else if (arg == "--api")
+            options.apis.push_back(argv[++i]);
+        else if (arg == "--min-time")
+            options.minTime = strtod(argv[++i], nullptr);
+        else if (arg == "--json")
+            options.jsonPath = argv[++i];
+        else if (arg == "--threads")
+        {
+            for (const char *p = argv[++i]; *p; )
+            {
+                char *pEnd;
+                const size_t uThreads = strtoul(p, &pEnd, 10);
+                if (pEnd == p || uThreads == 0)
+                {
+                    fprintf(stderr, "bad thread list: %s\n", argv[i]);
+                    return false;
+                }
+                options.threads.push_back(uThreads);
+                p = (*pEnd == ',') ? pEnd + 1 : pEnd;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (options.size == 0)
+    {
+        fprintf(stderr, "--size must be positive\n");
+        return false;
+    }
+
+    for (const std::string& name : options.codecs)
+    {
+        if (!FindCodec(name.c_str()))
+        {
+            fprintf(stderr, "unknown codec: %s\n", name.c_str());
+            return false;
+        }
+    }
+
+    // The surface functions never run on more threads than the shared pool has,
+    // so larger counts would be labelled with threads that never ran
+    const size_t uPool = ThreadPool::GetShared().GetConcurrency();
+    if (options.threads.empty())
+    {
+        for (size_t uThreads = 1; uThreads < uPool; uThreads *= 2)
+            options.threads.push_back(uThreads);
+        options.threads.push_back(uPool);
+    }
+
+    std::vector<size_t> threads;
+    for (size_t uThreads : options.threads)
+    {
+        if (uThreads > uPool)
+        {
+            fprintf(stderr, "--threads %zu exceeds the %zu pool threads, measuring %zu\n", uThreads, uPool, uPool);
+            uThreads = uPool;
+        }
+        if (std::find(threads.begin(), threads.end(), uThreads) == threads.end())
+            threads.push_back(uThreads);
+    }
+    options.threads.swap(threads);
+
+    return true;
+}
+
+// Runs fn until minTime has passed, returns the seconds of one run
+double Measure(const std::function<void()>& fn, double minTime, size_t& iterations)
+{
+    typedef std::chrono::steady_clock Clock;
+    iterations = 0;
+    const Clock::time_point start = Clock::now();
+    double elapsed;
+    do
+    {
+        fn();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minTime);
+    return elapsed / double(iterations);
+}
+
+// Inputs of one image in every layout the entry points take
+struct Workload
+{
+    const CorpusImage *pImage;
+    size_t nBlocks;
+    std::vector<HDRColorA> blocks;
+    std::vector<LDRColorA> blocksLDR;
+    std::vector<uint16_t> blocksHalf;
+    std::vector<float> red;     // Planar channels for the batched BC4/BC5 encoders
+    std::vector<float> green;
+};
+
+Workload PrepareWorkload(const CorpusImage& image)
+{
+    Workload work;
+    work.pImage = &image;
+    work.blocks = GatherBlocks(image.texels.data(), image.width, image.height);
+    work.blocksLDR = GatherBlocks(image.texelsLDR.data(), image.width, image.height);
+    work.nBlocks = work.blocks.size() / NUM_PIXELS_PER_BLOCK;
+
+    struct Half4 { uint16_t c[4]; };
+    std::vector<Half4> half = GatherBlocks(reinterpret_cast<const Half4 *>(image.texelsHalf.data()),
+        image.width, image.height);
+    work.blocksHalf.resize(half.size() * 4);
+    memcpy(work.blocksHalf.data(), half.data(), work.blocksHalf.size() * sizeof(uint16_t));
+
+    work.red.resize(work.blocks.size());
+    work.green.resize(work.blocks.size());
+    for (size_t i = 0; i < work.blocks.size(); ++i)
+    {
+        work.red[i] = work.blocks[i].r;
+        work.green[i] = work.blocks[i].g;
+    }
+    return work;
+}
+
+class Bench
+{
+public:
+    explicit Bench(const Options& options) : m_options(options) {}
+
+    void Run(const Workload& work, const CodecInfo& codec)
+    {
+        const CorpusImage& image = *work.pImage;
+        const size_t nBlocks = work.nBlocks;
+        const size_t blockSize = codec.blockSize;
+        std::vector<uint8_t> compressed(nBlocks * blockSize);
+        std::vector<HDRColorA> decoded(image.width * image.height);
+        std::vector<uint16_t> decodedHalf(image.width * image.height * 4);
+        std::vector<LDRColorA> decodedLDR(image.width * image.height);
+        HDRColorA aBlock[NUM_PIXELS_PER_BLOCK];
+        uint16_t aBlockHalf[NUM_PIXELS_PER_BLOCK * 4];
+        LDRColorA aBlockLDR[NUM_PIXELS_PER_BLOCK];
+
+        // Row decoders fill whole blocks, up to 16 bytes per texel
+        const size_t blocksWide = (image.width + 3) / 4;
+        const size_t blocksHigh = (image.height + 3) / 4;
+        std::vector<float> decodedRows(blocksWide * blocksHigh * NUM_PIXELS_PER_BLOCK * 4);
+
+        std::vector<uint32_t> flagSets = GetFlagSets(codec.format);
+        if (!m_options.bAllFlags)
+            flagSets.resize(1);
+        const uint32_t cacheFlags = m_options.bNoCache ? uint32_t(BC_FLAGS_NO_BLOCK_CACHE) : 0u;
+
+        for (uint32_t flags : flagSets)
+        {
+            Single(work, codec, "encode", flags, [&]
+            {
+                for (size_t i = 0; i < nBlocks; ++i)
+                    codec.pfEncode(&compressed[i * blockSize], &work.blocks[i * NUM_PIXELS_PER_BLOCK], flags);
+            });
+
+            if (codec.pfEncodeLDR)
+            {
+                Single(work, codec, "encode_ldr", flags, [&]
+                {
+                    for (size_t i = 0; i < nBlocks; ++i)
+                        codec.pfEncodeLDR(&compressed[i * blockSize], &work.blocksLDR[i * NUM_PIXELS_PER_BLOCK], flags);
+                });
+            }
+
+            if (codec.format == BC_FORMAT_BC1)
+            {
+                Single(work, codec, "encode_threshold", flags, [&]
+                {
+                    for (size_t i = 0; i < nBlocks; ++i)
+                        EncodeBC1(&compressed[i * blockSize], &work.blocksLDR[i * NUM_PIXELS_PER_BLOCK], 0.5f, flags);
+                });
+            }
+
+            if (codec.pfEncodeHalf)
+            {
+                Single(work, codec, "encode_half", flags, [&]
+                {
+                    for (size_t i = 0; i < nBlocks; ++i)
+                        codec.pfEncodeHalf(&compressed[i * blockSize], &work.blocksHalf[i * NUM_PIXELS_PER_BLOCK * 4], flags);
+                });
+            }
+
+            if (codec.pfEncodeBatch1)
+            {
+                Single(work, codec, "encode_batch", flags, [&]
+                {
+                    codec.pfEncodeBatch1(compressed.data(), work.red.data(), nBlocks, flags);
+                });
+            }
+
+            if (codec.pfEncodeBatch2)
+            {
+                Single(work, codec, "encode_batch", flags, [&]
+                {
+                    codec.pfEncodeBatch2(compressed.data(), work.red.data(), work.green.data(), nBlocks, flags);
+                });
+            }
+
+            Scaling(work, codec, "encode_surface", flags, [&](size_t uThreads)
+            {
+                EncodeSurface(codec.format, image.texels.data(), image.width, image.height,
+                    image.width * sizeof(HDRColorA), compressed.data(), flags | cacheFlags, uThreads);
+            });
+
+            if (codec.pfEncodeLDR)
+            {
+                Scaling(work, codec, "encode_surface_ldr", flags, [&](size_t uThreads)
+                {
+                    EncodeSurface(codec.format, image.texelsLDR.data(), image.width, image.height,
+                        image.width * sizeof(LDRColorA), compressed.data(), flags | cacheFlags, uThreads);
+                });
+            }
+
+            if (codec.pfEncodeHalf)
+            {
+                Scaling(work, codec, "encode_surface_half", flags, [&](size_t uThreads)
+                {
+                    EncodeSurface(codec.format, image.texelsHalf.data(), image.width, image.height,
+                        image.width * 4 * sizeof(uint16_t), compressed.data(), flags | cacheFlags, uThreads);
+                });
+            }
+        }
+
+        // Decoders see the output of the default flags
+        if (WantedDecoders())
+        {
+            EncodeSurface(codec.format, image.texels.data(), image.width, image.height,
+                image.width * sizeof(HDRColorA), compressed.data(), flagSets[0]);
+        }
+
+        Single(work, codec, "decode", 0, [&]
+        {
+            for (size_t i = 0; i < nBlocks; ++i)
+                codec.pfDecode(aBlock, &compressed[i * blockSize]);
+        });
+
+        if (codec.pfDecodeHalf)
+        {
+            Single(work, codec, "decode_half", 0, [&]
+            {
+                for (size_t i = 0; i < nBlocks; ++i)
+                    codec.pfDecodeHalf(aBlockHalf, &compressed[i * blockSize]);
+            });
+        }
+
+        if (codec.pfDecodeLDR)
+        {
+            Single(work, codec, "decode_ldr", 0, [&]
+            {
+                for (size_t i = 0; i < nBlocks; ++i)
+                    codec.pfDecodeLDR(aBlockLDR, &compressed[i * blockSize]);
+            });
+        }
+
+        for (const RowDecoder& row : codec.rowDecoders)
+        {
+            const size_t rowPitch = blocksWide * 4 * row.texelSize;
+            Single(work, codec, row.api, 0, [&]
+            {
+                uint8_t *pDst = reinterpret_cast<uint8_t *>(decodedRows.data());
+                for (size_t by = 0; by < blocksHigh; ++by)
+                    row.pfDecode(pDst + by * 4 * rowPitch, rowPitch, &compressed[by * blocksWide * blockSize], blocksWide);
+            });
+        }
+
+        Scaling(work, codec, "decode_surface", 0, [&](size_t uThreads)
+        {
+            DecodeSurface(codec.format, compressed.data(), image.width, image.height,
+                decoded.data(), image.width * sizeof(HDRColorA), uThreads);
+        });
+
+        Scaling(work, codec, "decode_surface_half", 0, [&](size_t uThreads)
+        {
+            DecodeSurface(codec.format, compressed.data(), image.width, image.height,
+                decodedHalf.data(), image.width * 4 * sizeof(uint16_t), uThreads);
+        });
+
+        Scaling(work, codec, "decode_surface_ldr", 0, [&](size_t uThreads)
+        {
+            DecodeSurface(codec.format, compressed.data(), image.width, image.height,
+                decodedLDR.data(), image.width * sizeof(LDRColorA), uThreads);
+        });
+    }
+
+    const std::vector<Result>& GetResults() const { return m_results; }
+
+private:
+    bool Wanted(const char *api) const
+    {
+        return Contains(m_options.apis, api);
+    }
+
+    bool WantedDecoders() const
+    {
+        if (m_options.apis.empty())
+            return true;
+        for (const std::string& api : m_options.apis)
+        {
+            if (api.compare(0, 6, "decode") == 0)
+                return true;
+        }
+        return false;
+    }
+
+    void Single(const Workload& work, const CodecInfo& codec, const char *api, uint32_t flags,
+        const std::function<void()>& fn)
+    {
+        if (!Wanted(api))
+            return;
+
+        Result result = NewResult(work, codec, api, flags, 1);
+        result.seconds = Measure(fn, m_options.minTime, result.iterations);
+        Report(result);
+    }
+
+    void Scaling(const Workload& work, const CodecInfo& codec, const char *api, uint32_t flags,
+        const std::function<void(size_t)>& fn)
+    {
+        if (!Wanted(api))
+            return;
+
+        double baseline = 0.0;
+        for (size_t uThreads : m_options.threads)
+        {
+            Result result = NewResult(work, codec, api, flags, uThreads);
+            result.seconds = Measure([&] { fn(uThreads); }, m_options.minTime, result.iterations);
+            if (baseline == 0.0)
+                baseline = result.seconds;
+            result.speedup = baseline / result.seconds;
+            Report(result);
+        }
+    }
+
+    Result NewResult(const Workload& work, const CodecInfo& codec, const char *api, uint32_t flags, size_t uThreads)
+    {
+        Result result = {};
+        result.image = work.pImage->name;
+        result.width = work.pImage->width;
+        result.height = work.pImage->height;
+        result.codec = codec.name;
+        result.api = api;
+        result.flags = flags;
+        result.threads = uThreads;
+        result.blocks = work.nBlocks;
+        return result;
+    }
+
+    void Report(const Result& result)
+    {
+        const double blocksPerSec = double(result.blocks) / result.seconds;
+        const double mpixPerSec = double(result.width * result.height) / result.seconds * 1e-6;
+        printf("%-10s %-6s %-20s %-40s %3zu %14.0f blk/s %10.4g MPix/s",
+            result.image.c_str(), result.codec.c_str(), result.api.c_str(), FormatFlags(result.flags).c_str(),
+            result.threads, blocksPerSec, mpixPerSec);
+        if (result.speedup > 0.0)
+            printf("  x%.2f", result.speedup);
+        printf("\n");
+        fflush(stdout);
+        m_results.push_back(result);
+    }
+
+    const Options& m_options;
+    std::vector<Result> m_results;
+};
+
+std::string JsonString(const std::string& text)
+{
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (uint8_t(c) < 0x20)
+        {
+            char aEscape[8];
+            snprintf(aEscape, sizeof(aEscape), "\\u%04x", c);
+            out += aEscape;
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+bool WriteJson(const char *path, const Options& options, const std::vector<Result>& results)
+{
+    FILE *pFile = fopen(path, "w");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "{\n  \"tool\": \"crosstex_bench\",\n  \"min_time\": %g,\n  \"hardware_threads\": %u,\n  \"pool_threads\": %zu,\n  \"results\": [\n",
+        options.minTime, std::thread::hardware_concurrency(), ThreadPool::GetShared().GetConcurrency());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        fprintf(pFile,
+            "    {\"image\": %s, \"width\": %zu, \"height\": %zu, \"codec\": %s, \"api\": %s, "
+            "\"flags\": %s, \"flags_value\": %u, \"threads\": %zu, \"blocks\": %zu, \"iterations\": %zu, "
+            "\"seconds\": %.9g, \"blocks_per_sec\": %.6g, \"mpix_per_sec\": %.6g, \"speedup\": %.4g}%s\n",
+            JsonString(r.image).c_str(), r.width, r.height, JsonString(r.codec).c_str(), JsonString(r.api).c_str(),
+            JsonString(FormatFlags(r.flags)).c_str(), r.flags, r.threads, r.blocks, r.iterations, r.seconds,
+            double(r.blocks) / r.seconds, double(r.width * r.height) / r.seconds * 1e-6, r.speedup,
+            (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+
+    const bool bOK = !ferror(pFile);
+    return (fclose(pFile) == 0) && bOK;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<CorpusImage> corpus;
+    if (options.bSynthetic)
+        corpus = BuildSyntheticCorpus(options.size);
+    for (const std::string& spec : options.raws)
+    {
+        CorpusImage image;
+        std::string error;
+        if (!LoadRawImage(spec.c_str(), image, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        corpus.push_back(std::move(image));
+    }
+
+    Bench bench(options);
+    for (const CorpusImage& image : corpus)
+    {
+        if (!Contains(options.images, image.name))
+            continue;
+
+        const Workload work = PrepareWorkload(image);
+        for (const CodecInfo& codec : GetCodecs())
+        {
+            if (Contains(options.codecs, codec.name))
+                bench.Run(work, codec);
+        }
+    }
+
+    if (!options.jsonPath.empty() && !WriteJson(options.jsonPath.c_str(), options, bench.GetResults()))
+    {
+        fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+        return 1;
+    }
+
+    return 0;
+}
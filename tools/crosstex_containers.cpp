@@ -0,0 +1,462 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "crosstex/DDS.hpp"
+#include "crosstex/KTX2.hpp"
+#include "crosstex/Surface.hpp"
+
+using namespace Tex;
+
+
+//-------------------------------------------------------------------------------------
+// crosstex_containers: DDS and KTX2 round trips and damaged files
+//
+// Textures with full mip chains, cube maps among them, are written through
+// DDSWriter and KTX2Writer with every supercompression scheme of the build and
+// read back through DDSReader, ReadDDSHeader and KTX2Reader. Every surface is
+// filled with a pattern of its own, so a surface read from the wrong place
+// shows up. The files are then truncated and their headers and level indices
+// damaged one field at a time, and every reader has to reject them. The KTX2
+// data format descriptors of BC1, BC3 and BC7 are compared with the ones the
+// specification gives. Exits with an error when any check fails.
+//-------------------------------------------------------------------------------------
+
+namespace {
+
+struct Case
+{
+    const char *name;
+    TextureDesc desc;
+};
+
+size_t g_nChecks = 0;
+size_t g_nFailed = 0;
+
+void Check(bool bOk, const char *what, const char *name)
+{
+    ++g_nChecks;
+    if (!bOk)
+    {
+        printf("FAIL  %-14s %s\n", name, what);
+        ++g_nFailed;
+    }
+}
+
+void PrintUsage()
+{
+    printf(
+        "usage: crosstex_containers [options]\n"
+        "  --dir PATH    directory for the scratch files (.)\n");
+}
+
+void StoreLE32(uint8_t *p, uint32_t v)
+{
+    for (size_t i = 0; i < 4; ++i)
+        p[i] = uint8_t(v >> (8 * i));
+}
+
+void StoreLE64(uint8_t *p, uint64_t v)
+{
+    StoreLE32(p, uint32_t(v));
+    StoreLE32(p + 4, uint32_t(v >> 32));
+}
+
+uint64_t LoadLE64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (size_t i = 8; i-- > 0;)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    FILE *pFile = fopen(path.c_str(), "rb");
+    if (!pFile)
+        return false;
+
+    data.clear();
+    uint8_t aBuffer[65536];
+    size_t uRead;
+    while ((uRead = fread(aBuffer, 1, sizeof(aBuffer), pFile)) > 0)
+        data.insert(data.end(), aBuffer, aBuffer + uRead);
+    fclose(pFile);
+    return true;
+}
+
+bool WriteFile(const std::string& path, const uint8_t *pData, size_t size)
+{
+    FILE *pFile = fopen(path.c_str(), "wb");
+    if (!pFile)
+        return false;
+    const bool bOk = fwrite(pData, 1, size, pFile) == size;
+    return (fclose(pFile) == 0) && bOk;
+}
+
+// Bytes no other surface of the texture holds at the same position
+void FillSurface(uint8_t *pDst, size_t size, size_t item, size_t level)
+{
+    uint32_t uState = uint32_t(item * 977 + level * 131 + 1);
+    for (size_t i = 0; i < size; ++i)
+    {
+        uState = uState * 1664525u + 1013904223u;
+        pDst[i] = uint8_t(uState >> 24);
+    }
+}
+
+bool SurfaceMatches(const uint8_t *pSrc, size_t size, size_t item, size_t level)
+{
+    std::vector<uint8_t> expected(size);
+    FillSurface(expected.data(), size, item, level);
+    return pSrc && memcmp(pSrc, expected.data(), size) == 0;
+}
+
+size_t GetLevelSize(const TextureDesc& desc, size_t level)
+{
+    return ComputeSurfaceSize(desc.format, std::max<size_t>(1, desc.width >> level),
+        std::max<size_t>(1, desc.height >> level));
+}
+
+bool SameDesc(const TextureDesc& a, const TextureDesc& b)
+{
+    return a.format == b.format && a.width == b.width && a.height == b.height && a.mipLevels == b.mipLevels
+        && a.arraySize == b.arraySize && a.cubeMap == b.cubeMap && a.srgb == b.srgb;
+}
+
+template <typename Reader>
+bool AllSurfacesMatch(const Reader& reader, const TextureDesc& desc)
+{
+    for (size_t item = 0; item < desc.arraySize; ++item)
+    {
+        for (size_t level = 0; level < desc.mipLevels; ++level)
+        {
+            if (!SurfaceMatches(reader.GetSurface(item, level), GetLevelSize(desc, level), item, level))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Sizes to cut a file of the given size to: inside the fixed header, inside the
+// variable part of the header and a few bytes short of the end
+std::vector<size_t> TruncatedSizes(size_t size, size_t headerSize)
+{
+    return { 0, 4, 60, headerSize - 1, headerSize, (headerSize + size) / 2, size - 1 };
+}
+
+//-------------------------------------------------------------------------------------
+// DDS
+//-------------------------------------------------------------------------------------
+
+void TestDDS(const Case& c, const std::string& dir)
+{
+    const std::string path = dir + "/crosstex_containers.dds";
+    const std::string damagedPath = dir + "/crosstex_containers_damaged.dds";
+
+    DDSWriter writer;
+    Check(writer.Create(path.c_str(), c.desc), "DDSWriter::Create", c.name);
+    const TextureDesc desc = writer.GetDesc();
+    for (size_t item = 0; item < desc.arraySize; ++item)
+    {
+        for (size_t level = 0; level < desc.mipLevels; ++level)
+            FillSurface(writer.GetSurface(item, level), GetLevelSize(desc, level), item, level);
+    }
+    Check(writer.Close(), "DDSWriter::Close", c.name);
+
+    DDSReader reader;
+    Check(reader.Open(path.c_str()), "DDSReader::Open", c.name);
+    Check(SameDesc(reader.GetDesc(), desc), "DDSReader desc", c.name);
+    Check(AllSurfacesMatch(reader, desc), "DDSReader surfaces", c.name);
+    reader.Close();
+
+    std::vector<uint8_t> file;
+    Check(ReadFile(path, file) && file.size() == ComputeDDSSize(desc), "DDS file size", c.name);
+    TextureDesc parsed = {};
+    size_t headerSize = 0;
+    Check(ReadDDSHeader(file.data(), file.size(), parsed, &headerSize) && SameDesc(parsed, desc)
+        && headerSize == GetDDSHeaderSize(desc), "ReadDDSHeader", c.name);
+    Check(GetDDSSurfaceOffset(desc, desc.arraySize - 1, desc.mipLevels - 1)
+        + GetLevelSize(desc, desc.mipLevels - 1) == file.size(), "GetDDSSurfaceOffset", c.name);
+
+    for (size_t size : TruncatedSizes(file.size(), headerSize))
+    {
+        Check(!ReadDDSHeader(file.data(), size, parsed), "ReadDDSHeader accepted a truncated file", c.name);
+        Check(WriteFile(damagedPath, file.data(), size) && !reader.Open(damagedPath.c_str()),
+            "DDSReader accepted a truncated file", c.name);
+    }
+
+    // Fields at byte offsets into the header, each damaged on its own
+    struct Damage
+    {
+        size_t uOffset;
+        uint32_t uValue;
+        const char *what;
+    };
+    const bool bDX10 = headerSize > 128;
+    const uint32_t uArraySize = uint32_t(desc.cubeMap ? desc.arraySize / 6 : desc.arraySize);
+    std::vector<Damage> damages =
+    {
+        { 0, 0x20534445, "bad magic" },
+        { 4, 120, "bad header size" },
+        { 12, uint32_t(desc.height * 2), "height past the data" },
+        { 16, uint32_t(desc.width * 2), "width past the data" },
+        { 28, uint32_t(desc.mipLevels + 1), "mip count past the data" },
+        { 28, 40, "mip count past the chain" },
+        { 76, 24, "bad pixel format size" },
+    };
+    if (bDX10)
+    {
+        damages.push_back({ 128, 28, "unsupported DXGI format" });
+        damages.push_back({ 132, 4, "3D texture" });
+        damages.push_back({ 140, 0, "empty array" });
+        damages.push_back({ 140, uArraySize + 1, "array size past the data" });
+    }
+    else
+    {
+        damages.push_back({ 84, 0x58585858, "unknown FourCC" });
+        if (desc.cubeMap)
+            damages.push_back({ 112, 0x200 | 0x1c00, "cube map missing faces" });
+    }
+
+    for (const Damage& damage : damages)
+    {
+        std::vector<uint8_t> damaged = file;
+        StoreLE32(damaged.data() + damage.uOffset, damage.uValue);
+        const std::string what = std::string("accepted ") + damage.what;
+        Check(!ReadDDSHeader(damaged.data(), damaged.size(), parsed), ("ReadDDSHeader " + what).c_str(), c.name);
+        Check(WriteFile(damagedPath, damaged.data(), damaged.size()) && !reader.Open(damagedPath.c_str()),
+            ("DDSReader " + what).c_str(), c.name);
+    }
+
+    remove(path.c_str());
+    remove(damagedPath.c_str());
+}
+
+//-------------------------------------------------------------------------------------
+// KTX2
+//-------------------------------------------------------------------------------------
+
+const size_t KTX2_HEADER_SIZE = 80;
+const size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+void TestKTX2(const Case& c, KTX2_SUPERCOMPRESSION scheme, const std::string& dir)
+{
+    const std::string path = dir + "/crosstex_containers.ktx2";
+    const std::string damagedPath = dir + "/crosstex_containers_damaged.ktx2";
+    const std::string name = std::string(c.name) + (scheme == KTX2_SUPERCOMPRESSION_ZLIB ? "/zlib" : "");
+
+    KTX2Writer writer;
+    Check(writer.Create(path.c_str(), c.desc, scheme), "KTX2Writer::Create", name.c_str());
+    const TextureDesc desc = writer.GetDesc();
+    for (size_t item = 0; item < desc.arraySize; ++item)
+    {
+        for (size_t level = 0; level < desc.mipLevels; ++level)
+            FillSurface(writer.GetSurface(item, level), GetLevelSize(desc, level), item, level);
+    }
+    Check(writer.Close(), "KTX2Writer::Close", name.c_str());
+
+    KTX2Reader reader;
+    Check(reader.Open(path.c_str()), "KTX2Reader::Open", name.c_str());
+    Check(SameDesc(reader.GetDesc(), desc), "KTX2Reader desc", name.c_str());
+    Check(reader.GetSupercompression() == scheme, "KTX2Reader supercompression", name.c_str());
+    Check(AllSurfacesMatch(reader, desc), "KTX2Reader surfaces", name.c_str());
+    reader.Close();
+
+    std::vector<uint8_t> file;
+    Check(ReadFile(path, file) && file.size() > KTX2_HEADER_SIZE, "KTX2 file", name.c_str());
+    const size_t indexEnd = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_ENTRY_SIZE * desc.mipLevels;
+    for (size_t size : TruncatedSizes(file.size(), indexEnd))
+    {
+        Check(WriteFile(damagedPath, file.data(), size) && !reader.Open(damagedPath.c_str()),
+            "KTX2Reader accepted a truncated file", name.c_str());
+    }
+
+    // Every field of every level index entry, damaged on its own
+    for (size_t level = 0; level < desc.mipLevels; ++level)
+    {
+        const size_t uEntry = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_ENTRY_SIZE * level;
+        const uint64_t uOffset = LoadLE64(file.data() + uEntry);
+        const uint64_t uLength = LoadLE64(file.data() + uEntry + 8);
+        const uint64_t uUncompressed = LoadLE64(file.data() + uEntry + 16);
+
+        struct Damage
+        {
+            size_t uField;
+            uint64_t uValue;
+            const char *what;
+        };
+        const Damage damages[] =
+        {
+            { 0, file.size(), "level offset at the end" },
+            { 0, file.size() - uLength + 1, "level running past the end" },
+            { 0, 0, "level inside the header" },
+            { 0, uOffset + 1, "misaligned level" },
+            { 8, uLength + 1, "level length" },
+            { 8, uLength - 1, "short level" },
+            { 8, UINT64_MAX, "huge level length" },
+            { 16, uUncompressed + GetLevelSize(desc, level), "uncompressed length" },
+            { 16, uUncompressed - 1, "uncompressed length off by one" },
+            { 16, 0, "empty level" },
+        };
+
+        for (const Damage& damage : damages)
+        {
+            // Moving a supercompressed level by a byte is not always detectable,
+            // zlib streams can start at odd offsets
+            if (damage.uField == 0 && damage.uValue == uOffset + 1 && scheme != KTX2_SUPERCOMPRESSION_NONE)
+                continue;
+
+            std::vector<uint8_t> damaged = file;
+            StoreLE64(damaged.data() + uEntry + damage.uField, damage.uValue);
+            char aWhat[96];
+            snprintf(aWhat, sizeof(aWhat), "KTX2Reader accepted level %zu: %s", level, damage.what);
+            Check(WriteFile(damagedPath, damaged.data(), damaged.size()) && !reader.Open(damagedPath.c_str()),
+                aWhat, name.c_str());
+        }
+    }
+
+    // Level count past the index
+    {
+        std::vector<uint8_t> damaged = file;
+        StoreLE32(damaged.data() + 40, uint32_t(desc.mipLevels + 1));
+        Check(WriteFile(damagedPath, damaged.data(), damaged.size()) && !reader.Open(damagedPath.c_str()),
+            "KTX2Reader accepted a level count past the index", name.c_str());
+    }
+
+    remove(path.c_str());
+    remove(damagedPath.c_str());
+}
+
+// Data format descriptors as the Khronos Data Format specification spells them
+// out for the vkFormats of BC1 (RGBA), BC3 and BC7, in 32-bit words
+struct DFDCase
+{
+    const char *name;
+    BC_FORMAT format;
+    bool srgb;
+    std::vector<uint32_t> words;
+};
+
+const uint32_t KHR_DF_SAMPLE_UNORM_UPPER = 0xffffffff;
+
+std::vector<DFDCase> GetDFDCases()
+{
+    return
+    {
+        { "dfd_bc1", BC_FORMAT_BC1, false, {
+            44, 0, 2 | (40 << 16), 128 | (1 << 8) | (1 << 16), 3 | (3 << 8), 8, 0,
+            0 | (63 << 16) | (1u << 24), 0, 0, KHR_DF_SAMPLE_UNORM_UPPER } },
+        { "dfd_bc3_srgb", BC_FORMAT_BC3, true, {
+            60, 0, 2 | (56 << 16), 130 | (1 << 8) | (2 << 16), 3 | (3 << 8), 16, 0,
+            0 | (63 << 16) | (15u << 24), 0, 0, KHR_DF_SAMPLE_UNORM_UPPER,
+            64 | (63 << 16) | (0u << 24), 0, 0, KHR_DF_SAMPLE_UNORM_UPPER } },
+        { "dfd_bc7", BC_FORMAT_BC7, false, {
+            44, 0, 2 | (40 << 16), 134 | (1 << 8) | (1 << 16), 3 | (3 << 8), 16, 0,
+            0 | (127 << 16) | (0u << 24), 0, 0, KHR_DF_SAMPLE_UNORM_UPPER } },
+    };
+}
+
+uint32_t LoadLE32(const uint8_t *p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// The reader ignores the descriptor, so it is compared byte for byte. Planes of
+// supercompressed files are unsized.
+void TestDFD(const DFDCase& c, KTX2_SUPERCOMPRESSION scheme, const std::string& dir)
+{
+    const std::string path = dir + "/crosstex_containers_dfd.ktx2";
+    const std::string name = std::string(c.name) + (scheme == KTX2_SUPERCOMPRESSION_ZLIB ? "/zlib" : "");
+
+    TextureDesc desc = {};
+    desc.format = c.format;
+    desc.width = 4;
+    desc.height = 4;
+    desc.mipLevels = 1;
+    desc.arraySize = 1;
+    desc.srgb = c.srgb;
+
+    KTX2Writer writer;
+    Check(writer.Create(path.c_str(), desc, scheme) && writer.Close(), "KTX2Writer", name.c_str());
+
+    std::vector<uint32_t> expected = c.words;
+    if (scheme != KTX2_SUPERCOMPRESSION_NONE)
+        expected[5] = 0;
+
+    std::vector<uint8_t> file;
+    bool bOk = ReadFile(path, file) && file.size() > KTX2_HEADER_SIZE;
+    const size_t uOffset = bOk ? LoadLE32(file.data() + 48) : 0;
+    const size_t uLength = bOk ? LoadLE32(file.data() + 52) : 0;
+    bOk = bOk && uLength == expected.size() * 4 && uOffset <= file.size() && uLength <= file.size() - uOffset;
+    for (size_t i = 0; bOk && i < expected.size(); ++i)
+        bOk = LoadLE32(file.data() + uOffset + 4 * i) == expected[i];
+    Check(bOk, "data format descriptor", name.c_str());
+
+    remove(path.c_str());
+}
+
+TextureDesc MakeDesc(BC_FORMAT format, size_t width, size_t height, size_t arraySize, bool cubeMap, bool srgb)
+{
+    TextureDesc desc = {};
+    desc.format = format;
+    desc.width = width;
+    desc.height = height;
+    desc.mipLevels = 0;
+    desc.arraySize = arraySize;
+    desc.cubeMap = cubeMap;
+    desc.srgb = srgb;
+    return desc;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = ".";
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc)
+            dir = argv[++i];
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    // Full mip chains: a cube map array with the DX10 header, a single legacy
+    // cube map with odd sized levels and a plain texture
+    const Case aCases[] =
+    {
+        { "bc7_cube_array", MakeDesc(BC_FORMAT_BC7, 64, 64, 12, true, true) },
+        { "bc1_cube", MakeDesc(BC_FORMAT_BC1, 40, 40, 6, true, false) },
+        { "bc4_2d", MakeDesc(BC_FORMAT_BC4U, 48, 20, 1, false, false) },
+    };
+
+    for (const Case& c : aCases)
+    {
+        TestDDS(c, dir);
+        TestKTX2(c, KTX2_SUPERCOMPRESSION_NONE, dir);
+        if (IsKTX2SupercompressionSupported(KTX2_SUPERCOMPRESSION_ZLIB))
+            TestKTX2(c, KTX2_SUPERCOMPRESSION_ZLIB, dir);
+        else
+            printf("skip  %-14s zlib supercompression is not built in\n", c.name);
+    }
+
+    for (const DFDCase& c : GetDFDCases())
+    {
+        TestDFD(c, KTX2_SUPERCOMPRESSION_NONE, dir);
+        if (IsKTX2SupercompressionSupported(KTX2_SUPERCOMPRESSION_ZLIB))
+            TestDFD(c, KTX2_SUPERCOMPRESSION_ZLIB, dir);
+    }
+
+    printf("%zu checks, %zu failed\n", g_nChecks, g_nFailed);
+    return g_nFailed ? 1 : 0;
+}
@@ -0,0 +1,436 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "crosstex/BC.hpp"
+#include "crosstex/Surface.hpp"
+#include "Codecs.hpp"
+#include "Corpus.hpp"
+
+using namespace Tex;
+
+
+//-------------------------------------------------------------------------------------
+// crosstex_quality: encode quality next to encode time
+//
+// Every corpus image is encoded with every flag set of every codec through
+// EncodeSurface and decoded block by block with the Decode* functions. The
+// error is measured per channel against the input, clamped to the range the
+// codec can store; BC6H errors are taken on log2(1 + x) so highlights do not
+// swamp the rest of the image. With --baseline the run fails when the PSNR of
+// any case drops more than --tolerance dB below the stored value.
+//-------------------------------------------------------------------------------------
+
+namespace {
+
+const char *BASELINE_HEADER = "# crosstex_quality baseline";
+
+struct Options
+{
+    size_t size = 64;
+    size_t threads = 0;
+    double tolerance = 0.05;
+    bool bAllFlags = true;
+    bool bSynthetic = true;
+    std::vector<std::string> images;
+    std::vector<std::string> codecs;
+    std::vector<std::string> raws;
+    std::string baselinePath;
+    std::string writeBaselinePath;
+};
+
+struct Result
+{
+    std::string key;        // "image codec flags"
+    std::string codec;
+    std::string flags;
+    size_t channels;
+    double rmse[4];
+    double psnr;
+    double seconds;
+};
+
+void PrintUsage()
+{
+    printf(
+        "usage: crosstex_quality [options]\n"
+        "  --size N              edge of the synthetic images (64)\n"
+        "  --image NAME          only this corpus image, repeatable\n"
+        "  --raw SPEC            add path:WIDTHxHEIGHT:rgba8|rgba16f|rgba32f, repeatable\n"
+        "  --no-synthetic        skip the synthetic corpus\n"
+        "  --default-flags       only the default flags instead of every set\n"
+        "  --codec NAME          only this codec (bc1 ... bc7), repeatable\n"
+        "  --threads N           encoder threads, 0 for all (0)\n"
+        "  --baseline PATH       fail when PSNR drops below the values stored in PATH\n"
+        "  --tolerance DB        allowed PSNR drop against the baseline (0.05)\n"
+        "  --write-baseline PATH store this run as a baseline\n");
+}
+
+bool Contains(const std::vector<std::string>& list, const std::string& value)
+{
+    return list.empty() || std::find(list.begin(), list.end(), value) != list.end();
+}
+
+bool ParseOptions(int argc, char **argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            exit(0);
+        }
+        else if (arg == "--no-synthetic")
+            options.bSynthetic = false;
+        else if (arg == "--default-flags")
+            options.bAllFlags = false;
+        else if (i + 1 >= argc)
+        {
+            fprintf(stderr, "unknown option or missing value: %s\n", arg.c_str());
+            return false;
+        }
+        else if (arg == "--size")
+            options.size = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--image")
+            options.images.push_back(argv[++i]);
+        else if (arg == "--raw")
+            options.raws.push_back(argv[++i]);
+        else if (arg == "--codec")
+            options.codecs.push_back(argv[++i]);
+        else if (arg == "--threads")
+            options.threads = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--baseline")
+            options.baselinePath = argv[++i];
+        else if (arg == "--tolerance")
+            options.tolerance = strtod(argv[++i], nullptr);
+        else if (arg == "--write-baseline")
+            options.writeBaselinePath = argv[++i];
+        else
+        {
+            fprintf(stderr, "unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (options.size == 0)
+    {
+        fprintf(stderr, "--size must be positive\n");
+        return false;
+    }
+
+    for (const std::string& name : options.codecs)
+    {
+        if (!FindCodec(name.c_str()))
+        {
+            fprintf(stderr, "unknown codec: %s\n", name.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Maps a channel value into the space the error is measured in
+float Reference(const CodecInfo& codec, float f)
+{
+    switch (codec.format)
+    {
+    case BC_FORMAT_BC6HU:
+        return log2f(1.0f + std::max(f, 0.0f));
+    case BC_FORMAT_BC6HS:
+        return (f < 0.0f) ? -log2f(1.0f - f) : log2f(1.0f + f);
+    case BC_FORMAT_BC4S:
+    case BC_FORMAT_BC5S:
+        return std::min(std::max(f, -1.0f), 1.0f);
+    default:
+        return std::min(std::max(f, 0.0f), 1.0f);
+    }
+}
+
+Result Measure(const CorpusImage& image, const CodecInfo& codec, uint32_t flags, size_t uThreads)
+{
+    const size_t blocksWide = (image.width + 3) / 4;
+    const size_t blocksHigh = (image.height + 3) / 4;
+    std::vector<uint8_t> compressed(blocksWide * blocksHigh * codec.blockSize);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    EncodeSurface(codec.format, image.texels.data(), image.width, image.height,
+        image.width * sizeof(HDRColorA), compressed.data(), flags, uThreads);
+
+    Result result = {};
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.codec = codec.name;
+    result.flags = FormatFlags(flags);
+    result.key = image.name + " " + result.codec + " " + result.flags;
+    // BC1 alpha is a 1-bit cutout; its error would hide any change in the color
+    result.channels = (codec.format == BC_FORMAT_BC1) ? 3 : codec.channels;
+
+    // Only the texels inside the image count, edge blocks replicate them
+    double aSum[4] = {};
+    size_t aCount[4] = {};
+    double peak = 0.0;
+    HDRColorA aBlock[NUM_PIXELS_PER_BLOCK];
+    for (size_t by = 0; by < blocksHigh; ++by)
+    {
+        for (size_t bx = 0; bx < blocksWide; ++bx)
+        {
+            codec.pfDecode(aBlock, &compressed[(by * blocksWide + bx) * codec.blockSize]);
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                const size_t x = bx * 4 + (i & 3);
+                const size_t y = by * 4 + (i >> 2);
+                if (x >= image.width || y >= image.height)
+                    continue;
+
+                // BC1 stores no color for texels it makes transparent
+                const HDRColorA& src = image.texels[y * image.width + x];
+                if (codec.format == BC_FORMAT_BC1 && aBlock[i].a == 0.0f && src.a < 0.5f)
+                    continue;
+
+                for (size_t ch = 0; ch < result.channels; ++ch)
+                {
+                    const float ref = Reference(codec, (&src.r)[ch]);
+                    const double d = double(Reference(codec, (&aBlock[i].r)[ch])) - double(ref);
+                    aSum[ch] += d * d;
+                    ++aCount[ch];
+                    peak = std::max(peak, double(fabsf(ref)));
+                }
+            }
+        }
+    }
+
+    double total = 0.0;
+    size_t nTotal = 0;
+    for (size_t ch = 0; ch < result.channels; ++ch)
+    {
+        result.rmse[ch] = aCount[ch] ? sqrt(aSum[ch] / double(aCount[ch])) : 0.0;
+        total += aSum[ch];
+        nTotal += aCount[ch];
+    }
+
+    // LDR codecs use the full range as the peak, BC6H the brightest texel
+    if (!codec.bHDR)
+        peak = 1.0;
+    const double rmse = nTotal ? sqrt(total / double(nTotal)) : 0.0;
+    result.psnr = (rmse > 0.0) ? 20.0 * log10(std::max(peak, 1e-6) / rmse) : 999.0;
+    return result;
+}
+
+void PrintResult(const Result& result, const char *pNote)
+{
+    printf("%-42s %8.3fs  rmse", result.key.c_str(), result.seconds);
+    for (size_t ch = 0; ch < 4; ++ch)
+    {
+        if (ch < result.channels)
+            printf(" %.5f", result.rmse[ch]);
+        else
+            printf("       -");
+    }
+    printf("  psnr %7.3f%s\n", result.psnr, pNote);
+}
+
+bool ReadBaseline(const char *path, size_t size, std::map<std::string, double>& baseline)
+{
+    FILE *pFile = fopen(path, "r");
+    if (!pFile)
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+
+    char aLine[512];
+    bool bOK = true;
+    unsigned long uSize = 0;
+    if (!fgets(aLine, sizeof(aLine), pFile)
+        || strncmp(aLine, BASELINE_HEADER, strlen(BASELINE_HEADER)) != 0
+        || sscanf(aLine + strlen(BASELINE_HEADER), " size %lu", &uSize) != 1)
+    {
+        fprintf(stderr, "%s is not a crosstex_quality baseline\n", path);
+        bOK = false;
+    }
+    else if (uSize != size)
+    {
+        fprintf(stderr, "%s was written for --size %lu\n", path, uSize);
+        bOK = false;
+    }
+
+    while (bOK && fgets(aLine, sizeof(aLine), pFile))
+    {
+        char aImage[128];
+        char aCodec[32];
+        char aFlags[128];
+        double psnr;
+        if (aLine[0] == '#' || aLine[0] == '\n')
+            continue;
+        if (sscanf(aLine, "%127s %31s %127s %lf", aImage, aCodec, aFlags, &psnr) != 4)
+        {
+            fprintf(stderr, "%s: bad line: %s", path, aLine);
+            bOK = false;
+            break;
+        }
+        baseline[std::string(aImage) + " " + aCodec + " " + aFlags] = psnr;
+    }
+
+    fclose(pFile);
+    return bOK;
+}
+
+bool WriteBaseline(const char *path, size_t size, const std::vector<Result>& results)
+{
+    FILE *pFile = fopen(path, "w");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "%s size %zu\n# image codec flags psnr rmse_r rmse_g rmse_b rmse_a\n", BASELINE_HEADER, size);
+    for (const Result& result : results)
+    {
+        fprintf(pFile, "%s %.4f", result.key.c_str(), result.psnr);
+        for (size_t ch = 0; ch < 4; ++ch)
+        {
+            if (ch < result.channels)
+                fprintf(pFile, " %.6f", result.rmse[ch]);
+            else
+                fprintf(pFile, " -");
+        }
+        fprintf(pFile, "\n");
+    }
+
+    const bool bOK = !ferror(pFile);
+    return (fclose(pFile) == 0) && bOK;
+}
+
+// Mean PSNR and total time of each codec and flag set over all images, the
+// points to compare effort levels on
+void PrintSummary(const std::vector<Result>& results)
+{
+    struct Point
+    {
+        std::string codec;
+        std::string flags;
+        double psnr;
+        double seconds;
+        size_t count;
+    };
+
+    std::vector<Point> points;
+    for (const Result& result : results)
+    {
+        auto it = std::find_if(points.begin(), points.end(), [&](const Point& p)
+        {
+            return p.codec == result.codec && p.flags == result.flags;
+        });
+        if (it == points.end())
+        {
+            points.push_back(Point{ result.codec, result.flags, 0.0, 0.0, 0 });
+            it = points.end() - 1;
+        }
+        it->psnr += result.psnr;
+        it->seconds += result.seconds;
+        ++it->count;
+    }
+
+    printf("\n%-6s %-40s %10s %10s\n", "codec", "flags", "seconds", "mean psnr");
+    for (const Point& p : points)
+        printf("%-6s %-40s %10.3f %10.3f\n", p.codec.c_str(), p.flags.c_str(), p.seconds, p.psnr / double(p.count));
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baselinePath.empty() && !ReadBaseline(options.baselinePath.c_str(), options.size, baseline))
+        return 2;
+
+    std::vector<CorpusImage> corpus;
+    if (options.bSynthetic)
+        corpus = BuildSyntheticCorpus(options.size);
+    for (const std::string& spec : options.raws)
+    {
+        CorpusImage image;
+        std::string error;
+        if (!LoadRawImage(spec.c_str(), image, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        corpus.push_back(std::move(image));
+    }
+
+    std::vector<Result> results;
+    size_t nFailed = 0;
+    size_t nMissing = 0;
+    for (const CorpusImage& image : corpus)
+    {
+        if (!Contains(options.images, image.name))
+            continue;
+
+        for (const CodecInfo& codec : GetCodecs())
+        {
+            if (!Contains(options.codecs, codec.name))
+                continue;
+
+            std::vector<uint32_t> flagSets = GetFlagSets(codec.format);
+            if (!options.bAllFlags)
+                flagSets.resize(1);
+
+            for (uint32_t flags : flagSets)
+            {
+                const Result result = Measure(image, codec, flags, options.threads);
+                results.push_back(result);
+
+                char aNote[64] = "";
+                if (!baseline.empty())
+                {
+                    auto it = baseline.find(result.key);
+                    if (it == baseline.end())
+                    {
+                        snprintf(aNote, sizeof(aNote), "  (not in baseline)");
+                        ++nMissing;
+                    }
+                    else
+                    {
+                        const double delta = result.psnr - it->second;
+                        const bool bFail = delta < -options.tolerance;
+                        snprintf(aNote, sizeof(aNote), "  %+.3f%s", delta, bFail ? "  FAIL" : "");
+                        nFailed += bFail ? 1 : 0;
+                    }
+                }
+                PrintResult(result, aNote);
+            }
+        }
+    }
+
+    PrintSummary(results);
+
+    if (!options.writeBaselinePath.empty() && !WriteBaseline(options.writeBaselinePath.c_str(), options.size, results))
+    {
+        fprintf(stderr, "cannot write %s\n", options.writeBaselinePath.c_str());
+        return 2;
+    }
+
+    if (!baseline.empty())
+    {
+        printf("\n%zu cases, %zu below baseline by more than %.3f dB, %zu not in baseline\n",
+            results.size(), nFailed, options.tolerance, nMissing);
+    }
+
+    return nFailed ? 1 : 0;
+}